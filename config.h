@@ -0,0 +1,27 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2010  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define PACKAGE_NAME "PPPlay"
+#define PACKAGE_BUGREPORT "steffen.ohrendorf@gmx.de"
+#define PACKAGE_VENDOR "Steffen Ohrendorf <steffen.ohrendorf@gmx.de>"
+#define PACKAGE_STRING "PPPlay 0.2.0-alpha0"
+#define PACKAGE_VERSION "0.2.0-alpha0"
+#define VERSION "0.2.0-alpha0"
+
+/* #undef WITH_MP3LAME */
+/* #undef WITH_OGG */
@@ -25,6 +25,8 @@
 
 #include "src/output/sdlaudiooutput.h"
 #include "src/output/wavaudiooutput.h"
+#include "src/output/flacaudiooutput.h"
+#include "src/output/streamaudiooutput.h"
 
 #ifdef WITH_MP3LAME
 #include "src/output/mp3audiooutput.h"
@@ -40,10 +42,16 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/filesystem.hpp>
+#include <fstream>
 #include <memory>
+#include <vector>
 #include "light4cxx/logger.h"
 
 #include "src/stuff/pluginregistry.h"
+#include "src/stuff/profiler.h"
+#include "src/genmod/samplecache.h"
+#include "src/genmod/playlist.h"
+#include "src/genmod/segmentrenderer.h"
 #include "src/stuff/system.h"
 
 #include <SDL2/SDL.h>
@@ -60,9 +68,18 @@ namespace config
 bool noGUI = false;
 uint16_t maxRepeat = 2;
 std::string filename;
+std::vector<std::string> filenames;
 std::string outputFilename;
+bool rawOutput = false;
 ppp::Sample::Interpolation interpolation = ppp::Sample::Interpolation::Hermite;
 int loglevel = 1;
+bool profile = false;
+std::string profileFilename;
+bool parallel = false;
+size_t jobs = 0;
+size_t period = 0;
+size_t preload = 2;
+size_t preloadBudget = 0;
 }
 
 void loadUserConfig()
@@ -112,19 +129,41 @@ bool parseCmdLine(int argc, char* argv[])
            ( "log-level,l",
              boost::program_options::value<int>( &config::loglevel )->default_value( config::loglevel ),
              "Sets the log level. Possible values:\n - 0 No logging\n - 1 Errors\n - 2 Warnings\n - 3 Informational\n - 4 Debug\n - 5 Trace\nWhen an invalid level is passed, it will automatically be set to 'Trace'. Levels 4 and 5 will also produce a more verbose output." )
-           ( "no-gui,n", "No GUI" );
+           ( "no-gui,n", "No GUI" )
+           ( "profile",
+             boost::program_options::value<std::string>( &config::profileFilename )->implicit_value( std::string() ),
+             "Profile the rendering stages and print a summary when done. If a file name is given, e.g. --profile=out.json, the measurements are also written to it as JSON, or as CSV if the name ends with .csv." )
+           ( "sample-cache",
+             boost::program_options::value<size_t>()->implicit_value( 0 ),
+             "Memory-map the module and decode XM/IT samples when they are first played. An optional budget in MiB, e.g. --sample-cache=64, limits the memory of the decoded samples; samples that were not played recently are dropped and decoded again when needed." )
+           ( "jobs,j",
+             boost::program_options::value<size_t>( &config::jobs )->implicit_value( 0 ),
+             "Render the song on multiple threads when writing a file or a stream. An optional number of threads, e.g. --jobs=4, defaults to the number of hardware threads. Only IT modules are split up; other formats are still rendered on a single thread. Cannot be used when streaming several files. Also sets the number of FLAC encoder threads." )
+           ( "low-latency",
+             boost::program_options::value<size_t>( &config::period )->implicit_value( 256 ),
+             "Play back with as little buffering as possible, e.g. for previewing. An optional device period in frames between 64 and 8192, e.g. --low-latency=512, defaults to 256. The buffering grows when the audio drops out, and the buffering statistics are logged every second at the informational log level." );
   boost::program_options::options_description ioOpts( "Input/Output Options" );
   ioOpts.add_options()
           ( "max-repeat,m",
             boost::program_options::value<uint16_t>( &config::maxRepeat )->default_value( config::maxRepeat ),
             "Maximum repeat count (the number of times an order can be played). Specify a number between 1 and 10,000." )
-          ( "file,f", boost::program_options::value<std::string>( &config::filename ), "Module file to play" )
+          ( "file,f",
+            boost::program_options::value<std::vector<std::string>>( &config::filenames ),
+            "Module file to play, or an archive whose modules are played; several files are played one after another without a gap when playing back or streaming" )
+          ( "preload",
+            boost::program_options::value<size_t>( &config::preload )->default_value( config::preload ),
+            "Number of the following files that are loaded in the background while playing several files" )
+          ( "preload-budget",
+            boost::program_options::value<size_t>( &config::preloadBudget )->default_value( config::preloadBudget ),
+            "Memory in MiB the files loaded in the background may take, estimated from their file sizes, or 0 for no limit. The next file is always loaded." )
           ( "output,o",
             boost::program_options::value<std::string>( &config::outputFilename )->default_value( std::string() ),
-            "Set mp3/wav filename" )
+            "Set mp3/ogg/wav/flac filename, or stream WAV data to stdout with '-' or to an inherited file descriptor with 'fd:N'" )
+          ( "raw", "Stream raw 16-bit stereo PCM at 44100 Hz instead of WAV data when streaming to stdout or a file descriptor" )
           ( "interpolation,i",
             boost::program_options::value<int>()->default_value( int( config::interpolation ) ),
-            "Set interpolation mode:\n - 0 No interpolation\n - 1 Linear interpolation\n - 2 Cubic interpolation" );
+            "Set interpolation mode:\n - 0 No interpolation\n - 1 Linear interpolation\n - 2 Cubic interpolation\n"
+            " - 3 Hermite interpolation\n - 4 Windowed sinc interpolation" );
   boost::program_options::positional_options_description p;
   p.add( "file", -1 );
 
@@ -136,6 +175,11 @@ bool parseCmdLine(int argc, char* argv[])
                                                                                           .positional( p ).run(), vm );
   boost::program_options::notify( vm );
 
+  if( config::period != 0 && (config::period < 64 || config::period > 8192) )
+  {
+    light4cxx::Logger::root()->warn( L4CXX_LOCATION, "Device period must be between 64 and 8192 frames, using 256" );
+    config::period = 256;
+  }
   if( config::maxRepeat < 1 || config::maxRepeat > 10000 )
   {
     std::cout << "Error: Maximum repeat count not within 1 to 10,000" << std::endl;
@@ -220,7 +264,7 @@ bool parseCmdLine(int argc, char* argv[])
   }
   if( vm.count( "help" ) || !vm.count( "file" ) )
   {
-    cout << "Usage: ppplay [options] <file>" << endl;
+    cout << "Usage: ppplay [options] <file>..." << endl;
     cout << PACKAGE_STRING << ", Copyright (C) 2010-2013 by " << PACKAGE_VENDOR << endl;
     cout << PACKAGE_NAME << " comes with ABSOLUTELY NO WARRANTY; for details type `ppp --warranty'." << endl;
     cout << "This is free software, and you are welcome to redistribute it" << endl;
@@ -228,10 +272,33 @@ bool parseCmdLine(int argc, char* argv[])
     cout << genOpts << ioOpts;
     return false;
   }
+  config::filename = config::filenames.front();
   if( vm.count( "no-gui" ) != 0 )
   {
     config::noGUI = true;
   }
+  if( vm.count( "raw" ) != 0 )
+  {
+    config::rawOutput = true;
+  }
+  if( StreamAudioOutput::parseTarget( config::outputFilename ) == StreamAudioOutput::parseTarget( "-" ) )
+  {
+    // keep stdout clean for the audio data
+    light4cxx::Logger::setOutput( &std::cerr );
+  }
+  if( vm.count( "profile" ) != 0 )
+  {
+    config::profile = true;
+  }
+  if( vm.count( "jobs" ) != 0 )
+  {
+    config::parallel = true;
+  }
+  if( vm.count( "sample-cache" ) != 0 )
+  {
+    ppp::SampleCache::instance().setBudget( vm["sample-cache"].as<size_t>() * 1024 * 1024 );
+    ppp::SampleCache::instance().setEnabled( true );
+  }
   switch( vm["interpolation"].as<int>() )
   {
   case 0:
@@ -250,12 +317,87 @@ bool parseCmdLine(int argc, char* argv[])
     light4cxx::Logger::root()->info( L4CXX_LOCATION, "Sample interpolation: hermite" );
     config::interpolation = ppp::Sample::Interpolation::Hermite;
     break;
+  case 4:
+    light4cxx::Logger::root()->info( L4CXX_LOCATION, "Sample interpolation: sinc" );
+    config::interpolation = ppp::Sample::Interpolation::Sinc;
+    break;
   default:
     light4cxx::Logger::root()->warn( L4CXX_LOCATION, "Invalid interpolation mode requested" );
   }
   return vm.count( "file" ) != 0;
 }
 
+/**
+ * @brief Replace the archives among the files by the modules they contain, and drop unsupported files
+ *
+ * @details
+ * Only the headers are read, so unsupported files are dropped before they reach
+ * the loader threads. Each file is probed once; the members of an archive are
+ * probed by playableMembers() while it decompresses the archive.
+ */
+void expandArchives()
+{
+  std::vector<std::string> expanded;
+  for( const std::string& filename: config::filenames )
+  {
+    if( ppp::tryProbe( filename ) )
+    {
+      expanded.emplace_back( filename );
+      continue;
+    }
+    // members of archives are no regular files
+    boost::system::error_code ec;
+    std::vector<std::string> members;
+    if( boost::filesystem::is_regular_file( filename, ec ) )
+    {
+      members = ppp::playableMembers( filename );
+    }
+    if( members.empty() )
+    {
+      light4cxx::Logger::root()->warn( L4CXX_LOCATION, "'%s' is not a supported module, skipping it", filename );
+      continue;
+    }
+    light4cxx::Logger::root()->info( L4CXX_LOCATION, "Playing %d modules from '%s'", members.size(), filename );
+    expanded.insert( expanded.end(), members.begin(), members.end() );
+  }
+  if( expanded.empty() )
+  {
+    // let the loader report the failure
+    expanded.emplace_back( config::filenames.front() );
+  }
+  config::filenames = std::move( expanded );
+  config::filename = config::filenames.front();
+}
+
+void reportProfile()
+{
+  if( !config::profile )
+  {
+    return;
+  }
+  ppp::profile::setEnabled( false );
+  std::cout << "Profile of '" << config::filename << "':\n";
+  ppp::profile::printSummary( std::cout );
+  if( config::profileFilename.empty() )
+  {
+    return;
+  }
+  std::ofstream dump( config::profileFilename );
+  if( !dump )
+  {
+    light4cxx::Logger::root()->error( L4CXX_LOCATION, "Cannot write profile to '%s'", config::profileFilename );
+    return;
+  }
+  if( boost::iends_with( config::profileFilename, ".csv" ) )
+  {
+    ppp::profile::writeCsv( dump, config::filename );
+  }
+  else
+  {
+    ppp::profile::writeJson( dump, config::filename );
+  }
+}
+
 void terminateHandler()
 {
   std::cerr << "Unexpected exception: " << boost::current_exception_diagnostic_information() << std::endl;
@@ -284,16 +426,49 @@ int main(int argc, char* argv[])
       return EXIT_SUCCESS;
     }
     SDL_Init( SDL_INIT_EVERYTHING );
+    expandArchives();
     light4cxx::Logger::root()->info( L4CXX_LOCATION, "Trying to load '%s'", config::filename );
     ppp::AbstractModule::Ptr module;
+    // several files are only played back to back when playing back or streaming
+    std::shared_ptr<ppp::Playlist> playlist;
     try
     {
-      module = ppp::tryLoad( config::filename, 44100, config::maxRepeat, config::interpolation );
+      if( config::filenames.size() > 1
+          && (config::outputFilename.empty() || StreamAudioOutput::parseTarget( config::outputFilename ) >= 0) )
+      {
+        if( config::parallel && !config::outputFilename.empty() )
+        {
+          // the segment renderer splits up a single module, it cannot follow the playlist
+          light4cxx::Logger::root()->error( L4CXX_LOCATION, "--jobs cannot be used when streaming several files" );
+          return EXIT_FAILURE;
+        }
+        // the files were probed by expandArchives()
+        playlist = std::make_shared<ppp::Playlist>( config::filenames, [](const std::string& filename) {
+          return ppp::tryLoad( filename, 44100, config::maxRepeat, config::interpolation );
+        }, config::preload, config::preloadBudget * 1024 * 1024 );
+        if( playlist->initialize( 44100 ) )
+        {
+          module = playlist->current();
+        }
+      }
+      else
+      {
+        if( config::filenames.size() > 1 )
+        {
+          light4cxx::Logger::root()->warn( L4CXX_LOCATION, "Only '%s' is written to '%s'", config::filename, config::outputFilename );
+        }
+        module = ppp::tryLoad( config::filename, 44100, config::maxRepeat, config::interpolation );
+      }
       if( !module )
       {
         light4cxx::Logger::root()->error( L4CXX_LOCATION, "Failed to load '%s'", config::filename );
         return EXIT_FAILURE;
       }
+      if( config::profile )
+      {
+        // start after loading, so the song length pre-calculation is not included
+        ppp::profile::setEnabled( true );
+      }
     }
     catch( ... )
     {
@@ -308,6 +483,48 @@ int main(int argc, char* argv[])
                 << std::endl;
       return EXIT_FAILURE;
     }
+    // file and stream outputs read from the segment renderer when rendering in parallel
+    AbstractAudioSource::Ptr source = module;
+    if( playlist )
+    {
+      source = playlist;
+    }
+    std::shared_ptr<ppp::SegmentRenderer> renderer;
+    if( config::parallel && !config::outputFilename.empty() )
+    {
+      renderer = std::make_shared<ppp::SegmentRenderer>( module, []() {
+        return ppp::tryLoad( config::filename, 44100, config::maxRepeat, config::interpolation );
+      }, config::jobs );
+      if( !renderer->initialize( 44100 ) )
+      {
+        light4cxx::Logger::root()->error( L4CXX_LOCATION, "Cannot render '%s' in parallel", config::filename );
+        return EXIT_FAILURE;
+      }
+      source = renderer;
+    }
+    const auto renderedFrames = [&module, &renderer]() {
+      if( renderer )
+      {
+        return renderer->renderedFrames();
+      }
+      return std::const_pointer_cast<const ppp::AbstractModule>( module )->state().playedFrames;
+    };
+    // show the playing entry of a playlist
+    const auto followPlaylist = [&module, &playlist]() {
+      if( !playlist )
+      {
+        return;
+      }
+      const ppp::AbstractModule::Ptr current = playlist->current();
+      if( current && current != module )
+      {
+        module = current;
+        if( uiMain )
+        {
+          uiMain->setModule( module );
+        }
+      }
+    };
     if( !config::noGUI )
     {
       light4cxx::Logger::root()->debug( L4CXX_LOCATION, "Initializing SDL Screen: %s", PACKAGE_STRING );
@@ -318,7 +535,7 @@ int main(int argc, char* argv[])
     if( config::outputFilename.empty() )
     {
       light4cxx::Logger::root()->info( L4CXX_LOCATION, "Init Audio" );
-      output = std::make_shared<SDLAudioOutput>( module );
+      output = std::make_shared<SDLAudioOutput>( source, config::period );
       if( !output->init( 44100 ) )
       {
         light4cxx::Logger::root()->fatal( L4CXX_LOCATION, "Audio Init failed" );
@@ -330,12 +547,15 @@ int main(int argc, char* argv[])
       }
       output->play();
       SDL_Event event;
+      auto lastStats = std::chrono::steady_clock::now();
+      AudioFifo::Stats prevStats;
       while( output )
       {
         if( output->errorCode() == AbstractAudioOutput::InputDry )
         {
           light4cxx::Logger::root()->debug( L4CXX_LOCATION, "Input is dry, trying to jump to the next song" );
-          if( !module->jumpNextSong() )
+          // the playlist already continued with the following songs and entries
+          if( playlist || !module->jumpNextSong() )
           {
             light4cxx::Logger::root()->debug( L4CXX_LOCATION, "Jump failed, quitting" );
             output.reset();
@@ -351,10 +571,28 @@ int main(int argc, char* argv[])
           output.reset();
           break;
         }
+        followPlaylist();
         if( output && uiMain )
         {
-          uiMain->setFft( reinterpret_cast<SDLAudioOutput*>(output.get())->leftFft(),
-                          reinterpret_cast<SDLAudioOutput*>(output.get())->rightFft() );
+          auto sdlOutput = reinterpret_cast<SDLAudioOutput*>(output.get());
+          sdlOutput->updateAnalysis();
+          uiMain->setFft( sdlOutput->leftFft(), sdlOutput->rightFft() );
+        }
+        if( output && config::period != 0 && std::chrono::steady_clock::now() - lastStats >= std::chrono::seconds( 1 ) )
+        {
+          lastStats = std::chrono::steady_clock::now();
+          const AudioFifo::Stats stats = reinterpret_cast<SDLAudioOutput*>(output.get())->bufferStats();
+          // time spent rendering relative to the duration of the rendered audio
+          const auto renderMicros = (stats.renderTime - prevStats.renderTime).count();
+          const auto budgetMicros = (stats.renderedFrames - prevStats.renderedFrames) * 1000000 / 44100;
+          light4cxx::Logger::root()->info( L4CXX_LOCATION,
+                                           "Queued %d frames (%d ms), threshold %d frames, %d underruns, render load %d%%",
+                                           stats.queued,
+                                           stats.queued * 1000 / 44100,
+                                           stats.threshold,
+                                           stats.underruns,
+                                           budgetMicros == 0 ? 0 : renderMicros * 100 / budgetMicros );
+          prevStats = stats;
         }
         if( !SDL_PollEvent( &event ) )
         {
@@ -379,21 +617,27 @@ int main(int argc, char* argv[])
             }
             break;
           case SDLK_END:
-            if( !module->jumpNextSong() )
+            if( !module->jumpNextSong() && !(playlist && playlist->skip()) )
               output.reset();
+            else
+              reinterpret_cast<SDLAudioOutput*>(output.get())->dropQueued();
             break;
           case SDLK_HOME:
             module->jumpPrevSong();
+            reinterpret_cast<SDLAudioOutput*>(output.get())->dropQueued();
             break;
           case SDLK_PAGEDOWN:
             if( !module->seekForward() )
             {
-              if( !module->jumpNextSong() )
+              if( !module->jumpNextSong() && !(playlist && playlist->skip()) )
                 output.reset();
             }
+            if( output )
+              reinterpret_cast<SDLAudioOutput*>(output.get())->dropQueued();
             break;
           case SDLK_PAGEUP:
             module->seekBackward();
+            reinterpret_cast<SDLAudioOutput*>(output.get())->dropQueued();
             break;
           case SDLK_x:
             uiMain->toggleInfoVisibility();
@@ -406,6 +650,16 @@ int main(int argc, char* argv[])
         {
           dosScreen->onMouseMove( event.motion.x / 8, event.motion.y / 16 );
         }
+        else if( dosScreen
+                 && ((event.type == SDL_WINDOWEVENT
+                      && (event.window.event == SDL_WINDOWEVENT_SHOWN
+                          || event.window.event == SDL_WINDOWEVENT_EXPOSED
+                          || event.window.event == SDL_WINDOWEVENT_RESTORED))
+                     || event.type == SDL_RENDER_TARGETS_RESET) )
+        {
+          // the screen only presents changed regions, so lost window contents must be redrawn completely
+          dosScreen->invalidate();
+        }
         else if( event.type == SDL_QUIT )
         {
           output.reset();
@@ -414,6 +668,34 @@ int main(int argc, char* argv[])
       if( output )
         output.reset();
     }
+    else if( StreamAudioOutput::parseTarget( config::outputFilename ) >= 0 )
+    {
+      light4cxx::Logger::root()->info( L4CXX_LOCATION, "Stream Output Mode" );
+      output = std::make_shared<StreamAudioOutput>( source,
+                                                    StreamAudioOutput::parseTarget( config::outputFilename ),
+                                                    config::rawOutput ? StreamAudioOutput::Format::Raw
+                                                                      : StreamAudioOutput::Format::Wav );
+      if( 0 == output->init( 44100 ) )
+      {
+        light4cxx::Logger::root()->error( L4CXX_LOCATION, "Cannot stream to '%s'", config::outputFilename );
+        return EXIT_FAILURE;
+      }
+      if( dosScreen )
+      {
+        uiMain = new UIMain( dosScreen.get(), module, output );
+      }
+      output->play();
+      while( output->playing() )
+      {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        followPlaylist();
+      }
+      if( output->errorCode() == AbstractAudioOutput::OutputError )
+      {
+        light4cxx::Logger::root()->warn( L4CXX_LOCATION, "Streaming stopped before the end of the song" );
+      }
+      output.reset();
+    }
     else if( boost::iends_with( config::outputFilename, ".wav" ) )
     {
       light4cxx::Logger::root()->info( L4CXX_LOCATION, "QuickWAV Output Mode" );
@@ -421,7 +703,7 @@ int main(int argc, char* argv[])
       {
         config::outputFilename = config::filename + ".wav";
       }
-      WavAudioOutput* wavout = new WavAudioOutput( module, config::outputFilename );
+      WavAudioOutput* wavout = new WavAudioOutput( source, config::outputFilename );
       output.reset( wavout );
       if( 0 == wavout->init( 44100 ) )
       {
@@ -450,8 +732,46 @@ int main(int argc, char* argv[])
       while( output->playing() )
       {
         std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
-        display +=
-          std::const_pointer_cast<const ppp::AbstractModule>( module )->state().playedFrames - display.count();
+        display += renderedFrames() - display.count();
+      }
+      output.reset();
+    }
+    else if( boost::iends_with( config::outputFilename, ".flac" ) )
+    {
+      light4cxx::Logger::root()->info( L4CXX_LOCATION, "QuickFLAC Output Mode" );
+      FlacAudioOutput* flacOut = new FlacAudioOutput( source, config::outputFilename, config::jobs );
+      output.reset( flacOut );
+      flacOut->setMeta( boost::trim_copy( module->metaInfo().title ),
+                        PACKAGE_STRING,
+                        std::const_pointer_cast<const ppp::AbstractModule>( module )->metaInfo().trackerInfo );
+      if( 0 == flacOut->init( 44100 ) )
+      {
+        if( flacOut->errorCode() == AbstractAudioOutput::OutputUnavailable )
+        {
+          light4cxx::Logger::root()->error( L4CXX_LOCATION, "Maybe cannot create FLAC File" );
+        }
+        else
+        {
+          light4cxx::Logger::root()->error( L4CXX_LOCATION, "FLAC initialization error: '%d'", flacOut->errorCode() );
+        }
+        return EXIT_FAILURE;
+      }
+      if( dosScreen )
+      {
+        uiMain = new UIMain( dosScreen.get(), module, output );
+      }
+      output->play();
+      size_t secs = module->length() / module->frequency();
+      boost::timer::progress_display display( module->length(),
+                                              std::cout,
+                                              stringFmt( "QuickFLAC: %s (%dm%02ds)\n",
+                                                         config::filename,
+                                                         secs / 60,
+                                                         secs % 60 ) );
+      while( output->playing() )
+      {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        display += renderedFrames() - display.count();
       }
       output.reset();
     }
@@ -463,7 +783,7 @@ int main(int argc, char* argv[])
         {
             config::outputFilename = config::filename + ".mp3";
         }
-        MP3AudioOutput* mp3out = new MP3AudioOutput(module, config::outputFilename);
+        MP3AudioOutput* mp3out = new MP3AudioOutput(source, config::outputFilename);
         output.reset(mp3out);
         mp3out->setID3(boost::trim_copy(module->metaInfo().title), PACKAGE_STRING, std::const_pointer_cast<const ppp::AbstractModule>(module)->metaInfo().trackerInfo);
         if(0 == mp3out->init(44100))
@@ -488,7 +808,7 @@ int main(int argc, char* argv[])
         while(output->playing())
         {
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            progress += std::const_pointer_cast<const ppp::AbstractModule>(module)->state().playedFrames - progress.count();
+            progress += renderedFrames() - progress.count();
         }
         output.reset();
     }
@@ -501,7 +821,7 @@ int main(int argc, char* argv[])
         {
             config::outputFilename = config::filename + ".ogg";
         }
-        OggAudioOutput* oggOut = new OggAudioOutput(module, config::outputFilename);
+        OggAudioOutput* oggOut = new OggAudioOutput(source, config::outputFilename);
         output.reset(oggOut);
         oggOut->setMeta(boost::trim_copy(module->metaInfo().title), PACKAGE_STRING, std::const_pointer_cast<const ppp::AbstractModule>(module)->metaInfo().trackerInfo);
         if(0 == oggOut->init(44100))
@@ -526,7 +846,7 @@ int main(int argc, char* argv[])
         while(output->playing())
         {
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            progress += std::const_pointer_cast<const ppp::AbstractModule>(module)->state().playedFrames - progress.count();
+            progress += renderedFrames() - progress.count();
         }
         output.reset();
     }
@@ -547,6 +867,7 @@ int main(int argc, char* argv[])
               << std::endl;
     return EXIT_FAILURE;
   }
+  reportProfile();
   dosScreen.reset();
   return EXIT_SUCCESS;
 }
\ No newline at end of file
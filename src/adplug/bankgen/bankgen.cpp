@@ -5,13 +5,14 @@
 
 #include "stream/filestream.h"
 
+#include "bankimage.h"
 #include "loader.h"
 
 int main(int argc, char** argv)
 {
-  if( argc < 2 )
+  if( argc < 3 )
   {
-    std::cout << "Missing output filename.\n";
+    std::cout << "Usage: " << argv[0] << " <database.xml> <database.bin>\n";
     return EXIT_FAILURE;
   }
 
@@ -136,5 +137,15 @@ int main(int argc, char** argv)
     return EXIT_FAILURE;
   }
 
+  try
+  {
+    bankdb::image::write( db, argv[2] );
+  }
+  catch( std::runtime_error& ex )
+  {
+    std::cout << "Failed to create " << argv[2] << ": " << ex.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,183 @@
+#include "bankimage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+namespace bankdb
+{
+namespace image
+{
+namespace
+{
+template<typename T>
+void writeRaw(std::ostream& out, const T* data, size_t count)
+{
+  out.write( reinterpret_cast<const char*>(data), sizeof( T ) * count );
+}
+}
+
+void write(const BankDatabase& db, const std::string& filename)
+{
+  std::vector<BankEntry> banks;
+  std::vector<InstrumentEntry> instruments;
+  std::vector<SlotSettings> slots;
+  std::map<SlotSettings, uint16_t> slotIndices;
+  std::string strings;
+
+  const auto addString = [&strings](const std::string& str) {
+    const auto offset = static_cast<uint32_t>(strings.size());
+    strings.append( str ).push_back( '\0' );
+    return offset;
+  };
+
+  const auto addSlot = [&slots, &slotIndices](const SlotSettings::Ptr& slot) -> uint16_t {
+    if( slot == nullptr )
+    {
+      return NoSlot;
+    }
+    auto it = slotIndices.find( *slot );
+    if( it != slotIndices.end() )
+    {
+      return it->second;
+    }
+    if( slots.size() >= NoSlot )
+    {
+      throw std::runtime_error( "Too many distinct slot settings" );
+    }
+    slots.emplace_back( *slot );
+    return slotIndices.emplace( *slot, static_cast<uint16_t>(slots.size() - 1) ).first->second;
+  };
+
+  // std::map keeps the banks sorted by name, which is the order the index needs
+  for( const auto& bank: db.banks() )
+  {
+    BankEntry entry{};
+    entry.name = addString( bank.first );
+    entry.description = addString( bank.second.description );
+    entry.flags = (bank.second.uses4op ? BankEntry::FlgUses4op : 0)
+                  | (bank.second.onlyPercussion ? BankEntry::FlgOnlyPercussion : 0);
+    banks.emplace_back( entry );
+
+    const size_t base = instruments.size();
+    instruments.resize( base + InstrumentsPerBank, InstrumentEntry{ NoSlot, NoSlot, 0, 0 } );
+    for( const auto& instrument: bank.second.instruments )
+    {
+      if( instrument.first >= InstrumentsPerBank )
+      {
+        throw std::runtime_error( "Instrument index out of range in bank " + bank.first );
+      }
+      InstrumentEntry& dest = instruments[base + instrument.first];
+      dest.first = addSlot( instrument.second.first );
+      dest.second = addSlot( instrument.second.second );
+      dest.flags = InstrumentEntry::FlgPresent;
+      if( instrument.second.pseudo4op )
+      {
+        dest.flags |= InstrumentEntry::FlgPseudo4op;
+      }
+      if( instrument.second.noteOverride )
+      {
+        dest.flags |= InstrumentEntry::FlgNoteOverride;
+        dest.noteOverride = *instrument.second.noteOverride;
+      }
+    }
+  }
+
+  Header header{};
+  std::copy( std::begin( Magic ), std::end( Magic ), header.magic );
+  header.version = Version;
+  header.bankCount = static_cast<uint32_t>(banks.size());
+  header.slotCount = static_cast<uint32_t>(slots.size());
+  header.stringsSize = static_cast<uint32_t>(strings.size());
+
+  std::ofstream out( filename, std::ios::binary | std::ios::trunc );
+  writeRaw( out, &header, 1 );
+  writeRaw( out, banks.data(), banks.size() );
+  writeRaw( out, instruments.data(), instruments.size() );
+  writeRaw( out, slots.data(), slots.size() );
+  writeRaw( out, strings.data(), strings.size() );
+  if( !out )
+  {
+    throw std::runtime_error( "Cannot write " + filename );
+  }
+}
+} // namespace image
+
+CompiledDatabase::CompiledDatabase(const std::string& filename)
+  : m_file( filename )
+{
+  if( !m_file.isOpen() )
+  {
+    throw std::runtime_error( "Cannot open bank database " + filename );
+  }
+
+  image::Header header;
+  if( m_file.size() < sizeof( header ) )
+  {
+    throw std::runtime_error( "Bank database truncated: " + filename );
+  }
+  std::memcpy( &header, m_file.data(), sizeof( header ) );
+  if( !std::equal( std::begin( image::Magic ), std::end( image::Magic ), header.magic )
+      || header.version != image::Version )
+  {
+    throw std::runtime_error( "Not a compatible bank database: " + filename );
+  }
+
+  const size_t banksOffset = sizeof( header );
+  const size_t instrumentsOffset = banksOffset + sizeof( image::BankEntry ) * header.bankCount;
+  const size_t slotsOffset = instrumentsOffset
+                             + sizeof( image::InstrumentEntry ) * image::InstrumentsPerBank * header.bankCount;
+  const size_t stringsOffset = slotsOffset + sizeof( SlotSettings ) * header.slotCount;
+  if( m_file.size() < stringsOffset + header.stringsSize
+      || (header.stringsSize != 0 && m_file.data()[stringsOffset + header.stringsSize - 1] != '\0') )
+  {
+    throw std::runtime_error( "Bank database truncated: " + filename );
+  }
+
+  const auto* bankEntries = reinterpret_cast<const image::BankEntry*>(m_file.data() + banksOffset);
+  const auto* instruments = reinterpret_cast<const image::InstrumentEntry*>(m_file.data() + instrumentsOffset);
+  const auto* slots = reinterpret_cast<const SlotSettings*>(m_file.data() + slotsOffset);
+  const auto* strings = reinterpret_cast<const char*>(m_file.data() + stringsOffset);
+
+  for( size_t i = 0; i < image::InstrumentsPerBank * header.bankCount; ++i )
+  {
+    const auto& entry = instruments[i];
+    if( (entry.first != image::NoSlot && entry.first >= header.slotCount)
+        || (entry.second != image::NoSlot && entry.second >= header.slotCount) )
+    {
+      throw std::runtime_error( "Invalid slot reference in bank database " + filename );
+    }
+  }
+
+  m_banks.resize( header.bankCount );
+  for( size_t i = 0; i < header.bankCount; ++i )
+  {
+    const auto& entry = bankEntries[i];
+    if( entry.name >= header.stringsSize || entry.description >= header.stringsSize )
+    {
+      throw std::runtime_error( "Invalid string reference in bank database " + filename );
+    }
+    CompiledBank& bank = m_banks[i];
+    bank.m_name = strings + entry.name;
+    bank.m_description = strings + entry.description;
+    bank.m_uses4op = (entry.flags & image::BankEntry::FlgUses4op) != 0;
+    bank.m_onlyPercussion = (entry.flags & image::BankEntry::FlgOnlyPercussion) != 0;
+    bank.m_instruments = instruments + i * image::InstrumentsPerBank;
+    bank.m_slots = slots;
+  }
+}
+
+const CompiledBank* CompiledDatabase::bank(const std::string& name) const
+{
+  auto it = std::lower_bound( m_banks.begin(), m_banks.end(), name, [](const CompiledBank& bank, const std::string& key) {
+    return std::strcmp( bank.name(), key.c_str() ) < 0;
+  } );
+  if( it == m_banks.end() || name != it->name() )
+  {
+    return nullptr;
+  }
+  return &*it;
+}
+} // namespace bankdb
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "bankdatabase.h"
+
+#include "stream/mappedfile.h"
+#include "stuff/utils.h"
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace bankdb
+{
+/**
+ * @brief On-disk layout of the compiled bank database
+ *
+ * @details
+ * All values are little-endian, all sections are 4-byte aligned:
+ *  - Header
+ *  - BankEntry[bankCount], sorted by name
+ *  - InstrumentEntry[bankCount * InstrumentsPerBank], bank by bank
+ *  - SlotSettings[slotCount], shared by all instruments
+ *  - NUL-terminated strings
+ */
+namespace image
+{
+constexpr char Magic[8] = { 'P', 'P', 'P', 'B', 'N', 'K', 'D', 'B' };
+constexpr uint32_t Version = 1;
+//! @brief Melodic instruments 0..127, percussion 128..255
+constexpr size_t InstrumentsPerBank = 256;
+constexpr uint16_t NoSlot = 0xffff;
+
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t bankCount;
+  uint32_t slotCount;
+  uint32_t stringsSize;
+};
+
+struct BankEntry
+{
+  static constexpr uint8_t FlgUses4op = 0x01;
+  static constexpr uint8_t FlgOnlyPercussion = 0x02;
+
+  //! @brief Offset of the name in the string section
+  uint32_t name;
+  //! @brief Offset of the description in the string section
+  uint32_t description;
+  uint8_t flags;
+  uint8_t reserved[3];
+};
+
+struct InstrumentEntry
+{
+  static constexpr uint8_t FlgPresent = 0x01;
+  static constexpr uint8_t FlgPseudo4op = 0x02;
+  static constexpr uint8_t FlgNoteOverride = 0x04;
+
+  //! @brief Index into the slot section, or NoSlot
+  uint16_t first;
+  //! @brief Index into the slot section, or NoSlot
+  uint16_t second;
+  uint8_t noteOverride;
+  uint8_t flags;
+};
+
+static_assert( sizeof( Header ) == 24, "Unexpected header layout" );
+static_assert( sizeof( BankEntry ) == 12, "Unexpected bank entry layout" );
+static_assert( sizeof( InstrumentEntry ) == 6, "Unexpected instrument entry layout" );
+static_assert( sizeof( SlotSettings ) == 12 && alignof( SlotSettings ) == 1, "SlotSettings must map the on-disk layout" );
+static_assert( std::is_trivially_copyable<SlotSettings>::value, "SlotSettings must map the on-disk layout" );
+
+/**
+ * @brief Write the compiled form of a bank database
+ * @param[in] db The database; its slot settings should already be made unique
+ * @param[in] filename Output filename
+ * @throws std::runtime_error if the file cannot be written or the database is too large
+ */
+void write(const BankDatabase& db, const std::string& filename);
+} // namespace image
+
+/**
+ * @brief An instrument within a mapped bank database
+ */
+class CompiledInstrument
+{
+public:
+  CompiledInstrument() = default;
+
+  CompiledInstrument(const image::InstrumentEntry* entry, const SlotSettings* slots) noexcept
+    : m_entry( entry )
+    , m_slots( slots )
+  {
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return m_entry != nullptr && (m_entry->flags & image::InstrumentEntry::FlgPresent) != 0;
+  }
+
+  const SlotSettings* first() const noexcept
+  {
+    return slot( m_entry->first );
+  }
+
+  const SlotSettings* second() const noexcept
+  {
+    return slot( m_entry->second );
+  }
+
+  boost::optional<uint8_t> noteOverride() const noexcept
+  {
+    if( (m_entry->flags & image::InstrumentEntry::FlgNoteOverride) == 0 )
+    {
+      return boost::none;
+    }
+    return m_entry->noteOverride;
+  }
+
+  bool pseudo4op() const noexcept
+  {
+    return (m_entry->flags & image::InstrumentEntry::FlgPseudo4op) != 0;
+  }
+
+private:
+  const image::InstrumentEntry* m_entry = nullptr;
+  const SlotSettings* m_slots = nullptr;
+
+  const SlotSettings* slot(uint16_t idx) const noexcept
+  {
+    return idx == image::NoSlot ? nullptr : m_slots + idx;
+  }
+};
+
+/**
+ * @brief A bank within a mapped bank database
+ */
+class CompiledBank
+{
+  friend class CompiledDatabase;
+
+public:
+  const char* name() const noexcept
+  {
+    return m_name;
+  }
+
+  const char* description() const noexcept
+  {
+    return m_description;
+  }
+
+  bool uses4op() const noexcept
+  {
+    return m_uses4op;
+  }
+
+  bool onlyPercussion() const noexcept
+  {
+    return m_onlyPercussion;
+  }
+
+  /**
+   * @brief Look up an instrument
+   * @param[in] idx Instrument index, percussion instruments start at 128
+   * @return The instrument, evaluates to @c false if it does not exist
+   */
+  CompiledInstrument instrument(size_t idx) const noexcept
+  {
+    if( idx >= image::InstrumentsPerBank )
+    {
+      return {};
+    }
+    return { m_instruments + idx, m_slots };
+  }
+
+private:
+  const char* m_name = nullptr;
+  const char* m_description = nullptr;
+  bool m_uses4op = false;
+  bool m_onlyPercussion = false;
+  const image::InstrumentEntry* m_instruments = nullptr;
+  const SlotSettings* m_slots = nullptr;
+};
+
+/**
+ * @brief Read-only bank database, memory-mapped from the image written by image::write()
+ *
+ * @details
+ * Opening the database only validates the section sizes and references; the
+ * instrument data is used in place, so no parsing happens on startup.
+ */
+class CompiledDatabase
+{
+public:
+  DISABLE_COPY( CompiledDatabase )
+
+  /**
+   * @brief Map a compiled bank database
+   * @param[in] filename Filename of the image
+   * @throws std::runtime_error if the file cannot be mapped or is not a valid image
+   */
+  explicit CompiledDatabase(const std::string& filename);
+
+  /**
+   * @brief Look up a bank by name
+   * @return The bank, or @c nullptr if it does not exist
+   */
+  const CompiledBank* bank(const std::string& name) const;
+
+  /**
+   * @brief Get all banks, sorted by name
+   */
+  const std::vector<CompiledBank>& banks() const noexcept
+  {
+    return m_banks;
+  }
+
+private:
+  MappedFile m_file;
+  std::vector<CompiledBank> m_banks{};
+};
+} // namespace bankdb
@@ -0,0 +1,216 @@
+#define BOOST_TEST_MODULE BankImage
+
+#include <boost/test/unit_test.hpp>
+
+#include "../bankimage.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace bankdb;
+
+namespace
+{
+class TestDatabase : public BankDatabase
+{
+public:
+  TestDatabase()
+  {
+    const auto slotA = makeSlot( 1 );
+    const auto slotB = makeSlot( 2 );
+
+    // registered out of order, the image is sorted by name
+    registerBank( "zeta", "Second bank" );
+    Instrument& piano = addInstrument( "zeta", 0 );
+    piano.first = slotA;
+    piano.second = slotB;
+    piano.pseudo4op = true;
+    Instrument& drum = addInstrument( "zeta", 128 + 35 );
+    drum.first = slotB;
+    drum.noteOverride = 47;
+    banks()["zeta"].uses4op = true;
+
+    registerBank( "alpha", "First bank" );
+    Instrument& organ = addInstrument( "alpha", 19 );
+    // an equal copy of slotA, shared in the image
+    organ.first = makeSlot( 1 );
+    banks()["alpha"].onlyPercussion = true;
+  }
+
+private:
+  static SlotSettings::Ptr makeSlot(uint8_t seed)
+  {
+    auto slot = std::make_shared<SlotSettings>();
+    for( size_t i = 0; i < slot->data.size(); i++ )
+    {
+      slot->data[i] = static_cast<uint8_t>(seed * 16 + i);
+    }
+    slot->finetune = static_cast<int8_t>(-seed);
+    return slot;
+  }
+};
+
+struct TempImage
+{
+  const std::string filename = ( boost::filesystem::temp_directory_path() / boost::filesystem::unique_path() ).string();
+
+  ~TempImage()
+  {
+    boost::filesystem::remove( filename );
+  }
+
+  std::vector<char> read() const
+  {
+    std::ifstream file( filename, std::ios::binary );
+    return std::vector<char>( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
+  }
+
+  void write(const std::vector<char>& data) const
+  {
+    std::ofstream file( filename, std::ios::binary | std::ios::trunc );
+    file.write( data.data(), data.size() );
+  }
+};
+
+void checkSlot(const SlotSettings* actual, const SlotSettings::Ptr& expected)
+{
+  if( expected == nullptr )
+  {
+    BOOST_CHECK( actual == nullptr );
+    return;
+  }
+  BOOST_REQUIRE( actual != nullptr );
+  BOOST_CHECK( *actual == *expected );
+}
+
+void checkBank(const CompiledBank& actual, const std::string& name, const Bank& expected)
+{
+  BOOST_CHECK_EQUAL( actual.name(), name );
+  BOOST_CHECK_EQUAL( actual.description(), expected.description );
+  BOOST_CHECK_EQUAL( actual.uses4op(), expected.uses4op );
+  BOOST_CHECK_EQUAL( actual.onlyPercussion(), expected.onlyPercussion );
+  for( size_t idx = 0; idx < image::InstrumentsPerBank; idx++ )
+  {
+    const CompiledInstrument instrument = actual.instrument( idx );
+    auto it = expected.instruments.find( idx );
+    if( it == expected.instruments.end() )
+    {
+      BOOST_CHECK( !instrument );
+      continue;
+    }
+    BOOST_REQUIRE( instrument );
+    checkSlot( instrument.first(), it->second.first );
+    checkSlot( instrument.second(), it->second.second );
+    BOOST_CHECK( instrument.noteOverride() == it->second.noteOverride );
+    BOOST_CHECK_EQUAL( instrument.pseudo4op(), it->second.pseudo4op );
+  }
+  BOOST_CHECK( !actual.instrument( image::InstrumentsPerBank ) );
+}
+
+//! @brief Write the test database, let @a corrupt modify the image, and check that it is rejected
+template<typename F>
+void checkRejected(F corrupt)
+{
+  TempImage file;
+  image::write( TestDatabase(), file.filename );
+  auto data = file.read();
+  corrupt( data );
+  file.write( data );
+  BOOST_CHECK_THROW( CompiledDatabase db( file.filename ), std::runtime_error );
+}
+
+constexpr size_t InstrumentsOffset = sizeof( image::Header ) + 2 * sizeof( image::BankEntry );
+
+template<typename T>
+void patch(std::vector<char>& data, size_t offset, T value)
+{
+  BOOST_REQUIRE_LE( offset + sizeof( value ), data.size() );
+  std::memcpy( data.data() + offset, &value, sizeof( value ) );
+}
+}
+
+BOOST_AUTO_TEST_CASE( RoundTrip )
+{
+  const TestDatabase source;
+  TempImage file;
+  image::write( source, file.filename );
+
+  const CompiledDatabase db( file.filename );
+  BOOST_REQUIRE_EQUAL( db.banks().size(), 2 );
+  checkBank( db.banks()[0], "alpha", source.banks().at( "alpha" ) );
+  checkBank( db.banks()[1], "zeta", source.banks().at( "zeta" ) );
+
+  BOOST_CHECK_EQUAL( db.bank( "alpha" ), &db.banks()[0] );
+  BOOST_CHECK_EQUAL( db.bank( "zeta" ), &db.banks()[1] );
+  BOOST_CHECK( db.bank( "beta" ) == nullptr );
+  BOOST_CHECK( db.bank( "" ) == nullptr );
+
+  // equal slot settings are stored once
+  BOOST_CHECK_EQUAL( db.banks()[0].instrument( 19 ).first(), db.banks()[1].instrument( 0 ).first() );
+  BOOST_CHECK_EQUAL( file.read().size(),
+                     InstrumentsOffset + 2 * image::InstrumentsPerBank * sizeof( image::InstrumentEntry )
+                     + 2 * sizeof( SlotSettings ) + std::strlen( "alphaFirst bankzetaSecond bank" ) + 4 );
+}
+
+BOOST_AUTO_TEST_CASE( MissingFile )
+{
+  BOOST_CHECK_THROW( CompiledDatabase db( "/nonexistent/bankdb.bin" ), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( Truncated )
+{
+  checkRejected( [](std::vector<char>& data) {
+    data.resize( sizeof( image::Header ) - 1 );
+  } );
+  checkRejected( [](std::vector<char>& data) {
+    data.pop_back();
+  } );
+  checkRejected( [](std::vector<char>& data) {
+    data.resize( InstrumentsOffset + 10 );
+  } );
+}
+
+BOOST_AUTO_TEST_CASE( BadHeader )
+{
+  checkRejected( [](std::vector<char>& data) {
+    data[0] = 'X';
+  } );
+  checkRejected( [](std::vector<char>& data) {
+    patch( data, offsetof( image::Header, version ), image::Version + 1 );
+  } );
+  checkRejected( [](std::vector<char>& data) {
+    patch( data, offsetof( image::Header, bankCount ), uint32_t( 3 ) );
+  } );
+}
+
+BOOST_AUTO_TEST_CASE( BadSlotReference )
+{
+  // the image contains two distinct slots
+  checkRejected( [](std::vector<char>& data) {
+    patch( data, InstrumentsOffset + offsetof( image::InstrumentEntry, first ), uint16_t( 2 ) );
+  } );
+  checkRejected( [](std::vector<char>& data) {
+    const size_t last = InstrumentsOffset + (2 * image::InstrumentsPerBank - 1) * sizeof( image::InstrumentEntry );
+    patch( data, last + offsetof( image::InstrumentEntry, second ), uint16_t( 0x1234 ) );
+  } );
+}
+
+BOOST_AUTO_TEST_CASE( BadStringReference )
+{
+  checkRejected( [](std::vector<char>& data) {
+    uint32_t stringsSize;
+    std::memcpy( &stringsSize, data.data() + offsetof( image::Header, stringsSize ), sizeof( stringsSize ) );
+    patch( data, sizeof( image::Header ) + offsetof( image::BankEntry, name ), stringsSize );
+  } );
+  checkRejected( [](std::vector<char>& data) {
+    patch( data, sizeof( image::Header ) + sizeof( image::BankEntry ) + offsetof( image::BankEntry, description ), uint32_t( 0xffffffff ) );
+  } );
+  // the string section must be terminated
+  checkRejected( [](std::vector<char>& data) {
+    data.back() = 'x';
+  } );
+}
@@ -60,14 +60,14 @@ void MultiChips::applyTimbre(Voice* voice, bool rightChan)
     }
   }
 
-  const bankdb::Instrument* timbre = instrument( patch );
+  const bankdb::CompiledInstrument timbre = instrument( patch );
   if( !timbre )
   {
     throw std::runtime_error( stringFmt( "Patch #%d not found", patch ) );
   }
-  if( timbre->second )
+  if( timbre.second() )
   {
-    if( !timbre->pseudo4op )
+    if( !timbre.pseudo4op() )
     {
       throw std::runtime_error( "4-op" );
     }
@@ -84,8 +84,8 @@ void MultiChips::applyTimbre(Voice* voice, bool rightChan)
   slot.setKeyOn( false );
   slot.setFnum( 0 );
   slot.setBlock( 0 );
-  timbre->first->apply( slot );
-  if( timbre->first->data[10] & 1 )
+  timbre.first()->apply( slot );
+  if( timbre.first()->data[10] & 1 )
   {
     slot.modulator().setTotalLevel( 63 );
   }
@@ -102,7 +102,7 @@ void MultiChips::applyTimbre(Voice* voice, bool rightChan)
 
   if( voice->secondary )
   {
-    BOOST_ASSERT( timbre->second != nullptr );
+    BOOST_ASSERT( timbre.second() != nullptr );
 
     slot = m_chips[voice->secondary->chip]
       .getSlotView( voice->secondary->slotId + (m_stereo && rightChan ? Voice::StereoOffset : 0) );
@@ -110,8 +110,8 @@ void MultiChips::applyTimbre(Voice* voice, bool rightChan)
     slot.setKeyOn( false );
     slot.setFnum( 0 );
     slot.setBlock( 0 );
-    timbre->second->apply( slot );
-    if( timbre->second->data[10] & 1 )
+    timbre.second()->apply( slot );
+    if( timbre.second()->data[10] & 1 )
     {
       slot.modulator().setTotalLevel( 63 );
     }
@@ -189,14 +189,14 @@ void MultiChips::applyVolume(Voice* voice, bool rightChan)
   opl::SlotView
     slot = m_chips[voice->chip].getSlotView( voice->slotId + (m_stereo && rightChan ? Voice::StereoOffset : 0) );
 
-  const bankdb::Instrument* timbre = instrument( voice->timbre );
+  const bankdb::CompiledInstrument timbre = instrument( voice->timbre );
   if( !timbre )
   {
     throw std::runtime_error( stringFmt( "Patch #%d not found", voice->timbre ) );
   }
-  if( timbre->second )
+  if( timbre.second() )
   {
-    if( !timbre->pseudo4op )
+    if( !timbre.pseudo4op() )
     {
       throw std::runtime_error( "4-op" );
     }
@@ -214,28 +214,28 @@ void MultiChips::applyVolume(Voice* voice, bool rightChan)
   }
 
   unsigned int
-    level = calculateTotalLevel( timbre->first->data[8] & 0x3f, voice->velocity, chan.volume, m_adlibVolumes, pan );
+    level = calculateTotalLevel( timbre.first()->data[8] & 0x3f, voice->velocity, chan.volume, m_adlibVolumes, pan );
   slot.carrier().setTotalLevel( level );
 
-  if( timbre->first->data[10] & 0x01 )
+  if( timbre.first()->data[10] & 0x01 )
   {
-    level = calculateTotalLevel( timbre->first->data[9] & 0x3f, voice->velocity, chan.volume, m_adlibVolumes, pan );
+    level = calculateTotalLevel( timbre.first()->data[9] & 0x3f, voice->velocity, chan.volume, m_adlibVolumes, pan );
     slot.modulator().setTotalLevel( level );
   }
 
   if( voice->secondary )
   {
-    BOOST_ASSERT( timbre->second != nullptr );
+    BOOST_ASSERT( timbre.second() != nullptr );
 
     slot = m_chips[voice->secondary->chip]
       .getSlotView( voice->secondary->slotId + (m_stereo && rightChan ? Voice::StereoOffset : 0) );
 
-    level = calculateTotalLevel( timbre->second->data[8] & 0x3f, voice->velocity, chan.volume, m_adlibVolumes, pan );
+    level = calculateTotalLevel( timbre.second()->data[8] & 0x3f, voice->velocity, chan.volume, m_adlibVolumes, pan );
     slot.carrier().setTotalLevel( level );
 
-    if( timbre->second->data[10] & 0x01 )
+    if( timbre.second()->data[10] & 0x01 )
     {
-      level = calculateTotalLevel( timbre->second->data[9] & 0x3f, voice->velocity, chan.volume, m_adlibVolumes, pan );
+      level = calculateTotalLevel( timbre.second()->data[9] & 0x3f, voice->velocity, chan.volume, m_adlibVolumes, pan );
       slot.modulator().setTotalLevel( level );
     }
   }
@@ -283,14 +283,14 @@ void MultiChips::applyPitch(Voice* voice, bool rightChan)
   if( voice->channel == 9 )
   {
     patch = voice->key + 128;
-    const bankdb::Instrument* timbre = instrument( patch );
+    const bankdb::CompiledInstrument timbre = instrument( patch );
     if( !timbre )
     {
       throw std::runtime_error( stringFmt( "Patch #%d not found", patch ) );
     }
-    if( timbre->second )
+    if( timbre.second() )
     {
-      if( !timbre->pseudo4op )
+      if( !timbre.pseudo4op() )
       {
         throw std::runtime_error( "4-op" );
       }
@@ -299,23 +299,23 @@ void MultiChips::applyPitch(Voice* voice, bool rightChan)
         voice->secondary = allocVoice();
       }
     }
-    if( !timbre->noteOverride )
+    if( !timbre.noteOverride() )
     {
       throw std::runtime_error( "No note override" );
     }
-    note = *timbre->noteOverride;
+    note = *timbre.noteOverride();
   }
   else
   {
     patch = m_channels.at( voice->channel ).timbre;
-    const bankdb::Instrument* timbre = instrument( patch );
+    const bankdb::CompiledInstrument timbre = instrument( patch );
     if( !timbre )
     {
       throw std::runtime_error( stringFmt( "Patch #%d not found", patch ) );
     }
-    if( timbre->second )
+    if( timbre.second() )
     {
-      if( !timbre->pseudo4op )
+      if( !timbre.pseudo4op() )
       {
         throw std::runtime_error( "4-op" );
       }
@@ -325,10 +325,10 @@ void MultiChips::applyPitch(Voice* voice, bool rightChan)
       }
     }
     note = voice->key;
-    detune1 = timbre->first->finetune;
-    if( timbre->second )
+    detune1 = timbre.first()->finetune;
+    if( timbre.second() )
     {
-      detune2 = timbre->second->finetune;
+      detune2 = timbre.second()->finetune;
     }
   }
 
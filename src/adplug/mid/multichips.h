@@ -4,7 +4,7 @@
 
 #include "stuff/utils.h"
 
-#include "../bankgen/bankdatabase.h"
+#include "../bankgen/bankimage.h"
 
 #include "stuff/system.h"
 
@@ -89,13 +89,12 @@ public:
     s_defaultPercussionBank = name;
   }
 
-  static const bankdb::BankDatabase& bankDbInstance()
+  static const bankdb::CompiledDatabase& bankDbInstance()
   {
-    static std::unique_ptr<bankdb::BankDatabase> bankDb;
+    static std::unique_ptr<bankdb::CompiledDatabase> bankDb;
     if( !bankDb )
     {
-      bankDb = std::make_unique<bankdb::BankDatabase>();
-      bankDb->load( ppp::whereAmI() + "/../share/ppplay/bankdb.xml" );
+      bankDb = std::make_unique<bankdb::CompiledDatabase>( ppp::whereAmI() + "/../share/ppplay/bankdb.bin" );
     }
     return *bankDb;
   }
@@ -116,11 +115,11 @@ public:
     {
       throw std::runtime_error( "Bank not found" );
     }
-    if( m_melodicBank->uses4op )
+    if( m_melodicBank->uses4op() )
     {
       throw std::runtime_error( "Bank uses pure 4-op slots" );
     }
-    if( m_melodicBank->onlyPercussion )
+    if( m_melodicBank->onlyPercussion() )
     {
       throw std::runtime_error( "Bank only provides rhythm instruments" );
     }
@@ -183,28 +182,20 @@ private:
   std::vector<opl::Opl3> m_chips;
   std::vector<Voice> m_voices;
   std::array<Channel, 16> m_channels;
-  const bankdb::Bank* m_melodicBank = nullptr;
-  const bankdb::Bank* m_percussionBank = nullptr;
+  const bankdb::CompiledBank* m_melodicBank = nullptr;
+  const bankdb::CompiledBank* m_percussionBank = nullptr;
 
-  static const bankdb::Instrument* instrument(size_t idx, const bankdb::Bank* bank)
+  static bankdb::CompiledInstrument instrument(size_t idx, const bankdb::CompiledBank* bank)
   {
     if( bank == nullptr )
     {
-      return nullptr;
+      return {};
     }
 
-    const auto& it = bank->instruments.find( idx );
-    if( it == bank->instruments.end() )
-    {
-      return nullptr;
-    }
-    else
-    {
-      return &it->second;
-    }
+    return bank->instrument( idx );
   }
 
-  const bankdb::Instrument* instrument(size_t idx) const
+  bankdb::CompiledInstrument instrument(size_t idx) const
   {
     if( idx < 128 )
     {
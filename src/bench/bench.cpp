@@ -0,0 +1,553 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Offline rendering benchmark
+ *
+ * @details
+ * Renders synthetic modules (every combination of format, channel count,
+ * interpolation and loop type), raw OPL3 register scripts and optionally all
+ * files of a corpus directory as fast as possible, and writes the results as
+ * JSON. The keys and their order are fixed, so the output of two runs can be
+ * compared with a plain diff or a script.
+ */
+
+#include "synthmodules.h"
+
+#include "genmod/abstractmodule.h"
+#include "light4cxx/logger.h"
+#include "output/audiotypes.h"
+#include "stream/memorystream.h"
+#include "stuff/pluginregistry.h"
+#include "stuff/stringutils.h"
+#include "ymf262/opl3.h"
+
+#include "xmmod/xmmodule.h"
+#include "itmod/itmodule.h"
+#include "s3mmod/s3mmodule.h"
+#include "modmod/modmodule.h"
+
+#include <boost/exception/all.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+std::atomic<uint64_t> s_allocations{ 0 };
+//! @brief Receives results that are otherwise unused, so the compiler cannot drop their computation
+volatile int64_t s_sink = 0;
+}
+
+/*
+ * Count all heap allocations of the process; the array forms forward to these
+ * by default.
+ */
+void* operator new(std::size_t size)
+{
+  s_allocations.fetch_add( 1, std::memory_order_relaxed );
+  if( void* ptr = std::malloc( size != 0 ? size : 1 ) )
+  {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free( ptr );
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free( ptr );
+}
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+namespace config
+{
+double seconds = 10;
+uint32_t frequency = 44100;
+std::vector<std::string> formats{ "mod", "s3m", "xm", "it", "opl" };
+std::vector<int> channels{ 4, 8, 16, 32 };
+std::vector<std::string> interpolations{ "none", "linear", "cubic", "hermite", "sinc" };
+std::vector<std::string> loops{ "none", "forward", "pingpong" };
+std::string corpus;
+bool noSynthetic = false;
+std::string outputFilename;
+}
+
+/**
+ * @struct Result
+ * @brief Measurements of a single benchmark run
+ */
+struct Result
+{
+  std::string name{};
+  std::string kind{};
+  std::string format{};
+  int channels = 0;
+  std::string interpolation{};
+  std::string loop{};
+  uint64_t frames = 0;
+  uint32_t frequency = 0;
+  double wallSeconds = 0;
+  uint64_t allocations = 0;
+  //! @brief Peak resident set size of the whole process up to the end of the run, including earlier runs
+  long processPeakRssKb = 0;
+  std::string error{};
+};
+
+/**
+ * @brief Peak resident set size of the process in KiB, or 0 if unknown
+ * @note This is the high-water mark since the process started, it never decreases.
+ */
+long peakRssKb()
+{
+#ifndef WIN32
+  rusage usage{};
+  if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+  {
+    return usage.ru_maxrss;
+  }
+#endif
+  return 0;
+}
+
+const std::vector<std::pair<std::string, ppp::Sample::Interpolation>>& interpolationNames()
+{
+  static const std::vector<std::pair<std::string, ppp::Sample::Interpolation>> names{
+    { "none", ppp::Sample::Interpolation::None },
+    { "linear", ppp::Sample::Interpolation::Linear },
+    { "cubic", ppp::Sample::Interpolation::Cubic },
+    { "hermite", ppp::Sample::Interpolation::Hermite },
+    { "sinc", ppp::Sample::Interpolation::Sinc }
+  };
+  return names;
+}
+
+const std::vector<std::pair<std::string, ppp::Sample::LoopType>>& loopNames()
+{
+  static const std::vector<std::pair<std::string, ppp::Sample::LoopType>> names{
+    { "none", ppp::Sample::LoopType::None },
+    { "forward", ppp::Sample::LoopType::Forward },
+    { "pingpong", ppp::Sample::LoopType::Pingpong }
+  };
+  return names;
+}
+
+const std::vector<std::pair<std::string, ppp::bench::Format>>& formatNames()
+{
+  static const std::vector<std::pair<std::string, ppp::bench::Format>> names{
+    { "mod", ppp::bench::Format::Mod },
+    { "s3m", ppp::bench::Format::S3m },
+    { "xm", ppp::bench::Format::Xm },
+    { "it", ppp::bench::Format::It }
+  };
+  return names;
+}
+
+bool isSelected(const std::vector<std::string>& selection, const std::string& name)
+{
+  return std::find( selection.begin(), selection.end(), name ) != selection.end();
+}
+
+std::string jsonString(const std::string& str)
+{
+  if( str.empty() )
+  {
+    return "null";
+  }
+  return '"' + jsonEscape( str ) + '"';
+}
+
+/**
+ * @brief Render a module until it ends or config::seconds of audio are rendered
+ */
+Result renderModule(const ppp::AbstractModule::Ptr& module)
+{
+  Result result;
+  result.frequency = config::frequency;
+
+  const auto maxFrames = static_cast<uint64_t>(config::seconds * config::frequency);
+  AudioFrameBuffer buffer( module->preferredBufferSize() );
+  const uint64_t allocations = s_allocations.load( std::memory_order_relaxed );
+  const auto start = Clock::now();
+  while( result.frames < maxFrames )
+  {
+    const size_t rendered = module->getAudioData( buffer.data(), buffer.size() );
+    result.frames += rendered;
+    if( rendered < buffer.size() )
+    {
+      break;
+    }
+  }
+  result.wallSeconds = std::chrono::duration<double>( Clock::now() - start ).count();
+  result.allocations = s_allocations.load( std::memory_order_relaxed ) - allocations;
+  result.processPeakRssKb = peakRssKb();
+  return result;
+}
+
+Result runSynthetic(ppp::bench::Format format,
+                    int channels,
+                    const std::pair<std::string, ppp::Sample::Interpolation>& inter,
+                    const std::pair<std::string, ppp::Sample::LoopType>& loop)
+{
+  // speed 6, tempo 125, 64 rows
+  static constexpr double PatternSeconds = 64 * 6 * 2.5 / 125;
+
+  ppp::bench::SynthSpec spec;
+  spec.format = format;
+  spec.channels = channels;
+  spec.loop = loop.second;
+  spec.orders = std::min( ppp::bench::maxOrders( format ),
+                          static_cast<int>(std::ceil( config::seconds / PatternSeconds )) + 1 );
+
+  Result result;
+  try
+  {
+    auto stream = ppp::bench::buildModule( spec );
+    ppp::AbstractModule::Ptr module;
+    switch( format )
+    {
+    case ppp::bench::Format::Mod:
+      module = ppp::mod::ModModule::factory( stream.get(), config::frequency, 1, inter.second );
+      break;
+    case ppp::bench::Format::S3m:
+      module = ppp::s3m::S3mModule::factory( stream.get(), config::frequency, 1, inter.second );
+      break;
+    case ppp::bench::Format::Xm:
+      module = ppp::xm::XmModule::factory( stream.get(), config::frequency, 1, inter.second );
+      break;
+    case ppp::bench::Format::It:
+      module = ppp::it::ItModule::factory( stream.get(), config::frequency, 1, inter.second );
+      break;
+    }
+
+    if( module )
+    {
+      result = renderModule( module );
+    }
+    else
+    {
+      result.error = "load failed";
+    }
+  }
+  catch( ... )
+  {
+    result.error = boost::current_exception_diagnostic_information();
+  }
+  result.kind = "synthetic";
+  result.format = ppp::bench::formatName( format );
+  result.channels = channels;
+  result.interpolation = inter.first;
+  result.loop = loop.first;
+  result.name = stringFmt( "%s/%dch/%s/%s", result.format, channels, inter.first, loop.first );
+  return result;
+}
+
+Result runOpl(int channels)
+{
+  const auto samples = static_cast<uint32_t>(config::seconds * opl::Opl3::SampleRate);
+  const auto script = ppp::bench::buildOplScript( channels, samples );
+
+  Result result;
+  result.kind = "synthetic";
+  result.format = "opl3";
+  result.channels = channels;
+  result.frequency = opl::Opl3::SampleRate;
+  result.name = stringFmt( "opl3/%dch", channels );
+
+  opl::Opl3 chip;
+  std::array<int16_t, 4> frame;
+  int64_t checksum = 0;
+  const uint64_t allocations = s_allocations.load( std::memory_order_relaxed );
+  const auto start = Clock::now();
+  for( const auto& write : script )
+  {
+    for( uint32_t i = 0; i < write.delay; i++ )
+    {
+      chip.read( &frame );
+      checksum += frame[0];
+    }
+    result.frames += write.delay;
+    chip.writeReg( write.reg, write.value );
+  }
+  result.wallSeconds = std::chrono::duration<double>( Clock::now() - start ).count();
+  result.allocations = s_allocations.load( std::memory_order_relaxed ) - allocations;
+  result.processPeakRssKb = peakRssKb();
+
+  s_sink = checksum;
+  return result;
+}
+
+Result runCorpusFile(const boost::filesystem::path& path,
+                     const std::string& relative,
+                     const std::pair<std::string, ppp::Sample::Interpolation>& inter)
+{
+  Result result;
+  try
+  {
+    if( auto module = ppp::tryLoad( path.string(), config::frequency, 1, inter.second ) )
+    {
+      result = renderModule( module );
+    }
+    else
+    {
+      result.error = "load failed";
+    }
+  }
+  catch( ... )
+  {
+    result.error = boost::current_exception_diagnostic_information();
+  }
+  result.kind = "corpus";
+  result.format = path.extension().string();
+  if( !result.format.empty() )
+  {
+    result.format.erase( 0, 1 );
+  }
+  result.interpolation = inter.first;
+  result.name = stringFmt( "corpus/%s/%s", relative, inter.first );
+  return result;
+}
+
+std::vector<Result> runAll()
+{
+  std::vector<Result> results;
+
+  if( !config::noSynthetic )
+  {
+    for( const auto& format : formatNames() )
+    {
+      if( !isSelected( config::formats, format.first ) )
+      {
+        continue;
+      }
+      for( int channels : config::channels )
+      {
+        if( !ppp::bench::supportsChannels( format.second, channels ) )
+        {
+          continue;
+        }
+        for( const auto& inter : interpolationNames() )
+        {
+          if( !isSelected( config::interpolations, inter.first ) )
+          {
+            continue;
+          }
+          for( const auto& loop : loopNames() )
+          {
+            if( !isSelected( config::loops, loop.first ) || !ppp::bench::supportsLoop( format.second, loop.second ) )
+            {
+              continue;
+            }
+            results.emplace_back( runSynthetic( format.second, channels, inter, loop ) );
+          }
+        }
+      }
+    }
+
+    if( isSelected( config::formats, "opl" ) )
+    {
+      std::vector<int> oplChannels;
+      for( int channels : config::channels )
+      {
+        channels = std::min( channels, 18 );
+        if( channels >= 1 && std::find( oplChannels.begin(), oplChannels.end(), channels ) == oplChannels.end() )
+        {
+          oplChannels.emplace_back( channels );
+        }
+      }
+      for( int channels : oplChannels )
+      {
+        results.emplace_back( runOpl( channels ) );
+      }
+    }
+  }
+
+  if( !config::corpus.empty() )
+  {
+    const boost::filesystem::path root( config::corpus );
+    std::vector<boost::filesystem::path> files;
+    for( boost::filesystem::recursive_directory_iterator it( root ), end; it != end; ++it )
+    {
+      if( boost::filesystem::is_regular_file( it->status() ) )
+      {
+        files.emplace_back( it->path() );
+      }
+    }
+    // directory iteration order is unspecified
+    std::sort( files.begin(), files.end() );
+
+    for( const auto& file : files )
+    {
+      const std::string relative = boost::filesystem::relative( file, root ).generic_string();
+      for( const auto& inter : interpolationNames() )
+      {
+        if( isSelected( config::interpolations, inter.first ) )
+        {
+          results.emplace_back( runCorpusFile( file, relative, inter ) );
+        }
+      }
+    }
+  }
+
+  return results;
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results)
+{
+  out << "{\n  \"version\": 2,\n";
+  out << boost::format( "  \"frequency\": %d,\n  \"seconds\": %.3f,\n" ) % config::frequency % config::seconds;
+  out << "  \"runs\": [";
+  for( size_t i = 0; i < results.size(); i++ )
+  {
+    const Result& r = results[i];
+    const double audioSeconds = r.frequency != 0 ? double( r.frames ) / r.frequency : 0;
+    out << (i == 0 ? "\n" : ",\n");
+    out << "    {\n";
+    out << "      \"name\": " << jsonString( r.name ) << ",\n";
+    out << "      \"kind\": " << jsonString( r.kind ) << ",\n";
+    out << "      \"format\": " << jsonString( r.format ) << ",\n";
+    out << "      \"channels\": " << r.channels << ",\n";
+    out << "      \"interpolation\": " << jsonString( r.interpolation ) << ",\n";
+    out << "      \"loop\": " << jsonString( r.loop ) << ",\n";
+    out << "      \"frames\": " << r.frames << ",\n";
+    out << boost::format( "      \"audio_s\": %.3f,\n" ) % audioSeconds;
+    out << boost::format( "      \"wall_s\": %.6f,\n" ) % r.wallSeconds;
+    out << boost::format( "      \"realtime_factor\": %.2f,\n" )
+      % (r.wallSeconds > 0 ? audioSeconds / r.wallSeconds : 0);
+    out << boost::format( "      \"ns_per_frame\": %.2f,\n" )
+      % (r.frames != 0 ? r.wallSeconds * 1e9 / r.frames : 0);
+    out << "      \"allocations\": " << r.allocations << ",\n";
+    out << boost::format( "      \"allocations_per_s\": %.1f,\n" )
+      % (r.wallSeconds > 0 ? r.allocations / r.wallSeconds : 0);
+    out << "      \"process_peak_rss_kb\": " << r.processPeakRssKb << ",\n";
+    out << "      \"error\": " << jsonString( r.error ) << "\n";
+    out << "    }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+bool parseCmdLine(int argc, char* argv[])
+{
+  boost::program_options::options_description opts( "Options" );
+  opts.add_options()
+        ( "help,h", "Shows this help and exits" )
+        ( "seconds,s",
+          boost::program_options::value<double>( &config::seconds )->default_value( config::seconds ),
+          "Maximum length of audio to render per run" )
+        ( "frequency",
+          boost::program_options::value<uint32_t>( &config::frequency )->default_value( config::frequency ),
+          "Output frequency of the module runs" )
+        ( "format",
+          boost::program_options::value<std::vector<std::string>>( &config::formats )->multitoken()
+                                                                                      ->default_value( config::formats,
+                                                                                                       "mod s3m xm it opl" ),
+          "Synthetic formats to run" )
+        ( "channels",
+          boost::program_options::value<std::vector<int>>( &config::channels )->multitoken()
+                                                                              ->default_value( config::channels,
+                                                                                               "4 8 16 32" ),
+          "Channel counts of the synthetic modules; counts a format cannot hold are skipped" )
+        ( "interpolation",
+          boost::program_options::value<std::vector<std::string>>( &config::interpolations )->multitoken()
+                                                                                             ->default_value(
+                                                                                               config::interpolations,
+                                                                                               "none linear cubic hermite sinc" ),
+          "Interpolation modes to run" )
+        ( "loop",
+          boost::program_options::value<std::vector<std::string>>( &config::loops )->multitoken()
+                                                                                    ->default_value( config::loops,
+                                                                                                     "none forward pingpong" ),
+          "Sample loop types of the synthetic modules" )
+        ( "corpus,c", boost::program_options::value<std::string>( &config::corpus ),
+          "Also render all files below this directory" )
+        ( "no-synthetic", "Only render the corpus" )
+        ( "output,o", boost::program_options::value<std::string>( &config::outputFilename ),
+          "Write the JSON results to this file instead of stdout" );
+
+  boost::program_options::variables_map vm;
+  boost::program_options::store( boost::program_options::parse_command_line( argc, argv, opts ), vm );
+  boost::program_options::notify( vm );
+
+  if( vm.count( "help" ) )
+  {
+    std::cout << opts << std::endl;
+    return false;
+  }
+  config::noSynthetic = vm.count( "no-synthetic" ) != 0;
+  if( config::seconds <= 0 || config::frequency == 0 )
+  {
+    BOOST_THROW_EXCEPTION( std::invalid_argument( "Length and frequency must be positive" ) );
+  }
+  return true;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    if( !parseCmdLine( argc, argv ) )
+    {
+      return EXIT_SUCCESS;
+    }
+    light4cxx::Logger::setLevel( light4cxx::Level::Off );
+
+    const auto results = runAll();
+    if( config::outputFilename.empty() )
+    {
+      writeJson( std::cout, results );
+    }
+    else
+    {
+      std::ofstream out( config::outputFilename );
+      writeJson( out, results );
+      if( !out )
+      {
+        std::cerr << "Error: Could not write " << config::outputFilename << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  catch( ... )
+  {
+    std::cerr << "Main: " << boost::current_exception_diagnostic_information() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,638 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "synthmodules.h"
+
+#include "stream/memorystream.h"
+#include "stuff/stringutils.h"
+#include "stuff/utils.h"
+#include "ymf262/opl3.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ppp
+{
+namespace bench
+{
+namespace
+{
+//! @brief Sample length in frames
+constexpr uint32_t SampleLength = 4096;
+//! @brief Rows per pattern
+constexpr int Rows = 64;
+//! @brief Distance between two notes in a channel
+constexpr int NoteRowStep = 8;
+//! @brief Semitone offsets of the notes that are cycled through
+constexpr int NoteOffsets[4] = { 0, 4, 7, 12 };
+//! @brief Amiga periods of the note offsets, starting at C-2
+constexpr uint16_t ModPeriods[4] = { 428, 339, 285, 214 };
+
+/**
+ * @class ByteWriter
+ * @brief Little helper to assemble binary files
+ */
+class ByteWriter
+{
+  DISABLE_COPY( ByteWriter )
+private:
+  std::vector<uint8_t> m_data{};
+public:
+  ByteWriter() = default;
+
+  size_t pos() const
+  {
+    return m_data.size();
+  }
+
+  void u8(uint8_t value)
+  {
+    m_data.push_back( value );
+  }
+
+  void u16(uint16_t value)
+  {
+    u8( value & 0xff );
+    u8( value >> 8 );
+  }
+
+  void u16be(uint16_t value)
+  {
+    u8( value >> 8 );
+    u8( value & 0xff );
+  }
+
+  void u32(uint32_t value)
+  {
+    u16( value & 0xffff );
+    u16( value >> 16 );
+  }
+
+  void fill(uint8_t value, size_t count)
+  {
+    m_data.insert( m_data.end(), count, value );
+  }
+
+  //! @brief Write a string, truncated or padded with NUL characters to @a length
+  void text(const std::string& str, size_t length)
+  {
+    for( size_t i = 0; i < length; i++ )
+    {
+      u8( i < str.length() ? static_cast<uint8_t>(str[i]) : 0 );
+    }
+  }
+
+  void align(size_t boundary)
+  {
+    while( m_data.size() % boundary != 0 )
+    {
+      u8( 0 );
+    }
+  }
+
+  void patch16(size_t at, uint16_t value)
+  {
+    BOOST_ASSERT( at + 2 <= m_data.size() );
+    m_data[at] = value & 0xff;
+    m_data[at + 1] = value >> 8;
+  }
+
+  void patch32(size_t at, uint32_t value)
+  {
+    patch16( at, value & 0xffff );
+    patch16( at + 2, value >> 16 );
+  }
+
+  std::unique_ptr<MemoryStream> toStream(const std::string& name) const
+  {
+    auto stream = std::make_unique<MemoryStream>( name );
+    stream->write( m_data.data(), m_data.size() );
+    stream->seek( 0 );
+    return stream;
+  }
+};
+
+/**
+ * @brief Signed 8-bit waveform with an integral number of periods in both halves
+ */
+std::vector<int8_t> waveform()
+{
+  std::vector<int8_t> result( SampleLength );
+  for( uint32_t i = 0; i < SampleLength; i++ )
+  {
+    const double phase = 2 * M_PI * 8 * i / SampleLength;
+    result[i] = static_cast<int8_t>(std::lround( 80 * std::sin( phase ) + 30 * std::sin( 3 * phase ) ));
+  }
+  return result;
+}
+
+bool isNoteRow(int row)
+{
+  return row % NoteRowStep == 0;
+}
+
+int noteIndex(int channel, int row)
+{
+  return (row / NoteRowStep + channel) % 4;
+}
+
+std::string title(const SynthSpec& spec)
+{
+  return stringFmt( "bench %dch", spec.channels );
+}
+
+std::unique_ptr<MemoryStream> buildMod(const SynthSpec& spec)
+{
+  ByteWriter w;
+  w.text( title( spec ), 20 );
+
+  w.text( "synth", 22 );
+  w.u16be( SampleLength / 2 );
+  w.u8( 0 );
+  w.u8( 64 );
+  if( spec.loop == Sample::LoopType::None )
+  {
+    w.u16be( 0 );
+    w.u16be( 1 );
+  }
+  else
+  {
+    w.u16be( SampleLength / 4 );
+    w.u16be( SampleLength / 4 );
+  }
+  for( int i = 1; i < 31; i++ )
+  {
+    w.fill( 0, 28 );
+    w.u16be( 1 );
+  }
+
+  w.u8( spec.orders );
+  w.u8( 0 );
+  w.fill( 0, 128 );
+  if( spec.channels == 4 )
+  {
+    w.text( "M.K.", 4 );
+  }
+  else if( spec.channels < 10 )
+  {
+    w.text( stringFmt( "%dCHN", spec.channels ), 4 );
+  }
+  else
+  {
+    w.text( stringFmt( "%dCH", spec.channels ), 4 );
+  }
+
+  for( int row = 0; row < Rows; row++ )
+  {
+    for( int chn = 0; chn < spec.channels; chn++ )
+    {
+      if( !isNoteRow( row ) )
+      {
+        w.u32( 0 );
+        continue;
+      }
+      const uint16_t period = ModPeriods[noteIndex( chn, row )];
+      w.u8( period >> 8 );
+      w.u8( period & 0xff );
+      w.u8( 1 << 4 );
+      w.u8( 0 );
+    }
+  }
+
+  for( int8_t value : waveform() )
+  {
+    w.u8( value );
+  }
+  return w.toStream( "bench.mod" );
+}
+
+std::unique_ptr<MemoryStream> buildS3m(const SynthSpec& spec)
+{
+  const int ordNum = spec.orders + (spec.orders & 1);
+
+  ByteWriter w;
+  w.text( title( spec ), 28 );
+  w.u8( 0x1a );
+  w.u8( 16 );
+  w.u16( 0 );
+  w.u16( ordNum );
+  w.u16( 1 );
+  w.u16( 1 );
+  w.u16( 0 );
+  w.u16( 0x1320 );
+  w.u16( 2 );
+  w.text( "SCRM", 4 );
+  w.u8( 64 );
+  w.u8( 6 );
+  w.u8( 125 );
+  w.u8( 0x80 | 48 );
+  w.u8( 0 );
+  w.u8( 0 );
+  w.fill( 0, 8 );
+  w.u16( 0 );
+  for( int i = 0; i < 32; i++ )
+  {
+    w.u8( i < spec.channels ? ((i & 1) << 3) | ((i / 2) & 7) : 0xff );
+  }
+
+  BOOST_ASSERT( w.pos() == 0x60 );
+  for( int i = 0; i < ordNum; i++ )
+  {
+    w.u8( i < spec.orders ? 0 : 0xff );
+  }
+  const size_t smpPtrPos = w.pos();
+  w.u16( 0 );
+  const size_t patPtrPos = w.pos();
+  w.u16( 0 );
+
+  w.align( 16 );
+  w.patch16( smpPtrPos, w.pos() / 16 );
+  w.u8( 1 );
+  w.text( "synth.smp", 12 );
+  const size_t memSegPos = w.pos();
+  w.fill( 0, 3 );
+  w.u32( SampleLength );
+  if( spec.loop == Sample::LoopType::None )
+  {
+    w.u32( 0 );
+    w.u32( 0 );
+  }
+  else
+  {
+    w.u32( SampleLength / 2 );
+    w.u32( SampleLength );
+  }
+  w.u8( 64 );
+  w.u8( 0 );
+  w.u8( 0 );
+  w.u8( spec.loop == Sample::LoopType::None ? 0 : 1 );
+  w.u32( 8363 );
+  w.fill( 0, 12 );
+  w.text( "synth", 28 );
+  w.text( "SCRS", 4 );
+
+  w.align( 16 );
+  w.patch16( patPtrPos, w.pos() / 16 );
+  const size_t patStart = w.pos();
+  w.u16( 0 );
+  for( int row = 0; row < Rows; row++ )
+  {
+    if( isNoteRow( row ) )
+    {
+      for( int chn = 0; chn < spec.channels; chn++ )
+      {
+        const int note = NoteOffsets[noteIndex( chn, row )];
+        w.u8( 0x20 | chn );
+        w.u8( ((4 + note / 12) << 4) | (note % 12) );
+        w.u8( 1 );
+      }
+    }
+    w.u8( 0 );
+  }
+  w.patch16( patStart, w.pos() - patStart );
+
+  w.align( 16 );
+  const size_t paragraph = w.pos() / 16;
+  w.patch16( memSegPos, paragraph >> 16 );
+  w.patch16( memSegPos + 1, paragraph & 0xffff );
+  for( int8_t value : waveform() )
+  {
+    w.u8( value + 128 );
+  }
+  return w.toStream( "bench.s3m" );
+}
+
+std::unique_ptr<MemoryStream> buildXm(const SynthSpec& spec)
+{
+  ByteWriter w;
+  w.text( "Extended Module: ", 17 );
+  w.text( title( spec ), 20 );
+  w.u8( 0x1a );
+  w.text( "ppplay_bench", 20 );
+  w.u16( 0x0104 );
+  w.u32( 20 + 256 );
+  w.u16( spec.orders );
+  w.u16( 0 );
+  w.u16( spec.channels );
+  w.u16( 1 );
+  w.u16( 1 );
+  w.u16( 1 );
+  w.u16( 6 );
+  w.u16( 125 );
+  w.fill( 0, 256 );
+
+  w.u32( 9 );
+  w.u8( 0 );
+  w.u16( Rows );
+  const size_t packedSizePos = w.pos();
+  w.u16( 0 );
+  const size_t patStart = w.pos();
+  for( int row = 0; row < Rows; row++ )
+  {
+    for( int chn = 0; chn < spec.channels; chn++ )
+    {
+      if( !isNoteRow( row ) )
+      {
+        w.u8( 0x80 );
+        continue;
+      }
+      w.u8( 0x83 );
+      w.u8( 49 + NoteOffsets[noteIndex( chn, row )] );
+      w.u8( 1 );
+    }
+  }
+  w.patch16( packedSizePos, w.pos() - patStart );
+
+  w.u32( 263 );
+  w.text( "synth", 22 );
+  w.u8( 0 );
+  w.u16( 1 );
+  w.u32( 40 );
+  w.fill( 0, 96 + 48 + 48 + 14 );
+  w.u16( 0 );
+  w.fill( 0, 22 );
+  static_assert( 4 + 22 + 1 + 2 + 4 + 96 + 48 + 48 + 14 + 2 + 22 == 263, "XM instrument header size" );
+
+  w.u32( SampleLength );
+  switch( spec.loop )
+  {
+  case Sample::LoopType::None:
+    w.u32( 0 );
+    w.u32( 0 );
+    break;
+  case Sample::LoopType::Forward:
+  case Sample::LoopType::Pingpong:
+    w.u32( SampleLength / 2 );
+    w.u32( SampleLength / 2 );
+    break;
+  }
+  w.u8( 64 );
+  w.u8( 0 );
+  w.u8( static_cast<uint8_t>(spec.loop) );
+  w.u8( 0x80 );
+  w.u8( 0 );
+  w.u8( 0 );
+  w.text( "synth", 22 );
+
+  int8_t prev = 0;
+  for( int8_t value : waveform() )
+  {
+    w.u8( value - prev );
+    prev = value;
+  }
+  return w.toStream( "bench.xm" );
+}
+
+std::unique_ptr<MemoryStream> buildIt(const SynthSpec& spec)
+{
+  ByteWriter w;
+  w.text( "IMPM", 4 );
+  w.text( title( spec ), 26 );
+  w.u16( 0x1004 );
+  w.u16( spec.orders );
+  w.u16( 0 );
+  w.u16( 1 );
+  w.u16( 1 );
+  w.u16( 0x0214 );
+  w.u16( 0x0214 );
+  w.u16( 0x09 ); // stereo, linear slides, sample mode
+  w.u16( 0 );
+  w.u8( 128 );
+  w.u8( 48 );
+  w.u8( 6 );
+  w.u8( 125 );
+  w.u8( 128 );
+  w.u8( 0 );
+  w.u16( 0 );
+  w.u32( 0 );
+  w.u32( 0 );
+  for( int i = 0; i < 64; i++ )
+  {
+    w.u8( i < spec.channels ? 32 : 32 | 128 );
+  }
+  w.fill( 64, 64 );
+
+  BOOST_ASSERT( w.pos() == 0xc0 );
+  w.fill( 0, spec.orders );
+  const size_t smpPtrPos = w.pos();
+  w.u32( 0 );
+  const size_t patPtrPos = w.pos();
+  w.u32( 0 );
+
+  w.patch32( smpPtrPos, w.pos() );
+  w.text( "IMPS", 4 );
+  w.text( "synth.smp", 12 );
+  w.u8( 0 );
+  w.u8( 64 );
+  switch( spec.loop )
+  {
+  case Sample::LoopType::None:
+    w.u8( 0x01 );
+    break;
+  case Sample::LoopType::Forward:
+    w.u8( 0x01 | 0x10 );
+    break;
+  case Sample::LoopType::Pingpong:
+    w.u8( 0x01 | 0x10 | 0x40 );
+    break;
+  }
+  w.u8( 64 );
+  w.text( "synth", 26 );
+  w.u8( 1 ); // signed samples
+  w.u8( 32 );
+  w.u32( SampleLength );
+  w.u32( spec.loop == Sample::LoopType::None ? 0 : SampleLength / 2 );
+  w.u32( spec.loop == Sample::LoopType::None ? 0 : SampleLength );
+  w.u32( 8363 );
+  w.u32( 0 );
+  w.u32( 0 );
+  const size_t dataPtrPos = w.pos();
+  w.u32( 0 );
+  w.fill( 0, 4 );
+
+  w.patch32( patPtrPos, w.pos() );
+  const size_t patLenPos = w.pos();
+  w.u16( 0 );
+  w.u16( Rows );
+  w.u32( 0 );
+  const size_t patStart = w.pos();
+  for( int row = 0; row < Rows; row++ )
+  {
+    if( isNoteRow( row ) )
+    {
+      for( int chn = 0; chn < spec.channels; chn++ )
+      {
+        w.u8( (chn + 1) | 0x80 );
+        w.u8( 0x03 );
+        w.u8( 60 + NoteOffsets[noteIndex( chn, row )] );
+        w.u8( 1 );
+      }
+    }
+    w.u8( 0 );
+  }
+  w.patch16( patLenPos, w.pos() - patStart );
+
+  w.patch32( dataPtrPos, w.pos() );
+  for( int8_t value : waveform() )
+  {
+    w.u8( value );
+  }
+  return w.toStream( "bench.it" );
+}
+}
+
+const char* formatName(Format format)
+{
+  switch( format )
+  {
+  case Format::Mod:
+    return "mod";
+  case Format::S3m:
+    return "s3m";
+  case Format::Xm:
+    return "xm";
+  case Format::It:
+    return "it";
+  default:
+    return "?";
+  }
+}
+
+bool supportsChannels(Format format, int channels)
+{
+  switch( format )
+  {
+  case Format::Mod:
+    // only the channel counts that have a known signature
+    return (channels >= 2 && channels < 10) || (channels >= 10 && channels <= 32 && channels % 2 == 0)
+      || channels == 11 || channels == 13 || channels == 15;
+  case Format::S3m:
+  case Format::Xm:
+    return channels >= 1 && channels <= 32;
+  case Format::It:
+    return channels >= 1 && channels <= 64;
+  default:
+    return false;
+  }
+}
+
+bool supportsLoop(Format format, Sample::LoopType loop)
+{
+  return loop != Sample::LoopType::Pingpong || format == Format::Xm || format == Format::It;
+}
+
+int maxOrders(Format format)
+{
+  switch( format )
+  {
+  case Format::Mod:
+    return 128;
+  case Format::S3m:
+    return 254;
+  case Format::Xm:
+    return 256;
+  case Format::It:
+    return 255;
+  default:
+    return 0;
+  }
+}
+
+std::unique_ptr<MemoryStream> buildModule(const SynthSpec& spec)
+{
+  BOOST_ASSERT( supportsChannels( spec.format, spec.channels ) );
+  BOOST_ASSERT( supportsLoop( spec.format, spec.loop ) );
+  BOOST_ASSERT( spec.orders >= 1 && spec.orders <= maxOrders( spec.format ) );
+  switch( spec.format )
+  {
+  case Format::Mod:
+    return buildMod( spec );
+  case Format::S3m:
+    return buildS3m( spec );
+  case Format::Xm:
+    return buildXm( spec );
+  case Format::It:
+    return buildIt( spec );
+  default:
+    return nullptr;
+  }
+}
+
+std::vector<OplWrite> buildOplScript(int channels, uint32_t samples)
+{
+  BOOST_ASSERT( channels >= 1 && channels <= 18 );
+
+  static constexpr uint8_t OperatorOffsets[9] = { 0x00, 0x01, 0x02, 0x08, 0x09, 0x0a, 0x10, 0x11, 0x12 };
+  // F-numbers of C, E, G and A at block 4
+  static constexpr uint16_t FNums[4] = { 0x158, 0x1b2, 0x204, 0x244 };
+  // a new note every quarter second
+  static constexpr uint32_t NoteStep = opl::Opl3::SampleRate / 4;
+
+  std::vector<OplWrite> script;
+  auto write = [&script](uint32_t delay, uint16_t reg, uint8_t value)
+  {
+    script.emplace_back( OplWrite{ delay, reg, value } );
+  };
+
+  write( 0, 0x105, 0x01 ); // OPL3 mode
+  write( 0, 0x104, 0x00 ); // no 4-op channels
+  write( 0, 0x001, 0x20 ); // waveform select
+  write( 0, 0x0bd, 0x00 ); // melodic mode
+
+  for( int chn = 0; chn < channels; chn++ )
+  {
+    const uint16_t base = (chn / 9) * 0x100;
+    const uint16_t op = base + OperatorOffsets[chn % 9];
+    for( uint16_t slot : { op, uint16_t( op + 3 ) } )
+    {
+      write( 0, 0x20 + slot, 0x21 ); // sustained, multiplier 1
+      write( 0, 0x60 + slot, 0xf3 );
+      write( 0, 0x80 + slot, 0x35 );
+    }
+    write( 0, 0x40 + op, 0x18 );
+    write( 0, 0x43 + op, 0x00 );
+    write( 0, 0xe0 + op, chn % 4 );
+    write( 0, 0xe3 + op, 0x00 );
+    write( 0, 0xc0 + base + chn % 9, 0x30 | (((chn % 7) + 1) << 1) );
+  }
+
+  uint32_t delay = 0;
+  for( uint32_t pos = 0; pos < samples; pos += NoteStep )
+  {
+    for( int chn = 0; chn < channels; chn++ )
+    {
+      const uint16_t reg = (chn / 9) * 0x100 + chn % 9;
+      const uint16_t fnum = FNums[(pos / NoteStep + chn) % 4];
+      write( delay, 0xb0 + reg, 0x00 );
+      delay = 0;
+      write( 0, 0xa0 + reg, fnum & 0xff );
+      write( 0, 0xb0 + reg, 0x20 | (4 << 2) | (fnum >> 8) );
+    }
+    delay = std::min( NoteStep, samples - pos );
+  }
+  if( delay != 0 )
+  {
+    // render the tail of the last note
+    write( delay, 0xb0, 0x00 );
+  }
+  return script;
+}
+}
+}
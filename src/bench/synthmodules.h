@@ -0,0 +1,127 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_SYNTHMODULES_H
+#define PPPLAY_SYNTHMODULES_H
+
+#include "genmod/sample.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class MemoryStream;
+
+namespace ppp
+{
+/**
+ * @ingroup Common
+ * @{
+ */
+
+/**
+ * @brief Synthetic workloads for the benchmark
+ *
+ * @details
+ * The generated modules are written byte by byte in their on-disk format, so
+ * that they go through the same loaders as real files. Every module consists
+ * of a single 64-row pattern that is repeated in all orders; each channel
+ * triggers a note every 8 rows, so that all voices are mixed all the time
+ * unless the sample is not looped.
+ */
+namespace bench
+{
+/**
+ * @brief Module formats that can be synthesized
+ */
+enum class Format
+{
+  Mod,
+  S3m,
+  Xm,
+  It
+};
+
+/**
+ * @struct SynthSpec
+ * @brief Parameters of a synthetic module
+ */
+struct SynthSpec
+{
+  Format format = Format::Mod;
+  int channels = 4;
+  Sample::LoopType loop = Sample::LoopType::Forward;
+  //! @brief Number of orders, each order plays the pattern once
+  int orders = 1;
+};
+
+/**
+ * @brief Get the lower-case name of a format
+ */
+const char* formatName(Format format);
+
+/**
+ * @brief Check if a format can hold the requested channel count
+ */
+bool supportsChannels(Format format, int channels);
+
+/**
+ * @brief Check if a format supports a loop type
+ */
+bool supportsLoop(Format format, Sample::LoopType loop);
+
+/**
+ * @brief Get the maximum number of orders of a format
+ */
+int maxOrders(Format format);
+
+/**
+ * @brief Build a module in memory
+ * @param[in] spec Module parameters
+ * @return Stream positioned at the start of the module
+ * @pre supportsChannels(spec.format, spec.channels) && supportsLoop(spec.format, spec.loop)
+ */
+std::unique_ptr<MemoryStream> buildModule(const SynthSpec& spec);
+
+/**
+ * @struct OplWrite
+ * @brief A single step of an OPL3 register script
+ */
+struct OplWrite
+{
+  //! @brief Number of samples to render before the register is written
+  uint32_t delay;
+  uint16_t reg;
+  uint8_t value;
+};
+
+/**
+ * @brief Build a raw OPL3 register script
+ * @param[in] channels Number of 2-operator channels to play (1..18)
+ * @param[in] samples Length of the script in samples at the OPL3 sample rate
+ * @return Register writes, starting with the chip setup
+ */
+std::vector<OplWrite> buildOplScript(int channels, uint32_t samples);
+}
+
+/**
+ * @}
+ */
+}
+
+#endif
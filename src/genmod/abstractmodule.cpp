@@ -25,7 +25,9 @@
 
 #include "orderentry.h"
 #include "channelstate.h"
+#include "samplecache.h"
 #include "stream/memarchive.h"
+#include "stuff/profiler.h"
 
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
@@ -36,7 +38,8 @@ namespace ppp
 AbstractModule::AbstractModule(int maxRpt, Sample::Interpolation inter)
   :
   m_metaInfo(), m_orders(), m_state(), m_songs(), m_maxRepeat( maxRpt ), m_isPreprocessing( false ), m_mutex()
-  , m_interpolation( inter )
+  , m_interpolation( inter ), m_snapshots(), m_prefetchedOrder( ~size_t( 0 ) )
+  , m_residual( std::make_shared<AudioFrameBuffer>() ), m_residualOffset( 0 )
 {
   BOOST_ASSERT_MSG( maxRpt != 0, "Maximum repeat count may not be 0" );
 }
@@ -51,6 +54,12 @@ AbstractArchive& AbstractModule::serialize(AbstractArchive* data)
     data->archive( order.get() );
   }
   data->archive( &m_state );
+  if( data->isLoading() )
+  {
+    // the remainder of the last tick belongs to the previous position
+    m_residual->clear();
+    m_residualOffset = 0;
+  }
   return *data;
 }
 
@@ -65,30 +74,33 @@ size_t AbstractModule::length() const
   return m_songs->length;
 }
 
-size_t AbstractModule::internal_getAudioData(AudioFrameBufferPtr& buffer, size_t size)
+size_t AbstractModule::internal_getAudioData(BasicSampleFrame* buffer, size_t size)
 {
-  if( !buffer )
-  {
-    buffer = std::make_shared<AudioFrameBuffer>();
-  }
+  // seeking drops the residual, and only holds m_mutex
+  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   if( m_isPreprocessing )
   {
-    buffer->clear();
-    buffer->resize( tickBufferLength() );
-    return tickBufferLength();
+    std::fill_n( buffer, size, BasicSampleFrame() );
+    return size;
   }
-  buffer->resize( 0 );
-  AudioFrameBufferPtr tmpBuf = std::make_shared<AudioFrameBuffer>();
-  while( buffer->size() < size )
+  size_t done = 0;
+  while( done < size )
   {
-    if( buildTick( tmpBuf ) == 0 || tmpBuf->empty() )
+    if( m_residualOffset >= m_residual->size() )
     {
-      // logger()->debug( L4CXX_LOCATION, "buildTick() returned 0" );
-      return 0;
+      m_residualOffset = 0;
+      if( buildTick( m_residual ) == 0 || m_residual->empty() )
+      {
+        m_residual->clear();
+        break;
+      }
     }
-    buffer->insert( buffer->end(), tmpBuf->begin(), tmpBuf->end() );
+    const size_t count = std::min( size - done, m_residual->size() - m_residualOffset );
+    std::copy_n( m_residual->begin() + m_residualOffset, count, buffer + done );
+    m_residualOffset += count;
+    done += count;
   }
-  return buffer->size();
+  return done;
 }
 
 size_t AbstractModule::internal_preferredBufferSize() const
@@ -98,13 +110,11 @@ size_t AbstractModule::internal_preferredBufferSize() const
 
 void AbstractModule::addOrder(std::unique_ptr<OrderEntry>&& o)
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   m_orders.emplace_back( std::move( o ) );
 }
 
 OrderEntry* AbstractModule::orderAt(size_t idx)
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   if( idx >= m_orders.size() )
   {
     logger()->error( L4CXX_LOCATION, "Requested order index out of range: %d >= %d", idx, m_orders.size() );
@@ -115,7 +125,6 @@ OrderEntry* AbstractModule::orderAt(size_t idx)
 
 size_t AbstractModule::orderCount() const noexcept
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   return m_orders.size();
 }
 
@@ -126,7 +135,6 @@ int AbstractModule::maxRepeat() const noexcept
 
 bool AbstractModule::setOrder(size_t newOrder)
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   const bool orderChanged = (newOrder != m_state.order);
   if( orderChanged && m_state.order < orderCount() )
   {
@@ -148,20 +156,17 @@ bool AbstractModule::setOrder(size_t newOrder)
 
 void AbstractModule::setRow(int16_t r) noexcept
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   m_state.row = r;
 }
 
 void AbstractModule::nextTick()
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   BOOST_ASSERT_MSG( m_state.speed != 0, "Data corruption: speed==0" );
   m_state.tick = (m_state.tick + 1) % m_state.speed;
 }
 
 void AbstractModule::setTempo(uint8_t t) noexcept
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   if( t == 0 )
     return;
   m_state.tempo = t;
@@ -169,7 +174,6 @@ void AbstractModule::setTempo(uint8_t t) noexcept
 
 void AbstractModule::setSpeed(uint8_t s) noexcept
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   if( s == 0 )
     return;
   m_state.speed = s;
@@ -205,9 +209,9 @@ bool AbstractModule::seekForward()
   {
     logger()->debug( L4CXX_LOCATION, "Already preprocessed - loading" );
     m_songs->states.next()->archive( this ).finishLoad();
+    publishSnapshot();
     return true;
   }
-  lock.unlock();
   BOOST_ASSERT( !m_isPreprocessing );
   m_isPreprocessing = true;
   // maybe not processed yet, so try to jump to the next order...
@@ -228,6 +232,7 @@ bool AbstractModule::seekForward()
     }
   };
   m_isPreprocessing = false;
+  publishSnapshot();
   return true;
 }
 
@@ -238,23 +243,59 @@ bool AbstractModule::seekBackward()
   {
     logger()->debug( L4CXX_LOCATION, "Seeking backward" );
     m_songs->states.prev()->archive( this ).finishLoad();
+    publishSnapshot();
     return true;
   }
   else if( !m_songs->states.empty() )
   {
     logger()->debug( L4CXX_LOCATION, "Resetting current seek position" );
     m_songs->states->archive( this ).finishLoad();
+    publishSnapshot();
     return true;
   }
   else if( m_songs.atFront() )
   {
     m_songs->states->archive( this ).finishLoad();
+    publishSnapshot();
     return true;
   }
   logger()->info( L4CXX_LOCATION, "Failed to seek backward" );
   return false;
 }
 
+size_t AbstractModule::seekStateCount() const
+{
+  std::lock_guard<std::recursive_mutex> lock( m_mutex );
+  return m_songs.isDangling() ? 0 : m_songs->states.size();
+}
+
+bool AbstractModule::restoreSeekState(size_t idx)
+{
+  std::lock_guard<std::recursive_mutex> lock( m_mutex );
+  if( idx >= seekStateCount() )
+  {
+    return false;
+  }
+  m_songs->states.revert();
+  for( size_t i = 0; i < idx; i++ )
+  {
+    m_songs->states.next();
+  }
+  m_songs->states->archive( this ).finishLoad();
+  publishSnapshot();
+  return true;
+}
+
+bool AbstractModule::hasExactSeekStates() const
+{
+  return internal_hasExactSeekStates();
+}
+
+bool AbstractModule::internal_hasExactSeekStates() const
+{
+  return false;
+}
+
 bool AbstractModule::jumpNextSong()
 {
   std::lock_guard<std::recursive_mutex> lock( m_mutex );
@@ -291,6 +332,7 @@ bool AbstractModule::jumpNextSong()
   m_songs->states.current()->archive( this ).finishLoad();
   m_state.pattern = orderAt( m_state.order )->index();
   m_isPreprocessing = false;
+  publishSnapshot();
   return true;
 }
 
@@ -310,6 +352,7 @@ bool AbstractModule::jumpPrevSong()
   --m_songs;
   m_songs->states.revert();
   m_songs->states.current()->archive( this ).finishLoad();
+  publishSnapshot();
   return true;
 }
 
@@ -331,15 +374,18 @@ bool AbstractModule::internal_initialize(uint32_t)
     logger()->info( L4CXX_LOCATION, "Song preprocessed, trying to jump to the next song." );
   }
   logger()->info( L4CXX_LOCATION, "Lengths calculated, resetting module." );
+  std::lock_guard<std::recursive_mutex> lock( m_mutex );
   m_songs.revert();
   m_songs->states.revert();
   m_songs->states->archive( this ).finishLoad();
+  publishSnapshot();
   return true;
 }
 
 size_t AbstractModule::buildTick(const AudioFrameBufferPtr& buffer)
 {
   std::lock_guard<std::recursive_mutex> lock( m_mutex );
+  profile::ScopedTimer timer( profile::Stage::Render );
 
   if( m_songs->states.empty() )
   {
@@ -352,7 +398,49 @@ size_t AbstractModule::buildTick(const AudioFrameBufferPtr& buffer)
     logger()->debug( L4CXX_LOCATION, "Stored song state for %ds", m_songs->storedSeconds() );
   }
 
-  return internal_buildTick( buffer );
+  const size_t length = internal_buildTick( buffer );
+  if( buffer && !m_isPreprocessing )
+  {
+    publishSnapshot();
+    profile::count( profile::Counter::Ticks );
+    profile::count( profile::Counter::Frames, length );
+    if( m_state.order != m_prefetchedOrder )
+    {
+      m_prefetchedOrder = m_state.order;
+      if( SampleCache::instance().isEnabled() && m_state.order + 1 < orderCount() )
+      {
+        internal_prefetch( m_state.order + 1 );
+      }
+    }
+  }
+  return length;
+}
+
+void AbstractModule::internal_prefetch(size_t)
+{
+}
+
+void AbstractModule::publishSnapshot()
+{
+  Snapshot& snapshot = m_snapshots.writeBuffer();
+  snapshot.state = m_state;
+  snapshot.channels.resize( internal_channelCount() );
+  for( size_t i = 0; i < snapshot.channels.size(); i++ )
+  {
+    snapshot.channels[i] = internal_channelStatus( i );
+  }
+  snapshot.songCount = m_songs.size();
+  if( snapshot.songCount != 0 )
+  {
+    snapshot.length = m_songs->length;
+    snapshot.songIndex = m_songs.where();
+  }
+  m_snapshots.publish();
+}
+
+const AbstractModule::Snapshot& AbstractModule::snapshot() const
+{
+  return m_snapshots.read();
 }
 
 int AbstractModule::channelCount() const
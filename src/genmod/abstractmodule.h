@@ -19,8 +19,10 @@
 */
 
 #include "modulestate.h"
+#include "channelstate.h"
 #include <output/abstractaudiosource.h>
 #include <stuff/trackingcontainer.h>
+#include <stuff/triplebuffer.h>
 #include "songinfo.h"
 #include "sample.h"
 
@@ -28,8 +30,6 @@
 
 namespace ppp
 {
-struct ChannelState;
-
 /**
  * @ingroup GenMod
  * @{
@@ -40,7 +40,6 @@ class OrderEntry;
 /**
  * @class GenModule
  * @brief An abstract class for all module classes
- * @todo Create a function to retrieve only the module's title without loading the whole module
  * @todo Multi-song: Reset module/channels on each new song?
  */
 class AbstractModule
@@ -73,6 +72,52 @@ public:
     std::string trackerInfo;
   };
 
+  /**
+   * @class ProbeInfo
+   * @brief Meta information gathered from the module headers only
+   *
+   * @details
+   * Filled in by the formats' @c probe() functions, which neither parse the
+   * patterns nor decode any sample data.
+   */
+  struct ProbeInfo
+    : public MetaInfo
+  {
+    //! @brief Short name of the format, e.g. @c "xm"
+    std::string format{};
+    //! @brief Number of channels
+    int channels = 0;
+    //! @brief Number of orders
+    size_t orders = 0;
+    //! @brief Number of patterns
+    size_t patterns = 0;
+    //! @brief Number of samples
+    size_t samples = 0;
+    //! @brief Number of instruments, 0 if the format has none
+    size_t instruments = 0;
+    //! @brief Sample names, including empty ones
+    std::vector<std::string> sampleNames{};
+  };
+
+  /**
+   * @class Snapshot
+   * @brief Playback information published by the rendering thread once per tick
+   * @see snapshot()
+   */
+  struct Snapshot
+  {
+    //! @brief Module state after the last rendered tick
+    ModuleState state{};
+    //! @brief Channel states after the last rendered tick
+    std::vector<ChannelState> channels{};
+    //! @brief Length of the current song in sample frames
+    size_t length = 0;
+    //! @brief Index of the current song
+    size_t songIndex = 0;
+    //! @brief Number of songs
+    size_t songCount = 0;
+  };
+
 private:
   MetaInfo m_metaInfo;
   //! @brief Order list
@@ -82,8 +127,16 @@ private:
   //! @brief Maximum module loops if module patterns are played multiple times
   const int m_maxRepeat;
   bool m_isPreprocessing;
+  //! @brief Serializes tick rendering against seeking and song changes
   mutable std::recursive_mutex m_mutex;
   Sample::Interpolation m_interpolation;
+  //! @brief Snapshots for lock-free consumers, filled while m_mutex is held
+  mutable TripleBuffer<Snapshot> m_snapshots;
+  //! @brief Order whose successor was passed to internal_prefetch() last
+  size_t m_prefetchedOrder;
+  //! @brief The last rendered tick, its frames from m_residualOffset on were not requested yet; guarded by m_mutex
+  AudioFrameBufferPtr m_residual;
+  size_t m_residualOffset;
 public:
   //BEGIN Construction/destruction
   /**
@@ -176,6 +229,27 @@ public:
    */
   bool seekBackward();
 
+  /**
+   * @brief Get the number of stored seek states of the current song
+   * @return Number of states, available after initialization
+   * @see restoreSeekState()
+   */
+  size_t seekStateCount() const;
+
+  /**
+   * @brief Continue playback from a stored seek state of the current song
+   * @param[in] idx Index of the state, states are stored every 15 seconds
+   * @return @c false if @a idx is out of range
+   * @see seekStateCount()
+   *
+   * @details
+   * Seeking forward and backward continues from the restored state.
+   */
+  bool restoreSeekState(size_t idx);
+
+  //! @copydoc internal_hasExactSeekStates
+  bool hasExactSeekStates() const;
+
   /**
    * @}
    */
@@ -190,6 +264,14 @@ public:
     return m_state;
   }
 
+  /**
+   * @brief Get the most recently published playback snapshot
+   * @return Reference to the snapshot, valid until the next call
+   * @note Never blocks the rendering thread, but must only be called from a single
+   *       consumer thread (i.e., the UI).
+   */
+  const Snapshot& snapshot() const;
+
   //! @copydoc internal_channelStatus
   ChannelState channelStatus(size_t idx) const;
 
@@ -302,6 +384,12 @@ private:
   //! @copydoc internal_buildTick
   size_t buildTick(const AudioFrameBufferPtr& buffer);
 
+  /**
+   * @brief Publishes the current playback state to snapshot() consumers
+   * @pre m_mutex is held by the caller
+   */
+  void publishSnapshot();
+
   bool internal_initialize(uint32_t frq) override final;
 
   /**
@@ -317,6 +405,14 @@ private:
    */
   virtual int internal_channelCount() const = 0;
 
+  /**
+   * @brief Check whether playback continues from a seek state exactly as it would have
+   * @retval true if the seek states contain the full channel state
+   * @retval false by default, e.g. when the states are recorded while only estimating
+   *         the song length and the channels are not updated
+   */
+  virtual bool internal_hasExactSeekStates() const;
+
   /**
    * @brief Get a tick
    * @param[out] buffer Pointer to the destination buffer or @c NULL to to only length estimation
@@ -333,12 +429,24 @@ private:
    */
   virtual size_t internal_buildTick(const AudioFrameBufferPtr& buffer) = 0;
 
+  /**
+   * @brief Decode the lazily decoded samples an order is going to use
+   * @param[in] order Index of the order
+   * @see SampleCache
+   *
+   * @details
+   * Called during playback with the order following the current one, so that
+   * its samples are decoded ahead of their first trigger. The default
+   * implementation does nothing.
+   */
+  virtual void internal_prefetch(size_t order);
+
   /**
    * @copydoc IAudioSource::getAudioData()
-   * @note The buffer will contain full ticks, so the buffer will generally
-   * have a different size as requested with @a requestedFrames.
+   * @note Ticks are split across calls, the frames of a tick that do not fit
+   * into @a buffer are returned by the next call.
    */
-  size_t internal_getAudioData(AudioFrameBufferPtr& buffer, size_t requestedFrames) override;
+  size_t internal_getAudioData(BasicSampleFrame* buffer, size_t requestedFrames) override;
 
   /**
    * @copydoc IAudioSource::preferredBufferSize()
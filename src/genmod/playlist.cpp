@@ -0,0 +1,320 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "playlist.h"
+
+#include "stream/archiveindex.h"
+
+#include <boost/exception/diagnostic_information.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+
+namespace ppp
+{
+namespace
+{
+constexpr size_t None = ~size_t( 0 );
+
+/**
+ * @brief Estimate the memory of a loaded module
+ * @param[in] filename Filename of the module, may point into an archive
+ * @return The size of the file or the uncompressed size of the archive member, 0 if unknown
+ */
+size_t estimateBytes(const std::string& filename)
+{
+  boost::filesystem::path path( filename );
+  boost::filesystem::path memberPath;
+  boost::system::error_code ec;
+  while( !path.empty() && !boost::filesystem::is_regular_file( path, ec ) )
+  {
+    memberPath = path.filename() / memberPath;
+    path = path.parent_path();
+  }
+  if( path.empty() )
+  {
+    return 0;
+  }
+  if( !memberPath.empty() )
+  {
+    const auto index = ArchiveIndex::get( path.string() );
+    const ArchiveIndex::Member* member = index ? index->find( memberPath.string() ) : nullptr;
+    return member != nullptr && member->size >= 0 ? static_cast<size_t>(member->size) : 0;
+  }
+  const auto size = boost::filesystem::file_size( path, ec );
+  return ec ? 0 : static_cast<size_t>(size);
+}
+}
+
+Playlist::Playlist(const std::vector<std::string>& filenames, const Loader& loader, size_t preload, size_t budget, size_t jobs)
+  : AbstractAudioSource(), m_entries(), m_loader( loader ), m_preload( preload ), m_budget( budget ), m_jobs( std::max<size_t>( jobs, 1 ) )
+{
+  m_entries.reserve( filenames.size() );
+  for( const std::string& filename: filenames )
+  {
+    m_entries.emplace_back( Entry{ filename, estimateBytes( filename ) } );
+  }
+}
+
+Playlist::~Playlist()
+{
+  stop();
+}
+
+bool Playlist::internal_initialize(uint32_t frequency)
+{
+  if( !m_workers.empty() )
+  {
+    return true;
+  }
+
+  std::unique_lock<std::mutex> lock( m_mutex );
+  // the first entry is needed right away
+  if( m_current < m_entries.size() && m_entries[m_current].state == State::Queued )
+  {
+    m_entries[m_current].state = State::Loading;
+    load( lock, m_current );
+  }
+
+  // even without preloading, the entries are loaded by the workers
+  for( size_t i = 0; i < m_jobs; i++ )
+  {
+    m_workers.emplace_back( &Playlist::work, this );
+  }
+  if( m_current < m_entries.size() && m_entries[m_current].state != State::Ready )
+  {
+    advance( lock );
+  }
+  if( m_current >= m_entries.size() )
+  {
+    logger()->error( L4CXX_LOCATION, "None of the %d entries could be loaded for %d Hz", m_entries.size(), frequency );
+    lock.unlock();
+    stop();
+    return false;
+  }
+  return true;
+}
+
+void Playlist::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  for( std::thread& worker: m_workers )
+  {
+    worker.join();
+  }
+  m_workers.clear();
+}
+
+size_t Playlist::nextToLoad() const
+{
+  // advance() is waiting for it
+  if( m_current < m_entries.size() && m_entries[m_current].state == State::Queued )
+  {
+    return m_current;
+  }
+
+  size_t ahead = 0;
+  size_t bytes = 0;
+  for( size_t i = m_current + 1; i < m_entries.size() && ahead < m_preload; i++ )
+  {
+    const Entry& entry = m_entries[i];
+    if( entry.state == State::Failed )
+    {
+      continue;
+    }
+    ++ahead;
+    if( entry.state != State::Queued )
+    {
+      bytes += entry.bytes;
+      continue;
+    }
+    // entries are loaded in order, so a large one is not overtaken by smaller ones
+    if( ahead == 1 || m_budget == 0 || bytes + entry.bytes <= m_budget )
+    {
+      return i;
+    }
+    return None;
+  }
+  return None;
+}
+
+void Playlist::work()
+{
+  std::unique_lock<std::mutex> lock( m_mutex );
+  while( true )
+  {
+    size_t index = None;
+    m_condition.wait( lock, [this, &index]() {
+      return m_stop || (index = nextToLoad()) != None;
+    } );
+    if( m_stop )
+    {
+      return;
+    }
+    m_entries[index].state = State::Loading;
+    load( lock, index );
+  }
+}
+
+void Playlist::load(std::unique_lock<std::mutex>& lock, size_t index)
+{
+  BOOST_ASSERT( m_entries[index].state == State::Loading );
+  const std::string filename = m_entries[index].filename;
+  lock.unlock();
+
+  logger()->debug( L4CXX_LOCATION, "Loading entry %d: '%s'", index, filename );
+  AbstractModule::Ptr module;
+  try
+  {
+    module = m_loader( filename );
+  }
+  catch( ... )
+  {
+    logger()->error( L4CXX_LOCATION, "Exception while loading '%s': %s", filename, boost::current_exception_diagnostic_information() );
+  }
+  if( module && module->frequency() != frequency() )
+  {
+    logger()->error( L4CXX_LOCATION, "'%s' is not initialized for %d Hz", filename, frequency() );
+    module.reset();
+  }
+
+  lock.lock();
+  Entry& entry = m_entries[index];
+  if( module )
+  {
+    entry.module = std::move( module );
+    entry.state = State::Ready;
+  }
+  else
+  {
+    logger()->warn( L4CXX_LOCATION, "Failed to load '%s', skipping it", filename );
+    entry.state = State::Failed;
+  }
+  m_condition.notify_all();
+}
+
+void Playlist::advance(std::unique_lock<std::mutex>& lock)
+{
+  if( m_current < m_entries.size() )
+  {
+    Entry& entry = m_entries[m_current];
+    entry.module.reset();
+    if( entry.state == State::Ready )
+    {
+      entry.state = State::Played;
+    }
+  }
+
+  while( ++m_current < m_entries.size() )
+  {
+    // the preloading window moved
+    m_condition.notify_all();
+
+    // the loading is left to the workers, nextToLoad() picks a queued playing entry first
+    Entry& entry = m_entries[m_current];
+    if( entry.state == State::Queued || entry.state == State::Loading )
+    {
+      logger()->info( L4CXX_LOCATION, "Waiting for '%s' to be loaded", entry.filename );
+      m_condition.wait( lock, [this, &entry]() {
+        return m_stop || entry.state == State::Ready || entry.state == State::Failed;
+      } );
+      if( m_stop )
+      {
+        m_current = m_entries.size();
+        return;
+      }
+    }
+
+    if( entry.state == State::Ready )
+    {
+      logger()->info( L4CXX_LOCATION, "Playing entry %d of %d: '%s'", m_current + 1, m_entries.size(), entry.filename );
+      return;
+    }
+  }
+  logger()->info( L4CXX_LOCATION, "End of the playlist" );
+}
+
+size_t Playlist::internal_getAudioData(BasicSampleFrame* buffer, size_t requestedFrames)
+{
+  std::unique_lock<std::mutex> lock( m_mutex );
+  if( m_skip )
+  {
+    m_skip = false;
+    advance( lock );
+  }
+
+  size_t done = 0;
+  while( done < requestedFrames && m_current < m_entries.size() )
+  {
+    const AbstractModule::Ptr module = m_entries[m_current].module;
+    lock.unlock();
+    done += module->getAudioData( buffer + done, requestedFrames - done );
+    const bool songEnded = done < requestedFrames;
+    // a module may contain several songs
+    const bool nextSong = songEnded && module->jumpNextSong();
+    lock.lock();
+    if( songEnded && !nextSong )
+    {
+      advance( lock );
+    }
+  }
+  return done;
+}
+
+size_t Playlist::internal_preferredBufferSize() const
+{
+  const AbstractModule::Ptr module = current();
+  return module ? module->preferredBufferSize() : 0;
+}
+
+AbstractModule::Ptr Playlist::current() const
+{
+  std::lock_guard<std::mutex> lock( m_mutex );
+  if( m_current >= m_entries.size() )
+  {
+    return nullptr;
+  }
+  return m_entries[m_current].module;
+}
+
+size_t Playlist::currentIndex() const
+{
+  std::lock_guard<std::mutex> lock( m_mutex );
+  return m_current;
+}
+
+bool Playlist::skip()
+{
+  std::lock_guard<std::mutex> lock( m_mutex );
+  if( m_current + 1 >= m_entries.size() )
+  {
+    return false;
+  }
+  m_skip = true;
+  return true;
+}
+
+light4cxx::Logger* Playlist::logger()
+{
+  return light4cxx::Logger::get( "module.playlist" );
+}
+}
@@ -0,0 +1,182 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_PLAYLIST_H
+#define PPPLAY_PLAYLIST_H
+
+#include "abstractmodule.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ppp
+{
+/**
+ * @ingroup GenMod
+ * @{
+ */
+
+/**
+ * @class Playlist
+ * @brief Plays several modules back to back
+ *
+ * @details
+ * While an entry is playing, worker threads load the following entries, so
+ * that the loading and the song length pre-calculation are done before they
+ * are needed. When the playing module ends, the buffer is filled up from the
+ * next module within the same call, so there is no gap between the entries.
+ *
+ * The number of loaded entries ahead of the playing one is limited, and so is
+ * their memory, estimated from the size of their files; the entry directly
+ * following the playing one is loaded regardless of the memory limit, and an
+ * entry within an archive is estimated by its uncompressed size.
+ *
+ * Apart from the first entry, which initialize() loads on the calling thread,
+ * modules are only loaded by the worker threads, even without preloading; if
+ * the next entry is not loaded in time, the output waits for it.
+ */
+class Playlist
+  : public AbstractAudioSource
+{
+public:
+  DISABLE_COPY( Playlist )
+
+  //! @brief Loads and initializes the module of an entry
+  typedef std::function<AbstractModule::Ptr(const std::string& filename)> Loader;
+
+  /**
+   * @brief Constructor
+   * @param[in] filenames The entries
+   * @param[in] loader Loads the entries, called from the worker threads
+   * @param[in] preload Number of entries to load ahead of the playing one
+   * @param[in] budget Memory in bytes the entries loaded ahead may take, 0 for no limit
+   * @param[in] jobs Number of worker threads
+   */
+  Playlist(const std::vector<std::string>& filenames,
+           const Loader& loader,
+           size_t preload = 2,
+           size_t budget = 0,
+           size_t jobs = 1);
+
+  ~Playlist() override;
+
+  /**
+   * @brief Get the playing module
+   * @return The module, or @c nullptr if the playlist has ended
+   */
+  AbstractModule::Ptr current() const;
+
+  /**
+   * @brief Get the index of the playing entry
+   * @return The index, equal to size() if the playlist has ended
+   */
+  size_t currentIndex() const;
+
+  size_t size() const noexcept
+  {
+    return m_entries.size();
+  }
+
+  const std::string& filename(size_t index) const
+  {
+    return m_entries.at( index ).filename;
+  }
+
+  /**
+   * @brief Stop the playing entry and continue with the next one
+   * @return @c false if there is no next entry
+   *
+   * @note The switch happens with the next request for audio data.
+   */
+  bool skip();
+
+private:
+  enum class State
+  {
+    Queued,
+    Loading,
+    Ready,
+    Failed,
+    Played
+  };
+
+  struct Entry
+  {
+    std::string filename;
+    //! @brief Estimated memory of the loaded module
+    size_t bytes;
+    State state = State::Queued;
+    AbstractModule::Ptr module{};
+  };
+
+  std::vector<Entry> m_entries;
+  Loader m_loader;
+  size_t m_preload;
+  size_t m_budget;
+  size_t m_jobs;
+  std::vector<std::thread> m_workers{};
+  //! @brief Guards the entries and the book-keeping below
+  mutable std::mutex m_mutex{};
+  std::condition_variable m_condition{};
+  size_t m_current = 0;
+  //! @brief Set by skip(), entries are only advanced by the rendering thread
+  bool m_skip = false;
+  bool m_stop = false;
+
+  bool internal_initialize(uint32_t frequency) override;
+  size_t internal_getAudioData(BasicSampleFrame* buffer, size_t requestedFrames) override;
+  size_t internal_preferredBufferSize() const override;
+
+  //! @brief Worker thread body
+  void work();
+
+  /**
+   * @brief Find the next entry a worker may load
+   * @return The index, or @c ~0 if there is none
+   */
+  size_t nextToLoad() const;
+
+  /**
+   * @brief Load an entry marked as State::Loading
+   * @param[in,out] lock Lock of m_mutex, released while loading
+   * @param[in] index Index of the entry
+   */
+  void load(std::unique_lock<std::mutex>& lock, size_t index);
+
+  /**
+   * @brief Release the playing entry and continue with the next one that could be loaded
+   * @param[in,out] lock Lock of m_mutex, released while waiting for an entry
+   */
+  void advance(std::unique_lock<std::mutex>& lock);
+
+  //! @brief Stop and join the worker threads
+  void stop();
+
+  static light4cxx::Logger* logger();
+};
+
+/**
+ * @}
+ */
+}
+
+#endif
@@ -17,6 +17,20 @@
 */
 
 #include "sample.h"
+#include "samplecache.h"
+
+#include "stream/mappedfile.h"
+#include "stream/mappedstream.h"
+#include "stuff/profiler.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace ppp
 {
@@ -24,71 +38,76 @@ namespace ppp
  * @ingroup GenMod
  * @{
  */
+Sample::~Sample() noexcept
+{
+  if( m_lazy )
+  {
+    SampleCache::instance().remove( this );
+  }
+}
+
 light4cxx::Logger* Sample::logger()
 {
   return light4cxx::Logger::get( "sample" );
 }
 
-AudioFrameBuffer Sample::readNonInterpolated(ppp::Stepper& stepper,
-                                             size_t requestedLen,
-                                             size_t limitMin,
-                                             size_t limitMax,
-                                             bool reverse) const
+bool Sample::isResident() const
 {
-  AudioFrameBuffer result;
-  while( requestedLen-- )
-  {
-    if( !reverse && stepper.trunc() >= 0 && static_cast<size_t>(stepper.trunc()) >= limitMax )
-    {
-      return result;
-    }
-    else if( reverse && (stepper.trunc() < 0 || static_cast<size_t>(stepper.trunc()) < limitMin) )
-    {
-      return result;
-    }
+  return !m_lazy || std::atomic_load( &m_lazy->frames ) != nullptr;
+}
 
-    result.emplace_back( sampleAt( stepper.trunc() ) );
-    if( !reverse )
-    {
-      stepper.next();
-    }
-    else
-    {
-      stepper.prev();
-    }
+void Sample::prefetch() const
+{
+  if( m_lazy )
+  {
+    SampleCache::instance().prefetch( this );
   }
-  return result;
 }
 
-AudioFrameBuffer Sample::readLinearInterpolated(ppp::Stepper& stepper,
-                                                size_t requestedLen,
-                                                size_t limitMin,
-                                                size_t limitMax,
-                                                bool reverse) const
+bool Sample::deferDecoding(Stream* stream, size_t length, size_t size, Decoder decoder)
 {
-  AudioFrameBuffer result;
-  while( requestedLen-- )
+  if( !SampleCache::instance().isEnabled() )
   {
-    if( !reverse && stepper.trunc() >= 0 && static_cast<size_t>(stepper.trunc()) >= limitMax )
-    {
-      return result;
-    }
-    else if( reverse && (stepper.trunc() < 0 || static_cast<size_t>(stepper.trunc()) < limitMin) )
-    {
-      return result;
-    }
+    return false;
+  }
+  const auto* mapped = dynamic_cast<const MappedStream*>(stream);
+  if( mapped == nullptr || !mapped->isOpen() || stream->pos() < 0 )
+  {
+    return false;
+  }
+  const size_t offset = stream->pos();
+  if( offset > mapped->file()->size() || size > mapped->file()->size() - offset )
+  {
+    return false;
+  }
+  m_data.assign( 2 * GuardFrames, BasicSampleFrame() );
+  m_data.shrink_to_fit();
+  m_lazy.reset( new LazyData{ mapped->file(), offset, length, std::move( decoder ), nullptr } );
+  return true;
+}
 
-    result.emplace_back( stepper.biased( sampleAt( stepper.trunc() ), sampleAt( 1u + stepper.trunc() ) ) );
-    if( !reverse )
-    {
-      stepper.next();
-    }
-    else
-    {
-      stepper.prev();
-    }
+std::shared_ptr<const BasicSampleFrame::Vector> Sample::lazyFrames() const
+{
+  BOOST_ASSERT( m_lazy != nullptr );
+  // no locking here, the cache only looks at the time when it evicts data
+  m_lazy->lastUse.store( std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed );
+  auto frames = std::atomic_load( &m_lazy->frames );
+  if( !frames )
+  {
+    auto decoded = std::make_shared<BasicSampleFrame::Vector>( m_lazy->length + 2 * GuardFrames );
+    MappedStream stream( m_lazy->file, m_title );
+    stream.seek( m_lazy->offset );
+    m_lazy->decoder( stream, decoded->data() + GuardFrames );
+    frames = std::move( decoded );
+    std::atomic_store( &m_lazy->frames, frames );
+    SampleCache::instance().add( this, m_lazy->length * sizeof( BasicSampleFrame ) );
   }
-  return result;
+  return frames;
+}
+
+void Sample::evict() const
+{
+  std::atomic_store( &m_lazy->frames, std::shared_ptr<const BasicSampleFrame::Vector>() );
 }
 
 namespace
@@ -110,153 +129,627 @@ constexpr inline float interpolateHermite4pt3oX(float x0, float x1, float x2, fl
   float c3 = (x3 - x0) / 2 + 1.5f * (x1 - x2);
   return ((c3 * t + c2) * t + c1) * t + c0;
 }
-}
 
-AudioFrameBuffer Sample::readCubicInterpolated(ppp::Stepper& stepper,
-                                               size_t requestedLen,
-                                               size_t limitMin,
-                                               size_t limitMax,
-                                               bool reverse) const
+/*
+ * The kernels interpolate the frame at the stepper's position from the taps
+ * around @a at, which points to the frame at the truncated position; they may
+ * read up to Sample::GuardFrames frames in both directions. They are constructed
+ * with the stepper for each chunk of frames, while its step size is constant.
+ */
+
+struct NonInterpolated
 {
-  AudioFrameBuffer result;
-  while( requestedLen-- )
+  explicit NonInterpolated(const Stepper&) noexcept
   {
-    if( !reverse && stepper.trunc() >= 0 && static_cast<size_t>(stepper.trunc()) >= limitMax )
-    {
-      return result;
-    }
-    else if( reverse && (stepper.trunc() < 0 || static_cast<size_t>(stepper.trunc()) < limitMin) )
+  }
+
+  static BasicSampleFrame at(const BasicSampleFrame* at, const Stepper&) noexcept
+  {
+    return at[0];
+  }
+};
+
+struct LinearInterpolated
+{
+  explicit LinearInterpolated(const Stepper&) noexcept
+  {
+  }
+
+  static BasicSampleFrame at(const BasicSampleFrame* at, const Stepper& stepper) noexcept
+  {
+    return stepper.biased( at[0], at[1] );
+  }
+};
+
+struct CubicInterpolated
+{
+  explicit CubicInterpolated(const Stepper&) noexcept
+  {
+  }
+
+  static BasicSampleFrame at(const BasicSampleFrame* at, const Stepper& stepper) noexcept
+  {
+    const float t = stepper.floatFraction();
+    const auto l = ppp::clip<int>( interpolateCubic( at[-1].left, at[0].left, at[1].left, at[2].left, t ), -32768, 32767 );
+    const auto r = ppp::clip<int>( interpolateCubic( at[-1].right, at[0].right, at[1].right, at[2].right, t ), -32768, 32767 );
+    return { static_cast<int16_t>(l), static_cast<int16_t>(r) };
+  }
+};
+
+struct HermiteInterpolated
+{
+  explicit HermiteInterpolated(const Stepper&) noexcept
+  {
+  }
+
+  static BasicSampleFrame at(const BasicSampleFrame* at, const Stepper& stepper) noexcept
+  {
+    const float t = stepper.floatFraction();
+    const auto l = ppp::clip<int>( interpolateHermite4pt3oX( at[-1].left, at[0].left, at[1].left, at[2].left, t ),
+                                   -32768, 32767 );
+    const auto r = ppp::clip<int>( interpolateHermite4pt3oX( at[-1].right, at[0].right, at[1].right, at[2].right, t ),
+                                   -32768, 32767 );
+    return { static_cast<int16_t>(l), static_cast<int16_t>(r) };
+  }
+};
+
+//! @brief Number of taps of the windowed sinc, reading at[-3] to at[4]
+constexpr size_t SincTaps = 8;
+//! @brief Number of fractional positions the windowed sinc is tabulated for
+constexpr size_t SincPhases = 256;
+//! @brief Step sizes the sinc cutoffs are designed for; the cutoff relative to the sample rate is the reciprocal
+constexpr std::array<float, 5> SincSteps{ { 1.0f, 1.5f, 2.0f, 3.0f, 4.0f } };
+
+/**
+ * @brief Polyphase windowed-sinc coefficients
+ *
+ * @details
+ * There is one table per entry of SincSteps, holding SincPhases phases of
+ * SincTaps coefficients each. Every coefficient is stored twice, matching the
+ * interleaved left and right values of the frames, and the coefficients of a
+ * phase sum up to 1.
+ */
+class SincTables
+{
+private:
+  std::vector<float> m_coefficients;
+
+  //! @brief Modified Bessel function of the first kind, order 0
+  static double besselI0(double x) noexcept
+  {
+    double sum = 1;
+    double term = 1;
+    for( int k = 1; k < 32; ++k )
     {
-      return result;
+      term *= (x / (2 * k)) * (x / (2 * k));
+      sum += term;
     }
+    return sum;
+  }
 
-    BasicSampleFrame samples[4];
-    for( int i = 0u; i < 4; i++ )
+  SincTables()
+    : m_coefficients( SincSteps.size() * SincPhases * 2 * SincTaps )
+  {
+    static constexpr double Beta = 6;
+    static constexpr double HalfWidth = SincTaps / 2;
+    auto* coeff = m_coefficients.data();
+    for( const float step: SincSteps )
     {
-      samples[i] = sampleAt( i + stepper.trunc() - 1u );
+      const double cutoff = 1.0 / step;
+      for( size_t phase = 0; phase < SincPhases; ++phase )
+      {
+        std::array<double, SincTaps> h;
+        double sum = 0;
+        for( size_t i = 0; i < SincTaps; ++i )
+        {
+          const double x = static_cast<double>(i) - (HalfWidth - 1) - static_cast<double>(phase) / SincPhases;
+          const double w = x / HalfWidth;
+          const double window = std::abs( w ) < 1 ? besselI0( Beta * std::sqrt( 1 - w * w ) ) / besselI0( Beta ) : 0;
+          const double sinc = x == 0 ? 1 : std::sin( M_PI * cutoff * x ) / (M_PI * cutoff * x);
+          h[i] = cutoff * sinc * window;
+          sum += h[i];
+        }
+        for( size_t i = 0; i < SincTaps; ++i )
+        {
+          *coeff++ = static_cast<float>(h[i] / sum);
+          *coeff++ = static_cast<float>(h[i] / sum);
+        }
+      }
     }
+  }
+
+public:
+  static const SincTables& instance()
+  {
+    static const SincTables tables;
+    return tables;
+  }
 
-    const auto l = ppp::clip<int>( interpolateCubic( samples[0].left,
-                                                     samples[1].left,
-                                                     samples[2].left,
-                                                     samples[3].left,
-                                                     stepper.floatFraction() ), -32768,
-                                   32767 );
-    const auto r = ppp::clip<int>( interpolateCubic( samples[0].right,
-                                                     samples[1].right,
-                                                     samples[2].right,
-                                                     samples[3].right,
-                                                     stepper.floatFraction() ), -32768,
-                                   32767 );
-    result.emplace_back( l, r );
-    if( !reverse )
+  /**
+   * @brief Get the table for a step size
+   * @param[in] step Step size of the stepper
+   * @return The table with the next higher designed step size, or the one for the highest step size
+   */
+  const float* forStep(float step) const noexcept
+  {
+    size_t idx = 0;
+    while( idx + 1 < SincSteps.size() && SincSteps[idx] < step )
     {
-      stepper.next();
+      ++idx;
     }
-    else
+    return m_coefficients.data() + idx * SincPhases * 2 * SincTaps;
+  }
+};
+
+struct SincInterpolated
+{
+  const float* const m_table;
+
+  explicit SincInterpolated(const Stepper& stepper) noexcept
+    : m_table( SincTables::instance().forStep( stepper.floatStepSize() ) )
+  {
+  }
+
+  BasicSampleFrame at(const BasicSampleFrame* at, const Stepper& stepper) const noexcept
+  {
+    const float* coeff = m_table + static_cast<size_t>(stepper.floatFraction() * SincPhases) * 2 * SincTaps;
+    const BasicSampleFrame* taps = at - (SincTaps / 2 - 1);
+#ifdef __SSE2__
+    static_assert( sizeof( BasicSampleFrame ) == 4, "Frames must consist of two 16-bit values" );
+    // the interleaved values sign-extended to 32 bits, two frames per vector
+    const __m128i lo = _mm_loadu_si128( reinterpret_cast<const __m128i*>(taps) );
+    const __m128i hi = _mm_loadu_si128( reinterpret_cast<const __m128i*>(taps + 4) );
+    __m128 acc = _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( lo, lo ), 16 ) ), _mm_loadu_ps( coeff ) );
+    acc = _mm_add_ps( acc,
+                      _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( lo, lo ), 16 ) ),
+                                  _mm_loadu_ps( coeff + 4 ) ) );
+    acc = _mm_add_ps( acc,
+                      _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( hi, hi ), 16 ) ),
+                                  _mm_loadu_ps( coeff + 8 ) ) );
+    acc = _mm_add_ps( acc,
+                      _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( hi, hi ), 16 ) ),
+                                  _mm_loadu_ps( coeff + 12 ) ) );
+    // fold the even and odd frames and saturate to 16 bits
+    acc = _mm_add_ps( acc, _mm_movehl_ps( acc, acc ) );
+    const __m128i packed = _mm_packs_epi32( _mm_cvttps_epi32( acc ), _mm_setzero_si128() );
+    BasicSampleFrame result;
+    result.left = static_cast<int16_t>(_mm_cvtsi128_si32( packed ));
+    result.right = static_cast<int16_t>(_mm_extract_epi16( packed, 1 ));
+    return result;
+#else
+    float l = 0;
+    float r = 0;
+    for( size_t i = 0; i < SincTaps; ++i )
     {
-      stepper.prev();
+      l += taps[i].left * coeff[2 * i];
+      r += taps[i].right * coeff[2 * i + 1];
     }
+    return { static_cast<int16_t>(ppp::clip<int>( l, -32768, 32767 )), static_cast<int16_t>(ppp::clip<int>( r, -32768, 32767 )) };
+#endif
   }
-  return result;
-}
+};
+
+static_assert( SincTaps / 2 <= Sample::GuardFrames, "The sinc taps must stay within the guard frames" );
 
-AudioFrameBuffer Sample::readHermiteInterpolated(ppp::Stepper& stepper,
-                                                 size_t requestedLen,
-                                                 size_t limitMin,
-                                                 size_t limitMax,
-                                                 bool reverse) const
+constexpr ptrdiff_t Guard = Sample::GuardFrames;
+
+/**
+ * @brief Sample frames as seen by the interpolation taps, with the loop continued beyond its limits
+ * @tparam Loop Loop type
+ * @tparam Reverse Set if reading backwards
+ */
+template<Sample::LoopType Loop, bool Reverse>
+class LoopedFrames
 {
-  AudioFrameBuffer result;
-  while( requestedLen-- )
+private:
+  //! @brief First frame, preceded and followed by Guard silent frames
+  const BasicSampleFrame* m_frames;
+  const ptrdiff_t m_length;
+  const ptrdiff_t m_loopStart;
+  const ptrdiff_t m_loopEnd;
+  //! @brief Taps around the loop end, Guard frames beyond it
+  std::array<BasicSampleFrame, 3 * Guard> m_endWindow{};
+  //! @brief Taps around the loop start when reading backwards in a ping-pong loop
+  std::array<BasicSampleFrame, 3 * Guard> m_startWindow{};
+  bool m_endWindowValid = false;
+  bool m_startWindowValid = false;
+
+  /**
+   * @brief Frame at an arbitrary position, following the loop
+   */
+  BasicSampleFrame tapAt(ptrdiff_t pos) const noexcept
   {
-    if( !reverse && stepper.trunc() >= 0 && static_cast<size_t>(stepper.trunc()) >= limitMax )
+    const ptrdiff_t loopLength = m_loopEnd - m_loopStart;
+    if( pos >= m_loopEnd && wrapsAtEnd() )
+    {
+      if( Loop == Sample::LoopType::Forward )
+      {
+        pos = m_loopStart + (pos - m_loopEnd) % loopLength;
+      }
+      else
+      {
+        const ptrdiff_t r = (pos - m_loopEnd) % (2 * loopLength);
+        pos = r < loopLength ? m_loopEnd - 1 - r : m_loopStart + (r - loopLength);
+      }
+    }
+    else if( pos < m_loopStart && wrapsAtStart() )
     {
-      return result;
+      const ptrdiff_t r = (m_loopStart - 1 - pos) % (2 * loopLength);
+      pos = r < loopLength ? m_loopStart + r : m_loopEnd - 1 - (r - loopLength);
     }
-    else if( reverse && (stepper.trunc() < 0 || static_cast<size_t>(stepper.trunc()) < limitMin) )
+    if( pos < -Guard || pos >= m_length + Guard )
     {
-      return result;
+      return {};
     }
+    return m_frames[pos];
+  }
+
+public:
+  LoopedFrames(const BasicSampleFrame* frames, size_t length, size_t loopStart, size_t loopEnd) noexcept
+    : m_frames( frames ), m_length( length ), m_loopStart( loopStart ), m_loopEnd( loopEnd )
+  {
+  }
+
+  //! @brief Check if the taps beyond the loop end continue the loop
+  bool wrapsAtEnd() const noexcept
+  {
+    return Loop != Sample::LoopType::None && m_loopEnd > m_loopStart;
+  }
+
+  //! @brief Check if the taps before the loop start are mirrored, i.e. when reading backwards in a ping-pong loop
+  bool wrapsAtStart() const noexcept
+  {
+    return Loop == Sample::LoopType::Pingpong && Reverse && m_loopEnd > m_loopStart;
+  }
 
-    BasicSampleFrame samples[4];
-    for( int i = 0u; i < 4; i++ )
+  /**
+   * @brief Read frames while the position stays within a span that needs no special handling of the taps
+   * @return Number of read frames, 0 if the position is outside of [ loopStart, loopEnd )
+   *         in reading direction
+   */
+  template<typename Kernel>
+  size_t read(const Kernel& kernel, Stepper& stepper, BasicSampleFrame* out, size_t count)
+  {
+    const ptrdiff_t pos = stepper.trunc();
+    if( Reverse ? pos < m_loopStart : pos >= m_loopEnd )
     {
-      samples[i] = sampleAt( i + stepper.trunc() - 1u );
+      return 0;
     }
 
-    const auto l = ppp::clip<int>( interpolateHermite4pt3oX( samples[0].left,
-                                                             samples[1].left,
-                                                             samples[2].left,
-                                                             samples[3].left,
-                                                             stepper.floatFraction() ),
-                                   -32768, 32767 );
-    const auto r = ppp::clip<int>( interpolateHermite4pt3oX( samples[0].right,
-                                                             samples[1].right,
-                                                             samples[2].right,
-                                                             samples[3].right,
-                                                             stepper.floatFraction() ),
-                                   -32768, 32767 );
-    result.emplace_back( l, r );
-    if( !reverse )
+    // find the span around pos and the frames its taps read from
+    const BasicSampleFrame* base = m_frames;
+    ptrdiff_t origin = 0;
+    ptrdiff_t lower = Reverse ? m_loopStart : std::numeric_limits<ptrdiff_t>::min();
+    ptrdiff_t upper = std::min( m_loopEnd, m_length );
+    if( pos < 0 || pos >= m_length )
+    {
+      // only reachable with inconsistent loop points, the taps would leave the guard frames
+      const ptrdiff_t done = std::min<ptrdiff_t>( count, 1 );
+      std::fill_n( out, done, BasicSampleFrame() );
+      Reverse ? stepper.prev() : stepper.next();
+      return done;
+    }
+    else if( Reverse && pos >= m_loopEnd )
     {
-      stepper.next();
+      // the loop changed while reading backwards, read down to the new loop end
+      lower = m_loopEnd;
+      upper = m_length;
+    }
+    else if( wrapsAtEnd() && pos >= m_loopEnd - Guard )
+    {
+      if( !m_endWindowValid )
+      {
+        for( ptrdiff_t i = 0; i < 3 * Guard; ++i )
+        {
+          m_endWindow[i] = tapAt( m_loopEnd - 2 * Guard + i );
+        }
+        m_endWindowValid = true;
+      }
+      base = m_endWindow.data();
+      origin = m_loopEnd - 2 * Guard;
+      lower = std::max( lower, m_loopEnd - Guard );
+    }
+    else if( wrapsAtStart() && pos < m_loopStart + Guard )
+    {
+      if( !m_startWindowValid )
+      {
+        for( ptrdiff_t i = 0; i < 3 * Guard; ++i )
+        {
+          m_startWindow[i] = tapAt( m_loopStart - Guard + i );
+        }
+        m_startWindowValid = true;
+      }
+      base = m_startWindow.data();
+      origin = m_loopStart - Guard;
+      upper = std::min( upper, m_loopStart + Guard );
     }
     else
     {
-      stepper.prev();
+      if( wrapsAtEnd() )
+      {
+        upper = std::min( upper, m_loopEnd - Guard );
+      }
+      if( wrapsAtStart() )
+      {
+        lower = std::max( lower, m_loopStart + Guard );
+      }
+    }
+
+    // no bounds checks for the taps within the span
+    size_t done = 0;
+    for( ; done < count; ++done )
+    {
+      const ptrdiff_t p = stepper.trunc();
+      if( p < lower || p >= upper )
+      {
+        break;
+      }
+      out[done] = kernel.at( base + (p - origin), stepper );
+      if( !Reverse )
+      {
+        stepper.next();
+      }
+      else
+      {
+        stepper.prev();
+      }
+    }
+    return done;
+  }
+};
+
+/**
+ * @brief Reads frames until a loop limit is reached
+ * @param[in] frames First frame of the sample, surrounded by the guard frames
+ * @param[in] length Length of the sample
+ * @param[in] loopStart Reading backwards stops before this position
+ * @param[in] loopEnd Reading forwards stops at this position
+ * @param[in,out] stepper Position and step size
+ * @param[out] out Destination of up to @a count frames
+ * @param[in] count Number of requested frames
+ * @return Number of read frames
+ */
+using ChunkReader = size_t (*)(const BasicSampleFrame* frames,
+                               size_t length,
+                               size_t loopStart,
+                               size_t loopEnd,
+                               Stepper& stepper,
+                               BasicSampleFrame* out,
+                               size_t count);
+
+//! @brief ChunkReader interpolating the frames with @a Kernel
+template<typename Kernel>
+struct Interpolated
+{
+  template<Sample::LoopType Loop, bool Reverse>
+  static size_t read(const BasicSampleFrame* frames,
+                     size_t length,
+                     size_t loopStart,
+                     size_t loopEnd,
+                     Stepper& stepper,
+                     BasicSampleFrame* out,
+                     size_t count)
+  {
+    LoopedFrames<Loop, Reverse> looped( frames, length, loopStart, loopEnd );
+    const Kernel kernel( stepper );
+    size_t done = 0;
+    while( done < count )
+    {
+      const size_t n = looped.read( kernel, stepper, out + done, count - done );
+      if( n == 0 )
+      {
+        break;
+      }
+      done += n;
     }
+    return done;
   }
-  return result;
+};
+
+/**
+ * @brief Advance the position until a loop limit is reached, without reading the frames
+ * @return Number of skipped frames
+ * @see ChunkReader
+ */
+template<bool Reverse>
+size_t skipChunk(size_t loopStart, size_t loopEnd, Stepper& stepper, size_t count) noexcept
+{
+  const size_t done = std::min( count,
+                                Reverse ? stepper.stepsBelow( loopStart ) : stepper.stepsUntil( loopEnd ) );
+  if( !Reverse )
+  {
+    stepper.advance( done );
+  }
+  else
+  {
+    stepper.retreat( done );
+  }
+  return done;
 }
 
-AudioFrameBuffer Sample::read(ppp::Sample::Interpolation inter,
-                              ppp::Stepper& stepper,
-                              size_t requestedLen,
-                              size_t limitMin,
-                              size_t limitMax,
-                              bool reverse) const
+/**
+ * @brief Move the position back into the loop after a loop limit was reached
+ * @return @c true if the position was moved
+ */
+template<Sample::LoopType Loop>
+bool wrap(Stepper& stepper, bool& reverse, size_t loopStart, size_t loopEnd) noexcept;
+
+template<>
+bool wrap<Sample::LoopType::None>(Stepper&, bool&, size_t, size_t) noexcept
+{
+  return false;
+}
+
+template<>
+bool wrap<Sample::LoopType::Forward>(Stepper& stepper, bool&, size_t loopStart, size_t loopEnd) noexcept
+{
+  const auto pos = stepper.trunc();
+  if( loopEnd <= loopStart || pos < 0 || static_cast<size_t>(pos) < loopEnd )
+  {
+    return false;
+  }
+  stepper = loopStart + (static_cast<size_t>(pos) - loopEnd) % (loopEnd - loopStart);
+  return true;
+}
+
+template<>
+bool wrap<Sample::LoopType::Pingpong>(Stepper& stepper, bool& reverse, size_t loopStart, size_t loopEnd) noexcept
 {
-  switch( inter )
+  if( loopEnd <= loopStart )
   {
-  case Interpolation::None:
-    return readNonInterpolated( stepper, requestedLen, limitMin, limitMax, reverse );
-  case Interpolation::Linear:
-    return readLinearInterpolated( stepper, requestedLen, limitMin, limitMax, reverse );
-  case Interpolation::Cubic:
-    return readCubicInterpolated( stepper, requestedLen, limitMin, limitMax, reverse );
-  case Interpolation::Hermite:
-    return readHermiteInterpolated( stepper, requestedLen, limitMin, limitMax, reverse );
-  default:
-    return {};
+    return false;
+  }
+  bool wrapped = false;
+  while( true )
+  {
+    const ptrdiff_t pos = stepper.trunc();
+    if( reverse && (pos < 0 || static_cast<size_t>(pos) < loopStart) )
+    {
+      stepper = 2 * static_cast<ptrdiff_t>(loopStart) - pos;
+      reverse = false;
+    }
+    else if( !reverse && pos > 0 && static_cast<size_t>(pos) >= loopEnd )
+    {
+      stepper = 2 * static_cast<ptrdiff_t>(loopEnd) - pos - 1;
+      reverse = true;
+    }
+    else
+    {
+      return wrapped;
+    }
+    wrapped = true;
   }
 }
 
-inline BasicSampleFrame Sample::sampleAt(size_t pos) const noexcept
+/**
+ * @brief Process the chunks of a voice up to its loop limits, following its loop
+ * @param[in] chunk Called with the direction and the number of processed frames, returns
+ *            the number of frames it processed before reaching a loop limit
+ * @return Number of processed frames, less than @a count if the voice ended
+ */
+template<Sample::LoopType Loop, typename Chunk>
+size_t followLoop(Stepper& stepper, bool& reverse, size_t loopStart, size_t loopEnd, size_t count, Chunk&& chunk)
 {
-  if( pos >= m_data.size() )
+  size_t done = 0;
+  while( done < count )
   {
-    return { 0, 0 };
+    const size_t n = chunk( reverse, done );
+    done += n;
+    if( !wrap<Loop>( stepper, reverse, loopStart, loopEnd ) && n == 0 )
+    {
+      break;
+    }
   }
-  return m_data[pos];
+  return done;
 }
 
 /**
- * @}
+ * @brief Reads the frames of a voice, following its loop
+ * @param[in,out] reverse Reading direction, changed by ping-pong loops
+ * @return Number of read frames, less than @a count if the voice ended
+ * @see ChunkReader
  */
-AudioFrameBuffer read(const Sample& smp,
-                      Sample::LoopType loopType,
-                      Sample::Interpolation inter,
-                      Stepper& stepper,
-                      size_t requestedLen,
-                      bool& reverse,
-                      size_t loopStart,
-                      size_t loopEnd,
-                      bool preprocess)
+using VoiceReader = size_t (*)(const BasicSampleFrame* frames,
+                               size_t length,
+                               size_t loopStart,
+                               size_t loopEnd,
+                               Stepper& stepper,
+                               BasicSampleFrame* out,
+                               size_t count,
+                               bool& reverse);
+
+template<typename Kernel, Sample::LoopType Loop>
+size_t readVoice(const BasicSampleFrame* frames,
+                 size_t length,
+                 size_t loopStart,
+                 size_t loopEnd,
+                 Stepper& stepper,
+                 BasicSampleFrame* out,
+                 size_t count,
+                 bool& reverse)
 {
-  BOOST_ASSERT( stepper.trunc() >= 0 );
+  return followLoop<Loop>( stepper, reverse, loopStart, loopEnd, count, [&](bool rev, size_t done)
+  {
+    return rev
+           ? Interpolated<Kernel>::template read<Loop, true>( frames, length, loopStart, loopEnd, stepper, out + done, count - done )
+           : Interpolated<Kernel>::template read<Loop, false>( frames, length, loopStart, loopEnd, stepper, out + done, count - done );
+  } );
+}
+
+/**
+ * @brief Advances a voice like a VoiceReader, without reading its frames
+ */
+using VoiceSkipper = size_t (*)(size_t loopStart, size_t loopEnd, Stepper& stepper, size_t count, bool& reverse);
+
+template<Sample::LoopType Loop>
+size_t skipVoice(size_t loopStart, size_t loopEnd, Stepper& stepper, size_t count, bool& reverse)
+{
+  return followLoop<Loop>( stepper, reverse, loopStart, loopEnd, count, [&](bool rev, size_t done)
+  {
+    return rev
+           ? skipChunk<true>( loopStart, loopEnd, stepper, count - done )
+           : skipChunk<false>( loopStart, loopEnd, stepper, count - done );
+  } );
+}
+
+/*
+ * The readers are specialized at compile time for every combination of
+ * interpolation, loop type and direction, so that the per-frame loops contain
+ * no decisions besides the span limits; the tables below select them once per call.
+ * The rows are indexed by Sample::Interpolation, the columns by Sample::LoopType.
+ */
 
-  // sanitize
+template<typename Kernel, Sample::LoopType Loop>
+constexpr std::array<ChunkReader, 2> chunkReadersByDirection() noexcept
+{
+  return { { &Interpolated<Kernel>::template read<Loop, false>, &Interpolated<Kernel>::template read<Loop, true> } };
+}
+
+template<typename Kernel>
+constexpr std::array<std::array<ChunkReader, 2>, 3> chunkReadersByLoop() noexcept
+{
+  return { {
+    chunkReadersByDirection<Kernel, Sample::LoopType::None>(),
+    chunkReadersByDirection<Kernel, Sample::LoopType::Forward>(),
+    chunkReadersByDirection<Kernel, Sample::LoopType::Pingpong>()
+  } };
+}
+
+template<typename Kernel>
+constexpr std::array<VoiceReader, 3> voiceReadersByLoop() noexcept
+{
+  return { {
+    &readVoice<Kernel, Sample::LoopType::None>,
+    &readVoice<Kernel, Sample::LoopType::Forward>,
+    &readVoice<Kernel, Sample::LoopType::Pingpong>
+  } };
+}
+
+const std::array<std::array<std::array<ChunkReader, 2>, 3>, 5> ChunkReaders{ {
+  chunkReadersByLoop<NonInterpolated>(),
+  chunkReadersByLoop<LinearInterpolated>(),
+  chunkReadersByLoop<CubicInterpolated>(),
+  chunkReadersByLoop<HermiteInterpolated>(),
+  chunkReadersByLoop<SincInterpolated>()
+} };
+
+const std::array<std::array<VoiceReader, 3>, 5> VoiceReaders{ {
+  voiceReadersByLoop<NonInterpolated>(),
+  voiceReadersByLoop<LinearInterpolated>(),
+  voiceReadersByLoop<CubicInterpolated>(),
+  voiceReadersByLoop<HermiteInterpolated>(),
+  voiceReadersByLoop<SincInterpolated>()
+} };
+
+const std::array<VoiceSkipper, 3> VoiceSkippers{ {
+  &skipVoice<Sample::LoopType::None>,
+  &skipVoice<Sample::LoopType::Forward>,
+  &skipVoice<Sample::LoopType::Pingpong>
+} };
+
+//! @brief Clamp the loop to the sample, or make it span the whole sample if it is not looped
+void sanitizeLoop(const Sample& smp, Sample::LoopType loopType, size_t& loopStart, size_t& loopEnd) noexcept
+{
   if( loopType == Sample::LoopType::None )
   {
     loopStart = 0;
@@ -273,86 +766,79 @@ AudioFrameBuffer read(const Sample& smp,
       loopEnd = smp.length();
     }
   }
+}
+}
 
-  AudioFrameBuffer result;
-  result.reserve( requestedLen );
-
-  while( result.size() < requestedLen )
+const BasicSampleFrame* Sample::frames(std::shared_ptr<const BasicSampleFrame::Vector>& keepAlive) const
+{
+  if( m_lazy )
   {
-    if( !preprocess )
-    {
-      auto tmp = smp.read( inter, stepper, requestedLen - result.size(), loopStart, loopEnd, reverse );
-      BOOST_ASSERT( tmp.size() <= requestedLen );
-      std::copy( tmp.begin(), tmp.end(), std::back_inserter( result ) );
-    }
-    else
-    {
-      while( result.size() < requestedLen )
-      {
-        if( !reverse && stepper.trunc() >= 0 && static_cast<size_t>(stepper.trunc()) >= loopEnd )
-        {
-          break;
-        }
-        else if( reverse && (stepper.trunc() < 0 || static_cast<size_t>(stepper.trunc()) < loopStart) )
-        {
-          break;
-        }
+    keepAlive = lazyFrames();
+    return keepAlive->data() + GuardFrames;
+  }
+  return m_data.data() + GuardFrames;
+}
 
-        result.emplace_back();
+AudioFrameBuffer Sample::read(ppp::Sample::Interpolation inter,
+                              ppp::Stepper& stepper,
+                              size_t requestedLen,
+                              size_t limitMin,
+                              size_t limitMax,
+                              bool reverse,
+                              LoopType loopType) const
+{
+  const auto reader = ChunkReaders[static_cast<size_t>(inter)][static_cast<size_t>(loopType)][reverse ? 1 : 0];
 
-        if( !reverse )
-        {
-          stepper.next();
-        }
-        else
-        {
-          stepper.prev();
-        }
-      }
-    }
+  std::shared_ptr<const BasicSampleFrame::Vector> keepAlive;
+  AudioFrameBuffer result( requestedLen );
+  result.resize( reader( frames( keepAlive ), length(), limitMin, limitMax, stepper, result.data(), requestedLen ) );
+  return result;
+}
 
-    bool stepperChanged;
-    do
-    {
-      stepperChanged = false;
+/**
+ * @}
+ */
+AudioFrameBuffer read(const Sample& smp,
+                      Sample::LoopType loopType,
+                      Sample::Interpolation inter,
+                      Stepper& stepper,
+                      size_t requestedLen,
+                      bool& reverse,
+                      size_t loopStart,
+                      size_t loopEnd,
+                      bool preprocess)
+{
+  BOOST_ASSERT( stepper.trunc() >= 0 );
 
-      switch( loopType )
-      {
-      case Sample::LoopType::None:
-        if( stepper.trunc() >= 0 && static_cast<size_t>(stepper.trunc()) >= loopEnd )
-        {
-          BOOST_ASSERT( result.size() <= requestedLen );
-          return result;
-        }
-        break;
-      case Sample::LoopType::Forward:
-        if( stepper.trunc() >= 0 && static_cast<size_t>(stepper.trunc()) >= loopEnd )
-        {
-          stepper = loopStart + (stepper.trunc() - loopEnd);
-          stepperChanged = true;
-        }
-        break;
-      case Sample::LoopType::Pingpong:
-        if( reverse && (stepper.trunc() < 0 || static_cast<size_t>(stepper.trunc()) < loopStart) )
-        {
-          stepper = loopStart + (loopStart - stepper.trunc());
-          reverse = false;
-          stepperChanged = true;
-        }
-        else if( !reverse && (stepper.trunc() > 0 && static_cast<size_t>(stepper.trunc()) >= loopEnd) )
-        {
-          stepper = loopEnd - (stepper.trunc() - loopEnd) - 1;
-          reverse = true;
-          stepperChanged = true;
-        }
+  sanitizeLoop( smp, loopType, loopStart, loopEnd );
 
-        break;
-      }
-    } while( stepperChanged );
+  profile::count( profile::Counter::AnnotatedAllocations );
+  AudioFrameBuffer result( requestedLen );
+  if( preprocess )
+  {
+    // the frames are silent already
+    result.resize( VoiceSkippers[static_cast<size_t>(loopType)]( loopStart, loopEnd, stepper, requestedLen, reverse ) );
+    return result;
   }
 
-  BOOST_ASSERT( result.size() <= requestedLen );
-
+  profile::count( profile::Counter::ActiveVoices );
+  std::shared_ptr<const BasicSampleFrame::Vector> keepAlive;
+  const auto reader = VoiceReaders[static_cast<size_t>(inter)][static_cast<size_t>(loopType)];
+  result.resize( reader( smp.frames( keepAlive ), smp.length(), loopStart, loopEnd, stepper, result.data(), requestedLen, reverse ) );
   return result;
 }
-}
\ No newline at end of file
+
+size_t skip(const Sample& smp,
+            Sample::LoopType loopType,
+            Stepper& stepper,
+            size_t requestedLen,
+            bool& reverse,
+            size_t loopStart,
+            size_t loopEnd)
+{
+  BOOST_ASSERT( stepper.trunc() >= 0 );
+
+  sanitizeLoop( smp, loopType, loopStart, loopEnd );
+  return VoiceSkippers[static_cast<size_t>(loopType)]( loopStart, loopEnd, stepper, requestedLen, reverse );
+}
+}
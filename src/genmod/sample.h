@@ -23,6 +23,16 @@
 #include <light4cxx/logger.h>
 #include "stepper.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+class Stream;
+
+class MappedFile;
+
 namespace ppp
 {
 /**
@@ -33,12 +43,21 @@ namespace ppp
 /**
  * @class GenSample
  * @brief An abstract sample class
+ *
+ * @details
+ * The frames are stored with GuardFrames silent frames before the first and
+ * after the last frame, so that the interpolation kernels can read their taps
+ * without bounds checks. The loop continuation beyond a loop end is supplied
+ * per read() call, as the loop may differ between calls (e.g. IT sustain loops).
  */
 class Sample
 {
 public:
   DISABLE_COPY( Sample )
 
+  //! @brief Number of silent frames stored before and after the sample data
+  static constexpr size_t GuardFrames = 8;
+
   //! @brief Loop type definitions
   enum class LoopType
   {
@@ -52,50 +71,80 @@ public:
     None,
     Linear,
     Cubic,
-    Hermite
+    Hermite,
+    Sinc //!< @brief 8-tap windowed sinc, band-limited when the sample is played faster than the output rate
   };
+
+  /**
+   * @brief Decodes sample data
+   * @param[in] stream Stream positioned at the encoded data
+   * @param[out] dest Destination of length() frames
+   */
+  typedef std::function<void(Stream& stream, BasicSampleFrame* dest)> Decoder;
 private:
+  friend class SampleCache;
+
+  /**
+   * @struct LazyData
+   * @brief Location of the encoded data of a lazily decoded sample
+   * @see deferDecoding()
+   */
+  struct LazyData
+  {
+    std::shared_ptr<const MappedFile> file;
+    //! @brief Offset of the encoded data within the file
+    size_t offset;
+    //! @brief Length of the sample in frames
+    size_t length;
+    Decoder decoder;
+    //! @brief Decoded data including the guard frames, only accessed through the std::atomic_* functions
+    std::shared_ptr<const BasicSampleFrame::Vector> frames;
+    //! @brief Time of the last use, in std::chrono::steady_clock ticks
+    std::atomic<std::chrono::steady_clock::rep> lastUse{ 0 };
+  };
+
   //! @brief Default volume of the sample
   uint8_t m_volume = 0;
   //! @brief Base frequency of the sample
   uint16_t m_frequency = 0;
-  //! @brief Sample data
-  BasicSampleFrame::Vector m_data{};
+  //! @brief Sample data including the guard frames, only the guard frames if the sample is decoded lazily
+  BasicSampleFrame::Vector m_data = BasicSampleFrame::Vector( 2 * GuardFrames );
+  //! @brief Set if the sample is decoded lazily
+  std::unique_ptr<LazyData> m_lazy{};
   //! @brief Sample filename
   std::string m_filename{};
   //! @brief Sample title
   std::string m_title{};
 
   /**
-   * @brief Get a sample
-   * @param[in,out] pos Position of the requested sample
-   * @return Sample value, 0 if invalid value for @a pos
+   * @brief Get the decoded data of a lazily decoded sample, decoding it if necessary
+   * @return The decoded data, kept alive even if the sample is evicted meanwhile
+   * @pre m_lazy != nullptr
    */
-  inline BasicSampleFrame sampleAt(size_t pos) const noexcept;
-
-  AudioFrameBuffer readNonInterpolated(Stepper& stepper,
-                                       size_t requestedLen,
-                                       size_t limitMin,
-                                       size_t limitMax,
-                                       bool reverse) const;
-
-  AudioFrameBuffer readLinearInterpolated(Stepper& stepper,
-                                          size_t requestedLen,
-                                          size_t limitMin,
-                                          size_t limitMax,
-                                          bool reverse) const;
-
-  AudioFrameBuffer readCubicInterpolated(Stepper& stepper,
-                                         size_t requestedLen,
-                                         size_t limitMin,
-                                         size_t limitMax,
-                                         bool reverse) const;
-
-  AudioFrameBuffer readHermiteInterpolated(Stepper& stepper,
-                                           size_t requestedLen,
-                                           size_t limitMin,
-                                           size_t limitMax,
-                                           bool reverse) const;
+  std::shared_ptr<const BasicSampleFrame::Vector> lazyFrames() const;
+
+  /**
+   * @brief Release the decoded data of a lazily decoded sample
+   * @note Called by the SampleCache
+   */
+  void evict() const;
+
+  /**
+   * @brief Get the first frame of the data for reading, decoding a lazily decoded sample if necessary
+   * @param[out] keepAlive Keeps the data of a lazily decoded sample alive while it is read
+   * @return Pointer to length() frames, surrounded by the guard frames
+   */
+  const BasicSampleFrame* frames(std::shared_ptr<const BasicSampleFrame::Vector>& keepAlive) const;
+
+  friend AudioFrameBuffer read(const Sample& smp,
+                               LoopType loopType,
+                               Interpolation inter,
+                               Stepper& stepper,
+                               size_t requestedLen,
+                               bool& reverse,
+                               size_t loopStart,
+                               size_t loopEnd,
+                               bool preprocess);
 
 public:
   /**
@@ -106,7 +155,7 @@ public:
   /**
    * @brief Destructor
    */
-  virtual ~Sample() noexcept = default;
+  virtual ~Sample() noexcept;
 
   /**
    * @brief Get the sample's Base Frequency
@@ -141,15 +190,39 @@ public:
    */
   size_t length() const noexcept
   {
-    return m_data.size();
+    return m_lazy ? m_lazy->length : m_data.size() - 2 * GuardFrames;
   }
 
+  /**
+   * @brief Check if the sample's data is decoded
+   * @return @c false if the sample is decoded lazily and its data is not resident
+   */
+  bool isResident() const;
+
+  /**
+   * @brief Decode a lazily decoded sample ahead of its use
+   * @note The data is decoded in the background, see SampleCache
+   */
+  void prefetch() const;
+
+  /**
+   * @brief Read interpolated frames
+   * @param[in] inter Interpolation
+   * @param[in,out] stepper Position and step size
+   * @param[in] requestedLen Number of requested frames
+   * @param[in] limitMin Reading backwards stops before this position, the loop start
+   * @param[in] limitMax Reading forwards stops at this position, the loop end
+   * @param[in] reverse Set to read backwards
+   * @param[in] loopType Loop between @a limitMin and @a limitMax that continues beyond the limits
+   * @return The frames, fewer than requested if a limit is reached
+   */
   AudioFrameBuffer read(Interpolation inter,
                         Stepper& stepper,
                         size_t requestedLen,
                         size_t limitMin,
                         size_t limitMax,
-                        bool reverse) const;
+                        bool reverse,
+                        LoopType loopType = LoopType::None) const;
 
 protected:
   typedef BasicSampleFrame::Vector::iterator Iterator;
@@ -169,7 +242,7 @@ protected:
    */
   inline Iterator beginIterator() noexcept
   {
-    return m_data.begin();
+    return m_data.begin() + GuardFrames;
   }
 
   /**
@@ -178,7 +251,16 @@ protected:
    */
   inline Iterator endIterator() noexcept
   {
-    return m_data.end();
+    return m_data.end() - GuardFrames;
+  }
+
+  /**
+   * @brief Get the first frame of the data
+   * @return Pointer to length() frames
+   */
+  inline BasicSampleFrame* data() noexcept
+  {
+    return m_data.data() + GuardFrames;
   }
 
   /**
@@ -214,18 +296,28 @@ protected:
    */
   inline void resizeData(size_t size)
   {
-    m_data.resize( size );
+    m_data.resize( size + 2 * GuardFrames );
+    std::fill( endIterator(), m_data.end(), BasicSampleFrame() );
   }
 
   void setData(const BasicSampleFrame::Vector& data)
   {
-    m_data = data;
+    resizeData( data.size() );
+    std::copy( data.begin(), data.end(), beginIterator() );
   }
 
-  void setData(BasicSampleFrame::Vector&& data)
-  {
-    m_data = std::move( data );
-  }
+  /**
+   * @brief Decode the sample's data only when it is needed
+   * @param[in] stream Stream positioned at the encoded data
+   * @param[in] length Length of the sample in frames
+   * @param[in] size Size of the encoded data in bytes
+   * @param[in] decoder Decodes the data, called with a stream positioned like @a stream
+   * @retval true if decoding was deferred; the position of @a stream is unchanged
+   * @retval false if the data must be decoded now, because lazy decoding is disabled,
+   *         @a stream is not a MappedStream or the data exceeds the file
+   * @see SampleCache
+   */
+  bool deferDecoding(Stream* stream, size_t length, size_t size, Decoder decoder);
 
   /**
    * @brief Get the logger
@@ -234,6 +326,23 @@ protected:
   static light4cxx::Logger* logger();
 };
 
+/**
+ * @brief Read the frames of a voice, following its loop
+ * @param[in] smp The sample
+ * @param[in] loopType Loop type
+ * @param[in] inter Interpolation
+ * @param[in,out] stepper Position and step size
+ * @param[in] requestedLen Number of requested frames
+ * @param[in,out] reverse Reading direction, changed by ping-pong loops
+ * @param[in] loopStart Loop start
+ * @param[in] loopEnd Loop end
+ * @param[in] preprocess Only advance the position and yield silence
+ * @return The frames, fewer than requested if the voice ended
+ *
+ * @details
+ * The reader is specialized at compile time for the interpolation, loop type and
+ * direction and is selected once per call, i.e. once per voice and tick.
+ */
 AudioFrameBuffer read(
   const Sample& smp,
   Sample::LoopType loopType,
@@ -245,6 +354,37 @@ AudioFrameBuffer read(
   size_t loopEnd,
   bool preprocess);
 
+/**
+ * @brief Advance a voice exactly like read(), without reading its frames
+ * @param[in] smp The sample
+ * @param[in] loopType Loop type
+ * @param[in,out] stepper Position and step size
+ * @param[in] requestedLen Number of frames to skip
+ * @param[in,out] reverse Reading direction, changed by ping-pong loops
+ * @param[in] loopStart Loop start
+ * @param[in] loopEnd Loop end
+ * @return Number of skipped frames, fewer than requested if the voice ended
+ *
+ * @details
+ * The position is advanced in constant time per loop iteration, and the data of
+ * lazily decoded samples is not decoded.
+ */
+size_t skip(
+  const Sample& smp,
+  Sample::LoopType loopType,
+  Stepper& stepper,
+  size_t requestedLen,
+  bool& reverse,
+  size_t loopStart,
+  size_t loopEnd);
+
+/**
+ * @brief Mix a voice into a buffer
+ * @return @c false if the voice ended before the end of the buffer
+ *
+ * @details
+ * Voices with zero gain on both channels are only advanced, see skip().
+ */
 inline bool mix(
   const Sample& smp,
   Sample::LoopType loopType,
@@ -259,6 +399,11 @@ inline bool mix(
   int rightShift,
   bool preprocess)
 {
+  if( factorLeft == 0 && factorRight == 0 )
+  {
+    return skip( smp, loopType, stepper, buffer.size(), reverse, loopStart, loopEnd ) == buffer.size();
+  }
+
   auto tmpBuf = read(
     smp,
     loopType,
@@ -0,0 +1,157 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "samplecache.h"
+#include "sample.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace ppp
+{
+constexpr std::chrono::seconds SampleCache::MinIdleTime;
+
+SampleCache& SampleCache::instance()
+{
+  // never destroyed, samples of static modules may outlive any static cache
+  static SampleCache* cache = new SampleCache();
+  return *cache;
+}
+
+void SampleCache::setBudget(size_t bytes)
+{
+  std::lock_guard<std::mutex> lock( m_mutex );
+  m_budget = bytes;
+  enforceBudget( Clock::now() );
+}
+
+size_t SampleCache::budget() const
+{
+  std::lock_guard<std::mutex> lock( m_mutex );
+  return m_budget;
+}
+
+size_t SampleCache::residentBytes() const
+{
+  std::lock_guard<std::mutex> lock( m_mutex );
+  return m_resident;
+}
+
+void SampleCache::add(const Sample* sample, size_t bytes)
+{
+  std::lock_guard<std::mutex> lock( m_mutex );
+  // the data may have been decoded twice, or evicted again meanwhile
+  if( m_entries.find( sample ) != m_entries.end() || !std::atomic_load( &sample->m_lazy->frames ) )
+  {
+    return;
+  }
+  m_entries.emplace( sample, bytes );
+  m_resident += bytes;
+  enforceBudget( Clock::now() );
+}
+
+void SampleCache::prefetch(const Sample* sample)
+{
+  std::lock_guard<std::mutex> lock( m_mutex );
+  // samples that were still in use may have become idle since the budget was exceeded
+  enforceBudget( Clock::now() );
+  if( m_entries.find( sample ) != m_entries.end() || sample == m_decoding
+      || std::find( m_pending.begin(), m_pending.end(), sample ) != m_pending.end() )
+  {
+    return;
+  }
+  m_pending.emplace_back( sample );
+  if( !m_threadStarted )
+  {
+    // the cache is never destroyed, so neither is the thread
+    std::thread( &SampleCache::prefetchThread, this ).detach();
+    m_threadStarted = true;
+  }
+  m_prefetchQueued.notify_one();
+}
+
+void SampleCache::prefetchThread()
+{
+  std::unique_lock<std::mutex> lock( m_mutex );
+  while( true )
+  {
+    m_prefetchQueued.wait( lock, [this]() {
+      return !m_pending.empty();
+    } );
+    m_decoding = m_pending.front();
+    m_pending.pop_front();
+    lock.unlock();
+    m_decoding->lazyFrames();
+    lock.lock();
+    m_decoding = nullptr;
+    m_prefetchDone.notify_all();
+  }
+}
+
+void SampleCache::remove(const Sample* sample)
+{
+  std::unique_lock<std::mutex> lock( m_mutex );
+  m_pending.erase( std::remove( m_pending.begin(), m_pending.end(), sample ), m_pending.end() );
+  m_prefetchDone.wait( lock, [this, sample]() {
+    return m_decoding != sample;
+  } );
+  auto it = m_entries.find( sample );
+  if( it == m_entries.end() )
+  {
+    return;
+  }
+  m_resident -= it->second;
+  m_entries.erase( it );
+}
+
+void SampleCache::enforceBudget(Clock::time_point now)
+{
+  if( m_budget == 0 || m_resident <= m_budget )
+  {
+    return;
+  }
+
+  std::vector<std::pair<Clock::rep, const Sample*>> candidates;
+  candidates.reserve( m_entries.size() );
+  const auto idleSince = (now - MinIdleTime).time_since_epoch().count();
+  for( const auto& entry: m_entries )
+  {
+    const auto lastUse = entry.first->m_lazy->lastUse.load( std::memory_order_relaxed );
+    // samples used more recently are still playing
+    if( lastUse <= idleSince )
+    {
+      candidates.emplace_back( lastUse, entry.first );
+    }
+  }
+  std::sort( candidates.begin(), candidates.end() );
+
+  for( const auto& victim: candidates )
+  {
+    if( m_resident <= m_budget )
+    {
+      break;
+    }
+    // a reader that got the data before it is released keeps it alive
+    victim.second->evict();
+    auto it = m_entries.find( victim.second );
+    m_resident -= it->second;
+    m_entries.erase( it );
+  }
+}
+}
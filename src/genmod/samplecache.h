@@ -0,0 +1,153 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_SAMPLECACHE_H
+#define PPPLAY_SAMPLECACHE_H
+
+#include <stuff/utils.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace ppp
+{
+/**
+ * @ingroup GenMod
+ * @{
+ */
+
+class Sample;
+
+/**
+ * @class SampleCache
+ * @brief Book-keeping of lazily decoded sample data
+ *
+ * @details
+ * When enabled, loaders that read from a MappedStream only remember where the
+ * encoded data of a sample is located; the data is decoded when the sample is
+ * mixed for the first time, or ahead of its use by a background thread when it
+ * is prefetched. The decoded data of samples that have not been used for a while
+ * is released again once the resident data exceeds the budget, and decoded again
+ * on the next use.
+ *
+ * Reading a sample does not take the cache's lock; the sample records the time
+ * of its last use itself, which is only evaluated when data is evicted.
+ */
+class SampleCache
+{
+public:
+  DISABLE_COPY( SampleCache )
+
+  /**
+   * @brief Get the process-wide cache
+   */
+  static SampleCache& instance();
+
+  /**
+   * @brief Enable or disable lazy decoding for modules loaded afterwards
+   */
+  void setEnabled(bool enabled) noexcept
+  {
+    m_enabled = enabled;
+  }
+
+  bool isEnabled() const noexcept
+  {
+    return m_enabled;
+  }
+
+  /**
+   * @brief Set the amount of decoded data to keep
+   * @param[in] bytes Budget in bytes, 0 for no limit
+   */
+  void setBudget(size_t bytes);
+
+  size_t budget() const;
+
+  /**
+   * @brief Get the size of the currently decoded lazy sample data
+   * @return Size in bytes
+   */
+  size_t residentBytes() const;
+
+private:
+  friend class Sample;
+
+  typedef std::chrono::steady_clock Clock;
+
+  //! @brief Samples used more recently than this are never evicted
+  static constexpr std::chrono::seconds MinIdleTime{ 1 };
+
+  mutable std::mutex m_mutex{};
+  //! @brief Size of the decoded data of the resident samples
+  std::unordered_map<const Sample*, size_t> m_entries{};
+  size_t m_budget = 0;
+  size_t m_resident = 0;
+  std::atomic<bool> m_enabled{ false };
+
+  //! @brief Samples to be decoded by the prefetch thread
+  std::deque<const Sample*> m_pending{};
+  //! @brief The sample the prefetch thread is decoding
+  const Sample* m_decoding = nullptr;
+  std::condition_variable m_prefetchQueued{};
+  std::condition_variable m_prefetchDone{};
+  bool m_threadStarted = false;
+
+  SampleCache() = default;
+
+  /**
+   * @brief Register the freshly decoded data of a sample
+   * @param[in] sample The sample
+   * @param[in] bytes Size of the decoded data
+   */
+  void add(const Sample* sample, size_t bytes);
+
+  /**
+   * @brief Queue a sample for decoding by the prefetch thread
+   * @param[in] sample The sample
+   * @note Also releases the data of samples that became idle meanwhile
+   */
+  void prefetch(const Sample* sample);
+
+  /**
+   * @brief Forget a sample that is being destroyed
+   * @note Waits until the prefetch thread has finished decoding the sample
+   */
+  void remove(const Sample* sample);
+
+  //! @brief Prefetch thread body
+  void prefetchThread();
+
+  /**
+   * @brief Evict the least recently used samples until the budget is met
+   * @pre m_mutex is held by the caller
+   */
+  void enforceBudget(Clock::time_point now);
+};
+
+/**
+ * @}
+ */
+}
+
+#endif
@@ -0,0 +1,198 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sampledecoder.h"
+
+#include "stream/stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ppp
+{
+namespace sampledecoder
+{
+namespace
+{
+//! @brief Number of values decoded per block read from the stream
+constexpr size_t BlockSize = 0x4000;
+
+inline int16_t load16(const uint8_t* src) noexcept
+{
+  int16_t value;
+  std::memcpy( &value, src, 2 );
+  return value;
+}
+
+#ifdef __SSE2__
+//! @brief Broadcast the last 16-bit lane of @a v to all lanes
+inline __m128i broadcastLast16(__m128i v) noexcept
+{
+  v = _mm_shufflehi_epi16( v, 0xff );
+  return _mm_unpackhi_epi64( v, v );
+}
+#endif
+
+void delta8(const uint8_t* src, int16_t* dest, size_t count, int16_t& state) noexcept
+{
+  int8_t acc = static_cast<int8_t>(state);
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  __m128i carry = _mm_set1_epi8( acc );
+  for( ; i + 16 <= count; i += 16 )
+  {
+    // prefix sum over the 16 bytes in log2(16) steps, then add the previous total
+    __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i) );
+    v = _mm_add_epi8( v, _mm_slli_si128( v, 1 ) );
+    v = _mm_add_epi8( v, _mm_slli_si128( v, 2 ) );
+    v = _mm_add_epi8( v, _mm_slli_si128( v, 4 ) );
+    v = _mm_add_epi8( v, _mm_slli_si128( v, 8 ) );
+    v = _mm_add_epi8( v, carry );
+    // interleaving with zero widens to value << 8
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(dest + i), _mm_unpacklo_epi8( zero, v ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(dest + i + 8), _mm_unpackhi_epi8( zero, v ) );
+    carry = broadcastLast16( _mm_unpackhi_epi8( v, v ) );
+  }
+  acc = static_cast<int8_t>(_mm_cvtsi128_si32( carry ) & 0xff);
+#endif
+  for( ; i < count; i++ )
+  {
+    acc = static_cast<int8_t>(acc + static_cast<int8_t>(src[i]));
+    dest[i] = acc * 256;
+  }
+  state = acc;
+}
+
+void delta16(const uint8_t* src, int16_t* dest, size_t count, int16_t& state) noexcept
+{
+  int16_t acc = state;
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128i carry = _mm_set1_epi16( acc );
+  for( ; i + 8 <= count; i += 8 )
+  {
+    __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + 2 * i) );
+    v = _mm_add_epi16( v, _mm_slli_si128( v, 2 ) );
+    v = _mm_add_epi16( v, _mm_slli_si128( v, 4 ) );
+    v = _mm_add_epi16( v, _mm_slli_si128( v, 8 ) );
+    v = _mm_add_epi16( v, carry );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(dest + i), v );
+    carry = broadcastLast16( v );
+  }
+  acc = static_cast<int16_t>(_mm_cvtsi128_si32( carry ) & 0xffff);
+#endif
+  for( ; i < count; i++ )
+  {
+    acc = static_cast<int16_t>(acc + load16( src + 2 * i ));
+    dest[i] = acc;
+  }
+  state = acc;
+}
+}
+
+void toPcm16(const uint8_t* src, Format format, int16_t* dest, size_t count, int16_t& state) noexcept
+{
+  switch( format )
+  {
+  case Format::Signed8:
+    for( size_t i = 0; i < count; i++ )
+    {
+      dest[i] = static_cast<int8_t>(src[i]) * 256;
+    }
+    break;
+  case Format::Unsigned8:
+    for( size_t i = 0; i < count; i++ )
+    {
+      dest[i] = (src[i] - 128) * 256;
+    }
+    break;
+  case Format::Delta8:
+    delta8( src, dest, count, state );
+    break;
+  case Format::Signed16:
+    std::memcpy( dest, src, 2 * count );
+    break;
+  case Format::Unsigned16:
+    for( size_t i = 0; i < count; i++ )
+    {
+      dest[i] = load16( src + 2 * i ) ^ int16_t( 0x8000 );
+    }
+    break;
+  case Format::Delta16:
+    delta16( src, dest, count, state );
+    break;
+  }
+}
+
+void store(const int16_t* src, BasicSampleFrame* dest, size_t count, Target target, bool symmetric) noexcept
+{
+  const int16_t minimum = symmetric ? -32767 : -32768;
+  switch( target )
+  {
+  case Target::Both:
+    for( size_t i = 0; i < count; i++ )
+    {
+      dest[i].left = dest[i].right = std::max( src[i], minimum );
+    }
+    break;
+  case Target::Left:
+    for( size_t i = 0; i < count; i++ )
+    {
+      dest[i].left = std::max( src[i], minimum );
+    }
+    break;
+  case Target::Right:
+    for( size_t i = 0; i < count; i++ )
+    {
+      dest[i].right = std::max( src[i], minimum );
+    }
+    break;
+  }
+}
+
+size_t decode(Stream& stream, Format format, BasicSampleFrame* dest, size_t count, Target target, bool symmetric)
+{
+  const size_t width = bytesPerValue( format );
+  std::vector<uint8_t> raw( std::min( count, BlockSize ) * width );
+  std::vector<int16_t> pcm( std::min( count, BlockSize ) );
+
+  int16_t state = 0;
+  size_t done = 0;
+  while( done < count )
+  {
+    const size_t requested = std::min( count - done, BlockSize );
+    stream.read( raw.data(), requested * width );
+    const size_t got = static_cast<size_t>(stream.stream()->gcount()) / width;
+    toPcm16( raw.data(), format, pcm.data(), got, state );
+    store( pcm.data(), dest + done, got, target, symmetric );
+    done += got;
+    if( got < requested )
+    {
+      break;
+    }
+  }
+  return done;
+}
+}
+}
@@ -0,0 +1,125 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_SAMPLEDECODER_H
+#define PPPLAY_SAMPLEDECODER_H
+
+#include "output/audiotypes.h"
+
+#include <cstddef>
+#include <cstdint>
+
+class Stream;
+
+namespace ppp
+{
+/**
+ * @ingroup GenMod
+ * @{
+ */
+
+/**
+ * @brief Bulk decoding of uncompressed sample data
+ *
+ * @details
+ * Sample bodies are read from the stream in large blocks, converted to 16-bit
+ * PCM in a tight loop (SSE2 for the delta decoding when available) and then
+ * written straight into the sample's frames. This avoids the per-value stream
+ * calls and the intermediate buffers of decoding value by value.
+ */
+namespace sampledecoder
+{
+/**
+ * @brief Encoding of the raw sample values
+ * @note 16-bit values are little-endian
+ */
+enum class Format
+{
+  Signed8,
+  Unsigned8,
+  Delta8, //!< @brief Signed 8-bit differences to the previous value
+  Signed16,
+  Unsigned16,
+  Delta16 //!< @brief Signed 16-bit differences to the previous value
+};
+
+/**
+ * @brief Channels of the destination frames that receive the decoded values
+ */
+enum class Target
+{
+  Both,
+  Left,
+  Right
+};
+
+/**
+ * @brief Size of a raw value in bytes
+ */
+constexpr size_t bytesPerValue(Format format) noexcept
+{
+  return format == Format::Signed16 || format == Format::Unsigned16 || format == Format::Delta16 ? 2 : 1;
+}
+
+/**
+ * @brief Convert raw values to 16-bit PCM
+ * @param[in] src Raw values
+ * @param[in] format Encoding of @a src
+ * @param[out] dest Destination of @a count values
+ * @param[in] count Number of values
+ * @param[in,out] state Last value of the previous block for delta encodings, start with 0
+ */
+void toPcm16(const uint8_t* src, Format format, int16_t* dest, size_t count, int16_t& state) noexcept;
+
+/**
+ * @brief Store 16-bit PCM values in sample frames
+ * @param[in] src Values to store
+ * @param[out] dest Destination frames
+ * @param[in] count Number of values
+ * @param[in] target Channels to write
+ * @param[in] symmetric Clip @c -32768 to @c -32767, so that the values can be negated safely
+ */
+void store(const int16_t* src, BasicSampleFrame* dest, size_t count, Target target, bool symmetric = false) noexcept;
+
+/**
+ * @brief Read and decode sample data
+ * @param[in] stream Stream positioned at the sample data
+ * @param[in] format Encoding of the data
+ * @param[out] dest Destination frames
+ * @param[in] count Number of values to decode
+ * @param[in] target Channels to write
+ * @param[in] symmetric Clip @c -32768 to @c -32767, see store()
+ * @return Number of decoded values, less than @a count if the stream ended early
+ *
+ * @details
+ * Frames that could not be decoded are left untouched.
+ */
+size_t decode(Stream& stream,
+              Format format,
+              BasicSampleFrame* dest,
+              size_t count,
+              Target target = Target::Both,
+              bool symmetric = false);
+}
+
+/**
+ * @}
+ */
+}
+
+#endif
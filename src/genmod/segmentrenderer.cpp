@@ -0,0 +1,226 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "segmentrenderer.h"
+#include "samplecache.h"
+
+#include <algorithm>
+
+namespace ppp
+{
+namespace
+{
+//! @brief Frames handed out per call, a segment spans several hundred thousand
+constexpr size_t ChunkFrames = 4096;
+
+inline size_t playedFrames(const AbstractModule& module)
+{
+  return module.state().playedFrames;
+}
+}
+
+SegmentRenderer::SegmentRenderer(const AbstractModule::Ptr& module, const Factory& factory, size_t jobs)
+  : AbstractAudioSource(), m_module( module ), m_factory( factory ), m_jobs( jobs )
+{
+  BOOST_ASSERT( module != nullptr );
+  if( m_jobs == 0 )
+  {
+    m_jobs = std::max( 1u, std::thread::hardware_concurrency() );
+  }
+}
+
+SegmentRenderer::~SegmentRenderer()
+{
+  stop();
+}
+
+bool SegmentRenderer::internal_initialize(uint32_t frequency)
+{
+  if( !m_workers.empty() )
+  {
+    return true;
+  }
+  if( !m_module->initialized() || m_module->frequency() != frequency )
+  {
+    logger()->error( L4CXX_LOCATION, "Module is not initialized for %d Hz", frequency );
+    return false;
+  }
+
+  if( SampleCache::instance().isEnabled() && SampleCache::instance().budget() != 0 )
+  {
+    // the cache is shared, so a clone could release data another clone is mixing
+    logger()->warn( L4CXX_LOCATION, "Lifting the sample cache budget while rendering in parallel" );
+    SampleCache::instance().setBudget( 0 );
+  }
+
+  // the positions are only known after restoring the states
+  std::vector<size_t> positions;
+  if( m_module->hasExactSeekStates() )
+  {
+    for( size_t i = 0; m_module->restoreSeekState( i ); i++ )
+    {
+      positions.emplace_back( playedFrames( *m_module ) );
+    }
+  }
+  m_module->restoreSeekState( 0 );
+  if( positions.empty() )
+  {
+    positions.emplace_back( playedFrames( *m_module ) );
+  }
+
+  m_segments.resize( positions.size() );
+  for( size_t i = 0; i < positions.size(); i++ )
+  {
+    m_segments[i].begin = positions[i];
+    m_segments[i].end = i + 1 < positions.size() ? positions[i + 1] : ~size_t( 0 );
+  }
+  logger()->info( L4CXX_LOCATION, "Rendering %d segments on %d threads", m_segments.size(), std::min( m_jobs, m_segments.size() ) );
+
+  for( size_t i = 0; i < std::min( m_jobs, m_segments.size() ); i++ )
+  {
+    m_workers.emplace_back( &SegmentRenderer::work, this );
+  }
+  return true;
+}
+
+void SegmentRenderer::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  for( std::thread& worker: m_workers )
+  {
+    worker.join();
+  }
+  m_workers.clear();
+}
+
+void SegmentRenderer::work()
+{
+  AbstractModule::Ptr clone;
+  std::unique_lock<std::mutex> lock( m_mutex );
+  while( true )
+  {
+    // stay at most two segments per worker ahead of the consumer
+    m_condition.wait( lock, [this]() {
+      return m_stop || m_nextSegment >= m_segments.size() || m_nextSegment < m_currentSegment + 2 * m_jobs;
+    } );
+    if( m_stop || m_nextSegment >= m_segments.size() )
+    {
+      return;
+    }
+    Segment& segment = m_segments[m_nextSegment++];
+    lock.unlock();
+
+    bool success = true;
+    if( !clone )
+    {
+      clone = m_factory();
+      for( size_t i = 0; clone && i < m_module->currentSongIndex(); i++ )
+      {
+        clone->jumpNextSong();
+      }
+    }
+    if( !clone || clone->frequency() != frequency() || !render( *clone, segment ) )
+    {
+      logger()->error( L4CXX_LOCATION, "Failed to render the segment at frame %d", segment.begin );
+      success = false;
+    }
+
+    lock.lock();
+    segment.done = true;
+    m_failed |= !success;
+    m_condition.notify_all();
+    if( !success )
+    {
+      return;
+    }
+  }
+}
+
+bool SegmentRenderer::render(AbstractModule& clone, Segment& segment) const
+{
+  const size_t index = &segment - m_segments.data();
+  if( !clone.restoreSeekState( index ) || playedFrames( clone ) != segment.begin )
+  {
+    return false;
+  }
+
+  // the last segment ends with the song
+  size_t remaining = segment.end - segment.begin;
+  while( remaining > 0 )
+  {
+    const size_t offset = segment.data.size();
+    const size_t count = std::min( remaining, ChunkFrames );
+    segment.data.resize( offset + count );
+    const size_t rendered = clone.getAudioData( segment.data.data() + offset, count );
+    segment.data.resize( offset + rendered );
+    remaining -= rendered;
+    if( rendered < count )
+    {
+      break;
+    }
+  }
+  return true;
+}
+
+size_t SegmentRenderer::internal_getAudioData(BasicSampleFrame* buffer, size_t requestedFrames)
+{
+  size_t done = 0;
+  std::unique_lock<std::mutex> lock( m_mutex );
+  while( done < requestedFrames && m_currentSegment < m_segments.size() )
+  {
+    Segment& segment = m_segments[m_currentSegment];
+    m_condition.wait( lock, [this, &segment]() {
+      return segment.done || m_failed;
+    } );
+    if( m_failed )
+    {
+      return 0;
+    }
+
+    if( m_segmentOffset < segment.data.size() )
+    {
+      const size_t count = std::min( requestedFrames - done, segment.data.size() - m_segmentOffset );
+      std::copy_n( segment.data.begin() + m_segmentOffset, count, buffer + done );
+      m_segmentOffset += count;
+      m_renderedFrames += count;
+      done += count;
+      continue;
+    }
+
+    AudioFrameBuffer().swap( segment.data );
+    ++m_currentSegment;
+    m_segmentOffset = 0;
+    m_condition.notify_all();
+  }
+  return done;
+}
+
+size_t SegmentRenderer::internal_preferredBufferSize() const
+{
+  return ChunkFrames;
+}
+
+light4cxx::Logger* SegmentRenderer::logger()
+{
+  return light4cxx::Logger::get( "module.segments" );
+}
+}
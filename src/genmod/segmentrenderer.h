@@ -0,0 +1,141 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_SEGMENTRENDERER_H
+#define PPPLAY_SEGMENTRENDERER_H
+
+#include "abstractmodule.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ppp
+{
+/**
+ * @ingroup GenMod
+ * @{
+ */
+
+/**
+ * @class SegmentRenderer
+ * @brief Renders the current song of a module on multiple threads
+ *
+ * @details
+ * The song is split at its seek states (see AbstractModule::seekStateCount()).
+ * Each worker thread owns an independently loaded clone of the module,
+ * restores the state at the start of a segment and renders ticks until the
+ * clone reaches the start of the next segment. The segments are handed out in
+ * order, so outputs see one contiguous stream and encode it as usual.
+ *
+ * Only a few segments are rendered ahead of the consumer to bound the memory.
+ *
+ * @note Formats whose seek states do not contain the full channel state (see
+ *       AbstractModule::hasExactSeekStates()) are rendered as a single segment.
+ */
+class SegmentRenderer
+  : public AbstractAudioSource
+{
+public:
+  DISABLE_COPY( SegmentRenderer )
+
+  //! @brief Loads and initializes another instance of the module
+  typedef std::function<AbstractModule::Ptr()> Factory;
+
+  /**
+   * @brief Constructor
+   * @param[in] module The module; must not be played while rendering
+   * @param[in] factory Creates the clones for the worker threads
+   * @param[in] jobs Number of worker threads, 0 to use one per hardware thread
+   */
+  SegmentRenderer(const AbstractModule::Ptr& module, const Factory& factory, size_t jobs = 0);
+
+  ~SegmentRenderer() override;
+
+  /**
+   * @brief Get the number of sample frames handed out so far
+   */
+  size_t renderedFrames() const noexcept
+  {
+    return m_renderedFrames;
+  }
+
+  size_t segmentCount() const noexcept
+  {
+    return m_segments.size();
+  }
+
+private:
+  struct Segment
+  {
+    //! @brief Position of the segment's seek state
+    size_t begin = 0;
+    //! @brief Start of the next segment, or @c ~0 for the last one
+    size_t end = 0;
+    AudioFrameBuffer data{};
+    bool done = false;
+  };
+
+  AbstractModule::Ptr m_module;
+  Factory m_factory;
+  size_t m_jobs;
+  std::vector<Segment> m_segments{};
+  std::vector<std::thread> m_workers{};
+  //! @brief Guards the segment book-keeping below and the segments' data
+  std::mutex m_mutex{};
+  std::condition_variable m_condition{};
+  //! @brief Next segment to be picked up by a worker
+  size_t m_nextSegment = 0;
+  //! @brief Segment currently handed out
+  size_t m_currentSegment = 0;
+  //! @brief Frames of the current segment already handed out
+  size_t m_segmentOffset = 0;
+  bool m_stop = false;
+  bool m_failed = false;
+  std::atomic<size_t> m_renderedFrames{ 0 };
+
+  bool internal_initialize(uint32_t frequency) override;
+  size_t internal_getAudioData(BasicSampleFrame* buffer, size_t requestedFrames) override;
+  size_t internal_preferredBufferSize() const override;
+
+  //! @brief Worker thread body
+  void work();
+
+  /**
+   * @brief Render a segment
+   * @param[in] clone The worker's module instance
+   * @param[in,out] segment The segment to render
+   * @return @c false if the seek state could not be restored
+   */
+  bool render(AbstractModule& clone, Segment& segment) const;
+
+  //! @brief Stop and join the worker threads
+  void stop();
+
+  static light4cxx::Logger* logger();
+};
+
+/**
+ * @}
+ */
+}
+
+#endif
@@ -20,6 +20,7 @@
 
 #include <output/audiotypes.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <boost/assert.hpp>
 
@@ -50,6 +51,23 @@ private:
   //! @brief Error variable (or fractional part). Range is [0, m_denominator-1]
   int_fast32_t m_fractionPart{ 0 };
   T m_intPart{ 0 };
+
+  //! @brief Move by @a delta fractional units
+  constexpr void move(int64_t delta) noexcept
+  {
+    const int64_t total = m_fractionPart + delta;
+    const int64_t denominator = m_denominator;
+    int64_t whole = total / denominator;
+    int64_t fraction = total % denominator;
+    if( fraction < 0 )
+    {
+      fraction += denominator;
+      --whole;
+    }
+    m_intPart += whole;
+    m_fractionPart = fraction;
+  }
+
 public:
   StepperBase() = delete;
 
@@ -130,6 +148,62 @@ public:
     return m_intPart;
   }
 
+  /**
+   * @brief Advance by several steps at once
+   * @param[in] steps Number of steps, the result is the same as calling next() @a steps times
+   */
+  constexpr void advance(size_t steps) noexcept
+  {
+    move( static_cast<int64_t>(steps) * m_numerator );
+  }
+
+  /**
+   * @brief Go back by several steps at once
+   * @param[in] steps Number of steps, the result is the same as calling prev() @a steps times
+   */
+  constexpr void retreat(size_t steps) noexcept
+  {
+    move( -static_cast<int64_t>(steps) * m_numerator );
+  }
+
+  /**
+   * @brief Calculate the number of next() calls until trunc() reaches a limit
+   * @param[in] limit The limit
+   * @return 0 if trunc() is not below @a limit, or SIZE_MAX if it is never reached
+   */
+  constexpr size_t stepsUntil(T limit) const noexcept
+  {
+    if( m_intPart >= limit )
+    {
+      return 0;
+    }
+    else if( m_numerator <= 0 )
+    {
+      return SIZE_MAX;
+    }
+    const int64_t missing = static_cast<int64_t>(limit - m_intPart) * m_denominator - m_fractionPart;
+    return static_cast<size_t>((missing + m_numerator - 1) / m_numerator);
+  }
+
+  /**
+   * @brief Calculate the number of prev() calls until trunc() falls below a limit
+   * @param[in] limit The limit
+   * @return 0 if trunc() is below @a limit, or SIZE_MAX if it never falls below it
+   */
+  constexpr size_t stepsBelow(T limit) const noexcept
+  {
+    if( m_intPart < limit )
+    {
+      return 0;
+    }
+    else if( m_numerator <= 0 )
+    {
+      return SIZE_MAX;
+    }
+    const int64_t excess = m_fractionPart + static_cast<int64_t>(m_intPart - limit) * m_denominator;
+    return static_cast<size_t>(excess / m_numerator + 1);
+  }
+
   constexpr StepperBase<T>& operator++()
   {
     next();
@@ -156,6 +230,15 @@ public:
     BOOST_ASSERT( m_fractionPart >= 0 && static_cast<uint_fast32_t>(m_fractionPart) < m_denominator );
   }
 
+  /**
+   * @brief Get the step size
+   * @return Absolute distance between two positions
+   */
+  constexpr float floatStepSize() const noexcept
+  {
+    return static_cast<float>(m_numerator < 0 ? -m_numerator : m_numerator) / m_denominator;
+  }
+
   constexpr float floatFraction() const
   {
     BOOST_ASSERT( m_fractionPart >= 0 && static_cast<uint_fast32_t>(m_fractionPart) < m_denominator );
@@ -0,0 +1,87 @@
+#define BOOST_TEST_MODULE AbstractModule
+
+#include <boost/test/unit_test.hpp>
+
+#include "../segmentrenderer.h"
+#include "testmodule.h"
+
+using namespace ppp;
+
+namespace
+{
+constexpr uint32_t Frequency = 8000;
+constexpr size_t Orders = 5;
+
+std::shared_ptr<TestModule> makeModule()
+{
+  auto module = std::make_shared<TestModule>( Orders );
+  BOOST_REQUIRE( module->initialize( Frequency ) );
+  return module;
+}
+
+//! @brief Check that @a frames is the song from frame @a first on
+void checkSong(const AudioFrameBuffer& frames, size_t first = 0)
+{
+  for( size_t i = 0; i < frames.size(); i++ )
+  {
+    const auto expected = TestModule::frameAt( first + i );
+    if( frames[i].left != expected.left || frames[i].right != expected.right )
+    {
+      BOOST_FAIL( "Frame " << first + i << " differs" );
+    }
+  }
+}
+}
+
+BOOST_AUTO_TEST_CASE( FrameByFrame )
+{
+  const auto module = makeModule();
+  const auto frames = renderAll( *module, 1 );
+  BOOST_CHECK_EQUAL( frames.size(), module->length() );
+  checkSong( frames );
+}
+
+BOOST_AUTO_TEST_CASE( OddChunks )
+{
+  const auto module = makeModule();
+  BOOST_REQUIRE_NE( module->length() % 997, 0 );
+  const auto frames = renderAll( *module, 997 );
+  BOOST_CHECK_EQUAL( frames.size(), module->length() );
+  checkSong( frames );
+}
+
+BOOST_AUTO_TEST_CASE( PreferredBufferSize )
+{
+  const auto module = makeModule();
+  const auto frames = renderAll( *module, module->preferredBufferSize() );
+  BOOST_CHECK_EQUAL( frames.size(), module->length() );
+  checkSong( frames );
+}
+
+BOOST_AUTO_TEST_CASE( Segments )
+{
+  const auto module = makeModule();
+  ppp::SegmentRenderer renderer( module, []() {
+    return makeModule();
+  }, 2 );
+  BOOST_REQUIRE( renderer.initialize( Frequency ) );
+  BOOST_CHECK_GT( renderer.segmentCount(), 1 );
+  const auto frames = renderAll( renderer, 997 );
+  BOOST_CHECK_EQUAL( frames.size(), module->length() );
+  checkSong( frames );
+}
+
+BOOST_AUTO_TEST_CASE( SeekDropsResidual )
+{
+  const auto module = makeModule();
+  AudioFrameBuffer buffer( 100 );
+  // ends within the first tick
+  BOOST_REQUIRE_EQUAL( module->getAudioData( buffer.data(), buffer.size() ), buffer.size() );
+  checkSong( buffer );
+
+  BOOST_REQUIRE( module->restoreSeekState( 1 ) );
+  const size_t position = std::const_pointer_cast<const TestModule>( module )->state().playedFrames;
+  BOOST_REQUIRE_GT( position, 0 );
+  BOOST_REQUIRE_EQUAL( module->getAudioData( buffer.data(), buffer.size() ), buffer.size() );
+  checkSong( buffer, position );
+}
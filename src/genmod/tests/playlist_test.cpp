@@ -0,0 +1,211 @@
+#define BOOST_TEST_MODULE Playlist
+
+#include <boost/test/unit_test.hpp>
+
+#include "../playlist.h"
+#include "testmodule.h"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace ppp;
+
+namespace
+{
+constexpr uint32_t Frequency = 8000;
+
+/**
+ * @brief Loads a TestModule of one order for every entry, and records the loads
+ *
+ * @details
+ * Entries named @c "fail" are rejected, entries named @c "throw" throw.
+ */
+class RecordingLoader
+{
+public:
+  RecordingLoader() = default;
+
+  AbstractModule::Ptr operator()(const std::string& filename)
+  {
+    {
+      std::lock_guard<std::mutex> lock( m_mutex );
+      m_loaded.emplace_back( filename );
+      m_threads.emplace_back( std::this_thread::get_id() );
+    }
+    if( filename == "fail" )
+    {
+      return nullptr;
+    }
+    if( filename == "throw" )
+    {
+      throw std::runtime_error( "broken entry" );
+    }
+    auto module = std::make_shared<TestModule>( 1 );
+    module->initialize( Frequency );
+    return module;
+  }
+
+  std::vector<std::string> loaded() const
+  {
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_loaded;
+  }
+
+  std::vector<std::thread::id> threads() const
+  {
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_threads;
+  }
+
+  //! @brief Wait until @a count entries were loaded
+  bool waitForLoads(size_t count) const
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+    while( loaded().size() < count )
+    {
+      if( std::chrono::steady_clock::now() > deadline )
+      {
+        return false;
+      }
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    return true;
+  }
+
+private:
+  mutable std::mutex m_mutex{};
+  std::vector<std::string> m_loaded{};
+  std::vector<std::thread::id> m_threads{};
+};
+
+std::shared_ptr<Playlist> makePlaylist(const std::vector<std::string>& filenames,
+                                       const std::shared_ptr<RecordingLoader>& loader,
+                                       size_t preload = 2,
+                                       size_t budget = 0)
+{
+  return std::make_shared<Playlist>( filenames, [loader](const std::string& filename) {
+    return ( *loader )( filename );
+  }, preload, budget );
+}
+
+size_t songLength()
+{
+  TestModule module( 1 );
+  BOOST_REQUIRE( module.initialize( Frequency ) );
+  return module.length();
+}
+
+//! @brief Check that @a frames contains @a songs complete songs back to back
+void checkSongs(const AudioFrameBuffer& frames, size_t songs)
+{
+  const size_t length = songLength();
+  BOOST_REQUIRE_EQUAL( frames.size(), songs * length );
+  for( size_t i = 0; i < frames.size(); i++ )
+  {
+    const BasicSampleFrame expected = TestModule::frameAt( i % length );
+    if( frames[i].left != expected.left || frames[i].right != expected.right )
+    {
+      BOOST_FAIL( "Frame " << i << " differs" );
+    }
+  }
+}
+
+struct TempFile
+{
+  const std::string filename = ( boost::filesystem::temp_directory_path() / boost::filesystem::unique_path() ).string();
+
+  explicit TempFile(size_t size)
+  {
+    std::ofstream file( filename, std::ios::binary );
+    file << std::string( size, 'x' );
+  }
+
+  ~TempFile()
+  {
+    boost::filesystem::remove( filename );
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE( GaplessSwitch )
+{
+  auto loader = std::make_shared<RecordingLoader>();
+  const auto playlist = makePlaylist( { "a", "b", "c" }, loader );
+  BOOST_REQUIRE( playlist->initialize( Frequency ) );
+  BOOST_CHECK_EQUAL( playlist->currentIndex(), 0u );
+
+  // the song length is not a multiple of the chunk size, so a switch happens within a request
+  BOOST_REQUIRE_NE( songLength() % 1000, 0u );
+  checkSongs( renderAll( *playlist, 1000 ), 3 );
+  BOOST_CHECK_EQUAL( playlist->currentIndex(), 3u );
+  BOOST_CHECK( !playlist->current() );
+  BOOST_CHECK( loader->loaded() == std::vector<std::string>( { "a", "b", "c" } ) );
+}
+
+BOOST_AUTO_TEST_CASE( FailedEntriesAreSkipped )
+{
+  auto loader = std::make_shared<RecordingLoader>();
+  const auto playlist = makePlaylist( { "fail", "a", "throw", "b", "fail" }, loader );
+  BOOST_REQUIRE( playlist->initialize( Frequency ) );
+  BOOST_CHECK_EQUAL( playlist->currentIndex(), 1u );
+  checkSongs( renderAll( *playlist, 1000 ), 2 );
+  BOOST_CHECK_EQUAL( playlist->currentIndex(), 5u );
+
+  const auto failing = makePlaylist( { "fail", "throw" }, std::make_shared<RecordingLoader>() );
+  BOOST_CHECK( !failing->initialize( Frequency ) );
+}
+
+BOOST_AUTO_TEST_CASE( Skip )
+{
+  auto loader = std::make_shared<RecordingLoader>();
+  const auto playlist = makePlaylist( { "a", "b" }, loader );
+  BOOST_REQUIRE( playlist->initialize( Frequency ) );
+
+  AudioFrameBuffer buffer( 1000 );
+  BOOST_REQUIRE_EQUAL( playlist->getAudioData( buffer.data(), buffer.size() ), buffer.size() );
+  BOOST_CHECK( playlist->skip() );
+  // the switch happens with the next request
+  BOOST_CHECK_EQUAL( playlist->currentIndex(), 0u );
+  AudioFrameBuffer rest = renderAll( *playlist, 1000 );
+  BOOST_CHECK_EQUAL( playlist->currentIndex(), 2u );
+  checkSongs( rest, 1 );
+  BOOST_CHECK( !playlist->skip() );
+}
+
+BOOST_AUTO_TEST_CASE( WaitsForWorkers )
+{
+  // without preloading, the next entry is still not loaded by the rendering thread
+  auto loader = std::make_shared<RecordingLoader>();
+  const auto playlist = makePlaylist( { "a", "b", "c" }, loader, 0 );
+  BOOST_REQUIRE( playlist->initialize( Frequency ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+  BOOST_CHECK_EQUAL( loader->loaded().size(), 1u );
+
+  checkSongs( renderAll( *playlist, 1000 ), 3 );
+  const auto threads = loader->threads();
+  BOOST_REQUIRE_EQUAL( threads.size(), 3u );
+  BOOST_CHECK( threads[1] != std::this_thread::get_id() );
+  BOOST_CHECK( threads[2] != std::this_thread::get_id() );
+}
+
+BOOST_AUTO_TEST_CASE( BudgetKeepsOrder )
+{
+  const TempFile first( 10 ), small( 100 ), large( 2000 ), last( 100 );
+  auto loader = std::make_shared<RecordingLoader>();
+  const auto playlist = makePlaylist( { first.filename, small.filename, large.filename, last.filename }, loader, 3, 1000 );
+  BOOST_REQUIRE( playlist->initialize( Frequency ) );
+
+  // the large entry exceeds the budget, and the last one must not overtake it
+  BOOST_REQUIRE( loader->waitForLoads( 2 ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+  BOOST_CHECK_EQUAL( loader->loaded().size(), 2u );
+
+  // the entry directly following the playing one is loaded regardless of the budget
+  checkSongs( renderAll( *playlist, 1000 ), 4 );
+  BOOST_CHECK( loader->loaded()
+                 == std::vector<std::string>( { first.filename, small.filename, large.filename, last.filename } ) );
+}
@@ -0,0 +1,137 @@
+#define BOOST_TEST_MODULE Sample
+
+#include <boost/test/unit_test.hpp>
+
+#include "../sample.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace ppp;
+
+namespace
+{
+class TestSample : public Sample
+{
+public:
+  explicit TestSample(const std::vector<int16_t>& values)
+  {
+    resizeData( values.size() );
+    for( size_t i = 0; i < values.size(); i++ )
+    {
+      data()[i] = { values[i], values[i] };
+    }
+  }
+};
+
+/**
+ * @brief Read with linear interpolation at a step size of 1
+ * @note The fraction is always 0, so each frame is the tap following the position
+ */
+std::vector<int16_t> readNext(const TestSample& sample,
+                              size_t pos,
+                              size_t count,
+                              Sample::LoopType loopType,
+                              size_t loopStart,
+                              size_t loopEnd)
+{
+  Stepper stepper( 1, 1 );
+  stepper = pos;
+  const auto frames = sample.read( Sample::Interpolation::Linear, stepper, count, loopStart, loopEnd, false, loopType );
+  std::vector<int16_t> result;
+  for( const auto& frame: frames )
+  {
+    result.emplace_back( frame.left );
+  }
+  return result;
+}
+}
+
+BOOST_AUTO_TEST_CASE( SilenceBeyondEnd )
+{
+  const TestSample sample( { 100, 200, 300, 400 } );
+  const std::vector<int16_t> expected{ 200, 300, 400, 0 };
+  const auto values = readNext( sample, 0, 10, Sample::LoopType::None, 0, 4 );
+  BOOST_CHECK_EQUAL_COLLECTIONS( values.begin(), values.end(), expected.begin(), expected.end() );
+}
+
+BOOST_AUTO_TEST_CASE( ForwardLoopContinues )
+{
+  const TestSample sample( { 100, 200, 300, 400, 500 } );
+  const std::vector<int16_t> expected{ 200, 300, 400, 200 };
+  const auto values = readNext( sample, 0, 10, Sample::LoopType::Forward, 1, 4 );
+  BOOST_CHECK_EQUAL_COLLECTIONS( values.begin(), values.end(), expected.begin(), expected.end() );
+}
+
+BOOST_AUTO_TEST_CASE( PingpongLoopIsMirrored )
+{
+  const TestSample sample( { 100, 200, 300, 400, 500 } );
+  const std::vector<int16_t> expected{ 200, 300, 400, 400 };
+  const auto values = readNext( sample, 0, 10, Sample::LoopType::Pingpong, 1, 4 );
+  BOOST_CHECK_EQUAL_COLLECTIONS( values.begin(), values.end(), expected.begin(), expected.end() );
+}
+
+BOOST_AUTO_TEST_CASE( ShortLoopContinues )
+{
+  const TestSample sample( { 100, 200, 300 } );
+  const std::vector<int16_t> expected{ 300, 200 };
+  const auto values = readNext( sample, 1, 10, Sample::LoopType::Forward, 1, 3 );
+  BOOST_CHECK_EQUAL_COLLECTIONS( values.begin(), values.end(), expected.begin(), expected.end() );
+}
+
+BOOST_AUTO_TEST_CASE( ShortSamplesStayInBounds )
+{
+  const TestSample sample( { 1000 } );
+  for( auto inter: { Sample::Interpolation::None, Sample::Interpolation::Linear, Sample::Interpolation::Cubic, Sample::Interpolation::Hermite,
+                      Sample::Interpolation::Sinc } )
+  {
+    for( auto loopType: { Sample::LoopType::None, Sample::LoopType::Forward, Sample::LoopType::Pingpong } )
+    {
+      Stepper stepper( 1, 3 );
+      const auto frames = sample.read( inter, stepper, 8, 0, 1, false, loopType );
+      BOOST_CHECK_EQUAL( frames.size(), 3 );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( SincKeepsConstantLevel )
+{
+  const TestSample sample( std::vector<int16_t>( 64, 10000 ) );
+  for( auto step: { 1, 3, 7 } )
+  {
+    // slower and faster than the output rate, using different cutoffs
+    Stepper stepper( step, 5 );
+    stepper = 16;
+    const auto frames = sample.read( Sample::Interpolation::Sinc, stepper, 8, 0, 48, false );
+    BOOST_REQUIRE_EQUAL( frames.size(), 8 );
+    for( const auto& frame: frames )
+    {
+      BOOST_CHECK_LE( std::abs( frame.left - 10000 ), 1 );
+      BOOST_CHECK_LE( std::abs( frame.right - 10000 ), 1 );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( SkipMatchesRead )
+{
+  const TestSample sample( std::vector<int16_t>( 100, 1 ) );
+  for( auto loopType: { Sample::LoopType::None, Sample::LoopType::Forward, Sample::LoopType::Pingpong } )
+  {
+    for( auto step: { 1, 7, 22, 65, 301 } )
+    {
+      Stepper readStepper( step, 22 );
+      Stepper skipStepper( step, 22 );
+      bool readReverse = false;
+      bool skipReverse = false;
+      for( int chunk = 0; chunk < 20; ++chunk )
+      {
+        const auto frames = ppp::read( sample, loopType, Sample::Interpolation::None, readStepper, 37, readReverse, 30, 90, false );
+        const auto skipped = ppp::skip( sample, loopType, skipStepper, 37, skipReverse, 30, 90 );
+        BOOST_CHECK_EQUAL( frames.size(), skipped );
+        BOOST_CHECK_EQUAL( readStepper.trunc(), skipStepper.trunc() );
+        BOOST_CHECK_EQUAL( readStepper.floatFraction(), skipStepper.floatFraction() );
+        BOOST_CHECK_EQUAL( readReverse, skipReverse );
+      }
+    }
+  }
+}
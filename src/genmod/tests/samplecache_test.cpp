@@ -0,0 +1,171 @@
+#define BOOST_TEST_MODULE SampleCache
+
+#include <boost/test/unit_test.hpp>
+
+#include "../sample.h"
+#include "../samplecache.h"
+#include "../sampledecoder.h"
+#include "stream/mappedstream.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace ppp;
+
+namespace
+{
+constexpr size_t Count = 1000;
+
+class TestSample : public Sample
+{
+public:
+  bool load(Stream* stream)
+  {
+    return deferDecoding( stream, Count, Count, [](Stream& str, BasicSampleFrame* dest) {
+      sampledecoder::decode( str, sampledecoder::Format::Signed8, dest, Count );
+    } );
+  }
+};
+
+struct TempModule
+{
+  const std::string filename = ( boost::filesystem::temp_directory_path() / boost::filesystem::unique_path() ).string();
+
+  TempModule()
+  {
+    // a header byte followed by two samples
+    std::ofstream file( filename, std::ios::binary );
+    file.put( 0x55 );
+    for( size_t i = 0; i < 2 * Count; i++ )
+    {
+      file.put( static_cast<char>(i) );
+    }
+  }
+
+  ~TempModule()
+  {
+    boost::filesystem::remove( filename );
+  }
+};
+
+int16_t expected(size_t index)
+{
+  return static_cast<int8_t>(index) * 256;
+}
+
+//! @brief Wait for the prefetch thread to decode a sample
+bool waitResident(const Sample& sample)
+{
+  for( int i = 0; i < 1000 && !sample.isResident(); i++ )
+  {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+  return sample.isResident();
+}
+}
+
+BOOST_AUTO_TEST_CASE( DecodesOnFirstUse )
+{
+  TempModule module;
+  SampleCache::instance().setEnabled( true );
+  SampleCache::instance().setBudget( 0 );
+  {
+    MappedStream stream( module.filename );
+    BOOST_REQUIRE( stream.isOpen() );
+    stream.seek( 1 + Count );
+
+    TestSample sample;
+    BOOST_REQUIRE( sample.load( &stream ) );
+    BOOST_CHECK_EQUAL( stream.pos(), 1 + Count );
+    BOOST_CHECK_EQUAL( sample.length(), Count );
+    BOOST_CHECK( !sample.isResident() );
+    BOOST_CHECK_EQUAL( SampleCache::instance().residentBytes(), 0 );
+
+    Stepper stepper( 1, 1 );
+    const auto frames = sample.read( Sample::Interpolation::None, stepper, Count, 0, Count, false );
+    BOOST_CHECK( sample.isResident() );
+    BOOST_CHECK_EQUAL( SampleCache::instance().residentBytes(), Count * sizeof( BasicSampleFrame ) );
+    BOOST_REQUIRE_EQUAL( frames.size(), Count );
+    for( size_t i = 0; i < Count; i++ )
+    {
+      BOOST_REQUIRE_EQUAL( frames[i].left, expected( Count + i ) );
+      BOOST_REQUIRE_EQUAL( frames[i].right, expected( Count + i ) );
+    }
+  }
+  BOOST_CHECK_EQUAL( SampleCache::instance().residentBytes(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( EvictsIdleSamples )
+{
+  TempModule module;
+  SampleCache::instance().setEnabled( true );
+  SampleCache::instance().setBudget( Count * sizeof( BasicSampleFrame ) );
+
+  MappedStream stream( module.filename );
+  BOOST_REQUIRE( stream.isOpen() );
+  TestSample first, second;
+  stream.seek( 1 );
+  BOOST_REQUIRE( first.load( &stream ) );
+  stream.seek( 1 + Count );
+  BOOST_REQUIRE( second.load( &stream ) );
+
+  // recently used samples are kept even if the budget is exceeded
+  first.prefetch();
+  BOOST_CHECK( waitResident( first ) );
+  second.prefetch();
+  BOOST_CHECK( waitResident( second ) );
+  BOOST_CHECK( first.isResident() );
+
+  std::this_thread::sleep_for( std::chrono::milliseconds( 1100 ) );
+  Stepper secondStepper( 1, 1 );
+  second.read( Sample::Interpolation::None, secondStepper, 1, 0, Count, false );
+  // reading does not evict, but the next prefetch does
+  BOOST_CHECK( first.isResident() );
+  second.prefetch();
+  BOOST_CHECK( !first.isResident() );
+  BOOST_CHECK( second.isResident() );
+  BOOST_CHECK_EQUAL( SampleCache::instance().residentBytes(), Count * sizeof( BasicSampleFrame ) );
+
+  // evicted samples are decoded again
+  Stepper stepper( 1, 1 );
+  const auto frames = first.read( Sample::Interpolation::None, stepper, 1, 0, Count, false );
+  BOOST_REQUIRE_EQUAL( frames.size(), 1 );
+  BOOST_CHECK_EQUAL( frames[0].left, expected( 0 ) );
+  BOOST_CHECK( first.isResident() );
+}
+
+BOOST_AUTO_TEST_CASE( DestroyWhilePrefetching )
+{
+  TempModule module;
+  SampleCache::instance().setEnabled( true );
+  SampleCache::instance().setBudget( 0 );
+
+  MappedStream stream( module.filename );
+  BOOST_REQUIRE( stream.isOpen() );
+  for( int i = 0; i < 100; i++ )
+  {
+    TestSample first, second;
+    stream.seek( 1 );
+    BOOST_REQUIRE( first.load( &stream ) );
+    stream.seek( 1 + Count );
+    BOOST_REQUIRE( second.load( &stream ) );
+    first.prefetch();
+    second.prefetch();
+  }
+  BOOST_CHECK_EQUAL( SampleCache::instance().residentBytes(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( DisabledDecodesEagerly )
+{
+  TempModule module;
+  SampleCache::instance().setEnabled( false );
+
+  MappedStream stream( module.filename );
+  BOOST_REQUIRE( stream.isOpen() );
+  TestSample sample;
+  BOOST_CHECK( !sample.load( &stream ) );
+  BOOST_CHECK( sample.isResident() );
+}
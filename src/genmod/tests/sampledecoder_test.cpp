@@ -0,0 +1,105 @@
+#define BOOST_TEST_MODULE SampleDecoder
+
+#include <boost/test/unit_test.hpp>
+
+#include "../sampledecoder.h"
+#include "stream/memorystream.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace ppp::sampledecoder;
+
+namespace
+{
+std::vector<uint8_t> randomBytes(size_t count)
+{
+  std::vector<uint8_t> result( count );
+  std::srand( 42 );
+  for( auto& b : result )
+  {
+    b = static_cast<uint8_t>(std::rand());
+  }
+  return result;
+}
+
+//! @brief Straightforward reference implementation
+int16_t reference(const std::vector<uint8_t>& raw, Format format, size_t index, int16_t& acc)
+{
+  const auto value16 = static_cast<int16_t>(raw[2 * index] | (raw[2 * index + 1] << 8));
+  switch( format )
+  {
+  case Format::Signed8:
+    return static_cast<int8_t>(raw[index]) << 8;
+  case Format::Unsigned8:
+    return (raw[index] - 128) << 8;
+  case Format::Delta8:
+    acc = static_cast<int8_t>(acc + static_cast<int8_t>(raw[index]));
+    return acc << 8;
+  case Format::Signed16:
+    return value16;
+  case Format::Unsigned16:
+    return static_cast<uint16_t>(value16) - 32768;
+  case Format::Delta16:
+    acc = static_cast<int16_t>(acc + value16);
+    return acc;
+  }
+  return 0;
+}
+
+std::unique_ptr<MemoryStream> makeStream(const std::vector<uint8_t>& raw)
+{
+  auto stream = std::make_unique<MemoryStream>();
+  stream->write( raw.data(), raw.size() );
+  stream->seek( 0 );
+  return stream;
+}
+}
+
+BOOST_AUTO_TEST_CASE( MatchesReference )
+{
+  // odd length that spans several stream blocks and leaves a tail for the SIMD paths
+  constexpr size_t Count = 0x4000 * 2 + 13;
+  const auto raw = randomBytes( 2 * Count );
+
+  for( Format format : { Format::Signed8, Format::Unsigned8, Format::Delta8, Format::Signed16, Format::Unsigned16,
+                         Format::Delta16 } )
+  {
+    auto stream = makeStream( raw );
+    std::vector<BasicSampleFrame> frames( Count );
+    BOOST_REQUIRE_EQUAL( decode( *stream, format, frames.data(), Count ), Count );
+
+    int16_t acc = 0;
+    for( size_t i = 0; i < Count; i++ )
+    {
+      const int16_t expected = reference( raw, format, i, acc );
+      BOOST_REQUIRE_EQUAL( frames[i].left, expected );
+      BOOST_REQUIRE_EQUAL( frames[i].right, expected );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( TargetsAndSymmetry )
+{
+  const std::vector<int16_t> pcm{ -32768, -1, 0, 32767 };
+  std::vector<BasicSampleFrame> frames( pcm.size(), BasicSampleFrame( 7, 7 ) );
+
+  store( pcm.data(), frames.data(), pcm.size(), Target::Left );
+  BOOST_CHECK_EQUAL( frames[0].left, -32768 );
+  BOOST_CHECK_EQUAL( frames[0].right, 7 );
+
+  store( pcm.data(), frames.data(), pcm.size(), Target::Right, true );
+  BOOST_CHECK_EQUAL( frames[0].right, -32767 );
+  BOOST_CHECK_EQUAL( frames[1].right, -1 );
+  BOOST_CHECK_EQUAL( frames[3].right, 32767 );
+}
+
+BOOST_AUTO_TEST_CASE( TruncatedStream )
+{
+  const auto raw = randomBytes( 100 );
+  auto stream = makeStream( raw );
+  std::vector<BasicSampleFrame> frames( 200, BasicSampleFrame( 7, 7 ) );
+  BOOST_REQUIRE_EQUAL( decode( *stream, Format::Signed8, frames.data(), frames.size() ), 100 );
+  BOOST_CHECK_EQUAL( frames[99].left, static_cast<int8_t>(raw[99]) << 8 );
+  BOOST_CHECK_EQUAL( frames[100].left, 7 );
+}
@@ -0,0 +1,242 @@
+#define BOOST_TEST_MODULE SegmentRenderer
+
+#include <boost/test/unit_test.hpp>
+
+#include "../segmentrenderer.h"
+#include "itmod/itmodule.h"
+#include "stream/memorystream.h"
+#include "testmodule.h"
+
+using namespace ppp;
+
+namespace
+{
+constexpr uint32_t Frequency = 8000;
+//! @brief Results in a song of about 192 seconds, i.e. 13 states at 15 second intervals
+constexpr size_t Orders = 25;
+
+std::shared_ptr<TestModule> makeModule(bool exactSeekStates = true)
+{
+  auto module = std::make_shared<TestModule>( Orders, exactSeekStates );
+  BOOST_REQUIRE( module->initialize( Frequency ) );
+  return module;
+}
+
+/**
+ * @brief Build an IT module that plays a looped sample through the resonant filter
+ *
+ * @details
+ * Every 16 rows a note is triggered and the filter cutoff is set with Z3x, the
+ * resonance follows with Z8C on the next row, and the cutoff is lowered again
+ * with Z20 in the middle of each note.
+ */
+std::vector<uint8_t> buildFilteredIt()
+{
+  constexpr uint16_t Orders = 12;
+  constexpr uint32_t SampleLength = 256;
+  std::vector<uint8_t> data;
+  const auto u8 = [&data](uint8_t value) {
+    data.emplace_back( value );
+  };
+  const auto u16 = [&data](uint16_t value) {
+    data.emplace_back( value & 0xff );
+    data.emplace_back( value >> 8 );
+  };
+  const auto u32 = [&data](uint32_t value) {
+    for( int i = 0; i < 4; i++ )
+    {
+      data.emplace_back( static_cast<uint8_t>(value >> (8 * i)) );
+    }
+  };
+  const auto text = [&data](const std::string& str, size_t length) {
+    for( size_t i = 0; i < length; i++ )
+    {
+      data.emplace_back( i < str.size() ? str[i] : 0 );
+    }
+  };
+  const auto patch32 = [&data](size_t at, uint32_t value) {
+    for( int i = 0; i < 4; i++ )
+    {
+      data[at + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+  };
+
+  text( "IMPM", 4 );
+  text( "filter test", 26 );
+  u16( 0x1004 );
+  u16( Orders );
+  u16( 0 ); // instruments
+  u16( 1 ); // samples
+  u16( 1 ); // patterns
+  u16( 0x0214 );
+  u16( 0x0214 );
+  u16( 0x09 ); // stereo, linear slides, sample mode
+  u16( 0 );
+  u8( 128 );
+  u8( 48 );
+  u8( 6 );
+  u8( 125 );
+  u8( 128 );
+  u8( 0 );
+  u16( 0 );
+  u32( 0 );
+  u32( 0 );
+  for( int i = 0; i < 64; i++ )
+  {
+    u8( i < 2 ? 32 : 32 | 128 );
+  }
+  text( std::string( 64, 64 ), 64 );
+  text( std::string(), Orders );
+  const size_t samplePointer = data.size();
+  u32( 0 );
+  const size_t patternPointer = data.size();
+  u32( 0 );
+
+  patch32( samplePointer, data.size() );
+  text( "IMPS", 4 );
+  text( "saw.smp", 12 );
+  u8( 0 );
+  u8( 64 );
+  u8( 0x01 | 0x10 ); // forward loop
+  u8( 64 );
+  text( "saw", 26 );
+  u8( 1 ); // signed samples
+  u8( 32 );
+  u32( SampleLength );
+  u32( 0 );
+  u32( SampleLength );
+  u32( 8363 );
+  u32( 0 );
+  u32( 0 );
+  const size_t dataPointer = data.size();
+  u32( 0 );
+  u32( 0 );
+
+  patch32( patternPointer, data.size() );
+  const size_t patternLength = data.size();
+  u16( 0 );
+  u16( 64 );
+  u32( 0 );
+  const size_t patternStart = data.size();
+  constexpr uint8_t CommandZ = 'Z' - 'A' + 1;
+  for( int row = 0; row < 64; row++ )
+  {
+    for( uint8_t chn = 0; chn < 2; chn++ )
+    {
+      switch( row % 16 )
+      {
+      case 0:
+        u8( (chn + 1) | 0x80 );
+        u8( 0x01 | 0x02 | 0x08 );
+        u8( 48 + 7 * chn + row / 16 );
+        u8( 1 );
+        u8( CommandZ );
+        u8( 0x30 + row / 4 );
+        break;
+      case 1:
+        u8( (chn + 1) | 0x80 );
+        u8( 0x08 );
+        u8( CommandZ );
+        u8( 0x8c );
+        break;
+      case 8:
+        u8( (chn + 1) | 0x80 );
+        u8( 0x08 );
+        u8( CommandZ );
+        u8( 0x20 );
+        break;
+      default:
+        break;
+      }
+    }
+    u8( 0 );
+  }
+  const size_t packed = data.size() - patternStart;
+  data[patternLength] = packed & 0xff;
+  data[patternLength + 1] = packed >> 8;
+
+  patch32( dataPointer, data.size() );
+  for( uint32_t i = 0; i < SampleLength; i++ )
+  {
+    u8( static_cast<uint8_t>(i * 3 - 128) );
+  }
+  return data;
+}
+
+AbstractModule::Ptr makeFilteredIt()
+{
+  static const std::vector<uint8_t> data = buildFilteredIt();
+  MemoryStream stream( "filter.it" );
+  stream.write( data.data(), data.size() );
+  return it::ItModule::factory( &stream, Frequency, 1, Sample::Interpolation::Linear );
+}
+
+void checkEqual(const AudioFrameBuffer& actual, const AudioFrameBuffer& expected)
+{
+  BOOST_REQUIRE_EQUAL( actual.size(), expected.size() );
+  for( size_t i = 0; i < actual.size(); i++ )
+  {
+    if( actual[i].left != expected[i].left || actual[i].right != expected[i].right )
+    {
+      BOOST_FAIL( "Frame " << i << " differs" );
+    }
+  }
+}
+}
+
+BOOST_AUTO_TEST_CASE( MatchesSerialRender )
+{
+  const auto serial = renderAll( *makeModule(), 1024 );
+  BOOST_REQUIRE_EQUAL( serial.size(), makeModule()->length() );
+
+  for( size_t jobs: { 1, 3, 8 } )
+  {
+    const auto module = makeModule();
+    BOOST_REQUIRE_EQUAL( module->seekStateCount(), 13 );
+    SegmentRenderer renderer( module, []() {
+      return makeModule();
+    }, jobs );
+    BOOST_REQUIRE( renderer.initialize( Frequency ) );
+    BOOST_CHECK_EQUAL( renderer.segmentCount(), 13 );
+    checkEqual( renderAll( renderer, 1000 ), serial );
+    BOOST_CHECK_EQUAL( renderer.renderedFrames(), serial.size() );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( ResonantFilterMatchesSerialRender )
+{
+  // the filter history is part of the channel state restored at each segment start
+  const auto serialModule = makeFilteredIt();
+  BOOST_REQUIRE( serialModule );
+  BOOST_REQUIRE( serialModule->hasExactSeekStates() );
+  BOOST_REQUIRE_GE( serialModule->seekStateCount(), 5u );
+  const auto serial = renderAll( *serialModule, 1024 );
+  BOOST_REQUIRE_EQUAL( serial.size(), serialModule->length() );
+
+  const auto module = makeFilteredIt();
+  SegmentRenderer renderer( module, makeFilteredIt, 3 );
+  BOOST_REQUIRE( renderer.initialize( Frequency ) );
+  BOOST_CHECK_EQUAL( renderer.segmentCount(), module->seekStateCount() );
+  checkEqual( renderAll( renderer, 1000 ), serial );
+}
+
+BOOST_AUTO_TEST_CASE( InexactStatesAreNotSplit )
+{
+  const auto module = makeModule( false );
+  SegmentRenderer renderer( module, []() {
+    return makeModule( false );
+  }, 4 );
+  BOOST_REQUIRE( renderer.initialize( Frequency ) );
+  BOOST_CHECK_EQUAL( renderer.segmentCount(), 1 );
+  checkEqual( renderAll( renderer, 1000 ), renderAll( *makeModule( false ), 1024 ) );
+}
+
+BOOST_AUTO_TEST_CASE( FailingCloneEndsTheStream )
+{
+  const auto module = makeModule();
+  SegmentRenderer renderer( module, []() {
+    return AbstractModule::Ptr();
+  }, 2 );
+  BOOST_REQUIRE( renderer.initialize( Frequency ) );
+  BOOST_CHECK( renderAll( renderer, 1000 ).empty() );
+}
@@ -0,0 +1,114 @@
+#ifndef PPPLAY_TESTMODULE_H
+#define PPPLAY_TESTMODULE_H
+
+#include "../abstractmodule.h"
+#include "../orderentry.h"
+
+/**
+ * @brief A module rendering a known signal
+ *
+ * @details
+ * Every order has 64 rows of 6 ticks. The tick length changes every row, so
+ * ticks do not line up with the buffers of the callers. Frame @c n of the song
+ * has the value frameAt(n), so any rendering can be checked against it.
+ */
+class TestModule : public ppp::AbstractModule
+{
+public:
+  /**
+   * @param[in] orders Number of orders, each lasts for about 7.5 seconds
+   * @param[in] exactSeekStates Value of hasExactSeekStates()
+   */
+  explicit TestModule(size_t orders, bool exactSeekStates = true)
+    : AbstractModule( 1 )
+    , m_exactSeekStates( exactSeekStates )
+  {
+    for( size_t i = 0; i < orders; i++ )
+    {
+      addOrder( std::make_unique<ppp::OrderEntry>( 0 ) );
+    }
+    setSpeed( 6 );
+    setTempo( tempoOf( 0 ) );
+  }
+
+  static BasicSampleFrame frameAt(size_t n)
+  {
+    return BasicSampleFrame( static_cast<int16_t>(n * 7), static_cast<int16_t>(n >> 3) );
+  }
+
+private:
+  bool m_exactSeekStates;
+
+  static uint8_t tempoOf(int16_t row)
+  {
+    return static_cast<uint8_t>(120 + row % 11);
+  }
+
+  ppp::ChannelState internal_channelStatus(size_t) const override
+  {
+    return ppp::ChannelState();
+  }
+
+  int internal_channelCount() const override
+  {
+    return 1;
+  }
+
+  bool internal_hasExactSeekStates() const override
+  {
+    return m_exactSeekStates;
+  }
+
+  size_t internal_buildTick(const AudioFrameBufferPtr& buffer) override
+  {
+    if( state().order >= orderCount() )
+    {
+      return 0;
+    }
+
+    const size_t length = tickBufferLength();
+    if( buffer != nullptr )
+    {
+      buffer->clear();
+      for( size_t i = 0; i < length; i++ )
+      {
+        buffer->emplace_back( frameAt( state().playedFrames + i ) );
+      }
+    }
+    state().playedFrames += length;
+
+    nextTick();
+    if( state().tick == 0 )
+    {
+      if( state().row == 63 )
+      {
+        setRow( 0 );
+        setOrder( state().order + 1 );
+      }
+      else
+      {
+        setRow( state().row + 1 );
+      }
+      setTempo( tempoOf( state().row ) );
+    }
+    return length;
+  }
+};
+
+/**
+ * @brief Render a source until it ends
+ * @param[in] source The source
+ * @param[in] chunk Number of frames requested per call
+ */
+inline AudioFrameBuffer renderAll(AbstractAudioSource& source, size_t chunk)
+{
+  AudioFrameBuffer result;
+  AudioFrameBuffer buffer( chunk );
+  while( const size_t count = source.getAudioData( buffer.data(), chunk ) )
+  {
+    result.insert( result.end(), buffer.begin(), buffer.begin() + count );
+  }
+  return result;
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <genmod/genbase.h>
 #include <genmod/stepper.h>
 #include <genmod/standardfxdesc.h>
+#include <stuff/profiler.h>
 
 #include <boost/algorithm/string.hpp>
 
@@ -13,6 +14,43 @@ namespace
 {
 constexpr uint8_t ChanToCarrier[9] = { 3, 4, 5, 11, 12, 13, 19, 20, 21 };
 constexpr uint16_t NoteToFnum[12] = { 8555, 8577, 8600, 8624, 8650, 8677, 8706, 8736, 8769, 8803, 8839, 8878 };
+
+/**
+ * @brief HSC files have no signature, so only the filename and the size can be checked
+ */
+bool isHscFile(Stream* stream)
+{
+  return boost::ends_with( boost::to_lower_copy( stream->name() ), ".hsc" ) && stream->size() <= 59187;
+}
+}
+
+std::unique_ptr<ppp::AbstractModule::ProbeInfo> Module::probe(Stream* stream)
+{
+  if( !isHscFile( stream ) )
+  {
+    return nullptr;
+  }
+  auto result = std::make_unique<ProbeInfo>();
+  result->filename = stream->name();
+  result->format = "hsc";
+  result->trackerInfo = "HSC Tracker";
+  result->channels = 9;
+  result->instruments = 128;
+
+  stream->seek( 128 * 12 );
+  uint8_t orders[51];
+  stream->read( orders, 51 );
+  if( !stream->good() )
+  {
+    return nullptr;
+  }
+  for( int i = 0; i < 51 && orders[i] != 0xff; i++ )
+  {
+    result->orders++;
+  }
+  const size_t patternBytes = stream->size() - stream->pos();
+  result->patterns = std::min<size_t>( 50, (patternBytes + sizeof( Note ) * 64 * 9 - 1) / (sizeof( Note ) * 64 * 9) );
+  return result;
 }
 
 std::shared_ptr<ppp::AbstractModule> Module::factory(Stream* stream,
@@ -31,7 +69,12 @@ std::shared_ptr<ppp::AbstractModule> Module::factory(Stream* stream,
 
 size_t Module::internal_buildTick(const AudioFrameBufferPtr& buffer)
 {
-  if( !update( buffer == nullptr ) )
+  bool updated;
+  {
+    ppp::profile::ScopedTimer timer( ppp::profile::Stage::Update );
+    updated = update( buffer == nullptr );
+  }
+  if( !updated )
   {
     logger()->info( L4CXX_LOCATION, "Update failed, song end reached" );
     return 0;
@@ -49,6 +92,7 @@ size_t Module::internal_buildTick(const AudioFrameBufferPtr& buffer)
   const auto BufferSize = static_cast<size_t>(frequency() / 18.20676);
   if( buffer )
   {
+    ppp::profile::ScopedTimer timer( ppp::profile::Stage::Opl );
     buffer->resize( BufferSize );
     ppp::Stepper interp( opl::Opl3::SampleRate, frequency() );
     for( size_t i = 0; i < BufferSize; i++ )
@@ -81,7 +125,7 @@ ppp::ChannelState Module::internal_channelStatus(size_t idx) const
 
 bool Module::load(Stream* stream)
 {
-  if( !boost::ends_with( boost::to_lower_copy( stream->name() ), ".hsc" ) || stream->size() > 59187 )
+  if( !isHscFile( stream ) )
   {
     logger()->debug( L4CXX_LOCATION, "Invalid filename or size mismatch (size=%d)", stream->size() );
     return false;
@@ -66,6 +66,13 @@ public:
                                                  int maxRpt,
                                                  ppp::Sample::Interpolation inter);
 
+  /**
+   * @brief Read the module's meta information without loading it
+   * @param[in] stream Module stream
+   * @return Meta information or nullptr if the stream does not contain an HSC module
+   */
+  static std::unique_ptr<ProbeInfo> probe(Stream* stream);
+
 protected:
   AbstractArchive& serialize(AbstractArchive* data) override;
 
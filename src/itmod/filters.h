@@ -40,11 +40,22 @@ public:
     m_k.fill( 0 );
   }
 
+  bool isActive() const noexcept
+  {
+    return m_active;
+  }
+
   float filter(float value)
   {
     if( !m_active )
       return value;
 
+    return apply( value );
+  }
+
+  //! @brief Filter a value regardless of isActive()
+  float apply(float value)
+  {
     const auto e = m_r * m_r;
 
     const auto d = (2 * m_p) * (m_r + 1) - 1;
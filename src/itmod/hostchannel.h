@@ -1,6 +1,7 @@
 #pragma once
 
 #include "genmod/channelstate.h"
+#include "stream/abstractarchive.h"
 
 #include <cstdint>
 #include <boost/assert.hpp>
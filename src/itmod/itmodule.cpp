@@ -1,3 +1,4 @@
+#include <bitset>
 #include <cmath>
 #include <map>
 #include <cstring>
@@ -6,6 +7,7 @@
 #include "genmod/genbase.h"
 #include "genmod/orderentry.h"
 #include "genmod/channelstate.h"
+#include "stuff/profiler.h"
 
 #include "itmodule.h"
 #include "itdata.h"
@@ -460,6 +462,117 @@ void ItModule::initVibrato(HostChannel& host)
   setVibrato( host );
 }
 
+namespace
+{
+std::string trackerName(uint16_t cwtV)
+{
+  switch( cwtV & 0xf000u )
+  {
+  case 0x0000:
+    return stringFmt( "Impulse Tracker %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
+  case 0x1000:
+  {
+    auto schismVersion = cwtV & 0xfff;
+    if( schismVersion <= 0x50 )
+    {
+      return stringFmt( "Schism Tracker %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
+    }
+
+    // > 0x50: the number of days since 2009-10-31
+
+    tm epoch{};
+    epoch.tm_year = 109;
+    epoch.tm_mon = 9;
+    epoch.tm_mday = 31;
+    auto epochSec = mktime( &epoch );
+
+    auto versionSec = ((schismVersion - 0x50) * 86400) + epochSec;
+    tm version{};
+#ifndef _MSC_VER
+    if( localtime_r(&versionSec, &version) )
+#else
+    if( localtime_s( &version, &versionSec ) )
+#endif
+    {
+      return stringFmt( "Schism Tracker %04d-%02d-%02d", version.tm_year + 1900, version.tm_mon + 1,
+                        version.tm_mday );
+    }
+    return stringFmt( "Schism Tracker 0x%03x", schismVersion );
+  }
+  case 0x4000:
+    return stringFmt( "pyIT %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
+  case 0x5000:
+    return stringFmt( "OpenMPT %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
+  case 0x6000:
+    return stringFmt( "BeRoTracker %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
+  case 0x7000:
+    if( cwtV == 0x7fff )
+    {
+      return "munch.py";
+    }
+    return stringFmt( "ITMCK %d.%d.%d", (cwtV >> 8) & 0xf, (cwtV >> 4) & 0xf, cwtV & 0xf );
+  case 0x8000:
+    return stringFmt( "Tralala %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
+  case 0xc000:
+    return stringFmt( "ChickDune ChipTune Tracker %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
+  case 0xd000:
+    if( cwtV == 0xdaeb )
+    {
+      return "spc2it";
+    }
+    return stringFmt( "Unknown (0x%04x)", cwtV );
+  default:
+    return stringFmt( "Unknown (0x%04x)", cwtV );
+  }
+}
+}
+
+std::unique_ptr<AbstractModule::ProbeInfo> ItModule::probe(Stream* stream)
+{
+  BOOST_ASSERT( stream != nullptr );
+  stream->seek( 0 );
+
+  ITHeader header;
+  *stream >> header;
+  if( !stream->good() || std::strncmp( header.id, "IMPM", 4 ) != 0 )
+  {
+    return nullptr;
+  }
+
+  auto result = std::make_unique<ProbeInfo>();
+  result->filename = stream->name();
+  result->format = "it";
+  result->title = stringncpy( header.name, 26 );
+  result->trackerInfo = trackerName( header.cwtV );
+  for( int i = 0; i < 64; ++i )
+  {
+    if( (header.chnPan[i] & 0x80) == 0 )
+    {
+      result->channels = i + 1;
+    }
+  }
+  result->orders = header.ordNum;
+  result->patterns = header.patNum;
+  result->samples = header.smpNum;
+  result->instruments = (header.flags & ITHeader::FlgInstrumentMode) != 0 ? header.insNum : 0;
+
+  stream->seekrel( header.ordNum + 4 * header.insNum );
+  const auto sampleOffsets = stream->readVector<uint32_t>( header.smpNum );
+  for( const auto offset: sampleOffsets )
+  {
+    stream->seek( offset );
+    ItSampleHeader sampleHeader;
+    *stream >> sampleHeader;
+    if( !stream->good() || std::strncmp( sampleHeader.id, "IMPS", 4 ) != 0 )
+    {
+      return nullptr;
+    }
+    result->sampleNames.emplace_back( stringncpy( sampleHeader.name, 26 ) );
+  }
+
+  return result;
+}
+
 std::shared_ptr<AbstractModule> ItModule::factory(Stream* stream,
                                                   uint32_t frequency,
                                                   int maxRpt,
@@ -567,6 +680,12 @@ std::shared_ptr<AbstractModule> ItModule::factory(Stream* stream,
     BOOST_ASSERT( stream->good() );
   }
 
+  result->m_patternIndices.reserve( result->m_patterns.size() );
+  for( auto& pattern: result->m_patterns )
+  {
+    result->m_patternIndices.emplace_back( pattern );
+  }
+
   if( (result->m_header.flags & ITHeader::FlgInstrumentMode) == 0 )
   {
     // pre-bind channels
@@ -591,88 +710,7 @@ std::shared_ptr<AbstractModule> ItModule::factory(Stream* stream,
     result->m_slaves[i].setHost( &result->m_hosts[i] );
   }
 
-  const uint16_t cwtV = result->m_header.cwtV;
-  switch( cwtV & 0xf000u )
-  {
-  case 0x0000:
-    result->noConstMetaInfo().trackerInfo = stringFmt( "Impulse Tracker %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
-    break;
-  case 0x1000:
-  {
-    auto schismVersion = cwtV & 0xfff;
-    if( schismVersion <= 0x50 )
-    {
-      result->noConstMetaInfo().trackerInfo = stringFmt( "Schism Tracker %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
-    }
-    else
-    {
-      // > 0x50: the number of days since 2009-10-31
-
-      tm epoch{};
-      epoch.tm_year = 109;
-      epoch.tm_mon = 9;
-      epoch.tm_mday = 31;
-      auto epochSec = mktime( &epoch );
-
-      auto versionSec = ((schismVersion - 0x50) * 86400) + epochSec;
-      tm version{};
-#ifndef _MSC_VER
-      if( localtime_r(&versionSec, &version) )
-#else
-      if( localtime_s( &version, &versionSec ) )
-#endif
-      {
-        result->noConstMetaInfo().trackerInfo =
-          stringFmt( "Schism Tracker %04d-%02d-%02d", version.tm_year + 1900, version.tm_mon + 1,
-                     version.tm_mday );
-      }
-      else
-      {
-        result->noConstMetaInfo().trackerInfo = stringFmt( "Schism Tracker 0x%03x", schismVersion );
-      }
-    }
-  }
-    break;
-  case 0x4000:
-    result->noConstMetaInfo().trackerInfo = stringFmt( "pyIT %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
-    break;
-  case 0x5000:
-    result->noConstMetaInfo().trackerInfo = stringFmt( "OpenMPT %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
-    break;
-  case 0x6000:
-    result->noConstMetaInfo().trackerInfo = stringFmt( "BeRoTracker %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
-    break;
-  case 0x7000:
-    if( cwtV == 0x7fff )
-    {
-      result->noConstMetaInfo().trackerInfo = "munch.py";
-    }
-    else
-    {
-      result->noConstMetaInfo().trackerInfo =
-        stringFmt( "ITMCK %d.%d.%d", (cwtV >> 8) & 0xf, (cwtV >> 4) & 0xf, cwtV & 0xf );
-    }
-    break;
-  case 0x8000:
-    result->noConstMetaInfo().trackerInfo = stringFmt( "Tralala %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
-    break;
-  case 0xc000:
-    result->noConstMetaInfo().trackerInfo =
-      stringFmt( "ChickDune ChipTune Tracker %X.%02X", (cwtV >> 8) & 0xf, cwtV & 0xff );
-    break;
-  case 0xd000:
-    if( cwtV == 0xdaeb )
-    {
-      result->noConstMetaInfo().trackerInfo = "spc2it";
-    }
-    else
-    {
-      result->noConstMetaInfo().trackerInfo = stringFmt( "Unknown (0x%04x)", cwtV );
-    }
-    break;
-  default:
-    result->noConstMetaInfo().trackerInfo = stringFmt( "Unknown (0x%04x)", cwtV );
-  }
+  result->noConstMetaInfo().trackerInfo = trackerName( result->m_header.cwtV );
   result->noConstMetaInfo().filename = stream->name();
   result->noConstMetaInfo().title = stringncpy( result->m_header.name, 26 );
 
@@ -686,7 +724,12 @@ std::shared_ptr<AbstractModule> ItModule::factory(Stream* stream,
 
 size_t ItModule::internal_buildTick(const AudioFrameBufferPtr& buffer)
 {
-  if( !update() )
+  bool updated;
+  {
+    profile::ScopedTimer timer( profile::Stage::Update );
+    updated = update();
+  }
+  if( !updated )
   {
     logger()->info( L4CXX_LOCATION, "Update failed" );
     setOrder( orderCount() );
@@ -713,11 +756,16 @@ size_t ItModule::internal_buildTick(const AudioFrameBufferPtr& buffer)
 
   MixerFrameBuffer mixBuffer;
   mixBuffer.resize( tickBufferLength() );
-  M32MixHandler( mixBuffer, buffer == nullptr );
+  profile::count( profile::Counter::AnnotatedAllocations );
+  {
+    profile::ScopedTimer timer( profile::Stage::Mix );
+    M32MixHandler( mixBuffer, buffer == nullptr );
+  }
   BOOST_ASSERT( mixBuffer.size() == tickBufferLength() );
 
   if( buffer != nullptr )
   {
+    profile::ScopedTimer timer( profile::Stage::PostProcess );
     buffer->clear();
 
     for( const auto& f: mixBuffer )
@@ -920,8 +968,8 @@ void ItModule::loadRow()
   BOOST_ASSERT( m_patternDataPtr != nullptr );
   while( uint8_t cellHeader = *m_patternDataPtr++ )
   {
-    BOOST_ASSERT( (cellHeader & 0x7fu) > 0 && (cellHeader & 0x7fu) <= m_hosts.size() );
-    auto host = &m_hosts[(cellHeader & 0x7fu) - 1];
+    // malformed patterns may refer to channels beyond 64, wrap them around like the PatternIndex does
+    auto host = &m_hosts[((cellHeader & 0x7fu) - 1) & 0x3fu];
 
     host->channelState.cell.clear();
 
@@ -1095,7 +1143,13 @@ void ItModule::goToProcessRow()
 
   m_currentDecodingPattern = state().pattern;
 
-  const auto& pattern = m_patterns.at( state().pattern );
+  auto& pattern = m_patterns.at( state().pattern );
+  auto& index = m_patternIndices.at( state().pattern );
+  if( !index.isSeededBy( m_hosts ) )
+  {
+    // the pattern relies on cell masks the previous pattern left behind
+    index = PatternIndex( pattern, PatternIndex::cellMasks( m_hosts ) );
+  }
 
   const auto& patternData = pattern.empty() ? emptyPattern : pattern;
 
@@ -1110,42 +1164,92 @@ void ItModule::goToProcessRow()
   setRow( m_nextRow );
   m_currentDecodingRow = m_nextRow;
 
-  m_patternDataPtr = patternData.data() + 6; // skip rowcount + dummy data
-
-  for( int i = 0; i < m_nextRow; ++i )
+  if( pattern.empty() )
   {
-    while( const auto chn = *m_patternDataPtr++ )
-    {
-      auto host = &m_hosts[(chn & 0x7fu) - 1];
+    // each row only consists of its terminating 0
+    m_patternDataPtr = patternData.data() + 6 + m_nextRow;
+    return;
+  }
 
-      if( (chn & 0x80u) != 0 )
-      {
-        host->cellMask = *m_patternDataPtr++;
-      }
+  // instead of decoding all rows before m_nextRow, apply the values they leave behind
+  BOOST_ASSERT( static_cast<size_t>(m_nextRow) < index.rows() );
+  m_patternDataPtr = patternData.data() + index.rowOffset( m_nextRow );
+  index.restore( m_nextRow, m_hosts );
+}
 
-      if( (host->cellMask & HCFLG_MSK_NOTE_1) != 0 )
-      {
-        host->patternNote = *m_patternDataPtr++;
-      }
+void ItModule::internal_prefetch(size_t order)
+{
+  const auto patternIndex = orderAt( order )->index();
+  if( patternIndex >= m_patterns.size() || m_patterns[patternIndex].empty() )
+  {
+    return;
+  }
 
-      if( (host->cellMask & HCFLG_MSK_INS_1) != 0 )
+  // only the instrument column is of interest, see loadRow() for the format
+  const auto& patternData = m_patterns[patternIndex];
+  const uint8_t* ptr = patternData.data() + 6;
+  const uint8_t* const end = patternData.data() + patternData.size();
+  std::array<uint8_t, 64> cellMasks{};
+  std::bitset<100> used;
+  while( ptr < end )
+  {
+    const auto chn = *ptr++;
+    if( chn == 0 )
+    {
+      continue;
+    }
+
+    auto& cellMask = cellMasks[(chn - 1) & 0x3fu];
+    if( (chn & 0x80u) != 0 && ptr < end )
+    {
+      cellMask = *ptr++;
+    }
+    if( (cellMask & HCFLG_MSK_NOTE_1) != 0 )
+    {
+      ++ptr;
+    }
+    if( (cellMask & HCFLG_MSK_INS_1) != 0 && ptr < end )
+    {
+      const auto ins = *ptr++;
+      if( ins != 0 && ins < used.size() )
       {
-        host->patternInstrument = *m_patternDataPtr++;
+        used.set( ins );
       }
+    }
+    if( (cellMask & HCFLG_MSK_VOL_1) != 0 )
+    {
+      ++ptr;
+    }
+    if( (cellMask & HCFLG_MSK_CMD_1) != 0 )
+    {
+      ptr += 2;
+    }
+  }
 
-      if( (host->cellMask & HCFLG_MSK_VOL_1) != 0 )
+  for( size_t ins = 1; ins < used.size(); ++ins )
+  {
+    if( !used[ins] )
+    {
+      continue;
+    }
+    if( (m_header.flags & ITHeader::FlgInstrumentMode) == 0 )
+    {
+      if( ins <= m_samples.size() )
       {
-        host->patternVolume = *m_patternDataPtr++;
+        m_samples[ins - 1]->prefetch();
       }
-
-      if( (host->cellMask & HCFLG_MSK_CMD_1) != 0 )
+    }
+    else if( ins <= m_instruments.size() )
+    {
+      for( const auto& entry: m_instruments[ins - 1].keyboardTable )
       {
-        host->lastPatternFx = *m_patternDataPtr++;
-        host->lastPatternFxParam = *m_patternDataPtr++;
+        if( entry.sample != 0 && entry.sample <= m_samples.size() )
+        {
+          m_samples[entry.sample - 1]->prefetch();
+        }
       }
     }
   }
-  BOOST_ASSERT( m_patternDataPtr <= patternData.data() + patternData.size() );
 }
 
 void ItModule::onCellLoaded(HostChannel& host)
@@ -3945,6 +4049,28 @@ Retry:
   }
 }
 
+/**
+ * @brief Add the frames of a voice to the mix buffer
+ * @tparam Filtered Set if the voice's filters are active, decided once per tick
+ */
+template<bool Filtered>
+void mixVoice(SlaveChannel& slave, const AudioFrameBuffer& frames, MixerFrameBuffer& mixBuffer)
+{
+  for( size_t i = 0; i < frames.size(); ++i )
+  {
+    float l = static_cast<MixerSample>(frames[i].left) * slave.mixVolumeL;
+    float r = static_cast<MixerSample>(frames[i].right) * slave.mixVolumeR;
+    if( Filtered )
+    {
+      l = slave.filterL.apply( l );
+      r = slave.filterR.apply( r );
+    }
+
+    mixBuffer[i].left += l;
+    mixBuffer[i].right += r;
+  }
+}
+
 void ItModule::M32MixHandler(MixerFrameBuffer& mixBuffer, bool preprocess)
 {
   static constexpr int MixVolume = 0x80; //!< 0..128
@@ -4021,37 +4147,52 @@ void ItModule::M32MixHandler(MixerFrameBuffer& mixBuffer, bool preprocess)
     }
 
     {
-      auto tmpBuf = ppp::read(
-        *slave.smpOffs,
-        slave.lpm,
-        interpolation(),
-        slave.sampleOffset,
-        mixBuffer.size(),
-        slave.loopDirBackward,
-        slave.loopBeg,
-        slave.loopEnd,
-        preprocess );
+      slave.filterL
+           .update( frequency(), (slave.filterCutoff & 0x7fu) * slave.envFilterCutoff, slave.filterResonance );
+      slave.filterR
+           .update( frequency(), (slave.filterCutoff & 0x7fu) * slave.envFilterCutoff, slave.filterResonance );
 
-      BOOST_ASSERT( tmpBuf.size() <= mixBuffer.size() );
-
-      if( !preprocess )
+      // an active filter keeps ringing even without input, and its history is part of
+      // the seek states, so it is run while preprocessing, too
+      size_t mixed;
+      if( !slave.filterL.isActive() && (preprocess || (slave.mixVolumeL == 0 && slave.mixVolumeR == 0)) )
       {
-        slave.filterL
-             .update( frequency(), (slave.filterCutoff & 0x7fu) * slave.envFilterCutoff, slave.filterResonance );
-        slave.filterR
-             .update( frequency(), (slave.filterCutoff & 0x7fu) * slave.envFilterCutoff, slave.filterResonance );
-
-        for( size_t i = 0; i < tmpBuf.size(); ++i )
+        mixed = ppp::skip(
+          *slave.smpOffs,
+          slave.lpm,
+          slave.sampleOffset,
+          mixBuffer.size(),
+          slave.loopDirBackward,
+          slave.loopBeg,
+          slave.loopEnd );
+      }
+      else
+      {
+        auto tmpBuf = ppp::read(
+          *slave.smpOffs,
+          slave.lpm,
+          interpolation(),
+          slave.sampleOffset,
+          mixBuffer.size(),
+          slave.loopDirBackward,
+          slave.loopBeg,
+          slave.loopEnd,
+          false );
+
+        BOOST_ASSERT( tmpBuf.size() <= mixBuffer.size() );
+
+        if( slave.filterL.isActive() )
         {
-          const auto l = slave.filterL.filter( static_cast<MixerSample>(tmpBuf[i].left) * slave.mixVolumeL );
-          const auto r = slave.filterR.filter( static_cast<MixerSample>(tmpBuf[i].right) * slave.mixVolumeR );
-
-          mixBuffer[i].left += l;
-          mixBuffer[i].right += r;
+          mixVoice<true>( slave, tmpBuf, mixBuffer );
         }
+        else
+        {
+          mixVoice<false>( slave, tmpBuf, mixBuffer );
+        }
+        mixed = tmpBuf.size();
       }
 
-      if( mixBuffer.size() != tmpBuf.size() )
+      if( mixBuffer.size() != mixed )
       {
         slave.flags = SCFLG_NOTE_CUT;
         if( !slave.disowned )
@@ -4083,6 +4224,12 @@ int ItModule::internal_channelCount() const
   return m_hosts.size();
 }
 
+bool ItModule::internal_hasExactSeekStates() const
+{
+  // the length estimation runs the full update, and mixes the voices with an active filter
+  return true;
+}
+
 light4cxx::Logger* ItModule::logger()
 {
   return light4cxx::Logger::get( AbstractModule::logger()->name() + ".it" );
@@ -6,6 +6,7 @@
 #include "hostchannel.h"
 #include "sample.h"
 #include "instrument.h"
+#include "patternindex.h"
 
 #include <cstring>
 
@@ -113,11 +114,20 @@ public:
                                                  int maxRpt,
                                                  Sample::Interpolation inter);
 
+  /**
+   * @brief Read the module's meta information without loading it
+   * @param[in] stream Module stream
+   * @return Meta information or nullptr if the stream does not contain an IT module
+   */
+  static std::unique_ptr<ProbeInfo> probe(Stream* stream);
+
 private:
   ITHeader m_header{};
 
   std::vector<ItInstrument> m_instruments{};
   std::vector<ItPattern> m_patterns{};
+  //! @brief Row index of each pattern, see goToProcessRow()
+  std::vector<PatternIndex> m_patternIndices{};
   std::array<HostChannel, 64> m_hosts{};
   std::array<SlaveChannel, 256> m_slaves{};
 
@@ -186,6 +196,10 @@ private:
 
   int internal_channelCount() const override;
 
+  bool internal_hasExactSeekStates() const override;
+
+  void internal_prefetch(size_t order) override;
+
   static light4cxx::Logger* logger();
 
   bool update();
@@ -0,0 +1,188 @@
+#include "patternindex.h"
+
+#include <light4cxx/logger.h>
+
+#include <bitset>
+
+namespace ppp
+{
+namespace it
+{
+namespace
+{
+constexpr size_t HeaderSize = 6;
+
+inline size_t hostIndex(uint8_t cellHeader) noexcept
+{
+  // like ItModule::loadRow(), channels beyond 64 wrap around
+  return ((cellHeader & 0x7fu) - 1) & 0x3fu;
+}
+}
+
+PatternIndex::PatternIndex(std::vector<uint8_t>& pattern, const std::array<uint8_t, 64>& seeds)
+{
+  if( pattern.size() < HeaderSize )
+  {
+    return;
+  }
+  const size_t rows = pattern[0] | (pattern[1] << 8);
+
+  // first pass: the channels the pattern uses and the row offsets
+  bool truncated = false;
+  const auto require = [&pattern, &truncated](size_t size) {
+    if( pattern.size() < size )
+    {
+      // pad cut-off cells and rows with zeros, i.e. empty values and row ends
+      pattern.resize( size, 0 );
+      truncated = true;
+    }
+  };
+  std::array<uint8_t, 64> masks = seeds;
+  std::bitset<64> used;
+  std::bitset<64> masked;
+  size_t pos = HeaderSize;
+  m_rowOffsets.reserve( rows );
+  for( size_t row = 0; row < rows; ++row )
+  {
+    m_rowOffsets.emplace_back( static_cast<uint32_t>(pos) );
+    while( true )
+    {
+      require( pos + 1 );
+      const uint8_t chn = pattern[pos++];
+      if( chn == 0 )
+      {
+        break;
+      }
+      const size_t host = hostIndex( chn );
+      if( (chn & 0x80u) != 0 )
+      {
+        require( pos + 1 );
+        masks[host] = pattern[pos++];
+        masked.set( host );
+      }
+      else if( !masked[host] && !used[host] )
+      {
+        // decoded with the mask the previous pattern left behind
+        m_seeds.emplace_back( static_cast<uint8_t>(host), masks[host] );
+      }
+      used.set( host );
+      pos += ((masks[host] & HCFLG_MSK_NOTE_1) != 0) + ((masks[host] & HCFLG_MSK_INS_1) != 0)
+        + ((masks[host] & HCFLG_MSK_VOL_1) != 0) + ((masks[host] & HCFLG_MSK_CMD_1) != 0) * 2;
+      require( pos );
+    }
+  }
+  if( truncated )
+  {
+    light4cxx::Logger::get( "module.it" )->warn( L4CXX_LOCATION, "Pattern data is truncated, padded to %d bytes", pattern.size() );
+  }
+
+  std::array<int, 64> slot;
+  slot.fill( -1 );
+  for( size_t host = 0; host < 64; ++host )
+  {
+    if( used[host] )
+    {
+      slot[host] = static_cast<int>(m_channels.size());
+      m_channels.emplace_back( static_cast<uint8_t>(host) );
+    }
+  }
+
+  // second pass: the values carried into each row
+  std::vector<CarriedValues> current( m_channels.size() );
+  std::array<uint8_t, 64> cellMasks = seeds;
+  m_carried.reserve( rows * m_channels.size() );
+  for( size_t row = 0; row < rows; ++row )
+  {
+    m_carried.insert( m_carried.end(), current.begin(), current.end() );
+    pos = m_rowOffsets[row];
+    while( const uint8_t chn = pattern[pos++] )
+    {
+      const size_t host = hostIndex( chn );
+      CarriedValues dummy;
+      CarriedValues& values = slot[host] < 0 ? dummy : current[slot[host]];
+      uint8_t& mask = cellMasks[host];
+      if( (chn & 0x80u) != 0 )
+      {
+        mask = values.cellMask = pattern[pos++];
+        values.flags |= CarriedValues::FlgMask;
+      }
+      if( (mask & HCFLG_MSK_NOTE_1) != 0 )
+      {
+        values.note = pattern[pos++];
+        values.flags |= CarriedValues::FlgNote;
+      }
+      if( (mask & HCFLG_MSK_INS_1) != 0 )
+      {
+        values.instrument = pattern[pos++];
+        values.flags |= CarriedValues::FlgInstrument;
+      }
+      if( (mask & HCFLG_MSK_VOL_1) != 0 )
+      {
+        values.volume = pattern[pos++];
+        values.flags |= CarriedValues::FlgVolume;
+      }
+      if( (mask & HCFLG_MSK_CMD_1) != 0 )
+      {
+        values.fx = pattern[pos++];
+        values.fxParam = pattern[pos++];
+        values.flags |= CarriedValues::FlgFx;
+      }
+    }
+  }
+}
+
+bool PatternIndex::isSeededBy(const std::array<HostChannel, 64>& hosts) const
+{
+  for( const auto& seed: m_seeds )
+  {
+    if( hosts[seed.first].cellMask != seed.second )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::array<uint8_t, 64> PatternIndex::cellMasks(const std::array<HostChannel, 64>& hosts)
+{
+  std::array<uint8_t, 64> masks;
+  for( size_t i = 0; i < hosts.size(); ++i )
+  {
+    masks[i] = hosts[i].cellMask;
+  }
+  return masks;
+}
+
+void PatternIndex::restore(size_t row, std::array<HostChannel, 64>& hosts) const
+{
+  BOOST_ASSERT( row < m_rowOffsets.size() );
+  const CarriedValues* values = m_carried.data() + row * m_channels.size();
+  for( const uint8_t channel: m_channels )
+  {
+    HostChannel& host = hosts[channel];
+    if( (values->flags & CarriedValues::FlgMask) != 0 )
+    {
+      host.cellMask = values->cellMask;
+    }
+    if( (values->flags & CarriedValues::FlgNote) != 0 )
+    {
+      host.patternNote = values->note;
+    }
+    if( (values->flags & CarriedValues::FlgInstrument) != 0 )
+    {
+      host.patternInstrument = values->instrument;
+    }
+    if( (values->flags & CarriedValues::FlgVolume) != 0 )
+    {
+      host.patternVolume = values->volume;
+    }
+    if( (values->flags & CarriedValues::FlgFx) != 0 )
+    {
+      host.lastPatternFx = values->fx;
+      host.lastPatternFxParam = values->fxParam;
+    }
+    ++values;
+  }
+}
+}
+}
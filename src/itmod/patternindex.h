@@ -0,0 +1,116 @@
+#pragma once
+
+#include "hostchannel.h"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ppp
+{
+namespace it
+{
+/**
+ * @brief Row index of a packed IT pattern
+ *
+ * @details
+ * A packed cell only contains the values that differ from the channel's
+ * previous cell, so decoding a row depends on the cell masks and values left
+ * behind by all preceding rows. The index stores the offset of each row and,
+ * for each row, the values the preceding rows of the pattern left in the host
+ * channels. Decoding can then start at any row in constant time instead of
+ * scanning the pattern from its first row.
+ */
+class PatternIndex
+{
+public:
+  PatternIndex() = default;
+
+  /**
+   * @brief Build the index of a pattern
+   * @param[in,out] pattern Pattern data, including the 6 header bytes
+   * @param[in] seeds Cell masks of the host channels when playback enters the pattern
+   * @note Truncated patterns are padded with empty rows.
+   */
+  PatternIndex(std::vector<uint8_t>& pattern, const std::array<uint8_t, 64>& seeds);
+
+  //! @brief Build the index of a pattern, assuming cleared cell masks when playback enters it
+  explicit PatternIndex(std::vector<uint8_t>& pattern)
+    : PatternIndex( pattern, std::array<uint8_t, 64>{} )
+  {
+  }
+
+  /**
+   * @brief Check whether the index is valid for the cell masks of the host channels
+   * @param[in] hosts The host channels when playback enters the pattern
+   *
+   * @details
+   * A channel that is used before the pattern sets its cell mask is decoded
+   * with the mask the previous pattern left behind. The index is only valid
+   * for the masks it was built with; well-formed patterns set the mask on the
+   * first use, so their index is valid for any masks.
+   */
+  bool isSeededBy(const std::array<HostChannel, 64>& hosts) const;
+
+  /**
+   * @brief Get the cell masks of the host channels, to build the index with
+   */
+  static std::array<uint8_t, 64> cellMasks(const std::array<HostChannel, 64>& hosts);
+
+  /**
+   * @brief Get the number of indexed rows
+   */
+  size_t rows() const noexcept
+  {
+    return m_rowOffsets.size();
+  }
+
+  /**
+   * @brief Get the offset of a row within the pattern data
+   */
+  uint32_t rowOffset(size_t row) const
+  {
+    return m_rowOffsets[row];
+  }
+
+  /**
+   * @brief Apply the values the rows before @a row leave in the host channels
+   * @param[in] row The row decoding starts at
+   * @param[in,out] hosts The host channels; values not set by the preceding rows are kept
+   */
+  void restore(size_t row, std::array<HostChannel, 64>& hosts) const;
+
+private:
+  /**
+   * @brief Values of a channel set by the preceding rows
+   */
+  struct CarriedValues
+  {
+    static constexpr uint8_t FlgMask = 0x01;
+    static constexpr uint8_t FlgNote = 0x02;
+    static constexpr uint8_t FlgInstrument = 0x04;
+    static constexpr uint8_t FlgVolume = 0x08;
+    static constexpr uint8_t FlgFx = 0x10;
+
+    //! @brief Values that are set
+    uint8_t flags = 0;
+    uint8_t cellMask = 0;
+    uint8_t note = 0;
+    uint8_t instrument = 0;
+    uint8_t volume = 0;
+    uint8_t fx = 0;
+    uint8_t fxParam = 0;
+  };
+
+  //! @brief Host channels that have data in the pattern
+  std::vector<uint8_t> m_channels{};
+  //! @brief Host channels used before the pattern sets their cell mask, and the masks the index assumes
+  std::vector<std::pair<uint8_t, uint8_t>> m_seeds{};
+  //! @brief Offset of each row within the pattern data
+  std::vector<uint32_t> m_rowOffsets{};
+  //! @brief Values at the start of each row, m_channels.size() entries per row
+  std::vector<CarriedValues> m_carried{};
+};
+}
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "genmod/sample.h"
+#include "genmod/sampledecoder.h"
 #include "stream/stream.h"
 
 #include <cstdint>
@@ -88,96 +89,68 @@ public:
 
     const bool _16Bit = (header.flg & ItSampleHeader::Flg16Bit) != 0;
     const bool mono = (header.flg & ItSampleHeader::FlgStereo) == 0;
+    const size_t count = header.length;
+    size_t size;
+    Decoder decoder;
     if( (header.flg & ItSampleHeader::FlgCompressed) != 0 )
     {
-      bool fixedCompression = (header.cvt & 4u) != 0;
+      const bool fixedCompression = (header.cvt & 4u) != 0;
 
-      // no compressed stereo
-      std::vector<int16_t> data;
-      if( _16Bit )
-      {
-        data = decompress<int16_t>( header.length, stream, fixedCompression );
-      }
-      else
-      {
-        data = decompress<int8_t>( header.length, stream, fixedCompression );
-      }
+      size = compressedSize( stream, count, _16Bit ? 2 : 1 );
+      decoder = [count, _16Bit, fixedCompression](Stream& str, BasicSampleFrame* dest) {
+        // no compressed stereo
+        std::vector<int16_t> decompressed;
+        if( _16Bit )
+        {
+          decompressed = decompress<int16_t>( count, str, fixedCompression );
+        }
+        else
+        {
+          decompressed = decompress<int8_t>( count, str, fixedCompression );
+        }
 
-      setData( interleave( data, data ) );
+        sampledecoder::store( decompressed.data(), dest, decompressed.size(), sampledecoder::Target::Both );
+      };
     }
     else
     {
-      // signedness (or delta?)
+      sampledecoder::Format format;
       if( (header.cvt & 4u) != 0 )
       {
         // delta compression
-        if( _16Bit )
-        {
-          if( mono )
-          {
-            const auto data = decompressAdpcm<int16_t>( header.length, stream );
-            setData( interleave( data, data ) );
-          }
-          else
-          {
-            const auto l = decompressAdpcm<int16_t>( header.length, stream );
-            const auto r = decompressAdpcm<int16_t>( header.length, stream );
-            setData( interleave( l, r ) );
-          }
-        }
-        else
-        {
-          if( mono )
-          {
-            const auto data = decompressAdpcm<int8_t>( header.length, stream );
-            setData( interleave( data, data ) );
-          }
-          else
-          {
-            const auto l = decompressAdpcm<int8_t>( header.length, stream );
-            const auto r = decompressAdpcm<int8_t>( header.length, stream );
-            setData( interleave( l, r ) );
-          }
-        }
+        format = _16Bit ? sampledecoder::Format::Delta16 : sampledecoder::Format::Delta8;
+      }
+      else if( (header.cvt & 1u) != 0 )
+      {
+        format = _16Bit ? sampledecoder::Format::Signed16 : sampledecoder::Format::Signed8;
       }
       else
       {
-        if( _16Bit )
+        format = _16Bit ? sampledecoder::Format::Unsigned16 : sampledecoder::Format::Unsigned8;
+      }
+
+      size = count * sampledecoder::bytesPerValue( format ) * (mono ? 1 : 2);
+      decoder = [count, format, mono](Stream& str, BasicSampleFrame* dest) {
+        if( mono )
         {
-          if( mono )
-          {
-            const auto data = readRaw<int16_t>( stream, header.length );
-            setData( interleave( data, data ) );
-          }
-          else
-          {
-            const auto l = readRaw<int16_t>( stream, header.length );
-            const auto r = readRaw<int16_t>( stream, header.length );
-            setData( interleave( l, r ) );
-          }
+          sampledecoder::decode( str, format, dest, count );
         }
         else
         {
-          if( mono )
-          {
-            const auto data = readRaw<int8_t>( stream, header.length );
-            setData( interleave( data, data ) );
-          }
-          else
-          {
-            const auto l = readRaw<int8_t>( stream, header.length );
-            const auto r = readRaw<int8_t>( stream, header.length );
-            setData( interleave( l, r ) );
-          }
+          sampledecoder::decode( str, format, dest, count, sampledecoder::Target::Left );
+          sampledecoder::decode( str, format, dest, count, sampledecoder::Target::Right );
         }
+      };
+    }
 
-        if( (header.cvt & 1u) == 0 )
-        {
-          swapSign();
-        }
-      }
+    if( deferDecoding( &stream, count, size, decoder ) )
+    {
+      return;
     }
 
+    resizeData( count );
+    decoder( stream, data() );
+
     BOOST_ASSERT( stream.good() );
     BOOST_ASSERT( length() == header.length );
   }
@@ -193,6 +166,32 @@ private:
     return value;
   }
 
+  /**
+   * @brief Get the size of compressed sample data without decompressing it
+   * @param[in] stream Stream positioned at the compressed data, the position is restored
+   * @param[in] len Length of the sample in frames
+   * @param[in] width Bytes per value
+   * @return Size of the compressed data in bytes
+   */
+  static std::size_t compressedSize(Stream& stream, std::size_t len, std::size_t width)
+  {
+    const auto start = stream.pos();
+    const std::size_t blockLength = 0x8000 / width;
+    std::size_t size = 0;
+    // every block starts with the size of its compressed data
+    while( len != 0 && stream )
+    {
+      uint16_t blockSize;
+      stream >> blockSize;
+      stream.seekrel( blockSize );
+      size += 2 + blockSize;
+      len -= std::min( blockLength, len );
+    }
+    stream.clear();
+    stream.seek( start );
+    return size;
+  }
+
   template<typename T>
   static std::vector<int16_t> decompress(std::size_t len, Stream& stream, bool it215)
   {
@@ -297,23 +296,6 @@ private:
     return result;
   }
 
-  template<typename T>
-  static std::vector<int16_t> decompressAdpcm(std::size_t len, Stream& stream)
-  {
-    std::vector<int16_t> result;
-
-    T delta = 0;
-    while( len-- )
-    {
-      T tmp;
-      stream.read( reinterpret_cast<char*>(&tmp), sizeof( T ) );
-      delta += tmp;
-      result.emplace_back( extend( delta ) );
-    }
-
-    return result;
-  }
-
   static uint32_t readBits(const uint8_t n, uint32_t& bitBuffer, uint32_t& bitOffset, Stream& stream)
   {
     BOOST_ASSERT( n <= 32 );
@@ -338,42 +320,6 @@ private:
     }
     return value >> (32u - n);
   }
-
-  template<typename T>
-  static std::vector<int16_t> readRaw(Stream& stream, std::size_t len)
-  {
-    std::vector<int16_t> result;
-    result.reserve( len );
-    while( len-- )
-    {
-      T tmp;
-      stream >> tmp;
-      result.emplace_back( extend( tmp ) );
-    }
-    return result;
-  }
-
-  static AudioFrameBuffer interleave(const std::vector<int16_t>& l, const std::vector<int16_t>& r)
-  {
-    BOOST_ASSERT( l.size() == r.size() );
-
-    AudioFrameBuffer result;
-    result.reserve( l.size() );
-    for( std::size_t i = 0; i < l.size(); ++i )
-    {
-      result.emplace_back( l[i], r[i] );
-    }
-    return result;
-  }
-
-  void swapSign()
-  {
-    for( auto it = beginIterator(); it != endIterator(); ++it )
-    {
-      it->left ^= 0x8000;
-      it->right ^= 0x8000;
-    }
-  }
 };
 }
 }
\ No newline at end of file
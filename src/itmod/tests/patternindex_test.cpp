@@ -0,0 +1,207 @@
+#define BOOST_TEST_MODULE PatternIndex
+
+#include <boost/test/unit_test.hpp>
+
+#include "../patternindex.h"
+
+#include <random>
+
+using namespace ppp::it;
+
+namespace
+{
+typedef std::array<HostChannel, 64> Hosts;
+
+/**
+ * @brief Decode all rows before @a row, the way playback did before the index existed
+ * @return Offset of @a row
+ */
+size_t scan(const std::vector<uint8_t>& pattern, size_t row, Hosts& hosts)
+{
+  size_t pos = 6;
+  for( size_t i = 0; i < row; ++i )
+  {
+    while( const uint8_t chn = pattern.at( pos++ ) )
+    {
+      HostChannel& host = hosts[((chn & 0x7fu) - 1) & 0x3fu];
+      if( (chn & 0x80u) != 0 )
+      {
+        host.cellMask = pattern.at( pos++ );
+      }
+      if( (host.cellMask & HCFLG_MSK_NOTE_1) != 0 )
+      {
+        host.patternNote = pattern.at( pos++ );
+      }
+      if( (host.cellMask & HCFLG_MSK_INS_1) != 0 )
+      {
+        host.patternInstrument = pattern.at( pos++ );
+      }
+      if( (host.cellMask & HCFLG_MSK_VOL_1) != 0 )
+      {
+        host.patternVolume = pattern.at( pos++ );
+      }
+      if( (host.cellMask & HCFLG_MSK_CMD_1) != 0 )
+      {
+        host.lastPatternFx = pattern.at( pos++ );
+        host.lastPatternFxParam = pattern.at( pos++ );
+      }
+    }
+  }
+  return pos;
+}
+
+void checkHosts(const Hosts& actual, const Hosts& expected)
+{
+  for( size_t i = 0; i < actual.size(); ++i )
+  {
+    BOOST_TEST_CONTEXT( "host " << i )
+    {
+      BOOST_REQUIRE_EQUAL( actual[i].cellMask, expected[i].cellMask );
+      BOOST_REQUIRE_EQUAL( actual[i].patternNote, expected[i].patternNote );
+      BOOST_REQUIRE_EQUAL( actual[i].patternInstrument, expected[i].patternInstrument );
+      BOOST_REQUIRE_EQUAL( actual[i].patternVolume, expected[i].patternVolume );
+      BOOST_REQUIRE_EQUAL( actual[i].lastPatternFx, expected[i].lastPatternFx );
+      BOOST_REQUIRE_EQUAL( actual[i].lastPatternFxParam, expected[i].lastPatternFxParam );
+    }
+  }
+}
+
+/**
+ * @brief Generate a packed pattern
+ * @param[in] malformed Use channels without setting their mask first, and cut off the data
+ */
+std::vector<uint8_t> generate(std::mt19937& rng, bool malformed)
+{
+  const size_t rows = std::uniform_int_distribution<size_t>( 1, 200 )( rng );
+  const size_t channels = std::uniform_int_distribution<size_t>( 1, 64 )( rng );
+  std::vector<uint8_t> pattern{ static_cast<uint8_t>(rows), static_cast<uint8_t>(rows >> 8), 0, 0, 0, 0 };
+  std::array<uint8_t, 64> masks{};
+  std::array<bool, 64> masked{};
+  std::uniform_int_distribution<int> byte( 0, 255 );
+  for( size_t row = 0; row < rows; ++row )
+  {
+    const size_t cells = std::uniform_int_distribution<size_t>( 0, 8 )( rng );
+    for( size_t cell = 0; cell < cells; ++cell )
+    {
+      const size_t host = std::uniform_int_distribution<size_t>( 0, channels - 1 )( rng );
+      const bool setMask = (!masked[host] && !malformed) || byte( rng ) < 64;
+      pattern.emplace_back( static_cast<uint8_t>((host + 1) | (setMask ? 0x80 : 0)) );
+      if( setMask )
+      {
+        masks[host] = static_cast<uint8_t>(byte( rng ));
+        masked[host] = true;
+        pattern.emplace_back( masks[host] );
+      }
+      if( !masked[host] )
+      {
+        // the data length depends on the previous pattern's mask, let it be arbitrary
+        continue;
+      }
+      const size_t size = ((masks[host] & HCFLG_MSK_NOTE_1) != 0) + ((masks[host] & HCFLG_MSK_INS_1) != 0)
+                          + ((masks[host] & HCFLG_MSK_VOL_1) != 0) + ((masks[host] & HCFLG_MSK_CMD_1) != 0) * 2;
+      for( size_t i = 0; i < size; ++i )
+      {
+        pattern.emplace_back( static_cast<uint8_t>(byte( rng )) );
+      }
+    }
+    pattern.emplace_back( 0 );
+  }
+  if( malformed )
+  {
+    pattern.resize( pattern.size() - std::uniform_int_distribution<size_t>( 0, pattern.size() - 6 )( rng ) );
+  }
+  return pattern;
+}
+
+Hosts randomHosts(std::mt19937& rng)
+{
+  std::uniform_int_distribution<int> byte( 0, 255 );
+  Hosts hosts;
+  for( HostChannel& host: hosts )
+  {
+    host.cellMask = static_cast<uint8_t>(byte( rng ));
+    host.patternNote = static_cast<uint8_t>(byte( rng ));
+    host.patternInstrument = static_cast<uint8_t>(byte( rng ));
+    host.patternVolume = static_cast<uint8_t>(byte( rng ));
+    host.lastPatternFx = static_cast<uint8_t>(byte( rng ));
+    host.lastPatternFxParam = static_cast<uint8_t>(byte( rng ));
+  }
+  return hosts;
+}
+
+/**
+ * @brief Enter a pattern at every row, once through the index and once by scanning
+ * @details The index is rebuilt if it was built for other cell masks, like ItModule::goToProcessRow() does.
+ */
+void checkPattern(std::mt19937& rng, std::vector<uint8_t> pattern)
+{
+  PatternIndex index( pattern );
+  const size_t rows = pattern[0] | (pattern[1] << 8);
+  BOOST_REQUIRE_EQUAL( index.rows(), rows );
+  for( size_t row = 0; row < rows; ++row )
+  {
+    const Hosts entry = randomHosts( rng );
+    if( !index.isSeededBy( entry ) )
+    {
+      index = PatternIndex( pattern, PatternIndex::cellMasks( entry ) );
+    }
+    BOOST_REQUIRE( index.isSeededBy( entry ) );
+    BOOST_REQUIRE_EQUAL( index.rows(), rows );
+
+    Hosts scanned = entry;
+    const size_t offset = scan( pattern, row, scanned );
+    BOOST_TEST_CONTEXT( "row " << row )
+    {
+      BOOST_REQUIRE_EQUAL( index.rowOffset( row ), offset );
+      Hosts restored = entry;
+      index.restore( row, restored );
+      checkHosts( restored, scanned );
+    }
+  }
+}
+}
+
+BOOST_AUTO_TEST_CASE( WellFormed )
+{
+  std::mt19937 rng( 1 );
+  for( int i = 0; i < 50; ++i )
+  {
+    auto pattern = generate( rng, false );
+    const auto original = pattern;
+    PatternIndex index( pattern );
+    // the index does not depend on the masks of the previous pattern
+    BOOST_CHECK( index.isSeededBy( randomHosts( rng ) ) );
+    BOOST_CHECK( pattern == original );
+    checkPattern( rng, pattern );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( MalformedMasks )
+{
+  std::mt19937 rng( 2 );
+  for( int i = 0; i < 200; ++i )
+  {
+    checkPattern( rng, generate( rng, true ) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( MasksCarriedIntoPattern )
+{
+  // host 1 is used with the previous pattern's mask, which decides whether the next byte is its note or ends the row
+  std::vector<uint8_t> pattern{ 2, 0, 0, 0, 0, 0, 0x01, 0x00, 0x00, 0x81, 0x02, 0x05, 0x00 };
+  Hosts hosts{};
+  hosts[0].patternNote = 0x55;
+
+  PatternIndex cleared( pattern, PatternIndex::cellMasks( hosts ) );
+  BOOST_CHECK( cleared.isSeededBy( hosts ) );
+  BOOST_CHECK_EQUAL( cleared.rowOffset( 1 ), 8 );
+
+  hosts[0].cellMask = HCFLG_MSK_NOTE_1;
+  BOOST_CHECK( !cleared.isSeededBy( hosts ) );
+  PatternIndex seeded( pattern, PatternIndex::cellMasks( hosts ) );
+  BOOST_CHECK( seeded.isSeededBy( hosts ) );
+  BOOST_CHECK_EQUAL( seeded.rowOffset( 1 ), 9 );
+  seeded.restore( 1, hosts );
+  BOOST_CHECK_EQUAL( hosts[0].patternNote, 0x00 );
+  BOOST_CHECK_EQUAL( hosts[0].cellMask, HCFLG_MSK_NOTE_1 );
+}
@@ -0,0 +1,222 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "asyncsink.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace light4cxx
+{
+namespace
+{
+//! @brief Interval in which the writer thread drains the rings
+constexpr std::chrono::milliseconds WriterInterval{ 20 };
+
+/**
+ * @brief Marks the ring of a thread as orphaned when the thread exits
+ * @tparam RingPtr Shared pointer to the ring
+ */
+template<typename RingPtr>
+struct RingHolder
+{
+  RingPtr ring{};
+
+  ~RingHolder()
+  {
+    if( ring )
+    {
+      ring->orphaned.store( true, std::memory_order_release );
+    }
+  }
+};
+} // anonymous namespace
+
+AsyncSink& AsyncSink::instance()
+{
+  static AsyncSink* s_instance = []()
+  {
+    auto* sink = new AsyncSink();
+    std::atexit( &AsyncSink::shutdown );
+    return sink;
+  }();
+  return *s_instance;
+}
+
+AsyncSink::AsyncSink()
+  : m_output( &std::cout )
+  , m_layout( "[%T %<5t %r] %L (in %F:%l): %m" )
+{
+  m_running = true;
+  m_writer = std::thread( &AsyncSink::run, this );
+}
+
+AsyncSink::Ring& AsyncSink::threadRing()
+{
+  static thread_local RingHolder<std::shared_ptr<Ring>> holder;
+  if( !holder.ring )
+  {
+    holder.ring = std::make_shared<Ring>();
+    std::lock_guard<std::mutex> lock( m_registryMutex );
+    m_rings.emplace_back( holder.ring );
+  }
+  return *holder.ring;
+}
+
+void AsyncSink::push(Level level, const Logger& logger, const Location& location, const std::string& message)
+{
+  Ring& ring = threadRing();
+  const size_t head = ring.head.load( std::memory_order_relaxed );
+  if( head - ring.tail.load( std::memory_order_acquire ) >= Ring::Capacity )
+  {
+    ring.dropped.fetch_add( 1, std::memory_order_relaxed );
+  }
+  else
+  {
+    Record& record = ring.slots[head & Ring::Mask];
+    record.sequence = m_sequence.fetch_add( 1, std::memory_order_relaxed );
+    record.level = level;
+    record.logger = &logger;
+    record.location = location;
+    record.threadId = std::this_thread::get_id();
+    record.time = std::chrono::steady_clock::now();
+    record.message.assign( message );
+    ring.head.store( head + 1, std::memory_order_release );
+  }
+
+  if( level >= Level::Error || !m_running.load( std::memory_order_acquire ) )
+  {
+    flush();
+  }
+}
+
+void AsyncSink::drain()
+{
+  std::lock_guard<std::mutex> lock( m_registryMutex );
+  for( auto it = m_rings.begin(); it != m_rings.end(); )
+  {
+    Ring& ring = **it;
+    // read the orphaned flag first, so no record pushed before the thread exited is missed
+    const bool orphaned = ring.orphaned.load( std::memory_order_acquire );
+    const size_t head = ring.head.load( std::memory_order_acquire );
+    size_t tail = ring.tail.load( std::memory_order_relaxed );
+    for( ; tail != head; ++tail )
+    {
+      if( m_pendingCount == m_pending.size() )
+      {
+        m_pending.emplace_back();
+      }
+      Record& pending = m_pending[m_pendingCount++];
+      Record& record = ring.slots[tail & Ring::Mask];
+      pending.sequence = record.sequence;
+      pending.level = record.level;
+      pending.logger = record.logger;
+      pending.location = record.location;
+      pending.threadId = record.threadId;
+      pending.time = record.time;
+      // swap to keep the allocated capacities in use on both sides
+      pending.message.swap( record.message );
+    }
+    ring.tail.store( tail, std::memory_order_release );
+    m_dropped += ring.dropped.exchange( 0, std::memory_order_relaxed );
+
+    if( orphaned )
+    {
+      it = m_rings.erase( it );
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+void AsyncSink::flush()
+{
+  std::lock_guard<std::mutex> lock( m_writeMutex );
+  drain();
+  if( m_pendingCount == 0 && m_dropped == 0 )
+  {
+    return;
+  }
+
+  std::sort( m_pending.begin(), m_pending.begin() + m_pendingCount, [](const Record& a, const Record& b)
+  {
+    return a.sequence < b.sequence;
+  } );
+
+  for( size_t i = 0; i < m_pendingCount; i++ )
+  {
+    m_layout.write( *m_output, m_pending[i] );
+    *m_output << '\n';
+  }
+  m_pendingCount = 0;
+
+  if( m_dropped != 0 )
+  {
+    *m_output << "[light4cxx] " << m_dropped << " log messages dropped\n";
+    m_dropped = 0;
+  }
+  m_output->flush();
+}
+
+void AsyncSink::setOutput(std::ostream* stream)
+{
+  flush();
+  std::lock_guard<std::mutex> lock( m_writeMutex );
+  m_output = stream;
+}
+
+void AsyncSink::setLayout(const std::string& fmt)
+{
+  Layout layout( fmt );
+  flush();
+  std::lock_guard<std::mutex> lock( m_writeMutex );
+  m_layout = std::move( layout );
+}
+
+void AsyncSink::run()
+{
+  std::unique_lock<std::mutex> lock( m_wakeMutex );
+  while( !m_stop )
+  {
+    m_wakeCondition.wait_for( lock, WriterInterval );
+    lock.unlock();
+    flush();
+    lock.lock();
+  }
+}
+
+void AsyncSink::shutdown()
+{
+  AsyncSink& sink = instance();
+  // from now on, every record is written synchronously
+  sink.m_running = false;
+  {
+    std::lock_guard<std::mutex> lock( sink.m_wakeMutex );
+    sink.m_stop = true;
+  }
+  sink.m_wakeCondition.notify_one();
+  if( sink.m_writer.joinable() )
+  {
+    sink.m_writer.join();
+  }
+  sink.flush();
+}
+}
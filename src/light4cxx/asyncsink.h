@@ -0,0 +1,147 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIGHT4CXX_ASYNCSINK_H
+#define LIGHT4CXX_ASYNCSINK_H
+
+#include "layout.h"
+
+#include <stuff/utils.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace light4cxx
+{
+/**
+ * @ingroup light4cxx
+ * @{
+ */
+
+/**
+ * @class AsyncSink
+ * @brief Collects log records from all threads and writes them in the background
+ *
+ * @details
+ * Every logging thread gets its own lock-free single-producer/single-consumer
+ * ring of records, so logging never waits for the output stream. A writer thread
+ * drains all rings periodically, restores the global order of the records and
+ * writes them using the current Layout.
+ *
+ * If a ring is full, the record is dropped and counted instead of blocking the
+ * logging thread; the number of dropped records is reported in the output.
+ * Records with Level::Error or Level::Fatal flush all pending records
+ * synchronously, so they are visible before the process possibly terminates.
+ */
+class AsyncSink
+{
+public:
+  DISABLE_COPY( AsyncSink )
+
+  /**
+   * @brief Get the global instance
+   * @note The instance is never destroyed, it is shut down at process exit
+   */
+  static AsyncSink& instance();
+
+  /**
+   * @brief Queue a record
+   * @param[in] level Level of the message
+   * @param[in] logger The logger where the message comes from
+   * @param[in] location Location of the message
+   * @param[in] message The formatted message
+   */
+  void push(Level level, const Logger& logger, const Location& location, const std::string& message);
+
+  /**
+   * @brief Write all pending records from all threads
+   */
+  void flush();
+
+  void setOutput(std::ostream* stream);
+
+  void setLayout(const std::string& fmt);
+
+private:
+  AsyncSink();
+
+  /**
+   * @struct Ring
+   * @brief Per-thread record queue
+   */
+  struct Ring
+  {
+    static constexpr size_t Capacity = 1024;
+    static constexpr size_t Mask = Capacity - 1;
+
+    std::array<Record, Capacity> slots{};
+    //! @brief Next slot to write, owned by the logging thread
+    std::atomic<size_t> head{ 0 };
+    //! @brief Next slot to read, owned by the writer
+    std::atomic<size_t> tail{ 0 };
+    //! @brief Number of records that didn't fit into the ring
+    std::atomic<size_t> dropped{ 0 };
+    //! @brief Set when the owning thread has exited
+    std::atomic<bool> orphaned{ false };
+  };
+
+  Ring& threadRing();
+
+  //! @brief Move all records from the rings to m_pending, removing orphaned rings
+  void drain();
+
+  //! @brief Writer thread function
+  void run();
+
+  static void shutdown();
+
+  //! @brief Global record sequence counter
+  std::atomic<uint64_t> m_sequence{ 0 };
+
+  //! @brief Protects m_rings
+  std::mutex m_registryMutex{};
+  std::vector<std::shared_ptr<Ring>> m_rings{};
+
+  //! @brief Serializes writing, protects everything below
+  std::mutex m_writeMutex{};
+  std::ostream* m_output;
+  Layout m_layout;
+  //! @brief Drained records, re-used between flushes
+  std::vector<Record> m_pending{};
+  size_t m_pendingCount = 0;
+  size_t m_dropped = 0;
+
+  std::mutex m_wakeMutex{};
+  std::condition_variable m_wakeCondition{};
+  //! @brief Set while the writer thread is running
+  std::atomic<bool> m_running{ false };
+  bool m_stop = false;
+  std::thread m_writer{};
+};
+
+/**
+ * @}
+ */
+}
+
+#endif
@@ -0,0 +1,274 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "layout.h"
+
+#include "logger.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <cctype>
+#include <ostream>
+#include <stdexcept>
+
+namespace light4cxx
+{
+namespace
+{
+//! @brief The process start time
+const std::chrono::steady_clock::time_point s_bootTime = std::chrono::steady_clock::now();
+
+#ifndef L4CXX_NO_ANSI_COLORS
+#define COLOR_RESET  "\033[0m"
+#define COLOR_RED    "\033[1;31m"
+#define COLOR_GREEN  "\033[1;32m"
+#define COLOR_YELLOW "\033[1;33m"
+#define COLOR_CYAN   "\033[1;36m"
+#else
+#define COLOR_RESET
+#define COLOR_RED
+#define COLOR_GREEN
+#define COLOR_YELLOW
+#define COLOR_CYAN
+#endif
+
+/**
+ * @brief Converts a Level to a string
+ * @param[in] l The level to convert
+ * @return String representation of @a l
+ */
+const char* levelString(Level l)
+{
+  switch( l )
+  {
+  case Level::Off:
+    return "";
+  case Level::Trace:
+    return COLOR_CYAN "TRACE" COLOR_RESET;
+  case Level::Debug:
+    return COLOR_GREEN "DEBUG" COLOR_RESET;
+  case Level::Info:
+    return "INFO";
+  case Level::Warn:
+    return COLOR_YELLOW "WARN " COLOR_RESET;
+  case Level::Error:
+    return COLOR_RED "ERROR" COLOR_RESET;
+  case Level::Fatal:
+    return COLOR_RED "FATAL" COLOR_RESET;
+  case Level::All:
+    BOOST_THROW_EXCEPTION( std::runtime_error( "Logging level invalid: Level::All should not be passed to levelString()" ) );
+  default:
+    BOOST_THROW_EXCEPTION( std::runtime_error( "Logging level invalid: Unknown Level passed to levelString()" ) );
+  }
+}
+} // anonymous namespace
+
+Layout::Layout(const std::string& fmt)
+{
+  const Token defaultToken;
+  Token token;
+  int state = 0;
+  for( size_t i = 0; i < fmt.length(); i++ )
+  {
+    const char c = fmt[i];
+    switch( state )
+    {
+    case 0:
+      // scan for %
+      if( c == '%' )
+      {
+        state = 1;
+        break;
+      }
+      if( m_tokens.empty() || m_tokens.back().selector != 0 )
+      {
+        m_tokens.emplace_back();
+      }
+      m_tokens.back().literal += c;
+      break;
+    case 1:
+      // flags
+      switch( c )
+      {
+      case '#':
+        token.flags |= std::ios_base::showbase;
+        break;
+      case '+':
+        token.flags |= std::ios_base::showpos;
+        break;
+      case ',':
+        token.flags |= std::ios_base::showpoint;
+        break;
+      case '0':
+        token.fill = '0';
+        break;
+      case ' ':
+        token.fill = ' ';
+        break;
+      case '<':
+        token.flags = (token.flags & ~std::ios_base::adjustfield) | std::ios_base::left;
+        break;
+      case '|':
+        token.flags = (token.flags & ~std::ios_base::adjustfield) | std::ios_base::internal;
+        break;
+      case '>':
+        token.flags = (token.flags & ~std::ios_base::adjustfield) | std::ios_base::right;
+        break;
+      case '=':
+        token.flags = (token.flags & ~std::ios_base::floatfield) | std::ios_base::fixed;
+        break;
+      case '~':
+        token.flags = (token.flags & ~std::ios_base::floatfield) | std::ios_base::scientific;
+        break;
+      default:
+        state = 2;
+        i--;
+        break;
+      }
+      break;
+    case 2:
+      // field width
+      if( isdigit( c ) )
+      {
+        token.width = c - '0';
+      }
+      else
+      {
+        i--;
+      }
+      state = 3;
+      break;
+    case 3:
+      // precision dot
+      if( c == '.' )
+      {
+        state = 4;
+      }
+      else
+      {
+        // no precision
+        state = 5;
+        i--;
+      }
+      break;
+    case 4:
+      // precision value
+      if( isdigit( c ) )
+      {
+        token.precision = c - '0';
+      }
+      else
+      {
+        token.precision = 0;
+        i--;
+      }
+      state = 5;
+      break;
+    case 5:
+      // format specifier
+      switch( c )
+      {
+      case '%':
+        if( m_tokens.empty() || m_tokens.back().selector != 0 )
+        {
+          m_tokens.emplace_back();
+        }
+        m_tokens.back().literal += '%';
+        break;
+      case 'f':
+      case 'F':
+      case 'l':
+      case 'L':
+      case 'm':
+      case 'r':
+      case 't':
+      case 'T':
+        token.selector = c;
+        if( c == 'T' )
+        {
+          token.flags = (token.flags & ~std::ios_base::basefield) | std::ios_base::hex;
+        }
+        m_tokens.emplace_back( token );
+        break;
+      default:
+        BOOST_THROW_EXCEPTION( std::runtime_error( std::string( "Unknown format specifier at: " ) + fmt.substr( i ) ) );
+      }
+      state = 0;
+      token = defaultToken;
+      break;
+    default:
+      BOOST_THROW_EXCEPTION( std::runtime_error( "Invalid format parsing state" ) );
+    }
+  }
+}
+
+void Layout::write(std::ostream& os, const Record& record) const
+{
+  const std::ios_base::fmtflags oldFlags = os.flags();
+  const char oldFill = os.fill();
+  const std::streamsize oldPrecision = os.precision();
+
+  for( const Token& token : m_tokens )
+  {
+    if( token.selector == 0 )
+    {
+      os << token.literal;
+      continue;
+    }
+
+    os.flags( token.flags );
+    os.fill( token.fill );
+    os.width( token.width );
+    os.precision( token.precision );
+    switch( token.selector )
+    {
+    case 'f':
+      os << record.location.function();
+      break;
+    case 'F':
+      os << record.location.file();
+      break;
+    case 'l':
+      os << record.location.line();
+      break;
+    case 'L':
+      os << record.logger->name();
+      break;
+    case 'm':
+      os << record.message;
+      break;
+    case 'r':
+      os << std::chrono::duration_cast<std::chrono::milliseconds>( record.time - s_bootTime ).count() / 1000.0f;
+      break;
+    case 't':
+      os << levelString( record.level );
+      break;
+    case 'T':
+      os << record.threadId;
+      break;
+    default:
+      BOOST_THROW_EXCEPTION( std::runtime_error( "Invalid format token" ) );
+    }
+  }
+
+  os.flags( oldFlags );
+  os.fill( oldFill );
+  os.precision( oldPrecision );
+  os.width( 0 );
+}
+}
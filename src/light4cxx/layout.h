@@ -0,0 +1,104 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIGHT4CXX_LAYOUT_H
+#define LIGHT4CXX_LAYOUT_H
+
+#include "level.h"
+#include "location.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ios>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace light4cxx
+{
+/**
+ * @ingroup light4cxx
+ * @{
+ */
+
+class Logger;
+
+/**
+ * @struct Record
+ * @brief A pending log message
+ * @note Records are re-used, so @a message keeps its capacity
+ */
+struct Record
+{
+  //! @brief Global ordering of the records of all threads
+  uint64_t sequence = 0;
+  Level level = Level::Off;
+  const Logger* logger = nullptr;
+  Location location{ 0, "", "" };
+  std::thread::id threadId{};
+  std::chrono::steady_clock::time_point time{};
+  std::string message{};
+};
+
+/**
+ * @class Layout
+ * @brief Pre-compiled message format
+ * @see Location::setFormat()
+ */
+class Layout
+{
+public:
+  /**
+   * @brief Compile a format string
+   * @param[in] fmt The format string
+   * @throw std::runtime_error if @a fmt cannot be parsed
+   */
+  explicit Layout(const std::string& fmt);
+
+  /**
+   * @brief Write a formatted record
+   * @param[in] os Output stream, its formatting state is restored afterwards
+   * @param[in] record The record to write
+   */
+  void write(std::ostream& os, const Record& record) const;
+
+private:
+  /**
+   * @struct Token
+   * @brief Either a literal text or a data selector with its stream formatting
+   */
+  struct Token
+  {
+    //! @brief Data selector, or @c 0 for literal text
+    char selector = 0;
+    std::string literal{};
+    std::ios_base::fmtflags flags = std::ios_base::dec | std::ios_base::skipws;
+    char fill = ' ';
+    std::streamsize width = 0;
+    std::streamsize precision = 6;
+  };
+
+  std::vector<Token> m_tokens{};
+};
+
+/**
+ * @}
+ */
+}
+
+#endif
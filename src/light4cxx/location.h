@@ -21,8 +21,6 @@
 
 #include "level.h"
 
-#include <thread>
-#include <utility>
 #include <string>
 #include <boost/current_function.hpp>
 
@@ -33,31 +31,32 @@ namespace light4cxx
  * @{
  */
 
-class Logger;
-
 /**
  * @class Location
  * @brief A class containing location information
+ *
+ * @details
+ * Only pointers to the static strings generated by the compiler are stored,
+ * so creating a location is free and never allocates. The thread ID is taken
+ * when a message is actually logged.
  */
 class Location
 {
 private:
-  const int m_line; //!< @brief The line withing m_file
-  const std::string m_file; //!< @brief The file
-  const std::string m_function; //!< @brief The function within m_file
-  const std::thread::id m_threadId; //!< @brief The thread ID
+  int m_line; //!< @brief The line withing m_file
+  const char* m_file; //!< @brief The file
+  const char* m_function; //!< @brief The function within m_file
 public:
   Location() = delete;
 
   /**
    * @brief Inline constructor
    * @param[in] line Line of the location within @a file
-   * @param[in] file File name of the location
-   * @param[in] function Function name of the location
-   * @param[in] id Thread ID of the location
+   * @param[in] file File name of the location, must have static storage duration
+   * @param[in] function Function name of the location, must have static storage duration
    */
-  inline Location(int line, std::string file, std::string function, const std::thread::id& id)
-    : m_line( line ), m_file( std::move( file ) ), m_function( std::move( function ) ), m_threadId( id )
+  constexpr Location(int line, const char* file, const char* function) noexcept
+    : m_line( line ), m_file( file ), m_function( function )
   {
   }
 
@@ -65,7 +64,7 @@ public:
    * @brief Get m_line
    * @return m_line
    */
-  inline int line() const
+  constexpr int line() const noexcept
   {
     return m_line;
   }
@@ -74,7 +73,7 @@ public:
    * @brief Get m_function
    * @return m_function
    */
-  inline std::string function() const
+  constexpr const char* function() const noexcept
   {
     return m_function;
   }
@@ -83,35 +82,20 @@ public:
    * @brief Get m_file
    * @return m_file
    */
-  inline std::string file() const
+  constexpr const char* file() const noexcept
   {
     return m_file;
   }
 
   /**
-   * @brief Get m_threadId
-   * @return m_threadId
-   */
-  inline std::thread::id threadId() const
-  {
-    return m_threadId;
-  }
-
-  /**
-   * @brief Convert a logging message to a string
-   * @param[in] l The logging level of the message
-   * @param[in] logger The logger where the message comes from
-   * @param[in] msg The actual message
-   * @return The formatted string ready for output
-   * @see toString()
-   */
-  std::string toString(Level l, const Logger& logger, const std::string& msg) const;
-
-  /**
-   * @brief Sets the format of the output of toString()
+   * @brief Sets the format of the logged messages
    * @param[in] fmt The format string
+   * @throw std::runtime_error if @a fmt cannot be parsed
    *
    * @details
+   * The format string is compiled once when it is set, so formatting a message
+   * does not need to parse it again.
+   *
    * The format string is loosely based on printf. Its syntax is:
    * @code
    * %<flags><fieldwidth>[.<precision>]<dataSelector>
@@ -153,10 +137,7 @@ public:
    *       <li>@b l - The line number.</li>
    *       <li>@b L - The logger's name.</li>
    *       <li>@b m - The message.</li>
-   *       <li>@b p - Current process runtime in seconds (double precision).</li>
-   *       <li>@b P - Current process runtime in seconds (integer precision).</li>
-   *       <li>@b r - Current processor time in seconds (double precision).</li>
-   *       <li>@b R - Current processor time in seconds (integer precision).</li>
+   *       <li>@b r - Process runtime in seconds when the message was logged.</li>
    *       <li>@b t - The log level string (one of TRACE, DEBUG, INFO, WARN, ERROR, FATAL).</li>
    *       <li>@b T - The thread ID in hexadecimal, but without the "0x" prefix. Depending on the architecture, it may be either 8 or 16 chars wide.</li>
    *     </ul>
@@ -164,25 +145,21 @@ public:
    * </ul>
    * The default format string is
    * @code
-   * "[%T %<5t %p] %L (in %F:%l): %m"
+   * "[%T %<5t %r] %L (in %F:%l): %m"
    * @endcode
    * which will output something like
    * @code
    * [7fffa234 WARN  1.234] root (in dev/foo.cpp:123): A warning message
    * @endcode
-   *
-   * @note The format string is pretty strict, so make sure to check it twice,
-   * otherwise you will encounter a std::runtime_error telling you that toString()
-   * cannot parse the string.
    */
   static void setFormat(const std::string& fmt);
 };
 
 /**
  * @brief Creates a Location instance with the location set to the current
- * file, line, function and thread.
+ * file, line and function.
  */
-#define L4CXX_LOCATION ::light4cxx::Location(__LINE__, __FILE__, BOOST_CURRENT_FUNCTION, ::std::this_thread::get_id())
+#define L4CXX_LOCATION ::light4cxx::Location(__LINE__, __FILE__, BOOST_CURRENT_FUNCTION)
 
 /**
  * @}
@@ -18,7 +18,8 @@
 
 #include "logger.h"
 
-#include <iostream>
+#include "asyncsink.h"
+
 #include <unordered_map>
 #include <mutex>
 
@@ -29,8 +30,17 @@
 
 namespace light4cxx
 {
-Level Logger::s_level = Level::Debug;
-std::ostream* Logger::s_output = &std::cout;
+std::atomic<Level> Logger::s_level{ Level::Debug };
+
+void Logger::setOutput(std::ostream* stream)
+{
+  AsyncSink::instance().setOutput( stream );
+}
+
+void Logger::flush()
+{
+  AsyncSink::instance().flush();
+}
 
 Logger* Logger::root()
 {
@@ -62,13 +72,11 @@ Logger::Logger(const std::string& name)
 
 void Logger::log(light4cxx::Level l, const light4cxx::Location& loc, const std::string& str) const
 {
-  if( l < s_level || s_level == Level::Off )
+  if( !isEnabled( l ) )
   {
     return;
   }
-  static std::mutex outMutex;
-  std::lock_guard<std::mutex> outLock( outMutex );
-  *s_output << loc.toString( l, *this, str ) << std::endl;
+  AsyncSink::instance().push( l, *this, loc, str );
 }
 }
 
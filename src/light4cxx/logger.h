@@ -25,6 +25,8 @@
 #include <stuff/utils.h>
 #include <stuff/stringutils.h>
 
+#include <atomic>
+
 namespace light4cxx
 {
 /**
@@ -57,16 +59,24 @@ public:
    */
   static Logger* root();
 
-  static void setOutput(std::ostream* stream)
-  {
-    s_output = stream;
-  }
+  /**
+   * @brief Set the stream where the messages are written to
+   * @param[in] stream The output stream (defaults to stdout)
+   * @note All pending messages are written to the previous stream first
+   */
+  static void setOutput(std::ostream* stream);
+
+  /**
+   * @brief Write all pending messages
+   * @note Messages are written asynchronously, except for Level::Error and Level::Fatal
+   */
+  static void flush();
 
   /**
    * @brief Get the logger's name
    * @return m_name
    */
-  inline std::string name() const
+  inline const std::string& name() const
   {
     return m_name;
   }
@@ -84,102 +94,107 @@ public:
    * @brief Log a message with Level::Trace
    * @param[in] loc The location
    * @param[in] fmt The message format string
+   * @param[in] args The format arguments, only formatted if the level is enabled
    */
-  template<class ...Args>
-  void trace(Location&& loc, std::string&& fmt, Args&& ...args)
+  template<class Fmt, class ...Args>
+  void trace(const Location& loc, Fmt&& fmt, Args&& ...args) const
   {
-    if( Level::Trace < s_level || s_level == Level::Off )
+    if( !isEnabled( Level::Trace ) )
     {
       return;
     }
-    log( Level::Trace,
-         std::forward<Location>( loc ),
-         stringFmt( std::forward<std::string>( fmt ), std::forward<Args>( args )... ) );
+    log( Level::Trace, loc, stringFmt( std::string( std::forward<Fmt>( fmt ) ), std::forward<Args>( args )... ) );
   }
 
   /**
    * @brief Log a message with Level::Debug
    * @param[in] loc The location
-   * @param[in] str The message itself
+   * @param[in] fmt The message format string
+   * @param[in] args The format arguments, only formatted if the level is enabled
    */
-  template<class ...Args>
-  void debug(Location&& loc, std::string&& fmt, Args&& ...args)
+  template<class Fmt, class ...Args>
+  void debug(const Location& loc, Fmt&& fmt, Args&& ...args) const
   {
-    if( Level::Debug < s_level || s_level == Level::Off )
+    if( !isEnabled( Level::Debug ) )
     {
       return;
     }
-    log( Level::Debug,
-         std::forward<Location>( loc ),
-         stringFmt( std::forward<std::string>( fmt ), std::forward<Args>( args )... ) );
+    log( Level::Debug, loc, stringFmt( std::string( std::forward<Fmt>( fmt ) ), std::forward<Args>( args )... ) );
   }
 
   /**
    * @brief Log a message with Level::Info
    * @param[in] loc The location
-   * @param[in] str The message itself
+   * @param[in] fmt The message format string
+   * @param[in] args The format arguments, only formatted if the level is enabled
    */
-  template<class ...Args>
-  void info(Location&& loc, std::string&& fmt, Args&& ...args)
+  template<class Fmt, class ...Args>
+  void info(const Location& loc, Fmt&& fmt, Args&& ...args) const
   {
-    if( Level::Info < s_level || s_level == Level::Off )
+    if( !isEnabled( Level::Info ) )
     {
       return;
     }
-    log( Level::Info,
-         std::forward<Location>( loc ),
-         stringFmt( std::forward<std::string>( fmt ), std::forward<Args>( args )... ) );
+    log( Level::Info, loc, stringFmt( std::string( std::forward<Fmt>( fmt ) ), std::forward<Args>( args )... ) );
   }
 
   /**
    * @brief Log a message with Level::Warn
    * @param[in] loc The location
-   * @param[in] str The message itself
+   * @param[in] fmt The message format string
+   * @param[in] args The format arguments, only formatted if the level is enabled
    */
-  template<class ...Args>
-  void warn(Location&& loc, std::string&& fmt, Args&& ...args)
+  template<class Fmt, class ...Args>
+  void warn(const Location& loc, Fmt&& fmt, Args&& ...args) const
   {
-    if( Level::Warn < s_level || s_level == Level::Off )
+    if( !isEnabled( Level::Warn ) )
     {
       return;
     }
-    log( Level::Warn,
-         std::forward<Location>( loc ),
-         stringFmt( std::forward<std::string>( fmt ), std::forward<Args>( args )... ) );
+    log( Level::Warn, loc, stringFmt( std::string( std::forward<Fmt>( fmt ) ), std::forward<Args>( args )... ) );
   }
 
   /**
    * @brief Log a message with Level::Error
    * @param[in] loc The location
-   * @param[in] str The message itself
+   * @param[in] fmt The message format string
+   * @param[in] args The format arguments, only formatted if the level is enabled
    */
-  template<class ...Args>
-  void error(Location&& loc, std::string&& fmt, Args&& ...args)
+  template<class Fmt, class ...Args>
+  void error(const Location& loc, Fmt&& fmt, Args&& ...args) const
   {
-    if( Level::Error < s_level || s_level == Level::Off )
+    if( !isEnabled( Level::Error ) )
     {
       return;
     }
-    log( Level::Error,
-         std::forward<Location>( loc ),
-         stringFmt( std::forward<std::string>( fmt ), std::forward<Args>( args )... ) );
+    log( Level::Error, loc, stringFmt( std::string( std::forward<Fmt>( fmt ) ), std::forward<Args>( args )... ) );
   }
 
   /**
    * @brief Log a message with Level::Fatal
    * @param[in] loc The location
-   * @param[in] str The message itself
+   * @param[in] fmt The message format string
+   * @param[in] args The format arguments, only formatted if the level is enabled
    */
-  template<class ...Args>
-  void fatal(Location&& loc, std::string&& fmt, Args&& ...args)
+  template<class Fmt, class ...Args>
+  void fatal(const Location& loc, Fmt&& fmt, Args&& ...args) const
   {
-    if( Level::Fatal < s_level || s_level == Level::Off )
+    if( !isEnabled( Level::Fatal ) )
     {
       return;
     }
-    log( Level::Fatal,
-         std::forward<Location>( loc ),
-         stringFmt( std::forward<std::string>( fmt ), std::forward<Args>( args )... ) );
+    log( Level::Fatal, loc, stringFmt( std::string( std::forward<Fmt>( fmt ) ), std::forward<Args>( args )... ) );
+  }
+
+  /**
+   * @brief Check if messages with a given level are logged
+   * @param[in] l The level to check, except Level::Off or Level::All
+   * @return @c true if messages with level @a l pass the level filter
+   */
+  static inline bool isEnabled(Level l) noexcept
+  {
+    const Level current = s_level.load( std::memory_order_relaxed );
+    return l >= current && current != Level::Off;
   }
 
   /**
@@ -188,7 +203,7 @@ public:
    */
   static Level level()
   {
-    return s_level;
+    return s_level.load( std::memory_order_relaxed );
   }
 
   /**
@@ -197,7 +212,7 @@ public:
    */
   static void setLevel(Level l)
   {
-    s_level = l;
+    s_level.store( l, std::memory_order_relaxed );
   }
 
 private:
@@ -213,9 +228,7 @@ private:
   std::string m_name;
 
   //! @brief The current logging level filter
-  static Level s_level;
-  //! @brief Output stream (defaults to stdout)
-  static std::ostream* s_output;
+  static std::atomic<Level> s_level;
 };
 
 /**
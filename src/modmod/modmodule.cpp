@@ -8,7 +8,9 @@
 #include "stream/stream.h"
 #include <genmod/channelstate.h>
 #include <genmod/orderentry.h>
+#include <stuff/profiler.h>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/exception/all.hpp>
 
 #include <array>
@@ -156,6 +158,150 @@ const IdMetaInfo smp15MetaInfo = {
 };
 } // anonymous namespace
 
+namespace
+{
+/**
+ * @brief Check a stream the way ModModule::load() does in one of the loading modes
+ * @param[in] stream The stream
+ * @param[in] loadMode One of LoadingMode
+ * @return Meta information, or nullptr if load() rejects the stream in this mode
+ *
+ * @details
+ * Only the header and the sample headers are read; the pattern count is taken
+ * from the order list, and of the sample data only the ADPCM tags are read to
+ * check the file size. As the pattern cells are not checked, load() may still
+ * reject a module with invalid sample numbers in its patterns.
+ */
+std::unique_ptr<AbstractModule::ProbeInfo> probeMode(Stream* stream, int loadMode)
+{
+  stream->clear();
+  stream->seek( 0 );
+  char modName[20];
+  stream->read( modName, 20 );
+  const IdMetaInfo* meta = &smp15MetaInfo;
+  if( loadMode != LoadingMode::Smp15 )
+  {
+    stream->seek( 0x438 );
+    meta = findMeta( stream );
+    if( meta == nullptr )
+    {
+      return nullptr;
+    }
+  }
+
+  auto result = std::make_unique<AbstractModule::ProbeInfo>();
+  result->filename = stream->name();
+  result->format = "mod";
+  result->title = stringncpy( modName, 20 );
+  result->trackerInfo = meta->tracker;
+  result->channels = meta->channels;
+  result->samples = loadMode == LoadingMode::Smp15 ? 15 : 31;
+
+  stream->seek( 20 );
+  std::vector<size_t> sampleLengths;
+  for( size_t i = 0; i < result->samples; i++ )
+  {
+    // name, big-endian length in words, finetune, volume, loop start and loop length
+    char name[22];
+    stream->read( name, 22 );
+    uint8_t length[2];
+    stream->read( length, 2 );
+    stream->seekrel( 6 );
+    result->sampleNames.emplace_back( stringncpy( name, 22 ) );
+    const size_t words = (length[0] << 8) | length[1];
+    sampleLengths.emplace_back( words > 1 ? words * 2 : 0 );
+  }
+
+  uint8_t songLen;
+  *stream >> songLen;
+  songLen = std::min<uint8_t>( songLen, 128 );
+  stream->seekrel( 1 ); // skip the restart pos
+  uint8_t orders[128];
+  stream->read( orders, 128 );
+  if( !stream->good() )
+  {
+    return nullptr;
+  }
+  // see LoadingMode for the two ways to determine the pattern count
+  uint8_t maxPatNum = 0;
+  for( int i = 0; i < 128; i++ )
+  {
+    if( orders[i] >= 64 )
+    {
+      continue;
+    }
+    if( i < songLen )
+    {
+      result->orders++;
+    }
+    if( i < songLen || loadMode != LoadingMode::Smp31Malformed )
+    {
+      maxPatNum = std::max( maxPatNum, orders[i] );
+    }
+  }
+  result->patterns = maxPatNum + 1u;
+  if( loadMode != LoadingMode::Smp15 )
+  {
+    stream->seekrel( 4 ); // skip the ID
+  }
+
+  // the pattern bodies are skipped, their size follows from the pattern count
+  const std::streamsize patternBytes = result->patterns * 64 * 4 * meta->channels;
+  if( stream->size() - stream->pos() < patternBytes )
+  {
+    return nullptr;
+  }
+  stream->seekrel( patternBytes );
+
+  for( size_t length: sampleLengths )
+  {
+    if( length == 0 )
+    {
+      continue;
+    }
+    char tag[5];
+    stream->read( tag, 5 );
+    if( !stream->good() )
+    {
+      return nullptr;
+    }
+    size_t bytes = length;
+    if( boost::algorithm::iequals( std::string( tag, 5 ), "ADPCM" ) )
+    {
+      // compression table and packed nibbles
+      bytes = 16 + (length + 1) / 2;
+    }
+    else
+    {
+      stream->seekrel( -5 );
+    }
+    if( stream->size() - stream->pos() < static_cast<std::streamsize>(bytes) )
+    {
+      return nullptr;
+    }
+    stream->seekrel( bytes );
+  }
+  if( stream->size() - stream->pos() >= 0x100 )
+  {
+    return nullptr;
+  }
+  return result;
+}
+} // anonymous namespace
+
+std::unique_ptr<AbstractModule::ProbeInfo> ModModule::probe(Stream* stream)
+{
+  // the same modes as factory(), in the same order
+  for( int i = 0; i < LoadingMode::Count; i++ )
+  {
+    if( auto result = probeMode( stream, i ) )
+    {
+      return result;
+    }
+  }
+  return nullptr;
+}
+
 bool ModModule::load(Stream* stream, int loadMode)
 {
   noConstMetaInfo().filename = stream->name();
@@ -306,13 +452,21 @@ size_t ModModule::internal_buildTick(const AudioFrameBufferPtr& buffer)
     if( buffer )
     {
       MixerFrameBufferPtr mixerBuffer = std::make_shared<MixerFrameBuffer>( tickBufferLength() );
+      profile::count( profile::Counter::AnnotatedAllocations );
       for( int currTrack = 0; currTrack < channelCount(); currTrack++ )
       {
         const auto& chan = m_channels[currTrack];
         const ModCell& cell = currPat->at( currTrack, state().row );
-        chan->update( cell, false ); // m_patDelayCount != -1);
-        chan->mixTick( mixerBuffer );
+        {
+          profile::ScopedTimer timer( profile::Stage::Update );
+          chan->update( cell, false ); // m_patDelayCount != -1);
+        }
+        {
+          profile::ScopedTimer timer( profile::Stage::Mix );
+          chan->mixTick( mixerBuffer );
+        }
       }
+      profile::ScopedTimer timer( profile::Stage::PostProcess );
       buffer->resize( mixerBuffer->size() );
       MixerSampleFrame* mixerBufferPtr = &mixerBuffer->front();
       BasicSampleFrame* bufPtr = &buffer->front();
@@ -58,6 +58,13 @@ public:
                                                  int maxRpt,
                                                  Sample::Interpolation inter);
 
+  /**
+   * @brief Read the module's meta information without loading it
+   * @param[in] stream Module stream
+   * @return Meta information or nullptr if the stream does not contain a MOD module
+   */
+  static std::unique_ptr<ProbeInfo> probe(Stream* stream);
+
 private:
   std::vector<std::unique_ptr<ModSample>> m_samples; //!< @brief Samples
   std::vector<std::unique_ptr<ModPattern>> m_patterns; //!< @brief Patterns
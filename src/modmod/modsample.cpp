@@ -17,6 +17,7 @@
 */
 
 #include "modsample.h"
+#include "genmod/sampledecoder.h"
 
 #include "stream/stream.h"
 
@@ -119,12 +120,7 @@ bool ModSample::loadData(Stream* stream)
                     stream->size() - stream->pos() );
     return false;
   }
-  for( auto it = beginIterator(); it != endIterator(); ++it )
-  {
-    int8_t tmp;
-    *stream >> tmp;
-    it->left = it->right = tmp << 8;
-  }
+  sampledecoder::decode( *stream, sampledecoder::Format::Signed8, data(), length() );
   return stream->good();
 }
 
@@ -133,18 +129,16 @@ bool ModSample::loadAdpcmData(Stream* stream)
   int8_t compressionTable[16];
   stream->read( compressionTable, 16 );
   // signed char GetDeltaValue(signed char prev, UINT n) const { return (signed char)(prev + CompressionTable[n & 0x0F]); }
+  const auto packed = stream->readVector<uint8_t>( (length() + 1) / 2 );
+  std::vector<int16_t> pcm( length() );
   int8_t delta = 0;
-  for( auto it = beginIterator(); it < endIterator(); )
+  for( size_t i = 0; i < length(); i++ )
   {
-    uint8_t tmpByte;
-    *stream >> tmpByte;
-    delta += compressionTable[tmpByte & 0x0f];
-    it->left = it->right = delta << 8;
-    ++it;
-    delta += compressionTable[tmpByte >> 4];
-    it->left = it->right = delta << 8;
-    ++it;
+    const uint8_t nibble = (i & 1) == 0 ? packed[i / 2] & 0x0f : packed[i / 2] >> 4;
+    delta += compressionTable[nibble];
+    pcm[i] = delta * 256;
   }
+  sampledecoder::store( pcm.data(), data(), pcm.size(), sampledecoder::Target::Both );
   return stream->good();
 }
 
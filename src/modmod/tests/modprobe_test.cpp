@@ -0,0 +1,210 @@
+#define BOOST_TEST_MODULE ModProbe
+
+#include <boost/test/unit_test.hpp>
+
+#include "../modmodule.h"
+#include "stream/memorystream.h"
+
+#include <string>
+#include <vector>
+
+using ppp::mod::ModModule;
+
+namespace
+{
+struct ModSpec
+{
+  //! @brief 31 samples and the "M.K." ID, or 15 samples without an ID
+  bool signature = true;
+  //! @brief Sample lengths in words, missing ones are empty
+  std::vector<uint16_t> sampleWords{ 64, 0, 300 };
+  //! @brief Samples stored ADPCM compressed
+  std::vector<bool> adpcm{};
+  uint8_t songLength = 2;
+  std::vector<uint8_t> orders{ 0, 1 };
+  size_t storedPatterns = 2;
+  //! @brief Put a cell with an invalid sample number into the first pattern
+  bool badCell = false;
+  //! @brief Bytes missing at the end of the sample data
+  size_t truncate = 0;
+  //! @brief Bytes appended after the sample data
+  size_t trailing = 0;
+};
+
+std::vector<uint8_t> buildMod(const ModSpec& spec)
+{
+  std::vector<uint8_t> data;
+  const auto appendString = [&data](const std::string& str, size_t length) {
+    for( size_t i = 0; i < length; i++ )
+    {
+      data.emplace_back( i < str.size() ? str[i] : 0 );
+    }
+  };
+
+  appendString( "probe test", 20 );
+  const size_t numSamples = spec.signature ? 31 : 15;
+  for( size_t i = 0; i < numSamples; i++ )
+  {
+    appendString( "sample " + std::to_string( i ), 22 );
+    const uint16_t words = i < spec.sampleWords.size() ? spec.sampleWords[i] : 0;
+    data.emplace_back( words >> 8 );
+    data.emplace_back( words & 0xff );
+    // finetune, volume, loop start, loop length
+    const uint8_t rest[] = { 0, 64, 0, 0, 0, 1 };
+    data.insert( data.end(), std::begin( rest ), std::end( rest ) );
+  }
+  data.emplace_back( spec.songLength );
+  data.emplace_back( 0x7f );
+  for( size_t i = 0; i < 128; i++ )
+  {
+    data.emplace_back( i < spec.orders.size() ? spec.orders[i] : 0 );
+  }
+  if( spec.signature )
+  {
+    appendString( "M.K.", 4 );
+  }
+
+  for( size_t pat = 0; pat < spec.storedPatterns; pat++ )
+  {
+    std::vector<uint8_t> pattern( 64 * 4 * 4, 0 );
+    // sample 1, period 428 in the first cell of each pattern
+    pattern[0] = (spec.badCell && pat == 0) ? 0x41 : 0x01;
+    pattern[1] = 0xac;
+    pattern[2] = 0x10;
+    data.insert( data.end(), pattern.begin(), pattern.end() );
+  }
+
+  for( size_t i = 0; i < spec.sampleWords.size(); i++ )
+  {
+    const size_t length = spec.sampleWords[i] > 1 ? spec.sampleWords[i] * 2u : 0;
+    if( length == 0 )
+    {
+      continue;
+    }
+    size_t bytes = length;
+    if( i < spec.adpcm.size() && spec.adpcm[i] )
+    {
+      appendString( "ADPCM", 5 );
+      bytes = 16 + (length + 1) / 2;
+    }
+    for( size_t j = 0; j < bytes; j++ )
+    {
+      data.emplace_back( static_cast<uint8_t>(j * 7) );
+    }
+  }
+  data.resize( data.size() - spec.truncate + spec.trailing, 0 );
+  return data;
+}
+
+std::unique_ptr<MemoryStream> makeStream(const std::vector<uint8_t>& raw)
+{
+  auto stream = std::make_unique<MemoryStream>( "test.mod" );
+  stream->write( raw.data(), raw.size() );
+  stream->seek( 0 );
+  return stream;
+}
+
+/**
+ * @brief Probe and load the data, and check that both come to the same result
+ * @return The probe result
+ */
+std::unique_ptr<ppp::AbstractModule::ProbeInfo> probeAndLoad(const std::vector<uint8_t>& data, bool expectAccepted)
+{
+  auto info = ModModule::probe( makeStream( data ).get() );
+  const auto module = ModModule::factory( makeStream( data ).get(), 44100, 1, ppp::Sample::Interpolation::None );
+  BOOST_CHECK_EQUAL( info != nullptr, module != nullptr );
+  BOOST_CHECK_EQUAL( info != nullptr, expectAccepted );
+  return info;
+}
+}
+
+BOOST_AUTO_TEST_CASE( Signature31 )
+{
+  const auto info = probeAndLoad( buildMod( ModSpec() ), true );
+  BOOST_REQUIRE( info );
+  BOOST_CHECK_EQUAL( info->title, "probe test" );
+  BOOST_CHECK_EQUAL( info->trackerInfo, "ProTracker" );
+  BOOST_CHECK_EQUAL( info->channels, 4 );
+  BOOST_CHECK_EQUAL( info->samples, 31u );
+  BOOST_CHECK_EQUAL( info->sampleNames.size(), 31u );
+  BOOST_CHECK_EQUAL( info->sampleNames[2], "sample 2" );
+  BOOST_CHECK_EQUAL( info->orders, 2u );
+  BOOST_CHECK_EQUAL( info->patterns, 2u );
+}
+
+BOOST_AUTO_TEST_CASE( Signature31Truncated )
+{
+  ModSpec spec;
+  spec.truncate = 10;
+  probeAndLoad( buildMod( spec ), false );
+}
+
+BOOST_AUTO_TEST_CASE( Signature31TrailingData )
+{
+  ModSpec spec;
+  spec.trailing = 0xff;
+  probeAndLoad( buildMod( spec ), true );
+  spec.trailing = 0x100;
+  probeAndLoad( buildMod( spec ), false );
+}
+
+BOOST_AUTO_TEST_CASE( MalformedOrderList )
+{
+  // an order after the song length refers to a pattern that is not stored
+  ModSpec spec;
+  spec.orders = { 0, 1, 5 };
+  const auto info = probeAndLoad( buildMod( spec ), true );
+  BOOST_REQUIRE( info );
+  BOOST_CHECK_EQUAL( info->patterns, 2u );
+}
+
+BOOST_AUTO_TEST_CASE( Samples15 )
+{
+  ModSpec spec;
+  spec.signature = false;
+  const auto info = probeAndLoad( buildMod( spec ), true );
+  BOOST_REQUIRE( info );
+  BOOST_CHECK_EQUAL( info->samples, 15u );
+  BOOST_CHECK_EQUAL( info->patterns, 2u );
+}
+
+BOOST_AUTO_TEST_CASE( Samples15Adpcm )
+{
+  ModSpec spec;
+  spec.signature = false;
+  spec.adpcm = { false, false, true };
+  probeAndLoad( buildMod( spec ), true );
+}
+
+BOOST_AUTO_TEST_CASE( Samples15BadCell )
+{
+  // the probe does not read the pattern cells, only the loader rejects them
+  ModSpec spec;
+  spec.signature = false;
+  spec.badCell = true;
+  const auto data = buildMod( spec );
+  BOOST_CHECK( ModModule::probe( makeStream( data ).get() ) );
+  BOOST_CHECK( !ModModule::factory( makeStream( data ).get(), 44100, 1, ppp::Sample::Interpolation::None ) );
+}
+
+BOOST_AUTO_TEST_CASE( Samples15MissingPattern )
+{
+  ModSpec spec;
+  spec.signature = false;
+  spec.storedPatterns = 1;
+  probeAndLoad( buildMod( spec ), false );
+}
+
+BOOST_AUTO_TEST_CASE( Samples15Truncated )
+{
+  ModSpec spec;
+  spec.signature = false;
+  spec.truncate = 1;
+  probeAndLoad( buildMod( spec ), false );
+}
+
+BOOST_AUTO_TEST_CASE( Garbage )
+{
+  probeAndLoad( std::vector<uint8_t>(), false );
+  probeAndLoad( std::vector<uint8_t>( 2000, 0xff ), false );
+}
@@ -93,12 +93,28 @@ size_t AbstractAudioSource::preferredBufferSize() const
   return internal_preferredBufferSize();
 }
 
-size_t AbstractAudioSource::getAudioData(AudioFrameBufferPtr& buffer, size_t requestedFrames)
+size_t AbstractAudioSource::getAudioData(BasicSampleFrame* buffer, size_t requestedFrames)
 {
   std::lock_guard<std::recursive_mutex> lock( m_mutex );
   return internal_getAudioData( buffer, requestedFrames );
 }
 
+size_t AbstractAudioSource::getAudioData(AudioFrameBufferPtr& buffer, size_t requestedFrames)
+{
+  if( requestedFrames == 0 )
+  {
+    requestedFrames = preferredBufferSize();
+  }
+  if( !buffer )
+  {
+    buffer = std::make_shared<AudioFrameBuffer>();
+  }
+  buffer->resize( requestedFrames );
+  const size_t count = getAudioData( buffer->data(), requestedFrames );
+  buffer->resize( count );
+  return count;
+}
+
 light4cxx::Logger* AbstractAudioSource::logger()
 {
   return light4cxx::Logger::get( "audio.source" );
@@ -23,6 +23,7 @@
 
 #include <light4cxx/logger.h>
 
+#include <atomic>
 #include <mutex>
 
 /**
@@ -42,7 +43,8 @@ private:
   bool m_initialized;
   //! @brief Frequency of this source
   uint32_t m_frequency;
-  bool m_paused;
+  //! @brief Polled by the audio threads, so it must not require locking
+  std::atomic<bool> m_paused;
   mutable std::recursive_mutex m_mutex;
 protected:
   /**
@@ -53,14 +55,14 @@ protected:
 private:
   /**
    * @brief Get audio data from the source
-   * @param[out] buffer The buffer containing the retrieved data
+   * @param[out] buffer Destination of @a requestedFrames frames, owned by the caller
    * @param[in] requestedFrames Number of requested frames
-   * @returns The number of frames actually returned - should be equal to @c buffer->size()
+   * @returns The number of frames actually written, which is less than @a requestedFrames
+   *          only when the source ends
    * @note If this function returns 0, the audio output device should stop playback
    * @see preferredBufferSize()
-   * @see isBusy()
    */
-  virtual size_t internal_getAudioData(AudioFrameBufferPtr& buffer, size_t requestedFrames) = 0;
+  virtual size_t internal_getAudioData(BasicSampleFrame* buffer, size_t requestedFrames) = 0;
   /**
    * @brief Get the preferred buffer size to prevent unnecessary calls to getAudioData()
    * @retval 0 if no size is specified
@@ -104,6 +106,13 @@ public:
   inline bool paused() const noexcept;
   inline void setPaused(bool p = true) noexcept;
   //! @copydoc internal_getAudioData
+  size_t getAudioData(BasicSampleFrame* buffer, size_t requestedFrames);
+  /**
+   * @brief Get audio data from the source into a frame buffer
+   * @param[in,out] buffer The buffer, created if it is @c nullptr and resized to the returned frames
+   * @param[in] requestedFrames Number of requested frames, preferredBufferSize() if 0
+   * @returns The number of frames actually returned, equal to @c buffer->size()
+   */
   size_t getAudioData(AudioFrameBufferPtr& buffer, size_t requestedFrames);
   //! @copydoc internal_preferredBufferSize
   size_t preferredBufferSize() const;
@@ -123,14 +132,12 @@ protected:
 
 bool AbstractAudioSource::paused() const noexcept
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
-  return m_paused;
+  return m_paused.load( std::memory_order_acquire );
 }
 
 void AbstractAudioSource::setPaused(bool p) noexcept
 {
-  std::lock_guard<std::recursive_mutex> lock( m_mutex );
-  m_paused = p;
+  m_paused.store( p, std::memory_order_release );
 }
 
 /**
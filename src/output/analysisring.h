@@ -0,0 +1,130 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_ANALYSISRING_H
+#define PPPLAY_ANALYSISRING_H
+
+#include "audiotypes.h"
+
+#include <stuff/utils.h>
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @ingroup Output
+ * @{
+ */
+
+/**
+ * @class AnalysisRing
+ * @brief Lock-free ring of the most recently played frames
+ *
+ * @details
+ * The audio callback appends every frame it plays with write(), which only
+ * copies and never waits. Analysis code on another thread fetches the latest
+ * frames with readLatest() at its own pace; a read that overlaps with the
+ * writer overwriting the same frames is detected and retried.
+ */
+class AnalysisRing
+{
+public:
+  DISABLE_COPY( AnalysisRing )
+
+  //! @brief Number of frames kept, a power of 2
+  static constexpr size_t Capacity = 8192;
+
+  AnalysisRing() = default;
+
+  /**
+   * @brief Append frames, overwriting the oldest ones
+   * @note Single writer only
+   */
+  void write(const BasicSampleFrame* frames, size_t count) noexcept
+  {
+    // only the last frames of an oversized write survive anyway
+    const size_t skipped = count > Capacity ? count - Capacity : 0;
+    frames += skipped;
+    count -= skipped;
+    const size_t begin = m_written.load( std::memory_order_relaxed ) + skipped;
+    // announce the frames about to be overwritten before touching them
+    m_writing.store( begin + count, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    const size_t offset = begin % Capacity;
+    const size_t first = std::min( count, Capacity - offset );
+    std::copy_n( frames, first, m_frames.begin() + offset );
+    std::copy_n( frames + first, count - first, m_frames.begin() );
+    m_written.store( begin + count, std::memory_order_release );
+  }
+
+  /**
+   * @brief Get the total number of frames written so far
+   */
+  size_t written() const noexcept
+  {
+    return m_written.load( std::memory_order_acquire );
+  }
+
+  /**
+   * @brief Copy the latest frames
+   * @param[out] dest Destination of @a count frames, oldest first
+   * @param[in] count Number of frames, at most Capacity/2
+   * @retval false if less than @a count frames were written, or the writer kept
+   *         overwriting them
+   */
+  bool readLatest(BasicSampleFrame* dest, size_t count) const noexcept
+  {
+    BOOST_ASSERT( count <= Capacity / 2 );
+    for( int attempt = 0; attempt < 4; ++attempt )
+    {
+      const size_t end = m_written.load( std::memory_order_acquire );
+      if( end < count )
+      {
+        return false;
+      }
+      const size_t begin = end - count;
+      const size_t offset = begin % Capacity;
+      const size_t first = std::min( count, Capacity - offset );
+      std::copy_n( m_frames.begin() + offset, first, dest );
+      std::copy_n( m_frames.begin(), count - first, dest + first );
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if( m_writing.load( std::memory_order_relaxed ) <= begin + Capacity )
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  std::array<BasicSampleFrame, Capacity> m_frames{};
+  //! @brief Number of frames written
+  std::atomic<size_t> m_written{ 0 };
+  //! @brief Number of frames written after the write in progress has finished
+  std::atomic<size_t> m_writing{ 0 };
+};
+
+/**
+ * @}
+ */
+
+#endif
@@ -23,13 +23,24 @@
 
 #include "audiofifo.h"
 
+#include "stuff/profiler.h"
+
 #include <boost/assert.hpp>
 
+#include <algorithm>
 #include <cmath>
 
+namespace
+{
+//! @brief Seconds without an underrun before the low-latency threshold is lowered
+constexpr size_t DecaySeconds = 10;
+//! @brief Upper bound of the low-latency threshold in multiples of its lower bound
+constexpr size_t MaxThresholdFactor = 4;
+}
+
 void AudioFifo::requestThread()
 {
-  AudioFrameBufferPtr buffer;
+  AudioFrameBufferPtr buffer = std::make_shared<AudioFrameBuffer>();
   while( AbstractAudioSource::Ptr src = m_source.lock() )
   {
     if( m_stopping )
@@ -47,7 +58,8 @@ void AudioFifo::requestThread()
       continue;
     }
 
-    size_t size = src->preferredBufferSize();
+    const size_t tick = src->preferredBufferSize();
+    size_t size = m_period != 0 ? m_period : tick;
     if( size == 0 )
     {
       size = m_buffer.capacity() - m_buffer.size();
@@ -56,15 +68,30 @@ void AudioFifo::requestThread()
     {
       continue;
     }
+    if( m_period != 0 && tick > m_longestTick )
+    {
+      // a chunk may require rendering a whole tick, so keep enough queued to cover it
+      m_longestTick = tick;
+      m_minThreshold = m_period + tick;
+      m_maxThreshold = MaxThresholdFactor * m_minThreshold;
+      m_threshold = std::max( m_threshold, m_minThreshold );
+      logger()->debug( L4CXX_LOCATION, "Longest tick is %d frames, raising minimum threshold to %d", tick, m_minThreshold );
+    }
+    const uint64_t generation = m_generation;
+    // do not block the device while rendering
+    bufferLock.unlock();
+
+    const auto start = std::chrono::steady_clock::now();
     size_t n = src->getAudioData( buffer, size );
+    m_renderMicros += std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start ).count();
+    m_renderedFrames += n;
     if( !src->paused() && (n == 0 || !buffer || buffer->empty()) )
     {
       logger()->debug( L4CXX_LOCATION, "Audio source dry" );
       continue;
     }
     // add the data to the queue...
-    bufferLock.unlock();
-    pushData( buffer );
+    pushData( buffer, generation );
     m_bufferChanged.notify_one();
   }
 }
@@ -72,7 +99,8 @@ void AudioFifo::requestThread()
 AudioFifo::AudioFifo(const AbstractAudioSource::WeakPtr& source, size_t threshold)
   :
   m_buffer(), m_threshold( threshold ), m_requestThread(), m_source( source ), m_stopping( false ), m_bufferMutex()
-  , m_bufferChanged(), dataPushed(), dataPulled()
+  , m_bufferChanged(), m_period( 0 ), m_minThreshold( threshold ), m_maxThreshold( threshold ), m_decayFrames( 0 )
+  , m_pulledSinceUnderrun( 0 ), m_longestTick( 0 ), m_underruns( 0 ), m_generation( 0 ), m_renderMicros( 0 ), m_renderedFrames( 0 )
 {
   BOOST_ASSERT_MSG( !source.expired(), "Invalid source passed to AudioFifo constructor" );
   BOOST_ASSERT_MSG( threshold >= 256, "Minimum capacity may not be less than 256" );
@@ -94,13 +122,19 @@ AudioFifo::~AudioFifo()
   logger()->trace( L4CXX_LOCATION, "Destroyed" );
 }
 
-void AudioFifo::pushData(const AudioFrameBufferPtr& buf)
+void AudioFifo::pushData(const AudioFrameBufferPtr& buf, uint64_t generation)
 {
   if( !buf )
   {
     return;
   }
+  ppp::profile::ScopedTimer timer( ppp::profile::Stage::FifoPush );
   std::unique_lock<std::mutex> lock( m_bufferMutex );
+  if( generation != m_generation )
+  {
+    logger()->trace( L4CXX_LOCATION, "Dropping %d frames rendered before the queue was cleared", buf->size() );
+    return;
+  }
   if( buf->size() > m_buffer.capacity() - m_buffer.size() )
   {
     // resize to next bigger exponent of 2
@@ -114,39 +148,43 @@ void AudioFifo::pushData(const AudioFrameBufferPtr& buf)
   }
   logger()->trace( L4CXX_LOCATION, "Pushing %d frames into buffer", buf->size() );
   std::copy( buf->begin(), buf->end(), std::back_inserter( m_buffer ) );
-  dataPushed( buf );
 }
 
-size_t AudioFifo::pullData(AudioFrameBufferPtr& data, size_t size)
+size_t AudioFifo::pullData(BasicSampleFrame* data, size_t size)
 {
+  ppp::profile::ScopedTimer timer( ppp::profile::Stage::FifoPull );
   std::unique_lock<std::mutex> lock( m_bufferMutex );
   if( size > m_buffer.size() )
   {
+    ppp::profile::count( ppp::profile::Counter::Underruns );
     logger()->debug( L4CXX_LOCATION,
                      "Buffer underrun: Requested %d frames while only %d frames in queue",
                      size,
                      m_buffer.size() );
     size = m_buffer.size();
+    ++m_underruns;
+    m_pulledSinceUnderrun = 0;
+    if( m_period != 0 && m_threshold < m_maxThreshold )
+    {
+      m_threshold = std::min( m_threshold + m_period, m_maxThreshold );
+      logger()->debug( L4CXX_LOCATION, "Raised threshold to %d frames", m_threshold );
+    }
   }
-  if( !data )
-  {
-    data = std::make_shared<AudioFrameBuffer>( size );
-  }
-  else if( size > data->size() )
+  else if( m_period != 0 )
   {
-    data->resize( size );
+    m_pulledSinceUnderrun += size;
+    if( m_pulledSinceUnderrun >= m_decayFrames && m_threshold > m_minThreshold )
+    {
+      m_threshold = std::max( m_threshold - m_period, m_minThreshold );
+      m_pulledSinceUnderrun = 0;
+      logger()->debug( L4CXX_LOCATION, "Lowered threshold to %d frames", m_threshold );
+    }
   }
-  std::copy_n( m_buffer.begin(), size, data->begin() );
+  std::copy_n( m_buffer.begin(), size, data );
   m_buffer.erase_begin( size );
   logger()->trace( L4CXX_LOCATION, "Pulled %d frames, %d frames left", size, m_buffer.size() );
-
-  if( data->size() != size )
-  {
-    logger()->error( L4CXX_LOCATION, "Copied %d frames into a buffer with %d frames", size, data->size() );
-  }
   lock.unlock();
   m_bufferChanged.notify_one();
-  dataPulled( data );
   return size;
 }
 
@@ -167,6 +205,49 @@ void AudioFifo::setCapacity(size_t len)
   m_buffer.set_capacity( len );
 }
 
+void AudioFifo::setPeriod(size_t period)
+{
+  BOOST_ASSERT_MSG( period > 0, "Period may not be 0" );
+  const AbstractAudioSource::Ptr src = m_source.lock();
+  std::unique_lock<std::mutex> lock( m_bufferMutex );
+  m_period = period;
+  m_longestTick = src ? src->preferredBufferSize() : 0;
+  m_minThreshold = m_period + m_longestTick;
+  m_maxThreshold = MaxThresholdFactor * m_minThreshold;
+  m_threshold = m_minThreshold;
+  m_decayFrames = DecaySeconds * (src ? src->frequency() : 44100);
+  m_pulledSinceUnderrun = 0;
+  if( m_buffer.capacity() < m_maxThreshold + m_period )
+  {
+    m_buffer.set_capacity( m_maxThreshold + m_period );
+  }
+  logger()->debug( L4CXX_LOCATION, "Period %d frames, threshold %d frames", m_period, m_threshold );
+  lock.unlock();
+  m_bufferChanged.notify_one();
+}
+
+void AudioFifo::clear()
+{
+  std::unique_lock<std::mutex> lock( m_bufferMutex );
+  m_buffer.clear();
+  ++m_generation;
+  lock.unlock();
+  m_bufferChanged.notify_one();
+}
+
+AudioFifo::Stats AudioFifo::stats() const
+{
+  Stats result;
+  std::unique_lock<std::mutex> lock( m_bufferMutex );
+  result.queued = m_buffer.size();
+  result.threshold = m_threshold;
+  result.underruns = m_underruns;
+  lock.unlock();
+  result.renderTime = std::chrono::microseconds( m_renderMicros.load() );
+  result.renderedFrames = m_renderedFrames.load();
+  return result;
+}
+
 size_t AudioFifo::capacity() const
 {
   std::unique_lock<std::mutex> lock( m_bufferMutex );
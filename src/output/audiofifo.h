@@ -26,10 +26,8 @@
 #include <light4cxx/logger.h>
 #include <boost/circular_buffer.hpp>
 
-#undef  BOOST_NO_CXX11_HDR_TUPLE
-
-#include <boost/signals2.hpp>
-
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -46,9 +44,32 @@
  * @details
  * A simple thread is created that continuously requests data from the connected
  * AbstractAudioSource.
+ *
+ * In low-latency mode (see setPeriod()) the threshold is adjusted at runtime:
+ * it starts at one device period plus the longest tick of the source, every
+ * underrun raises it by one period, and after 10 seconds without underruns it
+ * is lowered again by one period.
  */
 class AudioFifo
 {
+public:
+  /**
+   * @brief Buffering statistics for latency monitoring
+   */
+  struct Stats
+  {
+    //! @brief Number of queued frames
+    size_t queued = 0;
+    //! @brief Current threshold
+    size_t threshold = 0;
+    //! @brief Number of requests that could not be satisfied completely
+    uint64_t underruns = 0;
+    //! @brief Total time spent in the source, compare with the duration of renderedFrames
+    std::chrono::microseconds renderTime{ 0 };
+    //! @brief Total number of frames rendered by the source
+    uint64_t renderedFrames = 0;
+  };
+
 private:
   //! @brief Buffered audio frames
   boost::circular_buffer<BasicSampleFrame> m_buffer;
@@ -66,6 +87,24 @@ private:
   //! @brief Buffer modification notifier
   std::condition_variable m_bufferChanged;
 
+  //! @brief Frames requested from the source at once in low-latency mode, 0 otherwise
+  size_t m_period;
+  //! @brief Lower bound of m_threshold in low-latency mode
+  size_t m_minThreshold;
+  //! @brief Upper bound of m_threshold in low-latency mode
+  size_t m_maxThreshold;
+  //! @brief Number of frames pulled without an underrun before m_threshold is lowered
+  size_t m_decayFrames;
+  //! @brief Number of frames pulled since the last underrun or threshold change
+  size_t m_pulledSinceUnderrun;
+  //! @brief Longest tick the source returned, see AbstractAudioSource::preferredBufferSize()
+  size_t m_longestTick;
+  uint64_t m_underruns;
+  //! @brief Incremented by clear(), chunks rendered before are dropped
+  uint64_t m_generation;
+  std::atomic<uint64_t> m_renderMicros;
+  std::atomic<uint64_t> m_renderedFrames;
+
   /**
    * @brief Audio data pulling thread function
    * @param[in] fifo The FIFO that owns the thread
@@ -77,8 +116,10 @@ private:
   /**
    * @brief Adds a buffer to the internal queue by copying its contents
    * @param[in] buf The buffer to add
+   * @param[in] generation Value of m_generation when rendering started; the buffer
+   *                       is dropped if the queue has been cleared since
    */
-  void pushData(const AudioFrameBufferPtr& buf);
+  void pushData(const AudioFrameBufferPtr& buf, uint64_t generation);
 
 public:
   DISABLE_COPY( AudioFifo )
@@ -112,6 +153,23 @@ public:
    */
   void setCapacity(size_t len);
 
+  /**
+   * @brief Switch to low-latency buffering
+   * @param[in] period Number of frames pulled by the device at once
+   */
+  void setPeriod(size_t period);
+
+  /**
+   * @brief Drop all queued frames, e.g. after seeking
+   * @note A chunk that is being rendered while the queue is cleared is dropped as well
+   */
+  void clear();
+
+  /**
+   * @brief Get the current buffering statistics
+   */
+  Stats stats() const;
+
   /**
    * @brief Check if the FIFO is empty
    * @retval true FIFO is empty
@@ -119,7 +177,14 @@ public:
    */
   bool isEmpty() const;
 
-  size_t pullData(AudioFrameBufferPtr& buffer, size_t requestedFrames);
+  /**
+   * @brief Copy the oldest frames out of the FIFO
+   * @param[out] data Destination of up to @a requestedFrames frames
+   * @param[in] requestedFrames Number of frames to copy
+   * @return Number of copied frames, less than requested on an underrun
+   * @note Does not allocate, so it can be called from audio callbacks
+   */
+  size_t pullData(BasicSampleFrame* data, size_t requestedFrames);
 
   bool isSourcePaused() const
   {
@@ -127,21 +192,6 @@ public:
     return !src || src->paused();
   }
 
-  // These are needed to replace boost::mutex (or boost::signals2::mutex) with std::mutex,
-  // otherwise boost::thread would become a dependency.
-  using DataSignalSignature = void(const AudioFrameBufferPtr&);
-
-  using DataSignal = boost::signals2::signal<DataSignalSignature,
-                                             boost::signals2::optional_last_value<void>,
-                                             int,
-                                             std::less<>,
-                                             boost::function<DataSignalSignature>,
-                                             boost::signals2::detail::extended_signature<0,
-                                                                                         DataSignalSignature>::function_type,
-                                             std::mutex>;
-
-  DataSignal dataPushed;
-  DataSignal dataPulled;
 protected:
   /**
    * @brief Get the logger
@@ -16,6 +16,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #include "fft.h"
 
 #include <boost/assert.hpp>
@@ -24,21 +25,18 @@
 #include <cmath>
 
 /*
-copied and modified from: http://local.wasp.uwa.edu.au/~pbourke/miscellaneous/dft/fft_ms.c
-
-Modification of Paul Bourkes FFT code by Peter Cusack
-to utilise the Microsoft complex type.
-
-This computes an in-place complex-to-complex FFT
-x and y are the real and imaginary arrays of 2^m points.
-dir =  1 gives forward transform
-dir = -1 gives reverse transform
+The transform is an iterative radix-2 decimation-in-time FFT with precomputed
+twiddle factors and bit reversal indices.
+
+Both channels are real, so they are transformed together as the real and
+imaginary part of a single complex input; the spectra are separated afterwards
+using the symmetry of real-input transforms:
+  L[k] = (Z[k] + conj(Z[N-k])) / 2
+  R[k] = (Z[k] - conj(Z[N-k])) / 2i
 */
 
 namespace
 {
-constexpr bool reverseFFT = false;
-
 template<typename T>
 struct SimpleComplex
 {
@@ -57,15 +55,6 @@ struct SimpleComplex
     return SimpleComplex<Type>( real * rhs.real - imag * rhs.imag, real * rhs.imag + imag * rhs.real );
   }
 
-  template<typename U>
-  const SimpleComplex<Type>& operator*=(const SimpleComplex<U>& rhs) noexcept
-  {
-    Type r = real * rhs.real - imag * rhs.imag;
-    imag = real * rhs.imag + imag * rhs.real;
-    real = r;
-    return *this;
-  }
-
   template<typename U>
   constexpr SimpleComplex<Type> operator+(const SimpleComplex<U>& rhs) const noexcept
   {
@@ -86,85 +75,76 @@ struct SimpleComplex
     return SimpleComplex<Type>( real - rhs.real, imag - rhs.imag );
   }
 
-  template<typename U>
-  const SimpleComplex<Type>& operator-=(const SimpleComplex<U>& rhs) noexcept
+  constexpr SimpleComplex<Type> conj() const noexcept
   {
-    real -= rhs.real;
-    imag -= rhs.imag;
-    return *this;
+    return SimpleComplex<Type>( real, -imag );
   }
 
-  constexpr Type length() const noexcept
+  Type length() const noexcept
   {
     return std::sqrt( real * real + imag * imag );
   }
 };
 
-void DFFT(std::array<SimpleComplex<float>, ppp::FFT::InputLength>& data)
+typedef SimpleComplex<float> Complex;
+typedef std::array<Complex, ppp::FFT::InputLength> ComplexArray;
+
+/**
+ * @brief Tables that only depend on the transform length
+ */
+struct Tables
 {
-  // re-sort values by inverting the index bits
-  for( uint_fast16_t i = 0, j = 0; i < ppp::FFT::InputLength - 1; i++ )
+  //! @brief exp(-2*pi*i*k/N) for k < N/2
+  std::array<Complex, ppp::FFT::InputLength / 2> twiddles;
+  std::array<uint16_t, ppp::FFT::InputLength> bitReversed{};
+  //! @brief Hann window, scaled to convert the samples to -1..1
+  std::array<float, ppp::FFT::InputLength> window{};
+  //! @brief Amplitude weights, compensating the window's gain and emphasizing higher frequencies
+  std::array<float, ppp::FFT::InputLength / 2> weights{};
+
+  Tables()
+    : twiddles()
   {
-    if( i < j )
+    constexpr size_t N = ppp::FFT::InputLength;
+    for( size_t k = 0; k < N / 2; k++ )
     {
-      std::swap( data[i], data[j] );
+      const double angle = -2 * M_PI * k / N;
+      twiddles[k] = Complex( static_cast<float>(std::cos( angle )), static_cast<float>(std::sin( angle )) );
+      // the coherent gain of the Hann window is 1/2
+      weights[k] = static_cast<float>(2 * std::sqrt( k ));
     }
-    uint_fast16_t k = ppp::FFT::InputLength / 2;
-    while( k <= j )
-    {
-      j -= k;
-      k >>= 1;
-    }
-    j += k;
-  }
-  SimpleComplex<float> expFacMul( -1, 0 );
-  // recursive level loop
-  for( uint_fast8_t level = 0; level < ppp::FFT::InputBits; level++ )
-  {
-    SimpleComplex<float> expFac( 1, 0 );
-    for( uint_fast16_t section = 0; section < uint16_t( 1 << level ); section++ )
+    for( size_t i = 0; i < N; i++ )
     {
-      for( uint_fast16_t left = section; left < ppp::FFT::InputLength; left += 2 << level )
+      size_t reversed = 0;
+      for( uint_fast8_t bit = 0; bit < ppp::FFT::InputBits; bit++ )
       {
-        const uint_fast16_t right = left + (1 << level);
-        SimpleComplex<float> deltaRight = expFac * data[right];
-        data[right] = data[left] - deltaRight;
-        data[left] += deltaRight;
+        reversed |= ((i >> bit) & 1) << (ppp::FFT::InputBits - 1 - bit);
       }
-      expFac *= expFacMul;
+      bitReversed[i] = static_cast<uint16_t>(reversed);
+      window[i] = static_cast<float>((0.5 - 0.5 * std::cos( 2 * M_PI * i / (N - 1) )) / 32768);
     }
-    expFacMul.imag = std::sqrt( (1.0f - expFacMul.real) / 2.0f );
-    if( !reverseFFT )
-    {
-      expFacMul.imag = -expFacMul.imag;
-    }
-    expFacMul.real = std::sqrt( (1.0f + expFacMul.real) / 2.0f );
   }
-  /*	if (!reverseFFT)
-      {
-              for (unsigned short i = 0; i < inputLength; i++)
-                      data[i] /= inputLength;
-      }   */
-}
 
-void samplesToComplex(const BasicSample* smpPtr, std::array<SimpleComplex<float>, ppp::FFT::InputLength>* dest)
-{
-  BOOST_ASSERT( smpPtr != nullptr );
-  BOOST_ASSERT( dest != nullptr );
-  for( size_t i = 0; i < ppp::FFT::InputLength; i++ )
+  static const Tables& instance()
   {
-    (*dest)[i] = SimpleComplex<float>( *smpPtr / 32768.0f, 0 );
-    smpPtr += 2;
+    static const Tables tables;
+    return tables;
   }
-}
+};
 
-void fftToAmp(const std::array<SimpleComplex<float>, ppp::FFT::InputLength>& fft, std::vector<uint16_t>* dest)
+void DFFT(ComplexArray& data, const Tables& tables)
 {
-  dest->resize( ppp::FFT::InputLength / 2 );
-  uint16_t* ampsPtr = &dest->front();
-  for( size_t i = 0; i < ppp::FFT::InputLength / 2; i++ )
+  for( size_t half = 1, stride = ppp::FFT::InputLength / 2; half < ppp::FFT::InputLength; half <<= 1, stride >>= 1 )
   {
-    *(ampsPtr++) = static_cast<uint16_t>(fft[i].length() * std::sqrt( i ));
+    for( size_t start = 0; start < ppp::FFT::InputLength; start += 2 * half )
+    {
+      for( size_t i = 0; i < half; i++ )
+      {
+        const Complex deltaRight = tables.twiddles[i * stride] * data[start + half + i];
+        data[start + half + i] = data[start + i] - deltaRight;
+        data[start + i] += deltaRight;
+      }
+    }
   }
 }
 } // anonymous namespace
@@ -173,21 +153,35 @@ namespace ppp
 {
 namespace FFT
 {
-void doFFT(const AudioFrameBufferPtr& samples, std::vector<uint16_t>* L, std::vector<uint16_t>* R)
+void doFFT(const BasicSampleFrame* samples, std::vector<uint16_t>* L, std::vector<uint16_t>* R)
 {
   BOOST_ASSERT( L != nullptr );
   BOOST_ASSERT( R != nullptr );
-  BOOST_ASSERT( samples );
+  BOOST_ASSERT( samples != nullptr );
 
-  std::array<SimpleComplex<float>, ppp::FFT::InputLength> cArr;
+  const Tables& tables = Tables::instance();
 
-  samplesToComplex( &samples->front().left, &cArr );
-  DFFT( cArr );
-  fftToAmp( cArr, L );
+  ComplexArray data;
+  for( size_t i = 0; i < InputLength; i++ )
+  {
+    const BasicSampleFrame& frame = samples[tables.bitReversed[i]];
+    const float window = tables.window[tables.bitReversed[i]];
+    data[i] = Complex( frame.left * window, frame.right * window );
+  }
+  DFFT( data, tables );
 
-  samplesToComplex( &samples->front().right, &cArr );
-  DFFT( cArr );
-  fftToAmp( cArr, R );
+  L->resize( InputLength / 2 );
+  R->resize( InputLength / 2 );
+  for( size_t k = 0; k < InputLength / 2; k++ )
+  {
+    const Complex z = data[k];
+    const Complex mirrored = data[(InputLength - k) % InputLength].conj();
+    const Complex left = z + mirrored;
+    const Complex right = z - mirrored;
+    // the factor 1/2 of the separation is folded into the weights
+    (*L)[k] = static_cast<uint16_t>(std::min( 65535.0f, left.length() * tables.weights[k] / 2 ));
+    (*R)[k] = static_cast<uint16_t>(std::min( 65535.0f, right.length() * tables.weights[k] / 2 ));
+  }
 }
 }
 }
@@ -30,7 +30,13 @@ namespace FFT
 {
 static constexpr uint8_t InputBits = 11;
 static constexpr uint16_t InputLength = 1 << InputBits;
-extern void doFFT(const AudioFrameBufferPtr& samples, std::vector<uint16_t>* L, std::vector<uint16_t>* R);
+/**
+ * @brief Calculate the windowed amplitude spectra of both channels
+ * @param[in] samples InputLength frames
+ * @param[out] L Left amplitudes, InputLength/2 values
+ * @param[out] R Right amplitudes, InputLength/2 values
+ */
+extern void doFFT(const BasicSampleFrame* samples, std::vector<uint16_t>* L, std::vector<uint16_t>* R);
 }
 }
 
@@ -1,30 +1,45 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2013  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
 #include "fftobserver.h"
 
-#include "audiofifo.h"
+#include "analysisring.h"
 #include "fft.h"
 
 #include <boost/assert.hpp>
 
-FftObserver::FftObserver(AudioFifo* fifo)
-  : m_fifo( fifo ), m_buffer( std::make_shared<AudioFrameBuffer>( ppp::FFT::InputLength ) ), m_filled( 0 )
-  , m_left( ppp::FFT::InputLength, 0 ), m_right( ppp::FFT::InputLength, 0 ), m_dataPushedConnection()
+FftObserver::FftObserver(const AnalysisRing* ring)
+  : m_ring( ring ), m_buffer( ppp::FFT::InputLength ), m_lastWritten( 0 )
+  , m_left( ppp::FFT::InputLength / 2, 0 ), m_right( ppp::FFT::InputLength / 2, 0 )
 {
-  BOOST_ASSERT( fifo != nullptr );
-  m_dataPushedConnection = m_fifo->dataPushed.connect( [this](const auto& x) { dataPushed( x ); } );
+  BOOST_ASSERT( ring != nullptr );
 }
 
-void FftObserver::dataPushed(const AudioFrameBufferPtr& buffer)
+void FftObserver::update()
 {
-  if( !buffer )
+  const size_t written = m_ring->written();
+  if( written == m_lastWritten )
   {
     return;
   }
-  size_t size = std::min( buffer->size(), ppp::FFT::InputLength - m_filled );
-  std::copy( buffer->begin(), buffer->begin() + size, m_buffer->begin() + m_filled );
-  m_filled += size;
-  if( m_filled == ppp::FFT::InputLength )
+  m_lastWritten = written;
+  if( m_ring->readLatest( m_buffer.data(), m_buffer.size() ) )
   {
-    m_filled = 0;
-    ppp::FFT::doFFT( m_buffer, &m_left, &m_right );
+    ppp::FFT::doFFT( m_buffer.data(), &m_left, &m_right );
   }
-}
\ No newline at end of file
+}
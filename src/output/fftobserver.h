@@ -21,9 +21,8 @@
 
 #include "audiotypes.h"
 #include <stuff/utils.h>
-#include <boost/signals2/connection.hpp>
 
-class AudioFifo;
+class AnalysisRing;
 
 /**
  * @ingroup Output
@@ -32,25 +31,31 @@ class AudioFifo;
 
 /**
  * @class FftObserver
- * @brief Observer for calculating the DFFT
+ * @brief Calculates the DFFT of the most recently played frames
  */
 class FftObserver
 {
 private:
-  //! @brief Observed FIFO
-  AudioFifo* m_fifo;
-  AudioFrameBufferPtr m_buffer;
-  size_t m_filled;
+  //! @brief Observed frames
+  const AnalysisRing* m_ring;
+  AudioFrameBuffer m_buffer;
+  //! @brief Value of AnalysisRing::written() at the last update
+  size_t m_lastWritten;
   std::vector<uint16_t> m_left;
   std::vector<uint16_t> m_right;
-  boost::signals2::scoped_connection m_dataPushedConnection;
 public:
   DISABLE_COPY( FftObserver )
 
-  explicit FftObserver(AudioFifo* fifo);
+  explicit FftObserver(const AnalysisRing* ring);
 
   ~FftObserver() = default;
 
+  /**
+   * @brief Recalculate the spectra if new frames were played
+   * @note Meant to be called at display rate; never call it from the audio callback
+   */
+  void update();
+
   const std::vector<uint16_t>& left() const
   {
     return m_left;
@@ -60,9 +65,6 @@ public:
   {
     return m_right;
   }
-
-private:
-  void dataPushed(const AudioFrameBufferPtr& buffer);
 };
 
 /**
@@ -0,0 +1,248 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "flacaudiooutput.h"
+#include "stream/filestream.h"
+#include "stuff/profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+//! @brief Number of frames queued per worker
+constexpr size_t FramesPerJob = 2;
+}
+
+FlacAudioOutput::FlacAudioOutput(const AbstractAudioSource::WeakPtr& src, const std::string& filename, size_t jobs)
+  : AbstractAudioOutput( src ), m_filename( filename ), m_paused( true )
+  , m_jobs( jobs != 0 ? jobs : std::max<size_t>( std::thread::hardware_concurrency(), 1 ) ), m_renderer( src )
+{
+  logger()->info( L4CXX_LOCATION, "Created output: Filename '%s', %d encoder threads", filename, m_jobs );
+}
+
+FlacAudioOutput::~FlacAudioOutput()
+{
+  m_renderer.stop();
+  if( m_thread.joinable() )
+  {
+    m_thread.join();
+  }
+  logger()->trace( L4CXX_LOCATION, "Destroyed" );
+}
+
+void FlacAudioOutput::encodeThread()
+{
+  AudioFrameBuffer pending;
+  pending.reserve( flac::BlockFrames );
+  while( const AudioFrameBuffer* block = m_renderer.front() )
+  {
+    // the rendered blocks follow the ticks, the FLAC frames have a fixed size
+    auto it = block->begin();
+    while( it != block->end() )
+    {
+      const auto count = std::min<size_t>( flac::BlockFrames - pending.size(), block->end() - it );
+      pending.insert( pending.end(), it, it + count );
+      it += count;
+      if( pending.size() == flac::BlockFrames )
+      {
+        queueFrame( std::move( pending ) );
+        pending.clear();
+        pending.reserve( flac::BlockFrames );
+      }
+    }
+    m_renderer.pop();
+  }
+  if( !pending.empty() )
+  {
+    queueFrame( std::move( pending ) );
+  }
+
+  {
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_finished = true;
+    m_frameQueued.notify_all();
+    writeFrames( lock, 0 );
+  }
+  for( std::thread& worker: m_workers )
+  {
+    worker.join();
+  }
+  m_workers.clear();
+
+  m_info.md5 = m_md5.finish();
+  m_stream->seek( 4 );
+  const std::vector<uint8_t> info = flac::streamInfo( m_info, false );
+  m_stream->write( info.data(), info.size() );
+  logger()->debug( L4CXX_LOCATION, "Wrote %d sample frames, frame sizes %d to %d bytes", m_info.totalFrames, m_info.minFrameBytes, m_info.maxFrameBytes );
+
+  setErrorCode( InputDry );
+  pause();
+}
+
+void FlacAudioOutput::queueFrame(AudioFrameBuffer&& samples)
+{
+  m_md5.update( samples.data(), samples.size() );
+  std::unique_lock<std::mutex> lock( m_mutex );
+  writeFrames( lock, FramesPerJob * m_jobs - 1 );
+  const auto number = static_cast<uint32_t>(m_info.totalFrames / flac::BlockFrames);
+  m_info.totalFrames += samples.size();
+  m_frames.emplace_back( new Frame{ std::move( samples ), number } );
+  m_frameQueued.notify_one();
+}
+
+void FlacAudioOutput::writeFrames(std::unique_lock<std::mutex>& lock, size_t keep)
+{
+  while( !m_frames.empty() )
+  {
+    if( !m_frames.front()->done )
+    {
+      if( m_frames.size() <= keep )
+      {
+        return;
+      }
+      m_frameDone.wait( lock, [this]() {
+        return m_frames.front()->done;
+      } );
+    }
+
+    std::unique_ptr<Frame> frame = std::move( m_frames.front() );
+    m_frames.pop_front();
+    lock.unlock();
+    const auto size = static_cast<uint32_t>(frame->data.size());
+    if( m_info.minFrameBytes == 0 || size < m_info.minFrameBytes )
+    {
+      m_info.minFrameBytes = size;
+    }
+    m_info.maxFrameBytes = std::max( m_info.maxFrameBytes, size );
+    m_stream->write( frame->data.data(), frame->data.size() );
+    lock.lock();
+  }
+}
+
+void FlacAudioOutput::encodeWorker()
+{
+  std::unique_lock<std::mutex> lock( m_mutex );
+  while( true )
+  {
+    Frame* frame = nullptr;
+    m_frameQueued.wait( lock, [this, &frame]() {
+      auto it = std::find_if( m_frames.begin(), m_frames.end(), [](const std::unique_ptr<Frame>& f) {
+        return !f->taken;
+      } );
+      if( it != m_frames.end() )
+      {
+        frame = it->get();
+      }
+      return frame != nullptr || m_finished;
+    } );
+    if( frame == nullptr )
+    {
+      return;
+    }
+
+    // the frame stays queued until it is done, so it can be encoded without the lock
+    frame->taken = true;
+    lock.unlock();
+    {
+      ppp::profile::ScopedTimer timer( ppp::profile::Stage::Encode );
+      frame->data = flac::encodeFrame( frame->samples.data(), frame->samples.size(), m_info.sampleRate, frame->number );
+    }
+    AudioFrameBuffer().swap( frame->samples );
+    lock.lock();
+    frame->done = true;
+    m_frameDone.notify_all();
+  }
+}
+
+uint16_t FlacAudioOutput::internal_volumeRight() const
+{
+  return 0;
+}
+
+uint16_t FlacAudioOutput::internal_volumeLeft() const
+{
+  return 0;
+}
+
+void FlacAudioOutput::internal_pause()
+{
+  m_paused = true;
+  m_renderer.setPaused( true );
+}
+
+void FlacAudioOutput::internal_play()
+{
+  m_paused = false;
+  m_renderer.setPaused( false );
+}
+
+bool FlacAudioOutput::internal_paused() const
+{
+  return m_paused;
+}
+
+bool FlacAudioOutput::internal_playing() const
+{
+  return !m_paused;
+}
+
+int FlacAudioOutput::internal_init(int desiredFrq)
+{
+  AbstractAudioSource::Ptr lockedSrc = source();
+  logger()->trace( L4CXX_LOCATION, "Initializing FLAC" );
+  std::unique_ptr<FileStream> file( new FileStream( m_filename, FileStream::Mode::Write ) );
+  if( !file->isOpen() )
+  {
+    logger()->error( L4CXX_LOCATION, "Cannot open output file" );
+    setErrorCode( OutputUnavailable );
+    return 0;
+  }
+  m_stream = std::move( file );
+
+  m_info.sampleRate = lockedSrc->frequency();
+  // the frame sizes and the length are filled in when the stream is complete
+  const std::vector<uint8_t> header = flac::streamHeader( m_info, {
+    { "TITLE", m_title },
+    { "ARTIST", m_artist },
+    { "ALBUM", m_album },
+    { "ENCODER", "PPPlay" }
+  } );
+  m_stream->write( header.data(), header.size() );
+
+  for( size_t i = 0; i < m_jobs; i++ )
+  {
+    m_workers.emplace_back( &FlacAudioOutput::encodeWorker, this );
+  }
+  m_renderer.start();
+  m_thread = std::thread( &FlacAudioOutput::encodeThread, this );
+
+  logger()->trace( L4CXX_LOCATION, "FLAC initialized" );
+  return desiredFrq;
+}
+
+void FlacAudioOutput::setMeta(const std::string& title, const std::string& album, const std::string& artist)
+{
+  m_title = title;
+  m_album = album;
+  m_artist = artist;
+}
+
+light4cxx::Logger* FlacAudioOutput::logger()
+{
+  return light4cxx::Logger::get( AbstractAudioOutput::logger()->name() + ".flac" );
+}
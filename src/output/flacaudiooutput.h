@@ -0,0 +1,161 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_FLACAUDIOOUTPUT_H
+#define PPPLAY_FLACAUDIOOUTPUT_H
+
+#include "abstractaudiooutput.h"
+#include "flacencoder.h"
+#include "renderthread.h"
+#include "stream/stream.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * @ingroup Output
+ * @{
+ */
+
+/**
+ * @class FlacAudioOutput
+ * @brief Lossless output to a FLAC file
+ *
+ * @details
+ * The rendered audio is cut into FLAC frames of flac::BlockFrames sample frames,
+ * which are encoded independently by a pool of worker threads. The writer thread
+ * queues the frames and writes them in stream order as they are finished; at most
+ * a few frames per worker are queued, so memory stays bounded when the encoders
+ * fall behind. The STREAMINFO block, including the MD5 signature of the audio data,
+ * is completed once the stream has ended.
+ */
+class FlacAudioOutput
+  : public AbstractAudioOutput
+{
+public:
+  DISABLE_COPY( FlacAudioOutput )
+
+  FlacAudioOutput() = delete;
+
+  /**
+   * @brief Constructor
+   * @param[in] src Source of audio data
+   * @param[in] filename Output filename of the FLAC data
+   * @param[in] jobs Number of encoder threads, 0 for the number of hardware threads
+   */
+  explicit FlacAudioOutput(const AbstractAudioSource::WeakPtr& src, const std::string& filename, size_t jobs = 0);
+
+  ~FlacAudioOutput() override;
+
+  /**
+   * @brief Set the meta tags of the output file
+   * @param[in] title Title tag
+   * @param[in] album Album tag
+   * @param[in] artist Artist tag
+   * @pre Should be called before init(int).
+   */
+  void setMeta(const std::string& title, const std::string& album, const std::string& artist);
+
+protected:
+  /**
+   * @brief Get the logger
+   * @return Child logger with attached ".flac"
+   */
+  static light4cxx::Logger* logger();
+
+private:
+  struct Frame
+  {
+    AudioFrameBuffer samples;
+    uint32_t number;
+    std::vector<uint8_t> data{};
+    //! @brief Whether a worker is encoding or has encoded the frame
+    bool taken = false;
+    bool done = false;
+  };
+
+  std::string m_filename;
+  //! @brief Whether the output is paused
+  bool m_paused;
+  size_t m_jobs;
+
+  std::unique_ptr<Stream> m_stream{};
+  std::string m_title{};
+  std::string m_artist{};
+  std::string m_album{};
+  //! @brief Stream properties, updated by the writer thread
+  flac::StreamInfo m_info{};
+  //! @brief Signature of the queued sample frames, updated by the writer thread
+  flac::Md5 m_md5{};
+
+  //! @brief Guards the frame queue
+  std::mutex m_mutex{};
+  //! @brief Frames in stream order, from the oldest unwritten one
+  std::deque<std::unique_ptr<Frame>> m_frames{};
+  std::condition_variable m_frameQueued{};
+  std::condition_variable m_frameDone{};
+  //! @brief Set when the last frame is queued
+  bool m_finished = false;
+
+  //! @brief Renders the source while the previous blocks are encoded
+  RenderThread m_renderer;
+  //! @brief Cuts the rendered blocks into frames and writes the encoded ones
+  std::thread m_thread{};
+  std::vector<std::thread> m_workers{};
+
+  void encodeThread();
+
+  //! @brief Worker thread body
+  void encodeWorker();
+
+  /**
+   * @brief Queue a frame for encoding, writing finished frames while the queue is full
+   * @param[in] samples Sample frames of the FLAC frame
+   */
+  void queueFrame(AudioFrameBuffer&& samples);
+
+  /**
+   * @brief Write the finished frames at the front of the queue
+   * @param[in,out] lock Lock of m_mutex, released while writing
+   * @param[in] keep Wait for unfinished frames until at most this many are queued
+   */
+  void writeFrames(std::unique_lock<std::mutex>& lock, size_t keep);
+
+  uint16_t internal_volumeRight() const override;
+
+  uint16_t internal_volumeLeft() const override;
+
+  void internal_pause() override;
+
+  void internal_play() override;
+
+  bool internal_paused() const override;
+
+  bool internal_playing() const override;
+
+  int internal_init(int desiredFrq) override;
+};
+
+/**
+ * @}
+ */
+
+#endif
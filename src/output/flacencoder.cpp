@@ -0,0 +1,676 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "flacencoder.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+namespace flac
+{
+namespace
+{
+constexpr int BitsPerSample = 16;
+constexpr int MaxFixedOrder = 4;
+constexpr int MaxPartitionOrder = 8;
+//! @brief Largest Rice parameter of the 4-bit coding method, 15 is the escape code
+constexpr unsigned MaxRice4Parameter = 14;
+//! @brief Largest Rice parameter of the 5-bit coding method, 31 is the escape code
+constexpr unsigned MaxRice5Parameter = 30;
+
+struct CrcTables
+{
+  std::array<uint8_t, 256> crc8{ {} };
+  std::array<uint16_t, 256> crc16{ {} };
+
+  CrcTables()
+  {
+    for( unsigned i = 0; i < 256; i++ )
+    {
+      unsigned c8 = i;
+      unsigned c16 = i << 8;
+      for( int bit = 0; bit < 8; bit++ )
+      {
+        c8 = (c8 & 0x80) ? ((c8 << 1) ^ 0x07) : (c8 << 1);
+        c16 = (c16 & 0x8000) ? ((c16 << 1) ^ 0x8005) : (c16 << 1);
+      }
+      crc8[i] = static_cast<uint8_t>(c8);
+      crc16[i] = static_cast<uint16_t>(c16);
+    }
+  }
+};
+
+const CrcTables crcTables;
+
+uint8_t crc8(const std::vector<uint8_t>& data)
+{
+  uint8_t crc = 0;
+  for( uint8_t byte: data )
+  {
+    crc = crcTables.crc8[crc ^ byte];
+  }
+  return crc;
+}
+
+uint16_t crc16(const std::vector<uint8_t>& data)
+{
+  uint16_t crc = 0;
+  for( uint8_t byte: data )
+  {
+    crc = static_cast<uint16_t>((crc << 8) ^ crcTables.crc16[(crc >> 8) ^ byte]);
+  }
+  return crc;
+}
+
+/**
+ * @brief Big-endian bit packer
+ */
+class BitWriter
+{
+public:
+  void write(uint32_t value, unsigned bits)
+  {
+    BOOST_ASSERT( bits <= 32 );
+    if( bits == 0 )
+    {
+      return;
+    }
+    m_acc = (m_acc << bits) | (value & ((uint64_t( 1 ) << bits) - 1));
+    m_pending += bits;
+    while( m_pending >= 8 )
+    {
+      m_pending -= 8;
+      m_data.emplace_back( static_cast<uint8_t>(m_acc >> m_pending) );
+    }
+  }
+
+  void writeSigned(int32_t value, unsigned bits)
+  {
+    write( static_cast<uint32_t>(value), bits );
+  }
+
+  void writeRice(uint32_t value, unsigned parameter)
+  {
+    // unary quotient, terminated by a 1 bit
+    uint32_t quotient = value >> parameter;
+    while( quotient >= 32 )
+    {
+      write( 0, 32 );
+      quotient -= 32;
+    }
+    write( 1, quotient + 1 );
+    write( value, parameter );
+  }
+
+  void writeUtf8(uint32_t value)
+  {
+    if( value < 0x80 )
+    {
+      write( value, 8 );
+      return;
+    }
+    const int bytes = value < 0x800 ? 2 : value < 0x10000 ? 3 : value < 0x200000 ? 4 : value < 0x4000000 ? 5 : 6;
+    write( ((0xff00u >> bytes) & 0xff) | (value >> (6 * (bytes - 1))), 8 );
+    for( int i = bytes - 2; i >= 0; i-- )
+    {
+      write( 0x80 | ((value >> (6 * i)) & 0x3f), 8 );
+    }
+  }
+
+  void align()
+  {
+    if( m_pending > 0 )
+    {
+      write( 0, 8 - m_pending );
+    }
+  }
+
+  std::vector<uint8_t>& data() noexcept
+  {
+    return m_data;
+  }
+
+private:
+  std::vector<uint8_t> m_data{};
+  uint64_t m_acc = 0;
+  unsigned m_pending = 0;
+};
+
+void writeLe32(std::vector<uint8_t>& dest, uint32_t value)
+{
+  for( int i = 0; i < 4; i++ )
+  {
+    dest.emplace_back( static_cast<uint8_t>(value >> (8 * i)) );
+  }
+}
+
+inline uint32_t zigzag(int32_t value)
+{
+  return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t fixedResidual(const int32_t* x, int order)
+{
+  switch( order )
+  {
+  case 0:
+    return x[0];
+  case 1:
+    return x[0] - x[-1];
+  case 2:
+    return x[0] - 2 * x[-1] + x[-2];
+  case 3:
+    return x[0] - 3 * x[-1] + 3 * x[-2] - x[-3];
+  default:
+    return x[0] - 4 * x[-1] + 6 * x[-2] - 4 * x[-3] + x[-4];
+  }
+}
+
+/**
+ * @brief Find the fixed predictor with the smallest residual
+ * @param[in] samples Channel samples
+ * @param[out] magnitude Sum of the absolute residuals of the chosen order
+ * @return The order
+ */
+int chooseFixedOrder(const std::vector<int32_t>& samples, uint64_t& magnitude)
+{
+  const int maxOrder = static_cast<int>(std::min<size_t>( MaxFixedOrder, samples.size() - 1 ));
+  std::array<uint64_t, MaxFixedOrder + 1> sums{};
+  for( size_t i = maxOrder; i < samples.size(); i++ )
+  {
+    for( int order = 0; order <= maxOrder; order++ )
+    {
+      sums[order] += std::abs( fixedResidual( &samples[i], order ) );
+    }
+  }
+  int best = 0;
+  for( int order = 1; order <= maxOrder; order++ )
+  {
+    if( sums[order] < sums[best] )
+    {
+      best = order;
+    }
+  }
+  magnitude = sums[best];
+  return best;
+}
+
+/**
+ * @brief Choose the Rice parameter of a partition
+ * @param[in] sum Sum of the zigzag-coded residuals
+ * @param[in] count Number of residuals
+ * @param[out] bits Estimated size of the coded residuals
+ * @return The parameter
+ */
+unsigned chooseRiceParameter(uint64_t sum, size_t count, uint64_t& bits)
+{
+  unsigned best = 0;
+  bits = count + sum;
+  for( unsigned k = 1; k <= MaxRice5Parameter; k++ )
+  {
+    const uint64_t estimate = count * (k + 1) + (sum >> k);
+    if( estimate > bits )
+    {
+      break;
+    }
+    bits = estimate;
+    best = k;
+  }
+  return best;
+}
+
+struct ResidualPlan
+{
+  unsigned partitionOrder = 0;
+  std::vector<unsigned> parameters{};
+  bool wideParameters = false;
+  uint64_t bits = 0;
+};
+
+/**
+ * @brief Choose the partitioning and the Rice parameters of a residual
+ * @param[in] residual Zigzag-coded residual, starting after the warm-up samples
+ * @param[in] blockSize Number of samples including the warm-up samples
+ * @param[in] order Predictor order
+ */
+ResidualPlan planResidual(const std::vector<uint32_t>& residual, size_t blockSize, int order)
+{
+  unsigned maxOrder = 0;
+  while( maxOrder < MaxPartitionOrder
+         && blockSize % (size_t( 2 ) << maxOrder) == 0
+         && (blockSize >> (maxOrder + 1)) > static_cast<size_t>(order) )
+  {
+    ++maxOrder;
+  }
+
+  // partition sums of the finest partitioning, merged pairwise for the coarser ones
+  std::vector<uint64_t> sums( size_t( 1 ) << maxOrder, 0 );
+  const size_t finest = blockSize >> maxOrder;
+  for( size_t i = 0; i < residual.size(); i++ )
+  {
+    sums[(i + order) / finest] += residual[i];
+  }
+
+  ResidualPlan best;
+  for( int partitionOrder = maxOrder; partitionOrder >= 0; partitionOrder-- )
+  {
+    if( partitionOrder < static_cast<int>(maxOrder) )
+    {
+      for( size_t i = 0; i < (size_t( 1 ) << partitionOrder); i++ )
+      {
+        sums[i] = sums[2 * i] + sums[2 * i + 1];
+      }
+      sums.resize( size_t( 1 ) << partitionOrder );
+    }
+
+    ResidualPlan plan;
+    plan.partitionOrder = partitionOrder;
+    const size_t partitionSize = blockSize >> partitionOrder;
+    for( size_t i = 0; i < sums.size(); i++ )
+    {
+      uint64_t bits;
+      const unsigned parameter = chooseRiceParameter( sums[i], i == 0 ? partitionSize - order : partitionSize, bits );
+      plan.parameters.emplace_back( parameter );
+      plan.wideParameters |= parameter > MaxRice4Parameter;
+      plan.bits += bits;
+    }
+    plan.bits += plan.parameters.size() * (plan.wideParameters ? 5 : 4);
+    if( partitionOrder == static_cast<int>(maxOrder) || plan.bits < best.bits )
+    {
+      best = std::move( plan );
+    }
+  }
+  return best;
+}
+
+void writeSubframe(BitWriter& writer, const std::vector<int32_t>& samples, unsigned bps)
+{
+  if( std::all_of( samples.begin(), samples.end(), [&samples](int32_t s) { return s == samples.front(); } ) )
+  {
+    writer.write( 0x00, 8 );
+    writer.writeSigned( samples.front(), bps );
+    return;
+  }
+
+  uint64_t magnitude;
+  const int order = chooseFixedOrder( samples, magnitude );
+  std::vector<uint32_t> residual;
+  residual.reserve( samples.size() - order );
+  for( size_t i = order; i < samples.size(); i++ )
+  {
+    residual.emplace_back( zigzag( fixedResidual( &samples[i], order ) ) );
+  }
+  const ResidualPlan plan = planResidual( residual, samples.size(), order );
+
+  if( order * bps + 6 + plan.bits >= samples.size() * bps )
+  {
+    writer.write( 0x02, 8 );
+    for( int32_t sample: samples )
+    {
+      writer.writeSigned( sample, bps );
+    }
+    return;
+  }
+
+  writer.write( (0x08 | order) << 1, 8 );
+  for( int i = 0; i < order; i++ )
+  {
+    writer.writeSigned( samples[i], bps );
+  }
+  writer.write( plan.wideParameters ? 1 : 0, 2 );
+  writer.write( plan.partitionOrder, 4 );
+  const size_t partitionSize = samples.size() >> plan.partitionOrder;
+  auto it = residual.begin();
+  for( size_t i = 0; i < plan.parameters.size(); i++ )
+  {
+    writer.write( plan.parameters[i], plan.wideParameters ? 5 : 4 );
+    const size_t count = i == 0 ? partitionSize - order : partitionSize;
+    for( size_t j = 0; j < count; j++ )
+    {
+      writer.writeRice( *it++, plan.parameters[i] );
+    }
+  }
+}
+
+unsigned blockSizeCode(size_t count)
+{
+  if( count == 192 )
+  {
+    return 1;
+  }
+  for( unsigned code = 2; code <= 5; code++ )
+  {
+    if( count == size_t( 576 ) << (code - 2) )
+    {
+      return code;
+    }
+  }
+  for( unsigned code = 8; code <= 15; code++ )
+  {
+    if( count == size_t( 256 ) << (code - 8) )
+    {
+      return code;
+    }
+  }
+  return count <= 256 ? 6 : 7;
+}
+
+unsigned sampleRateCode(uint32_t rate)
+{
+  static const std::array<uint32_t, 12> rates = {
+    0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000
+  };
+  for( unsigned code = 1; code < rates.size(); code++ )
+  {
+    if( rates[code] == rate )
+    {
+      return code;
+    }
+  }
+  if( rate % 1000 == 0 && rate / 1000 <= 0xff )
+  {
+    return 12;
+  }
+  if( rate <= 0xffff )
+  {
+    return 13;
+  }
+  if( rate % 10 == 0 && rate / 10 <= 0xffff )
+  {
+    return 14;
+  }
+  // taken from STREAMINFO
+  return 0;
+}
+}
+
+void Md5::update(const BasicSampleFrame* frames, size_t count)
+{
+  std::array<uint8_t, 256> bytes;
+  while( count > 0 )
+  {
+    const size_t chunk = std::min<size_t>( count, bytes.size() / 4 );
+    for( size_t i = 0; i < chunk; i++ )
+    {
+      bytes[4 * i + 0] = static_cast<uint8_t>(frames[i].left);
+      bytes[4 * i + 1] = static_cast<uint8_t>(frames[i].left >> 8);
+      bytes[4 * i + 2] = static_cast<uint8_t>(frames[i].right);
+      bytes[4 * i + 3] = static_cast<uint8_t>(frames[i].right >> 8);
+    }
+    update( bytes.data(), 4 * chunk );
+    frames += chunk;
+    count -= chunk;
+  }
+}
+
+void Md5::update(const uint8_t* data, size_t size)
+{
+  size_t used = m_length % 64;
+  m_length += size;
+  while( size > 0 )
+  {
+    const size_t chunk = std::min<size_t>( size, 64 - used );
+    std::copy_n( data, chunk, m_block.begin() + used );
+    data += chunk;
+    size -= chunk;
+    used += chunk;
+    if( used == 64 )
+    {
+      transform( m_block.data() );
+      used = 0;
+    }
+  }
+}
+
+std::array<uint8_t, 16> Md5::finish()
+{
+  const uint64_t bits = m_length * 8;
+  // a 1 bit, zeros up to 8 bytes before the end of a block, and the length in bits
+  static const uint8_t padding[64] = { 0x80 };
+  update( padding, 1 + (119 - m_length % 64) % 64 );
+  uint8_t length[8];
+  for( int i = 0; i < 8; i++ )
+  {
+    length[i] = static_cast<uint8_t>(bits >> (8 * i));
+  }
+  update( length, 8 );
+
+  std::array<uint8_t, 16> digest;
+  for( size_t i = 0; i < 16; i++ )
+  {
+    digest[i] = static_cast<uint8_t>(m_state[i / 4] >> (8 * (i % 4)));
+  }
+  return digest;
+}
+
+void Md5::transform(const uint8_t* block)
+{
+  static constexpr uint32_t K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+  };
+  static constexpr unsigned Shifts[4][4] = {
+    { 7, 12, 17, 22 }, { 5, 9, 14, 20 }, { 4, 11, 16, 23 }, { 6, 10, 15, 21 }
+  };
+
+  uint32_t words[16];
+  for( int i = 0; i < 16; i++ )
+  {
+    words[i] = uint32_t( block[4 * i] ) | (uint32_t( block[4 * i + 1] ) << 8)
+               | (uint32_t( block[4 * i + 2] ) << 16) | (uint32_t( block[4 * i + 3] ) << 24);
+  }
+
+  uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+  for( int i = 0; i < 64; i++ )
+  {
+    uint32_t f;
+    int g;
+    switch( i / 16 )
+    {
+    case 0:
+      f = (b & c) | (~b & d);
+      g = i;
+      break;
+    case 1:
+      f = (d & b) | (~d & c);
+      g = (5 * i + 1) % 16;
+      break;
+    case 2:
+      f = b ^ c ^ d;
+      g = (3 * i + 5) % 16;
+      break;
+    default:
+      f = c ^ (b | ~d);
+      g = (7 * i) % 16;
+      break;
+    }
+    const uint32_t sum = a + f + K[i] + words[g];
+    const unsigned shift = Shifts[i / 16][i % 4];
+    a = d;
+    d = c;
+    c = b;
+    b += (sum << shift) | (sum >> (32 - shift));
+  }
+  m_state[0] += a;
+  m_state[1] += b;
+  m_state[2] += c;
+  m_state[3] += d;
+}
+
+std::vector<uint8_t> streamInfo(const StreamInfo& info, bool last)
+{
+  BitWriter writer;
+  writer.write( last ? 0x80 : 0x00, 8 );
+  writer.write( StreamInfoSize - 4, 24 );
+  writer.write( BlockFrames, 16 );
+  writer.write( BlockFrames, 16 );
+  writer.write( info.minFrameBytes, 24 );
+  writer.write( info.maxFrameBytes, 24 );
+  writer.write( info.sampleRate, 20 );
+  writer.write( 2 - 1, 3 );
+  writer.write( BitsPerSample - 1, 5 );
+  // 0 means unknown, a longer stream does not fit
+  const uint64_t total = info.totalFrames < (uint64_t( 1 ) << 36) ? info.totalFrames : 0;
+  writer.write( static_cast<uint32_t>(total >> 32), 4 );
+  writer.write( static_cast<uint32_t>(total), 32 );
+  for( uint8_t byte: info.md5 )
+  {
+    writer.write( byte, 8 );
+  }
+  BOOST_ASSERT( writer.data().size() == StreamInfoSize );
+  return std::move( writer.data() );
+}
+
+std::vector<uint8_t> streamHeader(const StreamInfo& info, const std::vector<std::pair<std::string, std::string>>& comments)
+{
+  std::vector<uint8_t> header = { 'f', 'L', 'a', 'C' };
+  const std::vector<uint8_t> infoBlock = streamInfo( info, false );
+  header.insert( header.end(), infoBlock.begin(), infoBlock.end() );
+
+  static const std::string vendor = "PPPlay";
+  std::vector<uint8_t> block;
+  writeLe32( block, vendor.size() );
+  block.insert( block.end(), vendor.begin(), vendor.end() );
+  std::vector<std::string> entries;
+  for( const auto& comment: comments )
+  {
+    if( !comment.second.empty() )
+    {
+      entries.emplace_back( comment.first + "=" + comment.second );
+    }
+  }
+  writeLe32( block, entries.size() );
+  for( const std::string& entry: entries )
+  {
+    writeLe32( block, entry.size() );
+    block.insert( block.end(), entry.begin(), entry.end() );
+  }
+
+  // the comments are the last metadata block, type 4
+  header.emplace_back( 0x80 | 4 );
+  header.emplace_back( static_cast<uint8_t>(block.size() >> 16) );
+  header.emplace_back( static_cast<uint8_t>(block.size() >> 8) );
+  header.emplace_back( static_cast<uint8_t>(block.size()) );
+  header.insert( header.end(), block.begin(), block.end() );
+  return header;
+}
+
+std::vector<uint8_t> encodeFrame(const BasicSampleFrame* frames, size_t count, uint32_t sampleRate, uint32_t frameNumber)
+{
+  BOOST_ASSERT( count > 0 && count <= BlockFrames );
+
+  enum Channel
+  {
+    Left, Right, Mid, Side
+  };
+  std::array<std::vector<int32_t>, 4> channels;
+  for( auto& channel: channels )
+  {
+    channel.resize( count );
+  }
+  for( size_t i = 0; i < count; i++ )
+  {
+    const int32_t left = frames[i].left;
+    const int32_t right = frames[i].right;
+    channels[Left][i] = left;
+    channels[Right][i] = right;
+    channels[Mid][i] = (left + right) >> 1;
+    channels[Side][i] = left - right;
+  }
+
+  std::array<uint64_t, 4> magnitudes;
+  for( int i = 0; i < 4; i++ )
+  {
+    chooseFixedOrder( channels[i], magnitudes[i] );
+  }
+
+  // channel assignment code and the channels of the two subframes
+  struct Assignment
+  {
+    unsigned code;
+    Channel first;
+    Channel second;
+  };
+  static const std::array<Assignment, 4> assignments = { {
+    { 0x1, Left, Right },
+    { 0x8, Left, Side },
+    { 0x9, Side, Right },
+    { 0xa, Mid, Side }
+  } };
+  const Assignment* assignment = &assignments[0];
+  for( const Assignment& candidate: assignments )
+  {
+    if( magnitudes[candidate.first] + magnitudes[candidate.second]
+        < magnitudes[assignment->first] + magnitudes[assignment->second] )
+    {
+      assignment = &candidate;
+    }
+  }
+
+  BitWriter writer;
+  // sync code, fixed block size
+  writer.write( 0xfff8, 16 );
+  const unsigned sizeCode = blockSizeCode( count );
+  const unsigned rateCode = sampleRateCode( sampleRate );
+  writer.write( sizeCode, 4 );
+  writer.write( rateCode, 4 );
+  writer.write( assignment->code, 4 );
+  // 16 bits per sample
+  writer.write( 0x4, 3 );
+  writer.write( 0, 1 );
+  writer.writeUtf8( frameNumber );
+  if( sizeCode == 6 )
+  {
+    writer.write( count - 1, 8 );
+  }
+  else if( sizeCode == 7 )
+  {
+    writer.write( count - 1, 16 );
+  }
+  if( rateCode == 12 )
+  {
+    writer.write( sampleRate / 1000, 8 );
+  }
+  else if( rateCode == 13 )
+  {
+    writer.write( sampleRate, 16 );
+  }
+  else if( rateCode == 14 )
+  {
+    writer.write( sampleRate / 10, 16 );
+  }
+  writer.write( crc8( writer.data() ), 8 );
+
+  // the side channel needs one more bit
+  writeSubframe( writer, channels[assignment->first], assignment->first == Side ? BitsPerSample + 1 : BitsPerSample );
+  writeSubframe( writer, channels[assignment->second], assignment->second == Side ? BitsPerSample + 1 : BitsPerSample );
+
+  writer.align();
+  writer.write( crc16( writer.data() ), 16 );
+  return std::move( writer.data() );
+}
+}
@@ -0,0 +1,132 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_FLACENCODER_H
+#define PPPLAY_FLACENCODER_H
+
+#include "audiotypes.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @ingroup Output
+ * @{
+ */
+
+/**
+ * @brief Encoding of 16-bit stereo frames into a native FLAC stream
+ *
+ * @details
+ * Every FLAC frame is encoded independently of the others, so frames can be
+ * encoded concurrently and written in order afterwards. The encoder chooses the
+ * stereo decorrelation and a fixed polynomial predictor per frame by their
+ * residual magnitude, and codes the residual with partitioned Rice codes; silent
+ * channels are stored as constants.
+ */
+namespace flac
+{
+//! @brief Number of sample frames per FLAC frame, only the last frame may be shorter
+constexpr size_t BlockFrames = 4096;
+
+//! @brief Size of the STREAMINFO block, including its header, following the "fLaC" marker
+constexpr size_t StreamInfoSize = 4 + 34;
+
+/**
+ * @brief Stream properties stored in the STREAMINFO block
+ */
+struct StreamInfo
+{
+  uint32_t sampleRate = 44100;
+  //! @brief Total number of sample frames, 0 if unknown
+  uint64_t totalFrames = 0;
+  //! @brief Smallest encoded frame in bytes, 0 if unknown
+  uint32_t minFrameBytes = 0;
+  //! @brief Largest encoded frame in bytes, 0 if unknown
+  uint32_t maxFrameBytes = 0;
+  //! @brief MD5 of the audio data, see Md5; all zero if unknown
+  std::array<uint8_t, 16> md5{ {} };
+};
+
+/**
+ * @brief MD5 message digest of the audio data
+ *
+ * @details
+ * FLAC signs the interleaved samples, stored as 16-bit little-endian values.
+ */
+class Md5
+{
+public:
+  Md5() = default;
+
+  //! @brief Add sample frames, in stream order
+  void update(const BasicSampleFrame* frames, size_t count);
+
+  //! @brief Add raw data
+  void update(const uint8_t* data, size_t size);
+
+  /**
+   * @brief Get the digest of the data added so far
+   * @note No data may be added afterwards.
+   */
+  std::array<uint8_t, 16> finish();
+
+private:
+  std::array<uint32_t, 4> m_state{ { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 } };
+  std::array<uint8_t, 64> m_block{ {} };
+  //! @brief Total number of bytes added
+  uint64_t m_length = 0;
+
+  void transform(const uint8_t* block);
+};
+
+/**
+ * @brief Create the stream header
+ * @param[in] info Stream properties
+ * @param[in] comments Vorbis comments like @c {"TITLE","..."}, empty ones are skipped
+ * @return The "fLaC" marker, the STREAMINFO block and the comment block
+ */
+std::vector<uint8_t> streamHeader(const StreamInfo& info, const std::vector<std::pair<std::string, std::string>>& comments);
+
+/**
+ * @brief Create the STREAMINFO block, to update it once the stream is complete
+ * @param[in] info Stream properties
+ * @param[in] last Whether this is the last metadata block
+ * @return StreamInfoSize bytes
+ */
+std::vector<uint8_t> streamInfo(const StreamInfo& info, bool last);
+
+/**
+ * @brief Encode a FLAC frame
+ * @param[in] frames Sample frames
+ * @param[in] count Number of sample frames, at most BlockFrames
+ * @param[in] sampleRate Sample rate of the stream
+ * @param[in] frameNumber Index of the frame within the stream
+ * @return The encoded frame
+ */
+std::vector<uint8_t> encodeFrame(const BasicSampleFrame* frames, size_t count, uint32_t sampleRate, uint32_t frameNumber);
+}
+
+/**
+ * @}
+ */
+
+#endif
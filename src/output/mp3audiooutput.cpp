@@ -18,29 +18,25 @@
 
 #include "mp3audiooutput.h"
 
+#include "stuff/profiler.h"
+
 #include <lame/lame.h>
 
 void MP3AudioOutput::encodeThread()
 {
-  while( AbstractAudioSource::Ptr lockedSrc = source() )
+  while( const AudioFrameBuffer* block = m_renderer.front() )
   {
-    std::lock_guard<std::mutex> lock( m_mutex );
-    if( m_paused || lockedSrc->paused() )
-    {
-      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
-      std::this_thread::yield();
-      continue;
-    }
-    AudioFrameBufferPtr buffer;
-    size_t size = lockedSrc->getAudioData( buffer, lockedSrc->preferredBufferSize() );
-    if( size == 0 || !buffer || buffer->empty() )
+    int res;
     {
-      setErrorCode( InputDry );
-      pause();
-      return;
+      ppp::profile::ScopedTimer timer( ppp::profile::Stage::Encode );
+      // LAME takes a non-const pointer, but does not modify the input
+      res = lame_encode_buffer_interleaved( m_lameGlobalFlags,
+                                            const_cast<int16_t*>(&block->front().left),
+                                            block->size(),
+                                            m_buffer,
+                                            BufferSize );
     }
-    int res =
-      lame_encode_buffer_interleaved( m_lameGlobalFlags, &buffer->front().left, buffer->size(), m_buffer, BufferSize );
+    m_renderer.pop();
     if( res < 0 )
     {
       switch( res )
@@ -60,17 +56,20 @@ void MP3AudioOutput::encodeThread()
       default:
         logger()->error( L4CXX_LOCATION, "Unknown error: %d", res );
       }
+      m_renderer.stop();
       pause();
       setErrorCode( OutputError );
-      break;
+      return;
     }
     m_file.write( reinterpret_cast<char*>( m_buffer ), res );
   }
+  setErrorCode( InputDry );
+  pause();
 }
 
 MP3AudioOutput::MP3AudioOutput(const AbstractAudioSource::WeakPtr& src, const std::string& filename)
   : AbstractAudioOutput( src ), m_lameGlobalFlags( nullptr ), m_file(), m_filename( filename ), m_buffer( nullptr )
-  , m_encoderThread(), m_paused( true ), m_mutex()
+  , m_renderer( src ), m_encoderThread(), m_paused( true ), m_mutex()
 {
   m_buffer = new uint8_t[BufferSize];
   m_lameGlobalFlags = lame_init();
@@ -79,7 +78,11 @@ MP3AudioOutput::MP3AudioOutput(const AbstractAudioSource::WeakPtr& src, const st
 
 MP3AudioOutput::~MP3AudioOutput()
 {
-  m_encoderThread.join();
+  m_renderer.stop();
+  if( m_encoderThread.joinable() )
+  {
+    m_encoderThread.join();
+  }
   std::lock_guard<std::mutex> lock( m_mutex );
   if( m_lameGlobalFlags != nullptr )
   {
@@ -105,11 +108,13 @@ uint16_t MP3AudioOutput::internal_volumeLeft() const
 void MP3AudioOutput::internal_pause()
 {
   m_paused = true;
+  m_renderer.setPaused( true );
 }
 
 void MP3AudioOutput::internal_play()
 {
   m_paused = false;
+  m_renderer.setPaused( false );
 }
 
 bool MP3AudioOutput::internal_paused() const
@@ -161,6 +166,7 @@ int MP3AudioOutput::internal_init(int desiredFrq)
     logger()->error( L4CXX_LOCATION, "LAME parameter initialization failed" );
     return 0;
   }
+  m_renderer.start();
   m_encoderThread = std::thread( &MP3AudioOutput::encodeThread, this );
   logger()->trace( L4CXX_LOCATION, "LAME initialized" );
   return desiredFrq;
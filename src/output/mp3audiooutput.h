@@ -20,6 +20,7 @@
 #define MP3AUDIOOUTPUT_H
 
 #include "abstractaudiooutput.h"
+#include "renderthread.h"
 #include "ppplay_output_mp3_export.h"
 
 #include <fstream>
@@ -46,12 +47,14 @@ std::ofstream m_file;
 std::string m_filename;
 //! @brief Internally used buffer for encoding
 uint8_t* m_buffer;
+//! @brief Renders the source while the previous blocks are encoded
+RenderThread m_renderer;
 //! @brief Encoder thread holder
 std::thread m_encoderThread;
 //! @brief Whether the output is paused
 bool m_paused;
 mutable std::mutex m_mutex;
-//! @brief Default size of m_buffer
+//! @brief Default size of m_buffer, large enough for a block of the RenderThread
 static constexpr size_t BufferSize = 32768;
 /**
  * @brief Encoder thread handler
@@ -18,61 +18,49 @@
 
 #include "oggaudiooutput.h"
 #include "stream/filestream.h"
+#include "stuff/profiler.h"
 
 #include <vorbis/vorbisenc.h>
 
 void OggAudioOutput::encodeThread()
 {
-  bool endOfStream = false;
-  while( AbstractAudioSource::Ptr lockedSrc = source() )
+  while( const AudioFrameBuffer* block = m_renderer.front() )
   {
-    if( endOfStream )
     {
-      vorbis_analysis_wrote( m_ds, 0 );
-      setErrorCode( InputDry );
-      pause();
-      break;
-    }
-    std::lock_guard<std::mutex> lock( m_mutex );
-    if( m_paused || lockedSrc->paused() )
-    {
-      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
-      std::this_thread::yield();
-      continue;
-    }
-    AudioFrameBufferPtr buffer;
-    size_t size = lockedSrc->getAudioData( buffer, lockedSrc->preferredBufferSize() );
-    if( size == 0 || !buffer || buffer->empty() )
-    {
-      vorbis_analysis_wrote( m_ds, 0 );
-      setErrorCode( InputDry );
-      pause();
-      return;
-    }
-    float** analysis = vorbis_analysis_buffer( m_ds, size );
-    for( size_t i = 0; i < size; i++ )
-    {
-      analysis[0][i] = (*buffer)[i].left / 32768.0;
-      analysis[1][i] = (*buffer)[i].right / 32768.0;
+      ppp::profile::ScopedTimer timer( ppp::profile::Stage::Encode );
+      const size_t size = block->size();
+      float** analysis = vorbis_analysis_buffer( m_ds, size );
+      for( size_t i = 0; i < size; i++ )
+      {
+        analysis[0][i] = (*block)[i].left / 32768.0;
+        analysis[1][i] = (*block)[i].right / 32768.0;
+      }
+      vorbis_analysis_wrote( m_ds, size );
+      writePages();
     }
-    vorbis_analysis_wrote( m_ds, size );
-    while( vorbis_analysis_blockout( m_ds, m_vb ) )
+    m_renderer.pop();
+  }
+
+  // signal the end of the stream and write the remaining pages
+  vorbis_analysis_wrote( m_ds, 0 );
+  writePages();
+  setErrorCode( InputDry );
+  pause();
+}
+
+void OggAudioOutput::writePages()
+{
+  while( vorbis_analysis_blockout( m_ds, m_vb ) )
+  {
+    vorbis_analysis( m_vb, nullptr );
+    vorbis_bitrate_addblock( m_vb );
+    ogg_packet op;
+    while( vorbis_bitrate_flushpacket( m_ds, &op ) )
     {
-      vorbis_analysis( m_vb, nullptr );
-      vorbis_bitrate_addblock( m_vb );
-      ogg_packet op;
-      while( vorbis_bitrate_flushpacket( m_ds, &op ) )
+      ogg_stream_packetin( m_os, &op );
+      while( ogg_stream_pageout( m_os, m_op ) )
       {
-        ogg_stream_packetin( m_os, &op );
-        while( ogg_stream_pageout( m_os, m_op ) )
-        {
-          m_stream->write( m_op->header, m_op->header_len ).write( m_op->body, m_op->body_len );
-          if( ogg_page_eos( m_op ) )
-          {
-            endOfStream = true;
-            break;
-          }
-        }
+        m_stream->write( m_op->header, m_op->header_len ).write( m_op->body, m_op->body_len );
       }
     }
   }
@@ -81,13 +69,18 @@ void OggAudioOutput::encodeThread()
 OggAudioOutput::OggAudioOutput(const AbstractAudioSource::WeakPtr& src, const std::string& filename)
   : AbstractAudioOutput( src ), m_filename( filename ), m_paused( true ), m_mutex(), m_vi( nullptr ), m_ds( nullptr )
   , m_vb( nullptr ), m_os( nullptr ), m_op( nullptr )
-  , m_stream( nullptr ), m_title(), m_artist(), m_album(), m_thread()
+  , m_stream( nullptr ), m_title(), m_artist(), m_album(), m_renderer( src ), m_thread()
 {
   logger()->info( L4CXX_LOCATION, "Created output: Filename '%s'", filename );
 }
 
 OggAudioOutput::~OggAudioOutput()
 {
+  m_renderer.stop();
+  if( m_thread.joinable() )
+  {
+    m_thread.join();
+  }
   std::lock_guard<std::mutex> lock( m_mutex );
   if( m_os )
   {
@@ -127,11 +120,13 @@ uint16_t OggAudioOutput::internal_volumeLeft() const
 void OggAudioOutput::internal_pause()
 {
   m_paused = true;
+  m_renderer.setPaused( true );
 }
 
 void OggAudioOutput::internal_play()
 {
   m_paused = false;
+  m_renderer.setPaused( false );
 }
 
 bool OggAudioOutput::internal_paused() const
@@ -191,6 +186,7 @@ int OggAudioOutput::internal_init(int desiredFrq)
     vorbis_comment_clear( &comments );
   }
 
+  m_renderer.start();
   m_thread = std::thread( &OggAudioOutput::encodeThread, this );
 
   logger()->trace( L4CXX_LOCATION, "OGG initialized" );
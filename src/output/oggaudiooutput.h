@@ -20,6 +20,7 @@
 #define OGGAUDIOOUTPUT_H
 
 #include "abstractaudiooutput.h"
+#include "renderthread.h"
 #include "stream/stream.h"
 
 #include <vorbis/codec.h>
@@ -48,10 +49,17 @@ private:
   std::string m_title;
   std::string m_artist;
   std::string m_album;
+  //! @brief Renders the source while the previous blocks are encoded
+  RenderThread m_renderer;
   std::thread m_thread;
 
   void encodeThread();
 
+  /**
+   * @brief Encode the analyzed data and write the completed pages
+   */
+  void writePages();
+
   uint16_t internal_volumeRight() const override;
 
   uint16_t internal_volumeLeft() const override;
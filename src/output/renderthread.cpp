@@ -0,0 +1,93 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "renderthread.h"
+
+#include <chrono>
+
+constexpr size_t RenderThread::BlockFrames;
+constexpr size_t RenderThread::QueueBlocks;
+
+RenderThread::RenderThread(const AbstractAudioSource::WeakPtr& source)
+  : m_source( source ), m_queue( QueueBlocks )
+{
+}
+
+RenderThread::~RenderThread()
+{
+  stop();
+}
+
+void RenderThread::start()
+{
+  BOOST_ASSERT( !m_thread.joinable() );
+  m_thread = std::thread( &RenderThread::run, this );
+}
+
+void RenderThread::stop()
+{
+  m_queue.close();
+  if( m_thread.joinable() )
+  {
+    m_thread.join();
+  }
+}
+
+void RenderThread::run()
+{
+  AudioFrameBufferPtr tick;
+  while( AudioFrameBuffer* block = m_queue.acquire() )
+  {
+    block->clear();
+    bool dry = false;
+    while( block->size() < BlockFrames )
+    {
+      AbstractAudioSource::Ptr lockedSrc = m_source.lock();
+      if( !lockedSrc )
+      {
+        dry = true;
+        break;
+      }
+      if( m_paused || lockedSrc->paused() )
+      {
+        if( m_queue.isClosed() )
+        {
+          return;
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        continue;
+      }
+      if( lockedSrc->getAudioData( tick, lockedSrc->preferredBufferSize() ) == 0 || !tick || tick->empty() )
+      {
+        dry = true;
+        break;
+      }
+      block->insert( block->end(), tick->begin(), tick->end() );
+    }
+
+    if( !block->empty() )
+    {
+      m_queue.commit();
+    }
+    if( dry )
+    {
+      m_queue.close();
+      return;
+    }
+  }
+}
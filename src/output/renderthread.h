@@ -0,0 +1,111 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_RENDERTHREAD_H
+#define PPPLAY_RENDERTHREAD_H
+
+#include "abstractaudiosource.h"
+
+#include "stuff/spscqueue.h"
+
+#include <atomic>
+#include <thread>
+
+/**
+ * @ingroup Output
+ * @{
+ */
+
+/**
+ * @class RenderThread
+ * @brief Renders an audio source ahead on its own thread
+ *
+ * @details
+ * Used by the encoding outputs so that mixing and encoding run on different
+ * cores: the source is rendered tick by tick into blocks of about BlockFrames
+ * frames, which are queued for the encoder. At most QueueBlocks blocks are
+ * rendered ahead; the blocks are recycled.
+ */
+class RenderThread
+{
+public:
+  DISABLE_COPY( RenderThread )
+
+  //! @brief Minimum number of frames per block, the last block of a song may be shorter
+  static constexpr size_t BlockFrames = 8192;
+  //! @brief Number of blocks that can be rendered ahead
+  static constexpr size_t QueueBlocks = 4;
+
+  RenderThread() = delete;
+
+  explicit RenderThread(const AbstractAudioSource::WeakPtr& source);
+
+  /**
+   * @brief Stops rendering, see stop()
+   */
+  ~RenderThread();
+
+  /**
+   * @brief Start rendering
+   * @note Rendering does not begin before setPaused(false) is called
+   */
+  void start();
+
+  /**
+   * @brief Stop rendering and wait for the thread to finish
+   * @note Blocks that are already queued can still be consumed
+   */
+  void stop();
+
+  void setPaused(bool paused) noexcept
+  {
+    m_paused = paused;
+  }
+
+  /**
+   * @brief Get the next rendered block, waiting until it is available
+   * @return The block, or @c nullptr if the source is dry and all blocks have been consumed
+   * @note The block must be released with pop() after it was processed
+   */
+  const AudioFrameBuffer* front()
+  {
+    return m_queue.front();
+  }
+
+  /**
+   * @brief Release the block returned by front() for re-use
+   */
+  void pop()
+  {
+    m_queue.pop();
+  }
+
+private:
+  AbstractAudioSource::WeakPtr m_source;
+  SpscQueue<AudioFrameBuffer> m_queue;
+  std::atomic<bool> m_paused{ true };
+  std::thread m_thread{};
+
+  void run();
+};
+
+/**
+ * @}
+ */
+
+#endif
@@ -18,8 +18,13 @@
 
 #include "sdlaudiooutput.h"
 
+#include "stuff/profiler.h"
+
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+#include <cmath>
+
 void SDLAudioOutput::sdlAudioCallback(void* userdata, uint8_t* stream, int len_bytes)
 {
   auto* outpSdl = static_cast<SDLAudioOutput*>(userdata);
@@ -35,14 +40,14 @@ size_t SDLAudioOutput::getSdlData(BasicSampleFrame* data, size_t numFrames)
   if( !lock.owns_lock() )
   {
     logger()->warn( L4CXX_LOCATION, "Failed to lock mutex" );
+    ppp::profile::count( ppp::profile::Counter::Underruns );
     return 0;
   }
   if( paused() || m_fifo.isSourcePaused() )
   {
     return 0;
   }
-  AudioFrameBufferPtr buffer;
-  size_t copied = m_fifo.pullData( buffer, numFrames );
+  size_t copied = m_fifo.pullData( data, numFrames );
   if( copied == 0 )
   {
     logger()->trace( L4CXX_LOCATION, "Source did not return any data - input is dry" );
@@ -56,13 +61,15 @@ size_t SDLAudioOutput::getSdlData(BasicSampleFrame* data, size_t numFrames)
   {
     logger()->trace( L4CXX_LOCATION, "Source provided not enough data: %d frames missing", numFrames );
   }
-  std::copy_n( buffer->begin(), copied, data );
+  m_playedFrames.write( data, copied );
   return copied;
 }
 
-SDLAudioOutput::SDLAudioOutput(const AbstractAudioSource::WeakPtr& src)
+SDLAudioOutput::SDLAudioOutput(const AbstractAudioSource::WeakPtr& src, size_t period)
   :
-  AbstractAudioOutput( src ), m_mutex(), m_fifo( src, 4096 ), m_volObserver( &m_fifo ), m_fftObserver( &m_fifo )
+  AbstractAudioOutput( src ), m_mutex(), m_period( period ), m_fifo( src, 4096 ), m_playedFrames()
+  , m_volObserver( &m_playedFrames )
+  , m_fftObserver( &m_playedFrames )
 {
   logger()->trace( L4CXX_LOCATION, "Created" );
 }
@@ -98,6 +105,11 @@ int SDLAudioOutput::internal_init(int desiredFrq)
   desired->channels = 2;
   desired->format = AUDIO_S16LSB;
   desired->samples = 2048;
+  if( m_period != 0 )
+  {
+    // SDL requires a power of 2
+    desired->samples = static_cast<uint16_t>(1u << static_cast<int>(std::ceil( std::log2( std::min<size_t>( m_period, 32768 ) ) )));
+  }
   desired->callback = sdlAudioCallback;
   desired->userdata = this;
   if( SDL_OpenAudio( desired.get(), obtained.get() ) < 0 )
@@ -107,6 +119,14 @@ int SDLAudioOutput::internal_init(int desiredFrq)
     return 0;
   }
   desiredFrq = desired->freq;
+  if( m_period != 0 )
+  {
+    m_fifo.setPeriod( obtained->samples );
+    logger()->info( L4CXX_LOCATION,
+                    "Low-latency playback with a device period of %d frames (%.1f ms)",
+                    obtained->samples,
+                    obtained->samples * 1000.0 / obtained->freq );
+  }
   if( const char* driverName = SDL_GetCurrentAudioDriver() )
   {
     logger()->info( L4CXX_LOCATION, "Using audio driver '%s'", driverName );
@@ -149,6 +169,12 @@ void SDLAudioOutput::internal_pause()
   }
 }
 
+void SDLAudioOutput::updateAnalysis()
+{
+  m_volObserver.update();
+  m_fftObserver.update();
+}
+
 uint16_t SDLAudioOutput::internal_volumeLeft() const
 {
   return m_volObserver.leftVol();
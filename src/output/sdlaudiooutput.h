@@ -21,6 +21,7 @@
 
 #include "abstractaudiooutput.h"
 #include "audiofifo.h"
+#include "analysisring.h"
 #include "volumeobserver.h"
 #include "fftobserver.h"
 
@@ -43,11 +44,37 @@ public:
 
   SDLAudioOutput() = delete;
 
-  //! @copydoc IAudioOutput::IAudioOutput(const IAudioSource::WeakPtr&)
-  explicit SDLAudioOutput(const AbstractAudioSource::WeakPtr& src);
+  /**
+   * @brief Constructor
+   * @param[in] src The audio source
+   * @param[in] period Device period in frames for low-latency playback, or 0 for the default buffering
+   * @see AudioFifo::setPeriod()
+   */
+  explicit SDLAudioOutput(const AbstractAudioSource::WeakPtr& src, size_t period = 0);
 
   ~SDLAudioOutput() override;
 
+  /**
+   * @brief Recalculate the FFT and the volume meters from the recently played frames
+   * @note The audio callback only copies the frames, so call this at display rate
+   *       from a single thread
+   */
+  void updateAnalysis();
+
+  /**
+   * @brief Drop the queued frames, so that seeking takes effect immediately
+   */
+  void dropQueued()
+  {
+    m_fifo.clear();
+  }
+
+  //! @copydoc AudioFifo::stats()
+  AudioFifo::Stats bufferStats() const
+  {
+    return m_fifo.stats();
+  }
+
   const std::vector<uint16_t>& leftFft() const
   {
     return m_fftObserver.left();
@@ -60,7 +87,11 @@ public:
 
 private:
   std::mutex m_mutex;
+  //! @brief Requested device period, 0 for the default buffering
+  size_t m_period;
   AudioFifo m_fifo;
+  //! @brief Frames played by the audio callback, for the observers
+  AnalysisRing m_playedFrames;
   VolumeObserver m_volObserver;
   FftObserver m_fftObserver;
 
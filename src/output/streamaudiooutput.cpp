@@ -0,0 +1,309 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "streamaudiooutput.h"
+
+#include "stuff/profiler.h"
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#ifdef WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+//! @brief Maximum number of buffers written at once
+constexpr size_t MaxBatchBuffers = 64;
+//! @brief Number of frames after which a batch is written
+constexpr size_t BatchFrames = 16384;
+
+#ifdef WIN32
+bool writeFully(int fd, const char* data, size_t size)
+{
+  while( size > 0 )
+  {
+    const int written = _write( fd, data, static_cast<unsigned int>(size) );
+    if( written < 0 )
+    {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+#endif
+}
+
+StreamAudioOutput::StreamAudioOutput(const AbstractAudioSource::WeakPtr& src, int fd, Format format)
+  : AbstractAudioOutput( src ), m_fd( fd ), m_format( format )
+{
+  logger()->info( L4CXX_LOCATION, "Created output: File descriptor %d", fd );
+}
+
+StreamAudioOutput::~StreamAudioOutput()
+{
+  m_stop = true;
+  if( m_encoderThread.joinable() )
+  {
+    m_encoderThread.join();
+  }
+  logger()->trace( L4CXX_LOCATION, "Destroyed" );
+}
+
+int StreamAudioOutput::parseTarget(const std::string& target)
+{
+  if( target == "-" )
+  {
+#ifdef WIN32
+    return _fileno( stdout );
+#else
+    return STDOUT_FILENO;
+#endif
+  }
+  if( !boost::starts_with( target, "fd:" ) || target.size() == 3 )
+  {
+    return -1;
+  }
+  char* end = nullptr;
+  const long fd = std::strtol( target.c_str() + 3, &end, 10 );
+  if( *end != '\0' || fd < 0 || fd > std::numeric_limits<int>::max() )
+  {
+    return -1;
+  }
+  return static_cast<int>(fd);
+}
+
+void StreamAudioOutput::encodeThread()
+{
+  while( !m_stop )
+  {
+    AbstractAudioSource::Ptr lockedSrc = source();
+    if( !lockedSrc )
+    {
+      break;
+    }
+    if( m_paused || lockedSrc->paused() )
+    {
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      continue;
+    }
+
+    size_t count = 0;
+    size_t frames = 0;
+    bool dry = false;
+    while( count < m_batch.size() && frames < BatchFrames )
+    {
+      auto& buffer = m_batch[count];
+      if( lockedSrc->getAudioData( buffer, lockedSrc->preferredBufferSize() ) == 0 || !buffer || buffer->empty() )
+      {
+        dry = true;
+        break;
+      }
+      frames += buffer->size();
+      ++count;
+    }
+
+    if( (count > 0 || !m_header.empty()) && !writeBatch( count ) )
+    {
+      setErrorCode( OutputError );
+      pause();
+      return;
+    }
+    if( dry )
+    {
+      setErrorCode( InputDry );
+      pause();
+      return;
+    }
+  }
+}
+
+bool StreamAudioOutput::writeBatch(size_t count)
+{
+  ppp::profile::ScopedTimer timer( ppp::profile::Stage::Encode );
+#ifdef WIN32
+  if( !writeFully( m_fd, m_header.data(), m_header.size() ) )
+  {
+    logger()->error( L4CXX_LOCATION, "Write failed: %s", std::strerror( errno ) );
+    return false;
+  }
+  for( size_t i = 0; i < count; ++i )
+  {
+    const auto& buffer = m_batch[i];
+    if( !writeFully( m_fd, reinterpret_cast<const char*>(buffer->data()), buffer->size() * sizeof( BasicSampleFrame ) ) )
+    {
+      logger()->error( L4CXX_LOCATION, "Write failed: %s", std::strerror( errno ) );
+      return false;
+    }
+  }
+#else
+  iovec vecs[MaxBatchBuffers + 1];
+  size_t vecCount = 0;
+  if( !m_header.empty() )
+  {
+    vecs[vecCount++] = iovec{ m_header.data(), m_header.size() };
+  }
+  for( size_t i = 0; i < count; ++i )
+  {
+    vecs[vecCount++] = iovec{ m_batch[i]->data(), m_batch[i]->size() * sizeof( BasicSampleFrame ) };
+  }
+
+  size_t first = 0;
+  while( first < vecCount )
+  {
+    const ssize_t written = writev( m_fd, vecs + first, static_cast<int>(vecCount - first) );
+    if( written < 0 )
+    {
+      if( errno == EINTR )
+      {
+        continue;
+      }
+      if( errno == EAGAIN || errno == EWOULDBLOCK )
+      {
+        // non-blocking descriptor, wait for the reader to catch up
+        if( m_stop )
+        {
+          return false;
+        }
+        pollfd waitFd{ m_fd, POLLOUT, 0 };
+        poll( &waitFd, 1, 100 );
+        continue;
+      }
+      if( errno == EPIPE )
+      {
+        logger()->info( L4CXX_LOCATION, "Reader closed the stream" );
+      }
+      else
+      {
+        logger()->error( L4CXX_LOCATION, "Write failed: %s", std::strerror( errno ) );
+      }
+      return false;
+    }
+
+    // skip the completely written vectors and advance into the partially written one
+    size_t remaining = static_cast<size_t>(written);
+    while( first < vecCount && remaining >= vecs[first].iov_len )
+    {
+      remaining -= vecs[first].iov_len;
+      ++first;
+    }
+    if( first < vecCount )
+    {
+      vecs[first].iov_base = static_cast<char*>(vecs[first].iov_base) + remaining;
+      vecs[first].iov_len -= remaining;
+    }
+  }
+#endif
+  m_header.clear();
+  return true;
+}
+
+uint16_t StreamAudioOutput::internal_volumeRight() const
+{
+  return 0;
+}
+
+uint16_t StreamAudioOutput::internal_volumeLeft() const
+{
+  return 0;
+}
+
+void StreamAudioOutput::internal_pause()
+{
+  m_paused = true;
+}
+
+void StreamAudioOutput::internal_play()
+{
+  m_paused = false;
+}
+
+bool StreamAudioOutput::internal_paused() const
+{
+  return m_paused;
+}
+
+bool StreamAudioOutput::internal_playing() const
+{
+  return !m_paused;
+}
+
+int StreamAudioOutput::internal_init(int desiredFrq)
+{
+  if( m_fd < 0 )
+  {
+    logger()->error( L4CXX_LOCATION, "Invalid file descriptor %d", m_fd );
+    setErrorCode( OutputUnavailable );
+    return 0;
+  }
+
+#ifdef WIN32
+  _setmode( m_fd, _O_BINARY );
+#else
+  // a closed pipe is reported through EPIPE instead of terminating the process
+  std::signal( SIGPIPE, SIG_IGN );
+#endif
+
+  if( m_format == Format::Wav )
+  {
+    // the sizes are unknown while streaming, readers treat the maximum as "until the end of the stream"
+    struct
+    {
+      char id1[4];
+      uint32_t size1;
+      char id2[4];
+      char id3[4];
+      int32_t subsize1;
+      int16_t format, numChans;
+      uint32_t sampleRate, byteRate;
+      int16_t blockAlign, bitsPerSample;
+      char id4[4];
+      uint32_t subsize2;
+    } header = {
+      { 'R', 'I', 'F', 'F' }, 0xffffffff,
+      { 'W', 'A', 'V', 'E' }, { 'f', 'm', 't', ' ' }, 16, 1, 2, static_cast<uint32_t>(desiredFrq),
+      uint32_t( desiredFrq * sizeof( BasicSampleFrame ) ), sizeof( BasicSampleFrame ), 16,
+      { 'd', 'a', 't', 'a' }, 0xffffffff
+    };
+    const auto* headerData = reinterpret_cast<const char*>(&header);
+    m_header.assign( headerData, headerData + sizeof( header ) );
+  }
+
+  m_batch.resize( MaxBatchBuffers );
+  m_encoderThread = std::thread( &StreamAudioOutput::encodeThread, this );
+  return desiredFrq;
+}
+
+light4cxx::Logger* StreamAudioOutput::logger()
+{
+  return light4cxx::Logger::get( AbstractAudioOutput::logger()->name() + ".stream" );
+}
@@ -0,0 +1,119 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_STREAMAUDIOOUTPUT_H
+#define PPPLAY_STREAMAUDIOOUTPUT_H
+
+#include "abstractaudiooutput.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * @ingroup Output
+ * @{
+ */
+
+/**
+ * @class StreamAudioOutput
+ * @brief Writes the audio to a pipe, a socket or stdout
+ *
+ * @details
+ * Unlike WavAudioOutput the target is never seeked, so it can be consumed
+ * while it is written, e.g. by an external encoder. Several rendered buffers
+ * are collected and written with a single vectored write; a slow reader
+ * throttles the rendering instead of letting data pile up in memory.
+ *
+ * The output stops with OutputError when the reader closes the stream.
+ */
+class StreamAudioOutput
+  : public AbstractAudioOutput
+{
+public:
+  //! @brief Encoding of the written data
+  enum class Format
+  {
+    Raw, //!< @brief Interleaved signed 16-bit little-endian stereo frames
+    Wav //!< @brief Raw frames preceded by a WAV header with unknown (maximum) sizes
+  };
+
+  DISABLE_COPY( StreamAudioOutput )
+
+  StreamAudioOutput() = delete;
+
+  /**
+   * @brief Constructor
+   * @param[in] src Audio source
+   * @param[in] fd File descriptor to write to, it is not closed by the output
+   * @param[in] format Encoding of the data
+   */
+  explicit StreamAudioOutput(const AbstractAudioSource::WeakPtr& src, int fd, Format format);
+
+  ~StreamAudioOutput() override;
+
+  /**
+   * @brief Get the file descriptor of an output target
+   * @param[in] target @c "-" for stdout, or @c "fd:N" for the inherited descriptor @c N
+   * @return The file descriptor, or @c -1 if @a target does not name a stream
+   */
+  static int parseTarget(const std::string& target);
+
+protected:
+  static light4cxx::Logger* logger();
+
+private:
+  int m_fd;
+  Format m_format;
+  std::thread m_encoderThread{};
+  std::atomic<bool> m_paused{ true };
+  std::atomic<bool> m_stop{ false };
+  //! @brief Data to write before the first frames
+  std::vector<char> m_header{};
+  //! @brief Buffers of the current batch, kept to reuse their memory
+  std::vector<AudioFrameBufferPtr> m_batch{};
+
+  void encodeThread();
+
+  /**
+   * @brief Write the pending header and the first @a count buffers of the batch
+   * @param[in] count Number of buffers
+   * @return @c false if the stream was closed or failed
+   */
+  bool writeBatch(size_t count);
+
+  uint16_t internal_volumeRight() const override;
+
+  uint16_t internal_volumeLeft() const override;
+
+  void internal_pause() override;
+
+  void internal_play() override;
+
+  bool internal_paused() const override;
+
+  bool internal_playing() const override;
+
+  int internal_init(int desiredFrq) override;
+};
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,99 @@
+#define BOOST_TEST_MODULE AudioFifo
+
+#include <boost/test/unit_test.hpp>
+
+#include "../abstractaudiosource.h"
+#include "../audiofifo.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+constexpr size_t Tick = 256;
+
+/**
+ * @brief Numbers its frames consecutively, and holds the first request until released
+ */
+class CountingSource
+  : public AbstractAudioSource
+{
+public:
+  CountingSource() = default;
+
+  //! @brief Wait until the first request is being rendered
+  void waitForFirstRequest()
+  {
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_changed.wait( lock, [this]() {
+      return m_entered;
+    } );
+  }
+
+  void release()
+  {
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_released = true;
+    m_changed.notify_all();
+  }
+
+private:
+  std::mutex m_mutex{};
+  std::condition_variable m_changed{};
+  bool m_entered = false;
+  bool m_released = false;
+  int16_t m_next = 0;
+
+  size_t internal_getAudioData(BasicSampleFrame* buffer, size_t requestedFrames) override
+  {
+    {
+      std::unique_lock<std::mutex> lock( m_mutex );
+      m_entered = true;
+      m_changed.notify_all();
+      m_changed.wait( lock, [this]() {
+        return m_released;
+      } );
+    }
+    for( size_t i = 0; i < requestedFrames; i++ )
+    {
+      buffer[i].left = buffer[i].right = m_next++;
+    }
+    return requestedFrames;
+  }
+
+  size_t internal_preferredBufferSize() const override
+  {
+    return Tick;
+  }
+
+  bool internal_initialize(uint32_t) override
+  {
+    return true;
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE( ClearDropsChunkInFlight )
+{
+  auto source = std::make_shared<CountingSource>();
+  BOOST_REQUIRE( source->initialize( 44100 ) );
+  AudioFifo fifo( source, Tick );
+
+  // the first chunk is being rendered while the queue is cleared, e.g. by a seek
+  source->waitForFirstRequest();
+  fifo.clear();
+  source->release();
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+  while( fifo.queuedLength() < Tick )
+  {
+    BOOST_REQUIRE( std::chrono::steady_clock::now() < deadline );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+  BasicSampleFrame frames[Tick];
+  BOOST_REQUIRE_EQUAL( fifo.pullData( frames, Tick ), Tick );
+  BOOST_CHECK_EQUAL( frames[0].left, static_cast<int16_t>(Tick) );
+  BOOST_CHECK_EQUAL( frames[Tick - 1].left, static_cast<int16_t>(2 * Tick - 1) );
+}
@@ -0,0 +1,555 @@
+#define BOOST_TEST_MODULE FlacEncoder
+
+#include <boost/test/unit_test.hpp>
+
+#include "../abstractaudiosource.h"
+#include "../flacaudiooutput.h"
+#include "../flacencoder.h"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+std::string hex(const std::array<uint8_t, 16>& digest)
+{
+  static const char digits[] = "0123456789abcdef";
+  std::string result;
+  for( uint8_t byte: digest )
+  {
+    result += digits[byte >> 4];
+    result += digits[byte & 15];
+  }
+  return result;
+}
+
+std::string md5(const std::string& str)
+{
+  flac::Md5 md5;
+  md5.update( reinterpret_cast<const uint8_t*>(str.data()), str.size() );
+  return hex( md5.finish() );
+}
+
+/**
+ * @brief Minimal FLAC decoder for the subset written by the encoder
+ *
+ * @details
+ * Decodes 16-bit stereo streams with CONSTANT, VERBATIM and FIXED subframes, and
+ * checks the frame CRCs. Any violation throws std::runtime_error.
+ */
+class Decoder
+{
+public:
+  explicit Decoder(const std::vector<uint8_t>& data)
+    : m_data( data )
+  {
+  }
+
+  flac::StreamInfo info{};
+  std::vector<BasicSampleFrame> frames{};
+
+  void decode()
+  {
+    check( read( 32 ) == 0x664c6143, "fLaC marker" );
+    bool last = false;
+    bool haveInfo = false;
+    while( !last )
+    {
+      last = read( 1 ) != 0;
+      const uint32_t type = read( 7 );
+      const uint32_t length = read( 24 );
+      if( type != 0 )
+      {
+        m_pos += 8 * length;
+        continue;
+      }
+      check( length == flac::StreamInfoSize - 4, "STREAMINFO size" );
+      check( read( 16 ) == flac::BlockFrames && read( 16 ) == flac::BlockFrames, "block size" );
+      info.minFrameBytes = read( 24 );
+      info.maxFrameBytes = read( 24 );
+      info.sampleRate = read( 20 );
+      check( read( 3 ) == 1 && read( 5 ) == 15, "16-bit stereo" );
+      info.totalFrames = uint64_t( read( 4 ) ) << 32;
+      info.totalFrames |= read( 32 );
+      for( uint8_t& byte: info.md5 )
+      {
+        byte = static_cast<uint8_t>(read( 8 ));
+      }
+      haveInfo = true;
+    }
+    check( haveInfo, "STREAMINFO block" );
+
+    for( uint32_t number = 0; m_pos < 8 * m_data.size(); number++ )
+    {
+      const size_t start = m_pos / 8;
+      decodeFrame( number );
+      const size_t size = m_pos / 8 - start;
+      check( size >= info.minFrameBytes && size <= info.maxFrameBytes, "frame size within the STREAMINFO range" );
+    }
+  }
+
+private:
+  const std::vector<uint8_t>& m_data;
+  size_t m_pos = 0;
+
+  static void check(bool condition, const std::string& what)
+  {
+    if( !condition )
+    {
+      throw std::runtime_error( "invalid FLAC data: " + what );
+    }
+  }
+
+  uint32_t read(int bits)
+  {
+    check( m_pos + bits <= 8 * m_data.size(), "unexpected end of data" );
+    uint32_t value = 0;
+    for( int i = 0; i < bits; i++, m_pos++ )
+    {
+      value = (value << 1) | ((m_data[m_pos / 8] >> (7 - m_pos % 8)) & 1);
+    }
+    return value;
+  }
+
+  int32_t readSigned(int bits)
+  {
+    const uint32_t value = read( bits );
+    return (value & (uint32_t( 1 ) << (bits - 1))) ? int32_t( value ) - (int32_t( 1 ) << bits) : int32_t( value );
+  }
+
+  uint32_t readUnary()
+  {
+    uint32_t count = 0;
+    while( read( 1 ) == 0 )
+    {
+      count++;
+    }
+    return count;
+  }
+
+  uint32_t crc8(size_t from, size_t to) const
+  {
+    uint32_t crc = 0;
+    for( size_t i = from; i < to; i++ )
+    {
+      crc ^= m_data[i];
+      for( int bit = 0; bit < 8; bit++ )
+      {
+        crc = ((crc << 1) ^ ((crc & 0x80) ? 0x07 : 0)) & 0xff;
+      }
+    }
+    return crc;
+  }
+
+  uint32_t crc16(size_t from, size_t to) const
+  {
+    uint32_t crc = 0;
+    for( size_t i = from; i < to; i++ )
+    {
+      crc ^= uint32_t( m_data[i] ) << 8;
+      for( int bit = 0; bit < 8; bit++ )
+      {
+        crc = ((crc << 1) ^ ((crc & 0x8000) ? 0x8005 : 0)) & 0xffff;
+      }
+    }
+    return crc;
+  }
+
+  void decodeFrame(uint32_t expectedNumber)
+  {
+    check( m_pos % 8 == 0, "frame alignment" );
+    const size_t start = m_pos / 8;
+    check( read( 16 ) == 0xfff8, "frame sync, fixed block size" );
+    const uint32_t sizeCode = read( 4 );
+    const uint32_t rateCode = read( 4 );
+    const uint32_t assignment = read( 4 );
+    check( read( 3 ) == 4 && read( 1 ) == 0, "16-bit samples" );
+
+    // UTF-8 coded frame number
+    uint32_t number = read( 8 );
+    int continuation = 0;
+    for( uint32_t mask = 0x80; (number & mask) != 0 && mask > 1; mask >>= 1 )
+    {
+      continuation++;
+    }
+    if( continuation > 0 )
+    {
+      check( continuation >= 2, "frame number coding" );
+      number &= 0x7f >> continuation;
+      for( int i = 1; i < continuation; i++ )
+      {
+        const uint32_t byte = read( 8 );
+        check( (byte & 0xc0) == 0x80, "frame number continuation" );
+        number = (number << 6) | (byte & 0x3f);
+      }
+    }
+    check( number == expectedNumber, "frame number" );
+
+    size_t count = 0;
+    if( sizeCode == 1 )
+    {
+      count = 192;
+    }
+    else if( sizeCode >= 2 && sizeCode <= 5 )
+    {
+      count = size_t( 576 ) << (sizeCode - 2);
+    }
+    else if( sizeCode == 6 )
+    {
+      count = read( 8 ) + 1;
+    }
+    else if( sizeCode == 7 )
+    {
+      count = read( 16 ) + 1;
+    }
+    else
+    {
+      check( sizeCode >= 8, "block size code" );
+      count = size_t( 256 ) << (sizeCode - 8);
+    }
+    check( count <= flac::BlockFrames, "block size" );
+    static const uint32_t rates[] = { 0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000 };
+    uint32_t rate = info.sampleRate;
+    if( rateCode >= 1 && rateCode <= 11 )
+    {
+      rate = rates[rateCode];
+    }
+    else if( rateCode == 12 )
+    {
+      rate = read( 8 ) * 1000;
+    }
+    else if( rateCode == 13 )
+    {
+      rate = read( 16 );
+    }
+    else if( rateCode == 14 )
+    {
+      rate = read( 16 ) * 10;
+    }
+    check( rateCode != 15 && rate == info.sampleRate, "sample rate" );
+    check( read( 8 ) == crc8( start, m_pos / 8 - 1 ), "header CRC" );
+
+    check( assignment == 1 || (assignment >= 8 && assignment <= 10), "stereo channel assignment" );
+    // the side channel needs an extra bit
+    const std::vector<int32_t> first = decodeSubframe( count, assignment == 9 ? 17 : 16 );
+    const std::vector<int32_t> second = decodeSubframe( count, assignment == 8 || assignment == 10 ? 17 : 16 );
+    m_pos = (m_pos + 7) / 8 * 8;
+    const uint32_t crc = crc16( start, m_pos / 8 );
+    check( read( 16 ) == crc, "frame CRC" );
+
+    for( size_t i = 0; i < count; i++ )
+    {
+      int32_t left = first[i];
+      int32_t right = second[i];
+      switch( assignment )
+      {
+      case 8:
+        right = left - second[i];
+        break;
+      case 9:
+        left = first[i] + second[i];
+        break;
+      case 10:
+      {
+        const int32_t side = second[i];
+        const int32_t mid = first[i] * 2 + (side & 1);
+        left = (mid + side) >> 1;
+        right = (mid - side) >> 1;
+        break;
+      }
+      default:
+        break;
+      }
+      check( left >= -32768 && left <= 32767 && right >= -32768 && right <= 32767, "sample range" );
+      BasicSampleFrame frame;
+      frame.left = static_cast<int16_t>(left);
+      frame.right = static_cast<int16_t>(right);
+      frames.emplace_back( frame );
+    }
+  }
+
+  std::vector<int32_t> decodeSubframe(size_t count, int bps)
+  {
+    check( read( 1 ) == 0, "subframe padding" );
+    const uint32_t type = read( 6 );
+    check( read( 1 ) == 0, "no wasted bits" );
+    std::vector<int32_t> samples;
+    if( type == 0 )
+    {
+      samples.assign( count, readSigned( bps ) );
+      return samples;
+    }
+    if( type == 1 )
+    {
+      for( size_t i = 0; i < count; i++ )
+      {
+        samples.emplace_back( readSigned( bps ) );
+      }
+      return samples;
+    }
+    check( type >= 8 && type <= 12, "subframe type" );
+    const size_t order = type - 8;
+    check( order <= count, "predictor order" );
+    for( size_t i = 0; i < order; i++ )
+    {
+      samples.emplace_back( readSigned( bps ) );
+    }
+
+    const uint32_t method = read( 2 );
+    check( method <= 1, "residual coding method" );
+    const int parameterBits = method == 0 ? 4 : 5;
+    const uint32_t escape = method == 0 ? 15 : 31;
+    const uint32_t partitionOrder = read( 4 );
+    check( (count >> partitionOrder) << partitionOrder == count && (count >> partitionOrder) >= order, "partition order" );
+    for( uint32_t partition = 0; partition < (uint32_t( 1 ) << partitionOrder); partition++ )
+    {
+      const uint32_t parameter = read( parameterBits );
+      const size_t partitionCount = (count >> partitionOrder) - (partition == 0 ? order : 0);
+      const int rawBits = parameter == escape ? static_cast<int>(read( 5 )) : 0;
+      for( size_t i = 0; i < partitionCount; i++ )
+      {
+        int64_t residual;
+        if( parameter == escape )
+        {
+          residual = rawBits == 0 ? 0 : readSigned( rawBits );
+        }
+        else
+        {
+          const uint64_t folded = (uint64_t( readUnary() ) << parameter) | read( static_cast<int>(parameter) );
+          residual = (folded & 1) ? -int64_t( folded >> 1 ) - 1 : int64_t( folded >> 1 );
+        }
+        const size_t n = samples.size();
+        int64_t prediction = 0;
+        switch( order )
+        {
+        case 1:
+          prediction = samples[n - 1];
+          break;
+        case 2:
+          prediction = 2 * int64_t( samples[n - 1] ) - samples[n - 2];
+          break;
+        case 3:
+          prediction = 3 * int64_t( samples[n - 1] ) - 3 * int64_t( samples[n - 2] ) + samples[n - 3];
+          break;
+        case 4:
+          prediction = 4 * int64_t( samples[n - 1] ) - 6 * int64_t( samples[n - 2] ) + 4 * int64_t( samples[n - 3] ) - samples[n - 4];
+          break;
+        default:
+          break;
+        }
+        const int64_t sample = prediction + residual;
+        check( sample >= -(int64_t( 1 ) << (bps - 1)) && sample < (int64_t( 1 ) << (bps - 1)), "predicted sample range" );
+        samples.emplace_back( static_cast<int32_t>(sample) );
+      }
+    }
+    return samples;
+  }
+};
+
+/**
+ * @brief A test signal covering the different subframe types and stereo modes
+ * @param[in] count Number of sample frames
+ */
+std::vector<BasicSampleFrame> testSignal(size_t count)
+{
+  std::mt19937 rng( 4711 );
+  std::uniform_int_distribution<int> noise( -32768, 32767 );
+  std::vector<BasicSampleFrame> frames( count );
+  for( size_t i = 0; i < count; i++ )
+  {
+    BasicSampleFrame& frame = frames[i];
+    // a different kind of signal every 3000 sample frames, so they mix within FLAC frames
+    switch( (i / 3000) % 6 )
+    {
+    case 0:
+      // silence
+      frame.left = frame.right = 0;
+      break;
+    case 1:
+      // the same tone on both channels
+      frame.left = frame.right = static_cast<int16_t>(std::lround( 20000 * std::sin( i * 0.05 ) ));
+      break;
+    case 2:
+      // different tones
+      frame.left = static_cast<int16_t>(std::lround( 30000 * std::sin( i * 0.01 ) ));
+      frame.right = static_cast<int16_t>(std::lround( 12000 * std::cos( i * 0.003 ) ));
+      break;
+    case 3:
+      // full scale noise
+      frame.left = static_cast<int16_t>(noise( rng ));
+      frame.right = static_cast<int16_t>(noise( rng ));
+      break;
+    case 4:
+      // full scale square wave, the side channel needs all 17 bits
+      frame.left = (i / 7) % 2 ? 32767 : -32768;
+      frame.right = (i / 7) % 2 ? -32768 : 32767;
+      break;
+    default:
+      // a constant left channel and quiet noise on the right one
+      frame.left = -1234;
+      frame.right = static_cast<int16_t>(noise( rng ) / 1024);
+      break;
+    }
+  }
+  return frames;
+}
+
+void checkEqual(const std::vector<BasicSampleFrame>& decoded, const std::vector<BasicSampleFrame>& expected)
+{
+  BOOST_REQUIRE_EQUAL( decoded.size(), expected.size() );
+  for( size_t i = 0; i < expected.size(); i++ )
+  {
+    if( decoded[i].left != expected[i].left || decoded[i].right != expected[i].right )
+    {
+      BOOST_ERROR( "sample frame " << i << " differs" );
+      return;
+    }
+  }
+}
+
+//! @brief Plays the test signal and then runs dry
+class SignalSource
+  : public AbstractAudioSource
+{
+public:
+  explicit SignalSource(const std::vector<BasicSampleFrame>& signal)
+    : AbstractAudioSource(), m_signal( signal )
+  {
+  }
+
+private:
+  const std::vector<BasicSampleFrame>& m_signal;
+  size_t m_pos = 0;
+
+  size_t internal_getAudioData(BasicSampleFrame* buffer, size_t requestedFrames) override
+  {
+    const size_t count = std::min( requestedFrames, m_signal.size() - m_pos );
+    std::copy_n( m_signal.begin() + m_pos, count, buffer );
+    m_pos += count;
+    return count;
+  }
+
+  size_t internal_preferredBufferSize() const override
+  {
+    // not a divisor of the FLAC block size
+    return 1000;
+  }
+
+  bool internal_initialize(uint32_t) override
+  {
+    return true;
+  }
+};
+
+/**
+ * @brief Encode the signal to a file with FlacAudioOutput
+ * @return The file contents
+ */
+std::vector<uint8_t> encodeFile(const std::vector<BasicSampleFrame>& signal, uint32_t sampleRate, size_t jobs)
+{
+  const std::string filename = ( boost::filesystem::temp_directory_path() / boost::filesystem::unique_path() ).string();
+  {
+    auto source = std::make_shared<SignalSource>( signal );
+    BOOST_REQUIRE( source->initialize( sampleRate ) );
+    FlacAudioOutput output( source, filename, jobs );
+    output.setMeta( "title", "album", "artist" );
+    BOOST_REQUIRE_EQUAL( output.init( sampleRate ), static_cast<int>(sampleRate) );
+    output.play();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 60 );
+    while( output.errorCode() != AbstractAudioOutput::InputDry )
+    {
+      BOOST_REQUIRE( std::chrono::steady_clock::now() < deadline );
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+  }
+  std::ifstream file( filename, std::ios::binary );
+  std::vector<uint8_t> data( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+  file.close();
+  boost::filesystem::remove( filename );
+  return data;
+}
+}
+
+BOOST_AUTO_TEST_CASE( Md5Vectors )
+{
+  BOOST_CHECK_EQUAL( md5( "" ), "d41d8cd98f00b204e9800998ecf8427e" );
+  BOOST_CHECK_EQUAL( md5( "abc" ), "900150983cd24fb0d6963f7d28e17f72" );
+  BOOST_CHECK_EQUAL( md5( "message digest" ), "f96b697d7cb7938d525a2f31aaf161d0" );
+  BOOST_CHECK_EQUAL( md5( "12345678901234567890123456789012345678901234567890123456789012345678901234567890" ),
+                     "57edf4a22be3c955ac49da2e2107b67a" );
+
+  // sample frames are signed as interleaved little-endian values, independent of the chunking
+  const std::vector<BasicSampleFrame> signal = testSignal( 1001 );
+  std::string bytes;
+  for( const BasicSampleFrame& frame: signal )
+  {
+    for( int16_t sample: { frame.left, frame.right } )
+    {
+      bytes += static_cast<char>(sample & 0xff);
+      bytes += static_cast<char>((sample >> 8) & 0xff);
+    }
+  }
+  flac::Md5 chunked;
+  for( size_t i = 0; i < signal.size(); i += 13 )
+  {
+    chunked.update( signal.data() + i, std::min<size_t>( 13, signal.size() - i ) );
+  }
+  BOOST_CHECK_EQUAL( hex( chunked.finish() ), md5( bytes ) );
+}
+
+BOOST_AUTO_TEST_CASE( RoundTrip )
+{
+  const std::vector<BasicSampleFrame> signal = testSignal( 5 * flac::BlockFrames + 123 );
+  flac::StreamInfo info;
+  info.sampleRate = 22050;
+  std::vector<uint8_t> data = flac::streamHeader( info, {} );
+  flac::Md5 md5;
+  for( size_t pos = 0; pos < signal.size(); pos += flac::BlockFrames )
+  {
+    const size_t count = std::min( flac::BlockFrames, signal.size() - pos );
+    const std::vector<uint8_t> frame = flac::encodeFrame( signal.data() + pos, count, info.sampleRate, static_cast<uint32_t>(pos / flac::BlockFrames) );
+    info.minFrameBytes = info.minFrameBytes == 0 ? frame.size() : std::min<uint32_t>( info.minFrameBytes, frame.size() );
+    info.maxFrameBytes = std::max<uint32_t>( info.maxFrameBytes, frame.size() );
+    data.insert( data.end(), frame.begin(), frame.end() );
+    md5.update( signal.data() + pos, count );
+  }
+  info.totalFrames = signal.size();
+  info.md5 = md5.finish();
+  const std::vector<uint8_t> block = flac::streamInfo( info, false );
+  std::copy( block.begin(), block.end(), data.begin() + 4 );
+
+  Decoder decoder( data );
+  decoder.decode();
+  BOOST_CHECK_EQUAL( decoder.info.sampleRate, info.sampleRate );
+  BOOST_CHECK_EQUAL( decoder.info.totalFrames, signal.size() );
+  checkEqual( decoder.frames, signal );
+  flac::Md5 decodedMd5;
+  decodedMd5.update( decoder.frames.data(), decoder.frames.size() );
+  BOOST_CHECK_EQUAL( hex( decodedMd5.finish() ), hex( decoder.info.md5 ) );
+}
+
+BOOST_AUTO_TEST_CASE( SerialAndParallelOutput )
+{
+  const std::vector<BasicSampleFrame> signal = testSignal( 7 * flac::BlockFrames + 500 );
+  const std::vector<uint8_t> serial = encodeFile( signal, 44100, 1 );
+  const std::vector<uint8_t> parallel = encodeFile( signal, 44100, 3 );
+  BOOST_CHECK( serial == parallel );
+
+  Decoder decoder( parallel );
+  decoder.decode();
+  BOOST_CHECK_EQUAL( decoder.info.sampleRate, 44100u );
+  BOOST_CHECK_EQUAL( decoder.info.totalFrames, signal.size() );
+  checkEqual( decoder.frames, signal );
+  flac::Md5 md5;
+  md5.update( signal.data(), signal.size() );
+  BOOST_CHECK_EQUAL( hex( decoder.info.md5 ), hex( md5.finish() ) );
+}
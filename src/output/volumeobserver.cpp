@@ -1,9 +1,34 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2013  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
 #include "volumeobserver.h"
 
-#include "audiofifo.h"
+#include "analysisring.h"
 
 #include <boost/assert.hpp>
-#include <functional>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace
 {
@@ -11,7 +36,6 @@ namespace
  * @brief Makes volume values logarithmic
  * @param[in] value Volume to make logarithmic
  * @return A more "natural" feeling value
- * @see AudioFifo::calcVolume()
  */
 uint16_t logify(uint16_t value)
 {
@@ -25,64 +49,85 @@ uint16_t logify(uint16_t value)
   return tmp > 0xffff ? 0xffff : tmp;
 }
 
+struct Levels
+{
+  uint64_t squaresLeft = 0;
+  uint64_t squaresRight = 0;
+  int peakLeft = 0;
+  int peakRight = 0;
+};
+
 /**
- * @brief Sums up the absolute sample values of an AudioFrameBuffer
- * @param[in] buf The buffer with the values to sum up
- * @param[out] left Sum of absolute left sample values
- * @param[out] right Sum of absolute right sample values
+ * @brief Sums up the squares and finds the absolute peaks of both channels
  */
-void sumAbsValues(const AudioFrameBufferPtr& buf, uint64_t& left, uint64_t& right)
+Levels measure(const BasicSampleFrame* frames, size_t count)
 {
-  left = right = 0;
-  for( const BasicSampleFrame& frame: *buf )
+  Levels levels;
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i leftMask = _mm_set1_epi32( 0x0000ffff );
+  __m128i peak = zero;
+  __m128i squaresLeft = zero;
+  __m128i squaresRight = zero;
+  for( ; i + 4 <= count; i += 4 )
+  {
+    // 4 frames, lanes alternate between left and right
+    const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>(frames + i) );
+    // the saturating negation maps -32768 to 32767
+    peak = _mm_max_epi16( peak, _mm_max_epi16( v, _mm_subs_epi16( zero, v ) ) );
+    // each product pair holds a single channel, the other one is multiplied by 0
+    const __m128i left = _mm_madd_epi16( v, _mm_and_si128( v, leftMask ) );
+    const __m128i right = _mm_madd_epi16( v, _mm_andnot_si128( leftMask, v ) );
+    squaresLeft = _mm_add_epi64( squaresLeft, _mm_add_epi64( _mm_unpacklo_epi32( left, zero ), _mm_unpackhi_epi32( left, zero ) ) );
+    squaresRight = _mm_add_epi64( squaresRight, _mm_add_epi64( _mm_unpacklo_epi32( right, zero ), _mm_unpackhi_epi32( right, zero ) ) );
+  }
+  alignas(16) int16_t peaks[8];
+  alignas(16) uint64_t sums[2];
+  _mm_store_si128( reinterpret_cast<__m128i*>(peaks), peak );
+  for( int lane = 0; lane < 8; lane += 2 )
+  {
+    levels.peakLeft = std::max<int>( levels.peakLeft, peaks[lane] );
+    levels.peakRight = std::max<int>( levels.peakRight, peaks[lane + 1] );
+  }
+  _mm_store_si128( reinterpret_cast<__m128i*>(sums), squaresLeft );
+  levels.squaresLeft = sums[0] + sums[1];
+  _mm_store_si128( reinterpret_cast<__m128i*>(sums), squaresRight );
+  levels.squaresRight = sums[0] + sums[1];
+#endif
+  for( ; i < count; i++ )
   {
-    left += std::abs( frame.left );
-    right += std::abs( frame.right );
+    levels.peakLeft = std::max( levels.peakLeft, std::min( 32767, std::abs( frames[i].left ) ) );
+    levels.peakRight = std::max( levels.peakRight, std::min( 32767, std::abs( frames[i].right ) ) );
+    levels.squaresLeft += frames[i].left * frames[i].left;
+    levels.squaresRight += frames[i].right * frames[i].right;
   }
+  return levels;
 }
 }
 
-VolumeObserver::VolumeObserver(AudioFifo* fifo)
-  : m_volLeftSum( 0 ), m_volLeftLog( 0 ), m_volRightSum( 0 ), m_volRightLog( 0 ), m_fifo( fifo )
-  , m_dataPushedConnection(), m_dataPulledConnection()
+VolumeObserver::VolumeObserver(const AnalysisRing* ring)
+  : m_volLeftLog( 0 ), m_volRightLog( 0 ), m_peakLeftLog( 0 ), m_peakRightLog( 0 ), m_ring( ring )
+  , m_buffer( Window ), m_lastWritten( 0 )
 {
-  BOOST_ASSERT( fifo != nullptr );
-  m_dataPushedConnection = m_fifo->dataPushed.connect( [this](const auto& x) {
-    dataPushed( x );
-  } );
-  m_dataPulledConnection = m_fifo->dataPulled.connect( [this](const auto& x) { dataPulled( x ); } );
+  BOOST_ASSERT( ring != nullptr );
 }
 
-void VolumeObserver::dataPulled(const AudioFrameBufferPtr& buffer)
+void VolumeObserver::update()
 {
-  uint64_t left = 0, right = 0;
-  sumAbsValues( buffer, left, right );
-  m_volLeftSum -= left;
-  m_volRightSum -= right;
-  if( m_fifo->queuedLength() < 4 )
+  const size_t written = m_ring->written();
+  if( written == m_lastWritten )
   {
-    m_volLeftLog = m_volRightLog = 0;
+    return;
   }
-  else
+  m_lastWritten = written;
+  if( !m_ring->readLatest( m_buffer.data(), m_buffer.size() ) )
   {
-    m_volLeftLog = logify( m_volLeftSum / (m_fifo->queuedLength() >> 2) );
-    m_volRightLog = logify( m_volRightSum / (m_fifo->queuedLength() >> 2) );
+    return;
   }
+  const Levels levels = measure( m_buffer.data(), m_buffer.size() );
+  m_volLeftLog = logify( static_cast<uint16_t>(std::sqrt( levels.squaresLeft / Window )) );
+  m_volRightLog = logify( static_cast<uint16_t>(std::sqrt( levels.squaresRight / Window )) );
+  m_peakLeftLog = logify( levels.peakLeft );
+  m_peakRightLog = logify( levels.peakRight );
 }
-
-void VolumeObserver::dataPushed(const AudioFrameBufferPtr& buffer)
-{
-  uint64_t left = 0, right = 0;
-  sumAbsValues( buffer, left, right );
-  m_volLeftSum += left;
-  m_volRightSum += right;
-  if( m_fifo->queuedLength() < 4 )
-  {
-    m_volLeftLog = m_volRightLog = 0;
-  }
-  else
-  {
-    m_volLeftLog = logify( m_volLeftSum / (m_fifo->queuedLength() >> 2) );
-    m_volRightLog = logify( m_volRightSum / (m_fifo->queuedLength() >> 2) );
-  }
-}
\ No newline at end of file
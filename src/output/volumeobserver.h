@@ -21,9 +21,10 @@
 
 #include "audiotypes.h"
 #include <stuff/utils.h>
-#include <boost/signals2/connection.hpp>
 
-class AudioFifo;
+#include <atomic>
+
+class AnalysisRing;
 
 /**
  * @ingroup Output
@@ -32,32 +33,42 @@ class AudioFifo;
 
 /**
  * @class VolumeObserver
- * @brief Observer for calculating the output peaks of an AudioFifo
+ * @brief Peak and RMS meters of the most recently played frames
  */
 class VolumeObserver
 {
 private:
-  //! @brief Sum of all left absolute sample values
-  uint64_t m_volLeftSum;
-  //! @brief Sum of all left absolute sample values (logarithmic)
-  uint16_t m_volLeftLog;
-
-  //! @brief Sum of all right absolute sample values
-  uint64_t m_volRightSum;
-  //! @brief Sum of all right absolute sample values (logarithmic)
-  uint16_t m_volRightLog;
-
-  //! @brief Observed FIFO
-  AudioFifo* m_fifo;
-  boost::signals2::scoped_connection m_dataPushedConnection;
-  boost::signals2::scoped_connection m_dataPulledConnection;
+  //! @brief Number of frames the meters are calculated from
+  static constexpr size_t Window = 2048;
+
+  //! @brief RMS of the left channel (logarithmic)
+  std::atomic<uint16_t> m_volLeftLog;
+  //! @brief RMS of the right channel (logarithmic)
+  std::atomic<uint16_t> m_volRightLog;
+  //! @brief Peak of the left channel (logarithmic)
+  std::atomic<uint16_t> m_peakLeftLog;
+  //! @brief Peak of the right channel (logarithmic)
+  std::atomic<uint16_t> m_peakRightLog;
+
+  //! @brief Observed frames
+  const AnalysisRing* m_ring;
+  AudioFrameBuffer m_buffer;
+  //! @brief Value of AnalysisRing::written() at the last update
+  size_t m_lastWritten;
 public:
   DISABLE_COPY( VolumeObserver )
 
-  explicit VolumeObserver(AudioFifo* fifo);
+  explicit VolumeObserver(const AnalysisRing* ring);
 
   ~VolumeObserver() = default;
 
+  /**
+   * @brief Recalculate the meters if new frames were played
+   * @note Meant to be called at display rate from a single thread; the values
+   *       may be read from any thread
+   */
+  void update();
+
   inline uint16_t leftVol() const
   {
     return m_volLeftLog;
@@ -68,10 +79,15 @@ public:
     return m_volRightLog;
   }
 
-private:
-  void dataPulled(const AudioFrameBufferPtr& buffer);
+  inline uint16_t leftPeak() const
+  {
+    return m_peakLeftLog;
+  }
 
-  void dataPushed(const AudioFrameBufferPtr& buffer);
+  inline uint16_t rightPeak() const
+  {
+    return m_peakRightLog;
+  }
 };
 
 /**
@@ -18,6 +18,8 @@
 
 #include "wavaudiooutput.h"
 
+#include "stuff/profiler.h"
+
 #include <boost/format.hpp>
 #include <chrono>
 
@@ -44,6 +46,7 @@ void WavAudioOutput::encodeThread()
       pause();
       return;
     }
+    ppp::profile::ScopedTimer timer( ppp::profile::Stage::Encode );
     m_file.write( reinterpret_cast<const char*>(&buffer->front()), buffer->size() * sizeof( BasicSampleFrame ) );
   }
 }
@@ -22,6 +22,7 @@
 #include "abstractaudiooutput.h"
 
 #include <fstream>
+#include <thread>
 
 /**
  * @ingroup Output
@@ -27,6 +27,9 @@
 
 #include <boost/format.hpp>
 
+#include <array>
+#include <limits>
+
 namespace
 {
 light4cxx::Logger* logger = light4cxx::Logger::get( "ppg.sdl" );
@@ -51,8 +54,73 @@ namespace
  *
  * This reduces the graphical overhead significantly.
  *
- * Please note that the layers are constantly locked.
+ * Only the bounding rectangles of the changed cells and of the drawn pixels are
+ * re-rendered. The layers are composed into a persistent target
+ * texture, so a frame without changes does not touch the renderer at all.
+ */
+/**
+ * @struct DirtyRect
+ * @brief Bounding rectangle of modified screen pixels
  */
+struct DirtyRect final
+{
+  int left = std::numeric_limits<int>::max();
+  int top = std::numeric_limits<int>::max();
+  int right = std::numeric_limits<int>::min();
+  int bottom = std::numeric_limits<int>::min();
+
+  bool isEmpty() const noexcept
+  {
+    return left >= right || top >= bottom;
+  }
+
+  void reset() noexcept
+  {
+    *this = DirtyRect();
+  }
+
+  void add(int x, int y, int w, int h) noexcept
+  {
+    left = std::min( left, x );
+    top = std::min( top, y );
+    right = std::max( right, x + w );
+    bottom = std::max( bottom, y + h );
+  }
+
+  void add(const DirtyRect& rhs) noexcept
+  {
+    if( !rhs.isEmpty() )
+    {
+      add( rhs.left, rhs.top, rhs.right - rhs.left, rhs.bottom - rhs.top );
+    }
+  }
+
+  SDL_Rect toSdl() const noexcept
+  {
+    return { left, top, right - left, bottom - top };
+  }
+};
+
+/**
+ * @struct LockedRect
+ * @brief Pixel access to a locked texture region
+ * @details
+ * Coordinates passed to at() are window coordinates, the offset of the locked region
+ * is taken into account.
+ */
+struct LockedRect final
+{
+  Uint32* pixels = nullptr;
+  int pitch = 0;
+  int originX = 0;
+  int originY = 0;
+
+  inline Uint32* at(int x, int y) const noexcept
+  {
+    return pixels + (y - originY) * pitch + (x - originX);
+  }
+};
+
 struct InstanceData final
 {
 private:
@@ -92,11 +160,6 @@ private:
   {
     Char chr{ ' ', Color::White, Color::Black };
     Char visible{ ' ', Color::White, Color::Black };
-
-    bool isDirty() const noexcept
-    {
-      return chr != visible;
-    }
   };
 
   std::vector<CharCell> chars{};
@@ -115,6 +178,20 @@ private:
   SDL_Texture* backgroundLayer = nullptr;
   SDL_Texture* pixelLayer = nullptr;
   SDL_Texture* foregroundLayer = nullptr;
+  //! @brief Persistent composition of the three layers, @c nullptr if render targets are not supported
+  SDL_Texture* composedLayer = nullptr;
+
+  //! @brief Pre-rendered 8x16 glyphs, each pixel is either 0 or ~0
+  std::vector<std::array<Uint32, 8 * 16>> glyphAtlas{};
+
+  //! @brief Pixel layer area that was modified since the last redraw
+  DirtyRect pixelsDirty{};
+  //! @brief Pixel layer area that contains non-transparent pixels
+  DirtyRect pixelsUsed{};
+  //! @brief Pixels drawn since lockPixels()
+  DirtyRect pixelsDrawn{};
+  //! @brief Set when the whole window needs to be composed again
+  bool fullRedraw = true;
 
 public:
   SDLScreen* screen = nullptr;
@@ -169,6 +246,11 @@ public:
     pixelLayer = nullptr;
     SDL_DestroyTexture( foregroundLayer );
     foregroundLayer = nullptr;
+    if( composedLayer != nullptr )
+    {
+      SDL_DestroyTexture( composedLayer );
+      composedLayer = nullptr;
+    }
 
     SDL_DestroyRenderer( mainRenderer );
     mainRenderer = nullptr;
@@ -185,28 +267,6 @@ private:
   int pixelLockPitch = -1;
   Uint32* pixelLockPixels = nullptr;
 
-  /**
-   * @brief Draw a pixel
-   * @param[in,out] surface Surface
-   * @param[in] x X position
-   * @param[in] y Y position
-   * @param[in] color %Screen color value
-   */
-  inline bool setPixel(SDL_Texture* texture, int x, int y, Uint32 color)
-  {
-    if( texture != nullptr && contains( x, y ) )
-    {
-      void* pixels;
-      int pitch;
-      if( SDL_LockTexture( texture, nullptr, &pixels, &pitch ) != 0 )
-        BOOST_THROW_EXCEPTION( std::runtime_error( "Failed to lock texture" ) );
-      setPixel( x, y, color, static_cast<Uint32*>(pixels), pitch );
-      SDL_UnlockTexture( texture );
-      return true;
-    }
-    return false;
-  }
-
   inline void setPixel(int x, int y, Uint32 color, Uint32* pixels, int pitch)
   {
     pixels[y * pitch / sizeof( Uint32 ) + x] = color;
@@ -215,7 +275,19 @@ private:
 public:
   void clearPixels(Color c = Color::None)
   {
+    if( c == Color::None && pixelsUsed.isEmpty() )
+    {
+      // nothing has been drawn since the last clear
+      return;
+    }
     clearTexture( pixelLayer, c );
+    pixelsDirty.add( pixelsUsed );
+    pixelsUsed.reset();
+    if( c != Color::None )
+    {
+      pixelsUsed.add( 0, 0, windowWidth, windowHeight );
+      pixelsDirty.add( pixelsUsed );
+    }
   }
 
   inline void setPixel(int x, int y, Color color)
@@ -234,6 +306,7 @@ public:
       BOOST_THROW_EXCEPTION( std::runtime_error( "Pixel data must be locked before updating" ) );
 
     setPixel( x, y, color, pixelLockPixels, pixelLockPitch );
+    pixelsDrawn.add( x, y, 1, 1 );
   }
 
   void lockPixels()
@@ -247,6 +320,9 @@ public:
     SDL_UnlockTexture( pixelLayer );
     pixelLockPixels = nullptr;
     pixelLockPitch = -1;
+    pixelsUsed.add( pixelsDrawn );
+    pixelsDirty.add( pixelsDrawn );
+    pixelsDrawn.reset();
   }
 
 private:
@@ -267,6 +343,43 @@ private:
     SDL_UnlockTexture( texture );
   }
 
+  LockedRect lockRect(SDL_Texture* texture, const SDL_Rect& rect) const
+  {
+    LockedRect result;
+    void* pixels;
+    if( SDL_LockTexture( texture, &rect, &pixels, &result.pitch ) != 0 )
+      BOOST_THROW_EXCEPTION( std::runtime_error( "Failed to lock texture" ) );
+    result.pixels = static_cast<Uint32*>(pixels);
+    result.pitch /= sizeof( Uint32 );
+    result.originX = rect.x;
+    result.originY = rect.y;
+    return result;
+  }
+
+  void buildGlyphAtlas()
+  {
+    glyphAtlas.resize( 256 );
+    for( size_t c = 0; c < 256; c++ )
+    {
+      for( int py = 0; py < 16; py++ )
+      {
+        for( int px = 0; px < 8; px++ )
+        {
+          glyphAtlas[c][py * 8 + px] = (plFont816[c][py] & (0x80 >> px)) ? ~Uint32( 0 ) : 0;
+        }
+      }
+    }
+  }
+
+  void renderCopy(SDL_Texture* texture, const SDL_Rect* rect)
+  {
+    if( SDL_RenderCopy( mainRenderer, texture, rect, rect ) != 0 )
+    {
+      logger->fatal( L4CXX_LOCATION, "SDL error: %s", SDL_GetError() );
+      BOOST_THROW_EXCEPTION( std::runtime_error( "Rendering failed" ) );
+    }
+  }
+
 public:
   bool init(int charWidth, int charHeight, const std::string& title);
 
@@ -285,27 +398,21 @@ private:
                        char c,
                        Uint32 foreground,
                        Uint32 background,
-                       Uint32* fgPixels,
-                       int fgPitch,
-                       Uint32* bgPixels,
-                       int bgPitch)
+                       const LockedRect& fg,
+                       const LockedRect& bg)
   {
     x <<= 3;
     y <<= 4;
-    for( int py = 0; py < 16; py++ )
+    const Uint32 transparent = mapColor( Color::None );
+    const Uint32* glyph = glyphAtlas[uint8_t( c )].data();
+    for( int py = 0; py < 16; py++, glyph += 8 )
     {
+      Uint32* fgRow = fg.at( x, y + py );
+      Uint32* bgRow = bg.at( x, y + py );
       for( int px = 0; px < 8; px++ )
       {
-        if( plFont816[uint8_t( c )][py] & (0x80 >> px) )
-        {
-          setPixel( x + px, y + py, foreground, fgPixels, fgPitch );
-        }
-        else
-        {
-          setPixel( x + px, y + py, mapColor( Color::None ), fgPixels, fgPitch );
-        }
-
-        setPixel( x + px, y + py, background, bgPixels, bgPitch );
+        fgRow[px] = (foreground & glyph[px]) | (transparent & ~glyph[px]);
+        bgRow[px] = background;
       }
     }
   }
@@ -314,6 +421,11 @@ public:
   void clear(char c, ppg::Color foreground, ppg::Color background);
 
   void redraw(bool showMouse, int cursorX, int cursorY);
+
+  void invalidate() noexcept
+  {
+    fullRedraw = true;
+  }
 };
 
 bool InstanceData::init(int charWidth, int charHeight, const std::string& title)
@@ -402,6 +514,18 @@ bool InstanceData::init(int charWidth, int charHeight, const std::string& title)
     BOOST_THROW_EXCEPTION( std::runtime_error( "Foreground Layer Initialization failed" ) );
   }
 
+  if( SDL_RenderTargetSupported( mainRenderer ) )
+  {
+    composedLayer =
+      SDL_CreateTexture( mainRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, windowWidth, windowHeight );
+  }
+  if( composedLayer == nullptr )
+  {
+    logger->info( L4CXX_LOCATION, "Render targets not available, composing the full window each frame" );
+  }
+
+  buildGlyphAtlas();
+
   dosColors[static_cast<int>(Color::None)] = 0x00000000; // transparent
   dosColors[static_cast<int>(Color::Black)] = 0x000000ff; // black
   dosColors[static_cast<int>(Color::Blue)] = 0x0000aaff; // blue
@@ -439,87 +563,99 @@ void InstanceData::clear(char c, ppg::Color foreground, ppg::Color background)
 
 void InstanceData::redraw(bool showMouse, int cursorX, int cursorY)
 {
-  void* fgPixels;
-  void* bgPixels;
-  int fgPitch;
-  int bgPitch;
-  if( SDL_LockTexture( foregroundLayer, nullptr, &fgPixels, &fgPitch ) != 0 )
-    BOOST_THROW_EXCEPTION( std::runtime_error( "Failed to lock foreground texture" ) );
-  if( SDL_LockTexture( backgroundLayer, nullptr, &bgPixels, &bgPitch ) != 0 )
-    BOOST_THROW_EXCEPTION( std::runtime_error( "Failed to lock background texture" ) );
-
-  {
-    // redraw the screen characters if changed
-    size_t ofs = 0;
-    for( size_t y = 0; y < charHeight; y++ )
+  if( !showMouse || !contains( cursorX * 8, cursorY * 16 ) )
+  {
+    cursorX = cursorY = -1;
+  }
+
+  // the cell below the mouse cursor is shown with inverted colors
+  const auto wanted = [this, cursorX, cursorY](int x, int y) -> Char
+  {
+    Char result = chars[x + y * charWidth].chr;
+    if( x == cursorX && y == cursorY )
+    {
+      result.foreground = ~result.foreground;
+      result.background = ~result.background;
+    }
+    return result;
+  };
+
+  // find the character cells that need to be updated
+  DirtyRect charsDirty;
+  for( size_t y = 0; y < charHeight; y++ )
+  {
+    for( size_t x = 0; x < charWidth; x++ )
     {
-      for( size_t x = 0; x < charWidth; x++, ofs++ )
+      if( wanted( x, y ) != chars[x + y * charWidth].visible )
       {
-        if( chars[ofs].isDirty() )
-        {
-          drawChar( x,
-                    y,
-                    chars[ofs].chr.chr,
-                    mapColor( chars[ofs].chr.foreground ),
-                    mapColor( chars[ofs].chr.background ),
-                    static_cast<Uint32*>(fgPixels),
-                    fgPitch,
-                    static_cast<Uint32*>(bgPixels),
-                    bgPitch );
-          chars[ofs].visible = chars[ofs].chr;
-        }
+        charsDirty.add( x, y, 1, 1 );
       }
     }
   }
 
-  // show the mouse cursor if applicable
-  if( showMouse && contains( cursorX, cursorY ) )
+  DirtyRect dirty;
+  if( !charsDirty.isEmpty() )
   {
-    size_t ofs = cursorX + cursorY * charWidth;
-    Uint32 c1 = mapColor( ~chars[ofs].visible.foreground );
-    Uint32 c2 = mapColor( ~chars[ofs].visible.background );
-    drawChar( cursorX,
-              cursorY,
-              chars[ofs].chr.chr,
-              c1,
-              c2,
-              static_cast<Uint32*>(fgPixels),
-              fgPitch,
-              static_cast<Uint32*>(bgPixels),
-              bgPitch );
-    chars[ofs].visible.foreground = ~chars[ofs].chr.foreground;
-    chars[ofs].visible.background = ~chars[ofs].chr.background;
-  }
+    const SDL_Rect rect{ charsDirty.left * 8, charsDirty.top * 16,
+                         (charsDirty.right - charsDirty.left) * 8, (charsDirty.bottom - charsDirty.top) * 16 };
+    const LockedRect fg = lockRect( foregroundLayer, rect );
+    const LockedRect bg = lockRect( backgroundLayer, rect );
 
-  SDL_UnlockTexture( foregroundLayer );
-  SDL_UnlockTexture( backgroundLayer );
+    for( int y = charsDirty.top; y < charsDirty.bottom; y++ )
+    {
+      for( int x = charsDirty.left; x < charsDirty.right; x++ )
+      {
+        const Char chr = wanted( x, y );
+        Char& visible = chars[x + y * charWidth].visible;
+        if( chr != visible )
+        {
+          drawChar( x, y, chr.chr, mapColor( chr.foreground ), mapColor( chr.background ), fg, bg );
+          visible = chr;
+        }
+      }
+    }
 
-  // now blit the background, pixels, and foreground (in that order) to the screen
-  if( SDL_SetRenderDrawColor( mainRenderer, 0, 0, 0, SDL_ALPHA_OPAQUE ) != 0 )
+    SDL_UnlockTexture( foregroundLayer );
+    SDL_UnlockTexture( backgroundLayer );
+    dirty.add( rect.x, rect.y, rect.w, rect.h );
+  }
+
+  dirty.add( pixelsDirty );
+  pixelsDirty.reset();
+  if( fullRedraw )
   {
-    logger->fatal( L4CXX_LOCATION, "SDL error: %s", SDL_GetError() );
-    BOOST_THROW_EXCEPTION( std::runtime_error( "Rendering failed" ) );
+    dirty.add( 0, 0, windowWidth, windowHeight );
+    fullRedraw = false;
   }
-  if( SDL_RenderClear( mainRenderer ) != 0 )
+  if( dirty.isEmpty() )
   {
-    logger->fatal( L4CXX_LOCATION, "SDL error: %s", SDL_GetError() );
-    BOOST_THROW_EXCEPTION( std::runtime_error( "Rendering failed" ) );
+    // nothing changed, so the last presented frame is still valid
+    return;
   }
-
-  if( SDL_RenderCopy( mainRenderer, backgroundLayer, nullptr, nullptr ) != 0 )
+  if( composedLayer == nullptr )
   {
-    logger->fatal( L4CXX_LOCATION, "SDL error: %s", SDL_GetError() );
-    BOOST_THROW_EXCEPTION( std::runtime_error( "Rendering failed" ) );
+    // without a persistent target the back buffer must be rebuilt completely
+    dirty.add( 0, 0, windowWidth, windowHeight );
   }
-  if( SDL_RenderCopy( mainRenderer, pixelLayer, nullptr, nullptr ) != 0 )
+
+  // compose the background, pixels, and foreground (in that order)
+  const SDL_Rect rect = dirty.toSdl();
+  if( composedLayer != nullptr && SDL_SetRenderTarget( mainRenderer, composedLayer ) != 0 )
   {
     logger->fatal( L4CXX_LOCATION, "SDL error: %s", SDL_GetError() );
     BOOST_THROW_EXCEPTION( std::runtime_error( "Rendering failed" ) );
   }
-  if( SDL_RenderCopy( mainRenderer, foregroundLayer, nullptr, nullptr ) != 0 )
+  renderCopy( backgroundLayer, &rect );
+  renderCopy( pixelLayer, &rect );
+  renderCopy( foregroundLayer, &rect );
+  if( composedLayer != nullptr )
   {
-    logger->fatal( L4CXX_LOCATION, "SDL error: %s", SDL_GetError() );
-    BOOST_THROW_EXCEPTION( std::runtime_error( "Rendering failed" ) );
+    if( SDL_SetRenderTarget( mainRenderer, nullptr ) != 0 )
+    {
+      logger->fatal( L4CXX_LOCATION, "SDL error: %s", SDL_GetError() );
+      BOOST_THROW_EXCEPTION( std::runtime_error( "Rendering failed" ) );
+    }
+    renderCopy( composedLayer, nullptr );
   }
 
   SDL_RenderPresent( mainRenderer );
@@ -565,6 +701,12 @@ void SDLScreen::drawThis()
   instanceData.redraw( hasMouseFocus(), m_cursorX, m_cursorY );
 }
 
+void SDLScreen::invalidate()
+{
+  LockGuard guard(this);
+  instanceData.invalidate();
+}
+
 void SDLScreen::drawChar(int x, int y, char c)
 {
   LockGuard guard(this);
@@ -67,6 +67,13 @@ public:
    */
   void clear(uint8_t c, Color foreground, Color background);
 
+  /**
+   * @brief Compose the whole window again with the next redraw
+   * @note Needed when the presented contents were lost, e.g. when the window
+   *       was uncovered or the render targets were reset.
+   */
+  void invalidate();
+
   void drawChar(int x, int y, char c) override;
 
   void drawPixel(int x, int y, Color c);
@@ -32,6 +32,7 @@
 #include "s3mcell.h"
 
 #include "stream/stream.h"
+#include "stuff/profiler.h"
 
 namespace ppp
 {
@@ -85,6 +86,33 @@ struct S3mModuleHeader
   uint8_t pannings[32];//!< @brief Channel pannings
 };
 #pragma pack(pop)
+
+inline std::string trackerName(uint16_t createdWith)
+{
+  std::string result;
+  switch( (createdWith >> 12) & 0x0f )
+  {
+  case s3mTIdScreamTracker:
+    result = "ScreamTracker v";
+    break;
+  case s3mTIdImagoOrpheus:
+    result = "Imago Orpheus v";
+    break;
+  case s3mTIdImpulseTracker:
+    result = "Impulse Tracker v";
+    break;
+    // the following IDs were found in the Schism Tracker sources
+  case s3mTIdSchismTracker:
+    result = "Schism Tracker v";
+    break;
+  case s3mTIdOpenMPT:
+    result = "OpenMPT v";
+    break;
+  default:
+    result = stringFmt( "Unknown Tracker (%x) v", createdWith >> 12 );
+  }
+  return result + stringFmt( "%x.%02x", (createdWith >> 8) & 0x0f, createdWith & 0xff );
+}
 #endif
 
 S3mModule::S3mModule(int maxRpt, Sample::Interpolation inter)
@@ -179,31 +207,9 @@ bool S3mModule::load(Stream* stream)
     {
       logger()->debug( L4CXX_LOCATION, "Default Pannings present" );
     }
-    bool schismTest = false;
-    switch( (s3mHdr.createdWith >> 12) & 0x0f )
-    {
-    case s3mTIdScreamTracker:
-      noConstMetaInfo().trackerInfo = "ScreamTracker v";
-      break;
-    case s3mTIdImagoOrpheus:
-      noConstMetaInfo().trackerInfo = "Imago Orpheus v";
-      break;
-    case s3mTIdImpulseTracker:
-      noConstMetaInfo().trackerInfo = "Impulse Tracker v";
-      break;
-      // the following IDs were found in the Schism Tracker sources
-    case s3mTIdSchismTracker:
-      noConstMetaInfo().trackerInfo = "Schism Tracker v";
-      schismTest = true;
-      break;  // some versions of Schism Tracker use ID 1
-    case s3mTIdOpenMPT:
-      noConstMetaInfo().trackerInfo = "OpenMPT v";
-      break;
-    default:
-      noConstMetaInfo().trackerInfo = stringFmt( "Unknown Tracker (%x) v", s3mHdr.createdWith >> 12 );
-    }
-    noConstMetaInfo().trackerInfo +=
-      stringFmt( "%x.%02x", (s3mHdr.createdWith >> 8) & 0x0f, s3mHdr.createdWith & 0xff );
+    noConstMetaInfo().trackerInfo = trackerName( s3mHdr.createdWith );
+    // some versions of Schism Tracker use ID 1
+    bool schismTest = ((s3mHdr.createdWith >> 12) & 0x0f) == s3mTIdSchismTracker;
     setTempo( s3mHdr.initialTempo );
     //m_playbackInfo.speed = s3mHdr.initialSpeed;
     setSpeed( s3mHdr.initialSpeed );
@@ -373,6 +379,61 @@ bool S3mModule::load(Stream* stream)
   }
 }
 
+std::unique_ptr<AbstractModule::ProbeInfo> S3mModule::probe(Stream* stream)
+{
+  stream->seek( 0 );
+  S3mModuleHeader s3mHdr;
+  *stream >> s3mHdr;
+  if( !stream->good() || !std::equal( s3mHdr.id, s3mHdr.id + 4, "SCRM" ) )
+  {
+    return nullptr;
+  }
+  s3mHdr.ordNum &= 0xff;
+  s3mHdr.patNum &= 0xff;
+  s3mHdr.smpNum &= 0xff;
+
+  auto result = std::make_unique<ProbeInfo>();
+  result->filename = stream->name();
+  result->format = "s3m";
+  result->title = stringncpy( s3mHdr.title, 28 );
+  result->trackerInfo = trackerName( s3mHdr.createdWith );
+  for( int i = 0; i < 32; i++ )
+  {
+    if( (s3mHdr.pannings[i] & 0x80) == 0 )
+    {
+      result->channels = i + 1;
+    }
+  }
+  result->orders = s3mHdr.ordNum;
+  result->patterns = s3mHdr.patNum;
+  result->samples = s3mHdr.smpNum;
+
+  stream->seek( 0x60 + s3mHdr.ordNum );
+  const auto sampleOffsets = stream->readVector<ParaPointer>( s3mHdr.smpNum );
+  if( !stream->good() )
+  {
+    return nullptr;
+  }
+  for( const auto pp: sampleOffsets )
+  {
+    if( pp == 0 )
+    {
+      result->sampleNames.emplace_back();
+      continue;
+    }
+    // the title is located at offset 0x30 of the sample header
+    stream->seek( pp * 16 + 0x30 );
+    char title[28];
+    stream->read( title, 28 );
+    if( !stream->good() )
+    {
+      return nullptr;
+    }
+    result->sampleNames.emplace_back( stringncpy( title, 28 ) );
+  }
+  return result;
+}
+
 bool S3mModule::existsSample(int16_t idx)
 {
   idx--;
@@ -615,14 +676,22 @@ try
   if( buffer )
   {
     MixerFrameBufferPtr mixerBuffer = std::make_shared<MixerFrameBuffer>( tickBufferLength() );
+    profile::count( profile::Counter::AnnotatedAllocations );
     for( int currTrack = 0; currTrack < channelCount(); currTrack++ )
     {
       const auto& chan = m_channels[currTrack];
       BOOST_ASSERT( chan != nullptr );
       const S3mCell& cell = currPat->at( currTrack, state().row );
-      chan->update( cell, m_patDelayCount != -1, false );
-      chan->mixTick( mixerBuffer );
+      {
+        profile::ScopedTimer timer( profile::Stage::Update );
+        chan->update( cell, m_patDelayCount != -1, false );
+      }
+      {
+        profile::ScopedTimer timer( profile::Stage::Mix );
+        chan->mixTick( mixerBuffer );
+      }
     }
+    profile::ScopedTimer timer( profile::Stage::PostProcess );
     buffer->resize( mixerBuffer->size() );
     MixerSampleFrame* mixerBufferPtr = &mixerBuffer->front();
     BasicSampleFrame* bufPtr = &buffer->front();
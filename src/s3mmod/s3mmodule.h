@@ -69,6 +69,13 @@ public:
                                                  int maxRpt,
                                                  Sample::Interpolation inter);
 
+  /**
+   * @brief Read the module's meta information without loading it
+   * @param[in] stream Module stream
+   * @return Meta information or nullptr if the stream does not contain an S3M module
+   */
+  static std::unique_ptr<ProbeInfo> probe(Stream* stream);
+
 private:
   uint16_t m_breakRow;      //!< @brief Row to break to, ~0 if unused
   uint16_t m_breakOrder;    //!< @brief Order to break to, ~0 if unused
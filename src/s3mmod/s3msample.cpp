@@ -24,6 +24,7 @@
 #include <boost/exception/all.hpp>
 
 #include "s3msample.h"
+#include "genmod/sampledecoder.h"
 #include "stream/stream.h"
 
 namespace ppp
@@ -127,70 +128,30 @@ bool S3mSample::load(Stream* str, size_t pos, bool imagoLoopEnd)
       logger()->warn( L4CXX_LOCATION, "Seek failed or length is zero, assuming empty." );
       return true;
     }
-    if( smpHdr.flags & static_cast<uint8_t>(s3mFlagSmp16bit) )
+    const bool is16bit = (smpHdr.flags & static_cast<uint8_t>(s3mFlagSmp16bit)) != 0;
+    if( is16bit )
     {
       logger()->info( L4CXX_LOCATION, "Loading 16-bit sample" );
       m_highQuality = true;
-      uint16_t smp16;
-      auto smpPtr = beginIterator();
-      for( size_t i = 0; i < length(); i++ )
-      {
-        if( !(*str >> smp16) )
-        {
-          logger()->warn( L4CXX_LOCATION, "EOF reached before Sample Data read completely, assuming zeroes." );
-          return true;
-        }
-        smpPtr->left = smpPtr->right =
-          clip( smp16 - 32768, -32767, 32767 );   // negating -32768 fails otherwise in surround mode
-        ++smpPtr;
-      }
-      if( loadStereo )
-      {
-        logger()->info( L4CXX_LOCATION, "Loading Stereo..." );
-        smpPtr = beginIterator();
-        for( size_t i = 0; i < length(); i++ )
-        {
-          if( !(*str >> smp16) )
-          {
-            logger()->warn( L4CXX_LOCATION, "EOF reached before Sample Data read completely, assuming zeroes." );
-            return true;
-          }
-          smpPtr->right = clip( smp16 - 32768, -32767, 32767 );   // negating -32768 fails otherwise in surround mode
-          ++smpPtr;
-        }
-      }
     }
     else
-    { // convert 8-bit samples to 16-bit ones
+    {
       logger()->info( L4CXX_LOCATION, "Loading 8-bit sample" );
-      uint8_t smp8;
-      auto smpPtr = beginIterator();
-      for( size_t i = 0; i < length(); i++ )
-      {
-        if( !(*str >> smp8) )
-        {
-          logger()->warn( L4CXX_LOCATION, "EOF reached before Sample Data read completely, assuming zeroes." );
-          return true;
-        }
-        smpPtr->left = smpPtr->right =
-          clip( (smp8 - 128) << 8, -32767, 32767 );   // negating -32768 fails otherwise in surround mode
-        ++smpPtr;
-      }
-      if( loadStereo )
+    }
+    const auto format = is16bit ? sampledecoder::Format::Unsigned16 : sampledecoder::Format::Unsigned8;
+    // negating -32768 fails otherwise in surround mode
+    const bool symmetric = true;
+    if( sampledecoder::decode( *str, format, data(), length(), sampledecoder::Target::Both, symmetric ) < length() )
+    {
+      logger()->warn( L4CXX_LOCATION, "EOF reached before Sample Data read completely, assuming zeroes." );
+      return true;
+    }
+    if( loadStereo )
+    {
+      logger()->info( L4CXX_LOCATION, "Loading Stereo..." );
+      if( sampledecoder::decode( *str, format, data(), length(), sampledecoder::Target::Right, symmetric ) < length() )
       {
-        logger()->info( L4CXX_LOCATION, "Loading Stereo..." );
-        smpPtr = beginIterator();
-        for( size_t i = 0; i < length(); i++ )
-        {
-          if( !(*str >> smp8) )
-          {
-            logger()->warn( L4CXX_LOCATION, "EOF reached before Sample Data read completely, assuming zeroes." );
-            return true;
-          }
-          smpPtr->right =
-            clip( (smp8 - 128) << 8, -32767, 32767 );   // negating -32768 fails otherwise in surround mode
-          ++smpPtr;
-        }
+        logger()->warn( L4CXX_LOCATION, "EOF reached before Sample Data read completely, assuming zeroes." );
       }
     }
     return true;
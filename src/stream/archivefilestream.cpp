@@ -17,10 +17,8 @@
 */
 
 #include "archivefilestream.h"
-
-#include <archive.h>
-#include <archive_entry.h>
-#include <sstream>
+#include "archiveindex.h"
+#include "mappedfile.h"
 
 #include <boost/filesystem.hpp>
 
@@ -35,7 +33,21 @@ light4cxx::Logger* logger()
 }
 
 ArchiveFileStream::ArchiveFileStream(const std::string& filename)
-  : MemoryStream( filename ), m_isOpen( false )
+  : ArchiveFileStream( extract( filename ) )
+{
+}
+
+ArchiveFileStream::ArchiveFileStream(const std::string& name, std::vector<uint8_t>&& contents)
+  : MappedStream( std::make_shared<const MappedFile>( std::move( contents ) ), name )
+{
+}
+
+ArchiveFileStream::ArchiveFileStream(Extracted&& extracted)
+  : MappedStream( extracted.file, extracted.name )
+{
+}
+
+ArchiveFileStream::Extracted ArchiveFileStream::extract(const std::string& filename)
 {
   boost::filesystem::path zipPath( filename );
   boost::filesystem::path zipFilePath;
@@ -47,49 +59,34 @@ ArchiveFileStream::ArchiveFileStream(const std::string& filename)
   if( !boost::filesystem::is_regular_file( zipPath ) )
   {
     logger()->warn( L4CXX_LOCATION, "Failed to open '%s'", filename );
-    return;
+    return { nullptr, filename };
   }
   logger()->trace( L4CXX_LOCATION,
-                   "Decomposed '%s': ZIP '%s', File '%s', using %s",
+                   "Decomposed '%s': ZIP '%s', File '%s'",
                    filename,
                    zipPath.string(),
-                   zipFilePath.string(),
-                   archive_version_string() );
+                   zipFilePath.string() );
 
-  archive* arch = archive_read_new();
-  archive_read_support_format_all( arch );
-  archive_read_support_filter_all( arch );
-#ifdef BOOST_WINDOWS_API
-  char arcPath[260];
-  wcstombs( arcPath, zipPath.c_str(), 260 );
-  if( ARCHIVE_OK == archive_read_open_filename( arch, arcPath, 1 << 16 ) )
+  const auto index = ArchiveIndex::get( zipPath.string() );
+  if( !index )
   {
-#else
-    if(ARCHIVE_OK == archive_read_open_filename(arch, zipPath.c_str(), 1 << 16))
-    {
-#endif
-    logger()->trace( L4CXX_LOCATION, "Opened '%s'", filename );
-    archive_entry* entry;
-    while( ARCHIVE_OK == archive_read_next_header( arch, &entry ) )
-    {
-      boost::filesystem::path current( archive_entry_pathname( entry ) );
-      if( zipFilePath == "." || current == zipFilePath )
-      {
-        setName( current.string() );
-        auto str = static_cast<std::stringstream*>(stream());
-        auto size = archive_entry_size( entry );
-        std::vector<char> data( size );
-        archive_read_data( arch, data.data(), size );
-        str->write( data.data(), size );
-        break;
-      }
-    }
+    logger()->debug( L4CXX_LOCATION, "Not an archive: '%s'", zipPath.string() );
+    return { nullptr, filename };
   }
-  else
+
+  const ArchiveIndex::Member* member = zipFilePath == "." ? &index->members().front()
+                                                          : index->find( zipFilePath.string() );
+  if( member == nullptr )
   {
-    logger()->error( L4CXX_LOCATION, "Failed to open '%s'", filename );
+    logger()->debug( L4CXX_LOCATION, "'%s' not found in '%s'", zipFilePath.string(), zipPath.string() );
+    return { nullptr, filename };
   }
-  archive_read_free( arch );
 
-  m_isOpen = true;
-}
\ No newline at end of file
+  std::vector<uint8_t> contents;
+  if( !index->extract( *member, contents ) )
+  {
+    logger()->error( L4CXX_LOCATION, "Failed to extract '%s' from '%s'", member->path, zipPath.string() );
+    return { nullptr, filename };
+  }
+  return { std::make_shared<const MappedFile>( std::move( contents ) ), member->path };
+}
@@ -19,28 +19,56 @@
 #ifndef PPPLAY_ARCHIVEFILESTREAM_H
 #define PPPLAY_ARCHIVEFILESTREAM_H
 
-#include "memorystream.h"
+#include "mappedstream.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 
 /**
  * @class ArchiveFileStream
  * @ingroup Common
- * @brief Class derived from MemoryStream for an archive file
+ * @brief Class derived from MappedStream for a file within an archive
+ *
+ * @details
+ * The file is decompressed into a single buffer that the stream reads from
+ * directly; as with mapped files, lazily decoded samples keep that buffer
+ * instead of decompressing the file again.
  */
 class ArchiveFileStream
-  : public MemoryStream
+  : public MappedStream
 {
 public:
   DISABLE_COPY( ArchiveFileStream )
 
+  /**
+   * @brief Extract a file from an archive
+   * @param[in] filename Path of the archive followed by the path within the archive,
+   *            e.g. @c music.zip/mods/song.xm; the first file of the archive is used
+   *            if the latter is @c "."
+   *
+   * @see ArchiveIndex
+   */
   explicit ArchiveFileStream(const std::string& filename);
 
-  bool isOpen() const
-  {
-    return m_isOpen;
-  }
+  /**
+   * @brief Read from an already extracted file, e.g. from ArchiveIndex::forEach()
+   * @param[in] name Stream name
+   * @param[in] contents File contents, taken over without copying
+   */
+  ArchiveFileStream(const std::string& name, std::vector<uint8_t>&& contents);
 
 private:
-  bool m_isOpen;
+  struct Extracted
+  {
+    std::shared_ptr<const MappedFile> file;
+    std::string name;
+  };
+
+  explicit ArchiveFileStream(Extracted&& extracted);
+
+  static Extracted extract(const std::string& filename);
 };
 
 #endif
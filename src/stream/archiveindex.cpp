@@ -0,0 +1,300 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "archiveindex.h"
+
+#include <archive.h>
+#include <archive_entry.h>
+
+#include <boost/filesystem.hpp>
+
+#include <mutex>
+
+#include "light4cxx/logger.h"
+
+namespace
+{
+light4cxx::Logger* logger()
+{
+  return light4cxx::Logger::get( "ArchiveIndex" );
+}
+
+constexpr size_t BlockSize = 1 << 16;
+//! @brief Number of archives whose index is kept
+constexpr size_t MaxCachedIndices = 32;
+
+struct ArchiveDeleter
+{
+  void operator()(archive* arch) const
+  {
+    archive_read_free( arch );
+  }
+};
+
+typedef std::unique_ptr<archive, ArchiveDeleter> ArchivePtr;
+
+ArchivePtr openArchive(const std::string& filename)
+{
+  ArchivePtr arch( archive_read_new() );
+  archive_read_support_format_all( arch.get() );
+  archive_read_support_filter_all( arch.get() );
+  if( ARCHIVE_OK != archive_read_open_filename( arch.get(), filename.c_str(), BlockSize ) )
+  {
+    return nullptr;
+  }
+  return arch;
+}
+
+bool nextHeader(archive* arch, archive_entry** entry)
+{
+  const int result = archive_read_next_header( arch, entry );
+  return result == ARCHIVE_OK || result == ARCHIVE_WARN;
+}
+
+std::string normalize(const char* pathname)
+{
+  return boost::filesystem::path( pathname ).generic_string();
+}
+
+/**
+ * @brief Decompress the current entry
+ * @param[in] arch The archive
+ * @param[in] size Expected size, or -1 if unknown
+ * @param[out] contents Receives the data
+ * @return @c false on errors
+ */
+bool readData(archive* arch, int64_t size, std::vector<uint8_t>& contents)
+{
+  // decompress straight into the final buffer; it only grows if the size is unknown
+  contents.resize( size >= 0 ? static_cast<size_t>(size) : BlockSize );
+  size_t done = 0;
+  while( true )
+  {
+    if( done == contents.size() )
+    {
+      if( size >= 0 )
+      {
+        break;
+      }
+      contents.resize( 2 * contents.size() );
+    }
+    const auto count = archive_read_data( arch, contents.data() + done, contents.size() - done );
+    if( count < 0 )
+    {
+      logger()->warn( L4CXX_LOCATION, "Failed to decompress: %s", archive_error_string( arch ) );
+      return false;
+    }
+    if( count == 0 )
+    {
+      break;
+    }
+    done += count;
+  }
+  contents.resize( done );
+  return true;
+}
+
+struct CacheEntry
+{
+  std::shared_ptr<const ArchiveIndex> index{};
+  uintmax_t size = 0;
+  std::time_t modified = 0;
+  uint64_t lastUse = 0;
+};
+
+struct IndexCache
+{
+  std::mutex mutex{};
+  std::unordered_map<std::string, CacheEntry> entries{};
+  uint64_t uses = 0;
+};
+
+IndexCache& indexCache()
+{
+  static IndexCache cache;
+  return cache;
+}
+}
+
+struct ArchiveIndex::Reader
+{
+  ArchivePtr arch;
+  //! @brief Ordinal of the next entry header
+  size_t next;
+};
+
+ArchiveIndex::ArchiveIndex(const std::string& filename)
+  : m_filename( filename )
+{
+  auto arch = openArchive( filename );
+  if( !arch )
+  {
+    return;
+  }
+
+  archive_entry* entry;
+  for( size_t ordinal = 0; nextHeader( arch.get(), &entry ); ++ordinal )
+  {
+    const char* pathname = archive_entry_pathname( entry );
+    if( pathname == nullptr || archive_entry_filetype( entry ) != AE_IFREG )
+    {
+      continue;
+    }
+    Member member{ normalize( pathname ), archive_entry_size_is_set( entry ) ? archive_entry_size( entry ) : -1, ordinal };
+    m_byPath.emplace( member.path, m_members.size() );
+    m_members.emplace_back( std::move( member ) );
+  }
+  logger()->trace( L4CXX_LOCATION, "Indexed '%s': %d files", filename, m_members.size() );
+}
+
+ArchiveIndex::~ArchiveIndex() = default;
+
+std::shared_ptr<const ArchiveIndex> ArchiveIndex::get(const std::string& filename)
+{
+  boost::system::error_code ec;
+  const auto size = boost::filesystem::file_size( filename, ec );
+  if( ec )
+  {
+    return nullptr;
+  }
+  const auto modified = boost::filesystem::last_write_time( filename, ec );
+  if( ec )
+  {
+    return nullptr;
+  }
+
+  IndexCache& cache = indexCache();
+  {
+    std::lock_guard<std::mutex> lock( cache.mutex );
+    auto it = cache.entries.find( filename );
+    if( it != cache.entries.end() && it->second.size == size && it->second.modified == modified )
+    {
+      it->second.lastUse = ++cache.uses;
+      return it->second.index;
+    }
+  }
+
+  // scanning may take a while, don't block other lookups meanwhile
+  std::shared_ptr<const ArchiveIndex> index( new ArchiveIndex( filename ) );
+  if( index->m_members.empty() )
+  {
+    // remember files that are not archives, too
+    index.reset();
+  }
+
+  std::lock_guard<std::mutex> lock( cache.mutex );
+  if( cache.entries.size() >= MaxCachedIndices && cache.entries.find( filename ) == cache.entries.end() )
+  {
+    auto oldest = cache.entries.begin();
+    for( auto it = cache.entries.begin(); it != cache.entries.end(); ++it )
+    {
+      if( it->second.lastUse < oldest->second.lastUse )
+      {
+        oldest = it;
+      }
+    }
+    cache.entries.erase( oldest );
+  }
+  cache.entries[filename] = CacheEntry{ index, size, modified, ++cache.uses };
+  return index;
+}
+
+const ArchiveIndex::Member* ArchiveIndex::find(const std::string& path) const
+{
+  auto it = m_byPath.find( boost::filesystem::path( path ).generic_string() );
+  if( it == m_byPath.end() )
+  {
+    return nullptr;
+  }
+  return &m_members[it->second];
+}
+
+bool ArchiveIndex::extract(const Member& member, std::vector<uint8_t>& contents) const
+{
+  std::lock_guard<std::mutex> lock( m_readerMutex );
+  if( !m_reader || m_reader->next > member.ordinal )
+  {
+    auto arch = openArchive( m_filename );
+    if( !arch )
+    {
+      m_reader.reset();
+      return false;
+    }
+    m_reader.reset( new Reader{ std::move( arch ), 0 } );
+  }
+
+  archive_entry* entry = nullptr;
+  while( m_reader->next <= member.ordinal )
+  {
+    // unread entries are skipped without decompressing them where the format allows it
+    if( !nextHeader( m_reader->arch.get(), &entry ) )
+    {
+      m_reader.reset();
+      return false;
+    }
+    ++m_reader->next;
+  }
+  const char* pathname = archive_entry_pathname( entry );
+  if( pathname == nullptr || normalize( pathname ) != member.path )
+  {
+    logger()->warn( L4CXX_LOCATION, "'%s' changed while reading '%s'", m_filename, member.path );
+    m_reader.reset();
+    return false;
+  }
+  const bool result = readData( m_reader->arch.get(), member.size, contents );
+  if( !result || member.ordinal == m_members.back().ordinal )
+  {
+    // nothing left to continue with
+    m_reader.reset();
+  }
+  return result;
+}
+
+bool ArchiveIndex::forEach(const Visitor& visitor) const
+{
+  auto arch = openArchive( m_filename );
+  if( !arch )
+  {
+    return false;
+  }
+
+  archive_entry* entry;
+  size_t next = 0;
+  for( size_t ordinal = 0; next < m_members.size(); ++ordinal )
+  {
+    if( !nextHeader( arch.get(), &entry ) )
+    {
+      return false;
+    }
+    if( ordinal != m_members[next].ordinal )
+    {
+      continue;
+    }
+    std::vector<uint8_t> contents;
+    if( !readData( arch.get(), m_members[next].size, contents ) )
+    {
+      return false;
+    }
+    if( !visitor( m_members[next], std::move( contents ) ) )
+    {
+      break;
+    }
+    ++next;
+  }
+  return true;
+}
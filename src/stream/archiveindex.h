@@ -0,0 +1,133 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_ARCHIVEINDEX_H
+#define PPPLAY_ARCHIVEINDEX_H
+
+#include <stuff/utils.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class ArchiveIndex
+ * @ingroup Common
+ * @brief The regular files within an archive
+ *
+ * @details
+ * The index is built by a single scan over the archive headers and cached per
+ * archive, so that loading several members of the same archive does not scan it
+ * again. Members are extracted by their position within the archive; for seekable
+ * formats like ZIP, libarchive skips the preceding members without decompressing
+ * them. Compressed streams like tar.gz can only be read from the start, so the
+ * reader is kept after each extraction, and members extracted in archive order
+ * are read in a single pass.
+ */
+class ArchiveIndex
+{
+public:
+  DISABLE_COPY( ArchiveIndex )
+
+  ~ArchiveIndex();
+
+  struct Member
+  {
+    //! @brief Path within the archive
+    std::string path;
+    //! @brief Uncompressed size, or -1 if the archive does not store it
+    int64_t size;
+    //! @brief Position of the entry within the archive, counting all entries
+    size_t ordinal;
+  };
+
+  /**
+   * @brief Visitor for forEach()
+   * @return @c false to stop
+   */
+  typedef std::function<bool(const Member& member, std::vector<uint8_t>&& contents)> Visitor;
+
+  /**
+   * @brief Get the index of an archive, building it if necessary
+   * @param[in] filename Filename of the archive
+   * @return The index, or @c nullptr if the file is not a readable archive or contains no files
+   *
+   * @details
+   * Indices are cached and rebuilt if the archive's size or modification time changes.
+   */
+  static std::shared_ptr<const ArchiveIndex> get(const std::string& filename);
+
+  const std::string& filename() const noexcept
+  {
+    return m_filename;
+  }
+
+  /**
+   * @brief Get the regular files, in archive order
+   */
+  const std::vector<Member>& members() const noexcept
+  {
+    return m_members;
+  }
+
+  /**
+   * @brief Look up a member by its path
+   * @return The member, or @c nullptr if it does not exist
+   */
+  const Member* find(const std::string& path) const;
+
+  /**
+   * @brief Decompress a member
+   * @param[in] member Member of this index
+   * @param[out] contents Receives the data
+   * @return @c false if the member could not be read
+   *
+   * @details
+   * Continues after the previously extracted member if @a member follows it,
+   * otherwise the archive is read again from the start. Extractions from the
+   * same archive are serialized.
+   */
+  bool extract(const Member& member, std::vector<uint8_t>& contents) const;
+
+  /**
+   * @brief Decompress all members in a single pass over the archive
+   * @param[in] visitor Called for every member in archive order
+   * @return @c false if reading the archive failed
+   */
+  bool forEach(const Visitor& visitor) const;
+
+private:
+  //! @brief An open archive positioned at an entry header
+  struct Reader;
+
+  explicit ArchiveIndex(const std::string& filename);
+
+  std::string m_filename;
+  std::vector<Member> m_members{};
+  std::unordered_map<std::string, size_t> m_byPath{};
+  //! @brief Guards m_reader
+  mutable std::mutex m_readerMutex{};
+  //! @brief The reader of the last extract(), or @c nullptr
+  mutable std::unique_ptr<Reader> m_reader{};
+};
+
+#endif
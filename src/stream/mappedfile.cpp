@@ -0,0 +1,93 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mappedfile.h"
+
+#ifdef WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filename)
+{
+#ifdef WIN32
+  std::ifstream file( filename.c_str(), std::ios::in | std::ios::binary );
+  if( !file.is_open() )
+  {
+    return;
+  }
+  m_buffer.assign( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+  m_open = true;
+#else
+  const int fd = open( filename.c_str(), O_RDONLY );
+  if( fd == -1 )
+  {
+    return;
+  }
+  struct stat info;
+  if( fstat( fd, &info ) == 0 && S_ISREG( info.st_mode ) )
+  {
+    m_size = info.st_size;
+    if( m_size == 0 )
+    {
+      m_open = true;
+    }
+    else
+    {
+      void* mapped = mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+      if( mapped != MAP_FAILED )
+      {
+        m_data = static_cast<const uint8_t*>(mapped);
+        m_open = true;
+        m_mapped = true;
+      }
+      else
+      {
+        m_size = 0;
+      }
+    }
+  }
+  // the mapping stays valid after closing the descriptor
+  close( fd );
+#endif
+}
+
+MappedFile::MappedFile(std::vector<uint8_t>&& contents) noexcept
+  : m_size( contents.size() )
+  , m_open( true )
+  , m_buffer( std::move( contents ) )
+{
+  m_data = m_buffer.data();
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef WIN32
+  if( m_mapped )
+  {
+    munmap( const_cast<uint8_t*>(m_data), m_size );
+  }
+#endif
+}
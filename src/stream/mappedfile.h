@@ -0,0 +1,97 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_MAPPEDFILE_H
+#define PPPLAY_MAPPEDFILE_H
+
+#include <stuff/utils.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class MappedFile
+ * @ingroup Common
+ * @brief A read-only file mapped into memory
+ *
+ * @details
+ * The pages are only read from disk when they are accessed, so mapping even
+ * a large file is cheap. On platforms without @c mmap the file is read into
+ * memory instead.
+ */
+class MappedFile
+{
+public:
+  DISABLE_COPY( MappedFile )
+
+  MappedFile() = delete;
+
+  /**
+   * @brief Map a file
+   * @param[in] filename Filename of the file to map
+   */
+  explicit MappedFile(const std::string& filename);
+
+  /**
+   * @brief Use data that is already in memory, e.g. an extracted archive member
+   * @param[in] contents The data, taken over without copying
+   */
+  explicit MappedFile(std::vector<uint8_t>&& contents) noexcept;
+
+  ~MappedFile();
+
+  /**
+   * @brief Check if the file is mapped
+   * @return @c true if the file could be opened
+   */
+  bool isOpen() const noexcept
+  {
+    return m_open;
+  }
+
+  /**
+   * @brief Get the mapped data
+   * @return Pointer to size() bytes
+   */
+  const uint8_t* data() const noexcept
+  {
+    return m_data;
+  }
+
+  /**
+   * @brief Get the size of the file
+   * @return Size in bytes
+   */
+  size_t size() const noexcept
+  {
+    return m_size;
+  }
+
+private:
+  const uint8_t* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_open = false;
+  //! @brief @c true if m_data must be unmapped
+  bool m_mapped = false;
+  //! @brief File contents if mapping is not available, or data supplied by the caller
+  std::vector<uint8_t> m_buffer{};
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mappedstream.h"
+#include "mappedfile.h"
+
+#include <streambuf>
+
+namespace
+{
+/**
+ * @brief Read-only stream buffer on top of a memory region
+ */
+class MappedBuffer
+  : public std::streambuf
+{
+public:
+  MappedBuffer(const uint8_t* data, size_t size)
+  {
+    char* begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+    setg( begin, begin, begin + size );
+  }
+
+protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode /*which*/) override
+  {
+    off_type base;
+    switch( dir )
+    {
+    case std::ios_base::beg:
+      base = 0;
+      break;
+    case std::ios_base::cur:
+      base = gptr() - eback();
+      break;
+    default:
+      base = egptr() - eback();
+      break;
+    }
+    return seekpos( base + off, std::ios_base::in );
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode /*which*/) override
+  {
+    // both the get and the put position are set by Stream::seek()
+    const off_type offset = pos;
+    if( offset < 0 || offset > egptr() - eback() )
+    {
+      return pos_type( off_type( -1 ) );
+    }
+    setg( eback(), eback() + offset, egptr() );
+    return pos;
+  }
+};
+
+/**
+ * @brief I/O stream owning its MappedBuffer
+ */
+class MappedIoStream
+  : public std::iostream
+{
+private:
+  MappedBuffer m_buffer;
+public:
+  explicit MappedIoStream(const MappedFile* file)
+    : std::iostream( nullptr )
+    , m_buffer( file != nullptr ? file->data() : nullptr, file != nullptr ? file->size() : 0 )
+  {
+    rdbuf( &m_buffer );
+  }
+};
+}
+
+MappedStream::MappedStream(const std::string& filename)
+  : MappedStream( std::make_shared<const MappedFile>( filename ), filename )
+{
+}
+
+MappedStream::MappedStream(const std::shared_ptr<const MappedFile>& file, const std::string& name)
+  : Stream( new MappedIoStream( file.get() ), name ), m_file( file )
+{
+}
+
+bool MappedStream::isOpen() const
+{
+  return m_file != nullptr && m_file->isOpen();
+}
+
+std::streamsize MappedStream::size() const
+{
+  return m_file != nullptr ? m_file->size() : 0;
+}
@@ -0,0 +1,77 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_MAPPEDSTREAM_H
+#define PPPLAY_MAPPEDSTREAM_H
+
+#include "stream.h"
+
+class MappedFile;
+
+/**
+ * @class MappedStream
+ * @ingroup Common
+ * @brief Class derived from Stream for memory-mapped files
+ * @note This is a read-only stream
+ *
+ * @details
+ * Several streams may share the same mapping, so that data can be read from
+ * the file again after the stream used for loading has been destroyed.
+ */
+class MappedStream
+  : public Stream
+{
+private:
+  std::shared_ptr<const MappedFile> m_file;
+public:
+  DISABLE_COPY( MappedStream )
+
+  MappedStream() = delete;
+
+  /**
+   * @brief Map a file
+   * @param[in] filename Filename of the file to map
+   */
+  explicit MappedStream(const std::string& filename);
+
+  /**
+   * @brief Read from an existing mapping
+   * @param[in] file The mapped file, @c nullptr for a stream that is not open
+   * @param[in] name Stream name
+   */
+  MappedStream(const std::shared_ptr<const MappedFile>& file, const std::string& name);
+
+  /**
+   * @brief Check if the file is mapped
+   * @return @c true if the file is mapped
+   */
+  bool isOpen() const;
+
+  std::streamsize size() const override;
+
+  /**
+   * @brief Get the mapping this stream reads from
+   * @return The mapped file
+   */
+  const std::shared_ptr<const MappedFile>& file() const
+  {
+    return m_file;
+  }
+};
+
+#endif
@@ -0,0 +1,194 @@
+#define BOOST_TEST_MODULE ArchiveIndex
+
+#include <boost/test/unit_test.hpp>
+
+#include "../archivefilestream.h"
+#include "../archiveindex.h"
+
+#include <archive.h>
+#include <archive_entry.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+typedef std::vector<std::pair<std::string, std::string>> Files;
+
+enum class Format
+{
+  Zip, TarGz
+};
+
+const Files DefaultFiles{
+  { "first.mod", "first member" },
+  { "songs/second.xm", std::string( 70000, 'x' ) + "end" },
+  { "songs/third.s3m", "" }
+};
+
+struct TempArchive
+{
+  const std::string filename = ( boost::filesystem::temp_directory_path() / boost::filesystem::unique_path() ).string();
+
+  ~TempArchive()
+  {
+    boost::filesystem::remove( filename );
+  }
+
+  //! @brief (Re-)write the archive, with a directory entry before the files
+  void write(Format format, const Files& files) const
+  {
+    archive* arch = archive_write_new();
+    if( format == Format::Zip )
+    {
+      archive_write_set_format_zip( arch );
+    }
+    else
+    {
+      archive_write_set_format_pax_restricted( arch );
+      archive_write_add_filter_gzip( arch );
+    }
+    BOOST_REQUIRE_EQUAL( archive_write_open_filename( arch, filename.c_str() ), ARCHIVE_OK );
+
+    archive_entry* entry = archive_entry_new();
+    archive_entry_set_pathname( entry, "songs/" );
+    archive_entry_set_filetype( entry, AE_IFDIR );
+    archive_entry_set_perm( entry, 0755 );
+    BOOST_REQUIRE_EQUAL( archive_write_header( arch, entry ), ARCHIVE_OK );
+    for( const auto& file: files )
+    {
+      archive_entry_clear( entry );
+      archive_entry_set_pathname( entry, file.first.c_str() );
+      archive_entry_set_filetype( entry, AE_IFREG );
+      archive_entry_set_perm( entry, 0644 );
+      archive_entry_set_size( entry, file.second.size() );
+      BOOST_REQUIRE_EQUAL( archive_write_header( arch, entry ), ARCHIVE_OK );
+      const auto written = archive_write_data( arch, file.second.data(), file.second.size() );
+      BOOST_REQUIRE_EQUAL( static_cast<size_t>(written), file.second.size() );
+    }
+    archive_entry_free( entry );
+    BOOST_REQUIRE_EQUAL( archive_write_close( arch ), ARCHIVE_OK );
+    archive_write_free( arch );
+  }
+};
+
+std::string extract(const ArchiveIndex& index, const std::string& path)
+{
+  const ArchiveIndex::Member* member = index.find( path );
+  BOOST_REQUIRE( member != nullptr );
+  std::vector<uint8_t> contents;
+  BOOST_REQUIRE( index.extract( *member, contents ) );
+  return std::string( contents.begin(), contents.end() );
+}
+
+std::string readStream(Stream& stream)
+{
+  std::string contents( static_cast<size_t>(stream.size()), '\0' );
+  stream.seek( 0 );
+  stream.read( &contents[0], contents.size() );
+  return contents;
+}
+
+void checkMembers(Format format)
+{
+  TempArchive archive;
+  archive.write( format, DefaultFiles );
+
+  const auto index = ArchiveIndex::get( archive.filename );
+  BOOST_REQUIRE( index );
+  BOOST_REQUIRE_EQUAL( index->members().size(), DefaultFiles.size() );
+  for( size_t i = 0; i < DefaultFiles.size(); ++i )
+  {
+    BOOST_CHECK_EQUAL( index->members()[i].path, DefaultFiles[i].first );
+    BOOST_CHECK( extract( *index, DefaultFiles[i].first ) == DefaultFiles[i].second );
+  }
+  // backwards, the reader of the previous extraction cannot be continued
+  for( size_t i = DefaultFiles.size(); i-- > 0; )
+  {
+    BOOST_CHECK( extract( *index, DefaultFiles[i].first ) == DefaultFiles[i].second );
+  }
+  // the same member twice, then skipping one
+  BOOST_CHECK( extract( *index, DefaultFiles[0].first ) == DefaultFiles[0].second );
+  BOOST_CHECK( extract( *index, DefaultFiles[0].first ) == DefaultFiles[0].second );
+  BOOST_CHECK( extract( *index, DefaultFiles[2].first ) == DefaultFiles[2].second );
+  BOOST_CHECK( index->find( "songs" ) == nullptr );
+  BOOST_CHECK( index->find( "missing.mod" ) == nullptr );
+
+  // members are streamed by their path within the archive
+  ArchiveFileStream second( archive.filename + "/songs/second.xm" );
+  BOOST_REQUIRE( second.isOpen() );
+  BOOST_CHECK( readStream( second ) == DefaultFiles[1].second );
+  ArchiveFileStream first( archive.filename + "/." );
+  BOOST_REQUIRE( first.isOpen() );
+  BOOST_CHECK( readStream( first ) == DefaultFiles[0].second );
+  BOOST_CHECK( !ArchiveFileStream( archive.filename + "/songs/missing.xm" ).isOpen() );
+
+  size_t visited = 0;
+  BOOST_CHECK( index->forEach( [&visited](const ArchiveIndex::Member& member, std::vector<uint8_t>&& contents) {
+    BOOST_CHECK_EQUAL( member.path, DefaultFiles[visited].first );
+    BOOST_CHECK( std::string( contents.begin(), contents.end() ) == DefaultFiles[visited].second );
+    ++visited;
+    return true;
+  } ) );
+  BOOST_CHECK_EQUAL( visited, DefaultFiles.size() );
+}
+}
+
+BOOST_AUTO_TEST_CASE( ZipMembers )
+{
+  checkMembers( Format::Zip );
+}
+
+BOOST_AUTO_TEST_CASE( TarMembers )
+{
+  checkMembers( Format::TarGz );
+}
+
+BOOST_AUTO_TEST_CASE( NoArchive )
+{
+  TempArchive archive;
+  {
+    std::ofstream file( archive.filename );
+    file << "not an archive";
+  }
+  BOOST_CHECK( !ArchiveIndex::get( archive.filename ) );
+  BOOST_CHECK( !ArchiveIndex::get( archive.filename + ".missing" ) );
+}
+
+BOOST_AUTO_TEST_CASE( CacheInvalidation )
+{
+  TempArchive archive;
+  archive.write( Format::Zip, DefaultFiles );
+  const auto index = ArchiveIndex::get( archive.filename );
+  BOOST_REQUIRE( index );
+  BOOST_CHECK( ArchiveIndex::get( archive.filename ) == index );
+
+  // a different size
+  Files files = DefaultFiles;
+  files.emplace_back( "fourth.it", "added" );
+  archive.write( Format::Zip, files );
+  const auto grown = ArchiveIndex::get( archive.filename );
+  BOOST_REQUIRE( grown );
+  BOOST_CHECK( grown != index );
+  BOOST_REQUIRE_EQUAL( grown->members().size(), files.size() );
+  BOOST_CHECK( extract( *grown, "fourth.it" ) == "added" );
+
+  // the same size, but a later modification time
+  const auto size = boost::filesystem::file_size( archive.filename );
+  const auto modified = boost::filesystem::last_write_time( archive.filename );
+  files.back().second = "ADDED";
+  archive.write( Format::Zip, files );
+  BOOST_REQUIRE_EQUAL( boost::filesystem::file_size( archive.filename ), size );
+  boost::filesystem::last_write_time( archive.filename, modified + 10 );
+  const auto rewritten = ArchiveIndex::get( archive.filename );
+  BOOST_REQUIRE( rewritten );
+  BOOST_CHECK( rewritten != grown );
+  BOOST_CHECK( extract( *rewritten, "fourth.it" ) == "ADDED" );
+  ArchiveFileStream stream( archive.filename + "/fourth.it" );
+  BOOST_REQUIRE( stream.isOpen() );
+  BOOST_CHECK( readStream( stream ) == "ADDED" );
+}
@@ -18,7 +18,10 @@
 
 #include "pluginregistry.h"
 #include "stream/archivefilestream.h"
+#include "stream/archiveindex.h"
 #include "stream/filestream.h"
+#include "stream/mappedstream.h"
+#include "genmod/samplecache.h"
 #include "stuff/system.h"
 
 #include "xmmod/xmmodule.h"
@@ -27,9 +30,13 @@
 #include "modmod/modmodule.h"
 #include "hscmod/hscmodule.h"
 
+#include <boost/filesystem.hpp>
+
 namespace ppp
 {
-AbstractModule::Ptr tryLoad(const std::string& filename, uint32_t frq, int maxRpt, Sample::Interpolation inter)
+namespace
+{
+AbstractModule::Ptr loadFrom(Stream& file, uint32_t frq, int maxRpt, Sample::Interpolation inter)
 {
   static const auto plugins = {
     &xm::XmModule::factory,
@@ -39,37 +46,119 @@ AbstractModule::Ptr tryLoad(const std::string& filename, uint32_t frq, int maxRp
     &hsc::Module::factory
   };
 
+  for( auto plugin: plugins )
+  {
+    file.clear();
+    file.seek( 0 );
+    if( auto result = (*plugin)( &file, frq, maxRpt, inter ) )
+    {
+      return result;
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<AbstractModule::ProbeInfo> probeFrom(Stream& file)
+{
+  static const auto probes = {
+    &xm::XmModule::probe,
+    &it::ItModule::probe,
+    &s3m::S3mModule::probe,
+    &mod::ModModule::probe,
+    &hsc::Module::probe
+  };
+
+  for( auto probe: probes )
+  {
+    file.clear();
+    file.seek( 0 );
+    if( auto result = (*probe)( &file ) )
+    {
+      return result;
+    }
+  }
+  return nullptr;
+}
+
+std::string memberFilename(const std::string& archive, const ArchiveIndex::Member& member)
+{
+  return (boost::filesystem::path( archive ) / member.path).string();
+}
+}
+
+AbstractModule::Ptr tryLoad(const std::string& filename, uint32_t frq, int maxRpt, Sample::Interpolation inter)
+{
+  bool mapped = false;
+  if( SampleCache::instance().isEnabled() )
+  {
+    // samples of modules loaded from a mapped file are decoded on demand
+    MappedStream file( filename );
+    mapped = file.isOpen();
+    if( mapped )
+    {
+      if( auto result = loadFrom( file, frq, maxRpt, inter ) )
+      {
+        return result;
+      }
+    }
+  }
+
+  if( !mapped )
   {
     FileStream file( filename );
     if( file.isOpen() )
     {
-      for( auto plugin: plugins )
+      if( auto result = loadFrom( file, frq, maxRpt, inter ) )
       {
-        file.clear();
-        file.seek( 0 );
-        if( auto result = (*plugin)( &file, frq, maxRpt, inter ) )
-        {
-          return result;
-        }
+        return result;
       }
     }
   }
 
+  ArchiveFileStream file( filename );
+  if( file.isOpen() )
+  {
+    return loadFrom( file, frq, maxRpt, inter );
+  }
+  return nullptr;
+}
+
+std::unique_ptr<AbstractModule::ProbeInfo> tryProbe(const std::string& filename)
+{
   {
-    ArchiveFileStream file( filename );
+    FileStream file( filename );
     if( file.isOpen() )
     {
-      for( auto plugin: plugins )
+      if( auto result = probeFrom( file ) )
       {
-        file.clear();
-        file.seek( 0 );
-        if( auto result = (*plugin)( &file, frq, maxRpt, inter ) )
-        {
-          return result;
-        }
+        return result;
       }
     }
   }
+
+  ArchiveFileStream file( filename );
+  if( file.isOpen() )
+  {
+    return probeFrom( file );
+  }
   return nullptr;
 }
+
+std::vector<std::string> playableMembers(const std::string& archive)
+{
+  std::vector<std::string> result;
+  if( const auto index = ArchiveIndex::get( archive ) )
+  {
+    index->forEach( [&archive, &result](const ArchiveIndex::Member& member, std::vector<uint8_t>&& contents)
+                    {
+                      ArchiveFileStream file( member.path, std::move( contents ) );
+                      if( probeFrom( file ) )
+                      {
+                        result.emplace_back( memberFilename( archive, member ) );
+                      }
+                      return true;
+                    } );
+  }
+  return result;
+}
 }
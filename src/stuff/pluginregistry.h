@@ -22,12 +22,31 @@
 #include <genmod/abstractmodule.h>
 
 #include <list>
+#include <string>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
 namespace ppp
 {
 AbstractModule::Ptr tryLoad(const std::string& filename, uint32_t frq, int maxRpt, Sample::Interpolation inter);
+
+/**
+ * @brief Read a module's meta information without loading the module
+ * @param[in] filename Module filename, may be located in an archive
+ * @return Meta information of the first format that recognizes the file, or nullptr
+ */
+std::unique_ptr<AbstractModule::ProbeInfo> tryProbe(const std::string& filename);
+
+/**
+ * @brief List the modules within an archive
+ * @param[in] archive Archive filename
+ * @return Filenames of the members that tryLoad() can play, in archive order
+ *
+ * @details
+ * The archive is decompressed in a single pass, and each member is only probed.
+ */
+std::vector<std::string> playableMembers(const std::string& archive);
 }
 
 #endif
@@ -0,0 +1,243 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "profiler.h"
+#include "stringutils.h"
+
+#include <boost/format.hpp>
+
+#include <array>
+#include <ostream>
+
+namespace ppp
+{
+namespace profile
+{
+namespace
+{
+/**
+ * @struct StageData
+ * @brief Accumulated timings of a stage
+ */
+struct StageData
+{
+  std::atomic<uint64_t> calls{ 0 };
+  std::atomic<uint64_t> totalNs{ 0 };
+  std::atomic<uint64_t> maxNs{ 0 };
+};
+
+std::array<StageData, static_cast<size_t>(Stage::Count)> s_stages;
+std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::Count)> s_counters;
+std::chrono::steady_clock::time_point s_startTime;
+std::chrono::steady_clock::time_point s_stopTime;
+
+const char* stageName(Stage stage)
+{
+  switch( stage )
+  {
+  case Stage::Render:
+    return "render";
+  case Stage::Update:
+    return "update";
+  case Stage::Mix:
+    return "mix";
+  case Stage::PostProcess:
+    return "postprocess";
+  case Stage::Opl:
+    return "opl";
+  case Stage::FifoPush:
+    return "fifo_push";
+  case Stage::FifoPull:
+    return "fifo_pull";
+  case Stage::Encode:
+    return "encode";
+  default:
+    return "?";
+  }
+}
+
+const char* counterName(Counter counter)
+{
+  switch( counter )
+  {
+  case Counter::Ticks:
+    return "ticks";
+  case Counter::Frames:
+    return "frames";
+  case Counter::ActiveVoices:
+    return "active_voices";
+  case Counter::AnnotatedAllocations:
+    return "annotated_allocations";
+  case Counter::Underruns:
+    return "underruns";
+  default:
+    return "?";
+  }
+}
+
+double wallSeconds()
+{
+  const auto end = enabled() ? std::chrono::steady_clock::now() : s_stopTime;
+  return std::chrono::duration<double>( end - s_startTime ).count();
+}
+
+/**
+ * @brief Quote a string for use in a CSV field
+ */
+std::string csvQuote(const std::string& str)
+{
+  std::string result = "\"";
+  for( char c : str )
+  {
+    if( c == '"' )
+    {
+      result += '"';
+    }
+    result += c;
+  }
+  return result + '"';
+}
+} // anonymous namespace
+
+namespace detail
+{
+std::atomic<bool> s_enabled{ false };
+
+void addTime(Stage stage, std::chrono::steady_clock::duration duration) noexcept
+{
+  StageData& data = s_stages[static_cast<size_t>(stage)];
+  const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>( duration ).count();
+  data.calls.fetch_add( 1, std::memory_order_relaxed );
+  data.totalNs.fetch_add( ns, std::memory_order_relaxed );
+  uint64_t prevMax = data.maxNs.load( std::memory_order_relaxed );
+  while( ns > prevMax && !data.maxNs.compare_exchange_weak( prevMax, ns, std::memory_order_relaxed ) )
+  {
+  }
+}
+
+void addCount(Counter counter, uint64_t n) noexcept
+{
+  s_counters[static_cast<size_t>(counter)].fetch_add( n, std::memory_order_relaxed );
+}
+}
+
+void setEnabled(bool enabled)
+{
+  if( enabled )
+  {
+    for( auto& stage : s_stages )
+    {
+      stage.calls = 0;
+      stage.totalNs = 0;
+      stage.maxNs = 0;
+    }
+    for( auto& counter : s_counters )
+    {
+      counter = 0;
+    }
+    s_startTime = std::chrono::steady_clock::now();
+  }
+  else if( profile::enabled() )
+  {
+    s_stopTime = std::chrono::steady_clock::now();
+  }
+  detail::s_enabled = enabled;
+}
+
+void printSummary(std::ostream& out)
+{
+  const double wall = wallSeconds();
+  out << boost::format( "%-12s %10s %12s %10s %10s %7s\n" ) % "Stage" % "Calls" % "Total ms" % "Avg us" % "Max us"
+    % "Wall%";
+  for( size_t i = 0; i < s_stages.size(); i++ )
+  {
+    const StageData& data = s_stages[i];
+    const uint64_t calls = data.calls;
+    if( calls == 0 )
+    {
+      continue;
+    }
+    const double totalMs = data.totalNs / 1e6;
+    out << boost::format( "%-12s %10d %12.2f %10.2f %10.2f %6.1f%%\n" )
+      % stageName( static_cast<Stage>(i) )
+      % calls
+      % totalMs
+      % (data.totalNs / 1e3 / calls)
+      % (data.maxNs / 1e3)
+      % (wall > 0 ? totalMs / 10 / wall : 0);
+  }
+
+  const uint64_t ticks = s_counters[static_cast<size_t>(Counter::Ticks)];
+  out << boost::format( "\n%-14s %12s %12s\n" ) % "Counter" % "Total" % "Per tick";
+  for( size_t i = 0; i < s_counters.size(); i++ )
+  {
+    const uint64_t value = s_counters[i];
+    out << boost::format( "%-14s %12d %12.2f\n" )
+      % counterName( static_cast<Counter>(i) )
+      % value
+      % (ticks != 0 ? double( value ) / ticks : 0.0);
+  }
+  out << boost::format( "\nWall time: %.3f s\n" ) % wall;
+}
+
+void writeJson(std::ostream& out, const std::string& source)
+{
+  out << "{\n  \"source\": \"" << jsonEscape( source ) << "\",\n";
+  out << "  \"wall_s\": " << wallSeconds() << ",\n";
+  out << "  \"stages\": {";
+  for( size_t i = 0; i < s_stages.size(); i++ )
+  {
+    const StageData& data = s_stages[i];
+    out << (i == 0 ? "\n" : ",\n");
+    out << boost::format( "    \"%s\": { \"calls\": %d, \"total_us\": %.3f, \"max_us\": %.3f }" )
+      % stageName( static_cast<Stage>(i) )
+      % data.calls.load()
+      % (data.totalNs / 1e3)
+      % (data.maxNs / 1e3);
+  }
+  out << "\n  },\n  \"counters\": {";
+  for( size_t i = 0; i < s_counters.size(); i++ )
+  {
+    out << (i == 0 ? "\n" : ",\n");
+    out << boost::format( "    \"%s\": %d" ) % counterName( static_cast<Counter>(i) ) % s_counters[i].load();
+  }
+  out << "\n  }\n}\n";
+}
+
+void writeCsv(std::ostream& out, const std::string& source)
+{
+  const std::string quoted = csvQuote( source );
+  out << "source,kind,name,calls,total_us,max_us,value\n";
+  for( size_t i = 0; i < s_stages.size(); i++ )
+  {
+    const StageData& data = s_stages[i];
+    out << boost::format( "%s,stage,%s,%d,%.3f,%.3f,\n" )
+      % quoted
+      % stageName( static_cast<Stage>(i) )
+      % data.calls.load()
+      % (data.totalNs / 1e3)
+      % (data.maxNs / 1e3);
+  }
+  for( size_t i = 0; i < s_counters.size(); i++ )
+  {
+    out << boost::format( "%s,counter,%s,,,,%d\n" ) % quoted % counterName( static_cast<Counter>(i) ) % s_counters[i].load();
+  }
+  out << boost::format( "%s,wall,wall_s,,,,%.6f\n" ) % quoted % wallSeconds();
+}
+}
+}
@@ -0,0 +1,174 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_PROFILER_H
+#define PPPLAY_PROFILER_H
+
+#include "utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace ppp
+{
+/**
+ * @ingroup Common
+ * @{
+ */
+
+/**
+ * @brief Opt-in render profiling
+ *
+ * @details
+ * Stages are timed with ScopedTimer and events are counted with count(). While
+ * profiling is disabled, both only cost a single relaxed atomic load, so the
+ * instrumentation can stay in the render paths.
+ *
+ * All values are accumulated process-wide and may be updated from any thread.
+ */
+namespace profile
+{
+/**
+ * @brief Timed render stages
+ */
+enum class Stage
+{
+  Render, //!< @brief Complete tick rendering (AbstractModule::buildTick)
+  Update, //!< @brief Row and effect processing
+  Mix, //!< @brief Voice mixing
+  PostProcess, //!< @brief Clipping the mixed frames to the output format
+  Opl, //!< @brief OPL synthesis
+  FifoPush, //!< @brief Pushing frames into an AudioFifo
+  FifoPull, //!< @brief Pulling frames from an AudioFifo
+  Encode, //!< @brief Encoding and writing output files
+  Count
+};
+
+/**
+ * @brief Counted events
+ */
+enum class Counter
+{
+  Ticks, //!< @brief Rendered ticks
+  Frames, //!< @brief Rendered frames
+  ActiveVoices, //!< @brief Mixed voices, summed over all ticks
+  AnnotatedAllocations, //!< @brief Buffer allocations at the annotated call sites in the render path, not all allocations
+  Underruns, //!< @brief Output requests that could not be satisfied completely
+  Count
+};
+
+namespace detail
+{
+extern std::atomic<bool> s_enabled;
+
+void addTime(Stage stage, std::chrono::steady_clock::duration duration) noexcept;
+
+void addCount(Counter counter, uint64_t n) noexcept;
+}
+
+/**
+ * @brief Check if profiling is enabled
+ */
+inline bool enabled() noexcept
+{
+  return detail::s_enabled.load( std::memory_order_relaxed );
+}
+
+/**
+ * @brief Enable or disable profiling
+ * @note Enabling resets all accumulated values and starts the wall clock
+ */
+void setEnabled(bool enabled);
+
+/**
+ * @brief Count an event
+ * @param[in] counter The counter to increase
+ * @param[in] n Number of events
+ */
+inline void count(Counter counter, uint64_t n = 1) noexcept
+{
+  if( enabled() )
+  {
+    detail::addCount( counter, n );
+  }
+}
+
+/**
+ * @class ScopedTimer
+ * @brief Adds the lifetime of the object to a stage
+ */
+class ScopedTimer
+{
+  DISABLE_COPY( ScopedTimer )
+private:
+  const Stage m_stage;
+  const bool m_active;
+  std::chrono::steady_clock::time_point m_start{};
+public:
+  explicit ScopedTimer(Stage stage) noexcept
+    : m_stage( stage ), m_active( enabled() )
+  {
+    if( m_active )
+    {
+      m_start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedTimer()
+  {
+    if( m_active )
+    {
+      detail::addTime( m_stage, std::chrono::steady_clock::now() - m_start );
+    }
+  }
+};
+
+/**
+ * @brief Print a human-readable summary table
+ * @param[in] out Output stream
+ */
+void printSummary(std::ostream& out);
+
+/**
+ * @brief Write all values as a JSON object
+ * @param[in] out Output stream
+ * @param[in] source Name of the profiled file
+ */
+void writeJson(std::ostream& out, const std::string& source);
+
+/**
+ * @brief Write all values as CSV
+ * @param[in] out Output stream
+ * @param[in] source Name of the profiled file
+ *
+ * @details
+ * Each stage and each counter is written as a row of the form
+ * <tt>source,kind,name,calls,total_us,max_us,value</tt>.
+ */
+void writeCsv(std::ostream& out, const std::string& source);
+}
+
+/**
+ * @}
+ */
+}
+
+#endif
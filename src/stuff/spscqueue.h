@@ -0,0 +1,183 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_SPSCQUEUE_H
+#define PPPLAY_SPSCQUEUE_H
+
+#include "utils.h"
+
+#include <boost/assert.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * @ingroup Common
+ * @{
+ */
+
+/**
+ * @class SpscQueue
+ * @brief Bounded single-producer/single-consumer queue of recycled slots
+ * @tparam T Element type, must be default-constructible
+ *
+ * @details
+ * The producer fills the slot returned by acquire() and hands it over with
+ * commit(); the consumer processes front() and gives the slot back with pop().
+ * Slots are never destroyed, so containers keep their capacity from one round
+ * to the next.
+ *
+ * The indices are lock-free; the mutex is only taken to sleep when the queue
+ * is full or empty, and to wake the other side up afterwards.
+ */
+template<typename T>
+class SpscQueue
+{
+private:
+  std::vector<T> m_slots;
+  //! @brief Number of committed slots, written by the producer
+  std::atomic<size_t> m_tail{ 0 };
+  //! @brief Number of popped slots, written by the consumer
+  std::atomic<size_t> m_head{ 0 };
+  std::atomic<bool> m_closed{ false };
+  std::mutex m_waitMutex{};
+  std::condition_variable m_waitCondition{};
+
+  void notify()
+  {
+    std::lock_guard<std::mutex> lock( m_waitMutex );
+    m_waitCondition.notify_all();
+  }
+
+public:
+  DISABLE_COPY( SpscQueue )
+
+  /**
+   * @brief Constructor
+   * @param[in] capacity Number of slots
+   * @pre capacity>0
+   */
+  explicit SpscQueue(size_t capacity)
+    : m_slots( capacity )
+  {
+    BOOST_ASSERT( capacity > 0 );
+  }
+
+  size_t capacity() const noexcept
+  {
+    return m_slots.size();
+  }
+
+  /**
+   * @brief Get the next free slot, waiting until the consumer releases one
+   * @return The slot, or @c nullptr if the queue was closed
+   * @note Producer side only
+   */
+  T* acquire()
+  {
+    const size_t tail = m_tail.load( std::memory_order_relaxed );
+    const auto hasRoom = [this, tail]() {
+      return tail - m_head.load( std::memory_order_acquire ) < m_slots.size();
+    };
+    if( !hasRoom() )
+    {
+      std::unique_lock<std::mutex> lock( m_waitMutex );
+      m_waitCondition.wait( lock, [this, &hasRoom]() {
+        return hasRoom() || m_closed;
+      } );
+    }
+    if( m_closed )
+    {
+      return nullptr;
+    }
+    return &m_slots[tail % m_slots.size()];
+  }
+
+  /**
+   * @brief Hand the slot returned by acquire() over to the consumer
+   * @note Producer side only
+   */
+  void commit()
+  {
+    m_tail.fetch_add( 1, std::memory_order_release );
+    notify();
+  }
+
+  /**
+   * @brief Get the oldest committed slot, waiting until the producer commits one
+   * @return The slot, or @c nullptr if the queue is empty and was closed
+   * @note Consumer side only
+   */
+  T* front()
+  {
+    const size_t head = m_head.load( std::memory_order_relaxed );
+    const auto hasData = [this, head]() {
+      return m_tail.load( std::memory_order_acquire ) != head;
+    };
+    if( !hasData() )
+    {
+      std::unique_lock<std::mutex> lock( m_waitMutex );
+      m_waitCondition.wait( lock, [this, &hasData]() {
+        return hasData() || m_closed;
+      } );
+      if( !hasData() )
+      {
+        return nullptr;
+      }
+    }
+    return &m_slots[head % m_slots.size()];
+  }
+
+  /**
+   * @brief Give the slot returned by front() back to the producer
+   * @note Consumer side only
+   */
+  void pop()
+  {
+    m_head.fetch_add( 1, std::memory_order_release );
+    notify();
+  }
+
+  /**
+   * @brief Wake up both sides and make further waits return immediately
+   *
+   * @details
+   * The producer closes the queue when it has nothing more to commit; the
+   * consumer still receives all committed slots. The consumer closes it to
+   * make a producer waiting in acquire() give up.
+   */
+  void close()
+  {
+    m_closed = true;
+    notify();
+  }
+
+  bool isClosed() const noexcept
+  {
+    return m_closed;
+  }
+};
+
+/**
+ * @}
+ */
+
+#endif
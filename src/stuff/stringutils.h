@@ -70,6 +70,34 @@ inline std::string stringFmt(std::string&& fmt, T&& val, Args&& ...args)
                     std::forward<Args>( args )... );
 }
 
+/**
+ * @brief Escape a string for use in a JSON string literal
+ * @param[in] str String to escape
+ * @return Escaped string, without the quotes
+ */
+inline std::string jsonEscape(const std::string& str)
+{
+  std::string result;
+  result.reserve( str.size() );
+  for( char c : str )
+  {
+    if( c == '"' || c == '\\' )
+    {
+      result += '\\';
+      result += c;
+    }
+    else if( static_cast<unsigned char>(c) < 0x20 )
+    {
+      result += stringFmt( "\\u%04x", int( c ) );
+    }
+    else
+    {
+      result += c;
+    }
+  }
+  return result;
+}
+
 /**
  * @}
  */
@@ -0,0 +1,72 @@
+#define BOOST_TEST_MODULE SpscQueue
+
+#include <boost/test/unit_test.hpp>
+
+#include "../spscqueue.h"
+
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( OrderedTransfer )
+{
+  SpscQueue<std::vector<int>> queue( 4 );
+  constexpr int Count = 100000;
+  std::thread producer( [&queue]()
+                        {
+                          for( int i = 0; i < Count; ++i )
+                          {
+                            std::vector<int>* slot = queue.acquire();
+                            slot->assign( 3, i );
+                            queue.commit();
+                          }
+                          queue.close();
+                        } );
+
+  int expected = 0;
+  while( const std::vector<int>* slot = queue.front() )
+  {
+    BOOST_REQUIRE_EQUAL( slot->size(), 3 );
+    BOOST_REQUIRE_EQUAL( slot->front(), expected );
+    ++expected;
+    queue.pop();
+  }
+  producer.join();
+  BOOST_REQUIRE_EQUAL( expected, Count );
+}
+
+BOOST_AUTO_TEST_CASE( SlotsAreRecycled )
+{
+  SpscQueue<std::vector<int>> queue( 2 );
+  queue.acquire()->reserve( 100 );
+  queue.commit();
+  queue.acquire();
+  queue.commit();
+  queue.pop();
+  queue.pop();
+  // the first slot comes around again and keeps its capacity
+  BOOST_REQUIRE_GE( queue.acquire()->capacity(), 100 );
+}
+
+BOOST_AUTO_TEST_CASE( CloseDrainsCommittedSlots )
+{
+  SpscQueue<int> queue( 2 );
+  *queue.acquire() = 1;
+  queue.commit();
+  *queue.acquire() = 2;
+  queue.commit();
+
+  // a full queue makes the producer wait until it is closed
+  std::thread producer( [&queue]()
+                        {
+                          BOOST_CHECK( queue.acquire() == nullptr );
+                        } );
+  queue.close();
+  producer.join();
+
+  BOOST_REQUIRE( queue.isClosed() );
+  BOOST_REQUIRE_EQUAL( *queue.front(), 1 );
+  queue.pop();
+  BOOST_REQUIRE_EQUAL( *queue.front(), 2 );
+  queue.pop();
+  BOOST_REQUIRE( queue.front() == nullptr );
+}
@@ -0,0 +1,53 @@
+#define BOOST_TEST_MODULE TripleBuffer
+
+#include <boost/test/unit_test.hpp>
+
+#include "../triplebuffer.h"
+
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_CASE( ReadWithoutPublish )
+{
+  TripleBuffer<int> buf;
+  BOOST_REQUIRE( !buf.hasFresh() );
+  BOOST_REQUIRE_EQUAL( buf.read(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( LatestValueWins )
+{
+  TripleBuffer<int> buf;
+  buf.writeBuffer() = 1;
+  buf.publish();
+  buf.writeBuffer() = 2;
+  buf.publish();
+  BOOST_REQUIRE( buf.hasFresh() );
+  BOOST_REQUIRE_EQUAL( buf.read(), 2 );
+  BOOST_REQUIRE( !buf.hasFresh() );
+  // reading again without a new publication returns the same value
+  BOOST_REQUIRE_EQUAL( buf.read(), 2 );
+}
+
+BOOST_AUTO_TEST_CASE( ConcurrentPublication )
+{
+  TripleBuffer<std::string> buf;
+  constexpr int Count = 100000;
+  std::thread producer( [&buf]()
+                        {
+                          for( int i = 1; i <= Count; ++i )
+                          {
+                            buf.writeBuffer() = std::to_string( i );
+                            buf.publish();
+                          }
+                        } );
+
+  int last = 0;
+  while( last < Count )
+  {
+    const std::string& value = buf.read();
+    const int current = value.empty() ? 0 : std::stoi( value );
+    BOOST_REQUIRE_GE( current, last );
+    last = current;
+  }
+  producer.join();
+}
@@ -0,0 +1,115 @@
+/*
+    PPPlay - an old-fashioned module player
+    Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PPPLAY_TRIPLEBUFFER_H
+#define PPPLAY_TRIPLEBUFFER_H
+
+#include "utils.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @ingroup Common
+ * @{
+ */
+
+/**
+ * @class TripleBuffer
+ * @brief Lock-free single-producer/single-consumer value publication
+ * @tparam T Published type, must be copy-assignable
+ *
+ * @details
+ * The producer fills writeBuffer() and calls publish(); the consumer calls
+ * read() and gets the most recently published value. Neither side ever blocks
+ * or waits for the other. Slots are re-used, so assigning into writeBuffer()
+ * keeps the capacity of contained containers and strings.
+ *
+ * The three slot indices are packed into a single atomic byte together with a
+ * "fresh" flag. The producer owns the back slot, the consumer owns the front
+ * slot, and the middle slot is swapped atomically between them.
+ */
+template<typename T>
+class TripleBuffer
+{
+private:
+  static constexpr uint8_t FreshFlag = 0x40;
+  static constexpr uint8_t IndexMask = 0x03;
+
+  std::array<T, 3> m_slots{};
+  //! @brief Index of the middle slot (bits 0-1) and the fresh flag
+  std::atomic<uint8_t> m_middle{ 1 };
+  //! @brief Slot owned by the producer
+  uint8_t m_back = 0;
+  //! @brief Slot owned by the consumer
+  uint8_t m_front = 2;
+
+public:
+  DISABLE_COPY( TripleBuffer )
+
+  TripleBuffer() = default;
+
+  /**
+   * @brief Access the producer's slot
+   * @return The slot that will be published with the next publish() call
+   * @note Producer side only
+   */
+  T& writeBuffer() noexcept
+  {
+    return m_slots[m_back];
+  }
+
+  /**
+   * @brief Make the producer's slot visible to the consumer
+   * @note Producer side only
+   */
+  void publish() noexcept
+  {
+    m_back = m_middle.exchange( m_back | FreshFlag, std::memory_order_acq_rel ) & IndexMask;
+  }
+
+  /**
+   * @brief Get the latest published value
+   * @return Reference to the consumer's slot, valid until the next call to read()
+   * @note Consumer side only
+   */
+  const T& read() noexcept
+  {
+    if( m_middle.load( std::memory_order_relaxed ) & FreshFlag )
+    {
+      m_front = m_middle.exchange( m_front, std::memory_order_acq_rel ) & IndexMask;
+    }
+    return m_slots[m_front];
+  }
+
+  /**
+   * @brief Check whether a value was published since the last read()
+   * @note Consumer side only
+   */
+  bool hasFresh() const noexcept
+  {
+    return (m_middle.load( std::memory_order_relaxed ) & FreshFlag) != 0;
+  }
+};
+
+/**
+ * @}
+ */
+
+#endif
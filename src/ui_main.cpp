@@ -98,7 +98,7 @@ UIMain::UIMain(ppg::Widget* parent, const ppp::AbstractModule::Ptr& module, cons
   :
   Widget( parent ), m_position( nullptr ), m_screenSep1( nullptr ), m_screenSep2( nullptr ), m_playbackInfo( nullptr )
   , m_volBar( nullptr ), m_chanInfos(), m_chanCells()
-  , m_trackerInfo( nullptr ), m_modTitle( nullptr ), m_progress( nullptr ), m_module( module ), m_output( output )
+  , m_trackerInfo( nullptr ), m_modTitle( nullptr ), m_progress( nullptr ), m_module(), m_output( output )
   , m_fftLeft(), m_fftRight()
 {
   logger()->trace( L4CXX_LOCATION, "Initializing" );
@@ -163,6 +163,19 @@ UIMain::UIMain(ppg::Widget* parent, const ppp::AbstractModule::Ptr& module, cons
   m_modTitle->alignment = ppg::Label::Alignment::Center;
   m_modTitle->setFgColorRange( 0, ppg::Color::BrightWhite, 0 );
   m_modTitle->show();
+  setModule( module );
+  m_progress = new ppg::ProgressBar( this, 0, 40 );
+  m_progress->setPosition( (area().width() - 40) / 2, 3, false );
+  m_progress->setFgColor( ppg::Color::BrightWhite );
+  m_progress->show();
+  UIMain::toTop( m_progress );
+  logger()->trace( L4CXX_LOCATION, "Initialized" );
+}
+
+void UIMain::setModule(const ppp::AbstractModule::Ptr& module)
+{
+  LockGuard guard( this );
+  m_module = module;
   m_trackerInfo->setText( stringFmt( "Tracker: %s - Channels: %d",
                                      std::const_pointer_cast<const ppp::AbstractModule>( module )->metaInfo()
                                                                                                  .trackerInfo,
@@ -186,12 +199,6 @@ UIMain::UIMain(ppg::Widget* parent, const ppp::AbstractModule::Ptr& module, cons
   {
     m_modTitle->setText( std::string( " -=\xf0[ " ) + fname + " ]\xf0=- " );
   }
-  m_progress = new ppg::ProgressBar( this, 0, 40 );
-  m_progress->setPosition( (area().width() - 40) / 2, 3, false );
-  m_progress->setFgColor( ppg::Color::BrightWhite );
-  m_progress->show();
-  UIMain::toTop( m_progress );
-  logger()->trace( L4CXX_LOCATION, "Initialized" );
 }
 
 namespace
@@ -211,9 +218,11 @@ void UIMain::drawThis()
   }
   logger()->trace( L4CXX_LOCATION, "Updating" );
   m_volBar->shift( outLock->volumeLeft() >> 8, outLock->volumeRight() >> 8 );
-  size_t msecs = modLock->state().playedFrames / 441;
-  size_t msecslen = modLock->length() / 441;
-  const ppp::ModuleState state = modLock->state();
+  // never lock the module here, the render thread publishes everything we need
+  const ppp::AbstractModule::Snapshot& snapshot = modLock->snapshot();
+  const ppp::ModuleState& state = snapshot.state;
+  size_t msecs = state.playedFrames / 441;
+  size_t msecslen = snapshot.length / 441;
   std::string posStr = stringFmt( "{BrightWhite;}%3d{White;}(%3d){BrightWhite;}/%2d \xf9 %02d:%02d.%02d/%02d:%02d.%02d",
                                   state.order,
                                   state.pattern,
@@ -224,9 +233,9 @@ void UIMain::drawThis()
                                   msecslen / 6000,
                                   msecslen / 100 % 60,
                                   msecslen % 100 );
-  if( modLock->songCount() > 1 )
+  if( snapshot.songCount > 1 )
   {
-    posStr += stringFmt( " \xf9 Song %d/%d", modLock->currentSongIndex() + 1, modLock->songCount() );
+    posStr += stringFmt( " \xf9 Song %d/%d", snapshot.songIndex + 1, snapshot.songCount );
   }
   m_position->setEscapedText( posStr );
   m_playbackInfo->setEscapedText(
@@ -234,18 +243,18 @@ void UIMain::drawThis()
                state.speed,
                state.tempo,
                state.globalVolume * 100 / state.globalVolumeLimit ) );
-  for( int i = 0; i < modLock->channelCount(); i++ )
+  for( size_t i = 0; i < snapshot.channels.size(); i++ )
   {
     if( i >= 16 )
     {
       break;
     }
-    const ppp::ChannelState chanState = modLock->channelStatus( i );
+    const ppp::ChannelState& chanState = snapshot.channels[i];
     m_chanCells.at( i )->setText( chanState.cell );
     m_chanInfos.at( i )->setText( stateToString( i, chanState ) );
   }
-  m_progress->setMax( modLock->length() );
-  m_progress->setValue( modLock->state().playedFrames );
+  m_progress->setMax( snapshot.length );
+  m_progress->setValue( state.playedFrames );
   logger()->trace( L4CXX_LOCATION, "Drawing" );
 
   const int width = ppg::SDLScreen::instance()->area().width() * 8;
@@ -57,6 +57,11 @@ public:
 
   ~UIMain() override = default;
 
+  /**
+   * @brief Show another module, e.g. when the next playlist entry starts
+   */
+  void setModule(const ppp::AbstractModule::Ptr& module);
+
   void setFft(const std::vector<uint16_t>& left, const std::vector<uint16_t>& right)
   {
     m_fftLeft = left;
@@ -141,6 +141,32 @@ bool XmInstrument::load(Stream* str)
   return true;
 }
 
+bool XmInstrument::skip(Stream* str, std::vector<std::string>* sampleTitles)
+{
+  size_t startPos = str->pos();
+  InstrumentHeader hdr;
+  *str >> hdr;
+  if( hdr.numSamples > 255 )
+  {
+    return false;
+  }
+  str->seek( startPos + hdr.size );
+  // the sample headers are followed by the data of all samples
+  size_t dataSize = 0;
+  for( uint_fast16_t i = 0; i < hdr.numSamples; i++ )
+  {
+    int32_t length;
+    *str >> length;
+    str->seekrel( 14 );
+    char title[22];
+    str->read( title, 22 );
+    sampleTitles->emplace_back( stringncpy( title, 22 ) );
+    dataSize += std::max<int32_t>( length, 0 );
+  }
+  str->seekrel( dataSize );
+  return str->good();
+}
+
 uint8_t XmInstrument::mapNoteIndex(uint8_t note) const
 {
   if( note >= 96 )
@@ -165,6 +191,17 @@ const std::unique_ptr<XmSample>& XmInstrument::mapNoteSample(uint8_t note) const
   return m_samples[mapped];
 }
 
+void XmInstrument::prefetch() const
+{
+  for( const auto& smp: m_samples )
+  {
+    if( smp )
+    {
+      smp->prefetch();
+    }
+  }
+}
+
 std::string XmInstrument::title() const
 {
   return m_title;
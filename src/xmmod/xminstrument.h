@@ -98,6 +98,14 @@ public:
    */
   bool load(Stream* str);
 
+  /**
+   * @brief Skip an instrument in a stream, collecting its sample titles
+   * @param[in] str The stream positioned at the instrument
+   * @param[out] sampleTitles Receives the titles of the instrument's samples
+   * @return @c true on success
+   */
+  static bool skip(Stream* str, std::vector<std::string>* sampleTitles);
+
   /**
    * @brief Map a note index into its sample index
    * @param[in] note Note to map
@@ -114,6 +122,12 @@ public:
    */
   const std::unique_ptr<XmSample>& mapNoteSample(uint8_t note) const;
 
+  /**
+   * @brief Decode the instrument's lazily decoded samples
+   * @see Sample::prefetch()
+   */
+  void prefetch() const;
+
   /**
    * @brief Get the instrument's title
    * @return m_title
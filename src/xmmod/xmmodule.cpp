@@ -32,6 +32,7 @@
 #include "stream/stream.h"
 #include "genmod/channelstate.h"
 #include "genmod/orderentry.h"
+#include "stuff/profiler.h"
 
 #include <boost/algorithm/string.hpp>
 
@@ -80,6 +81,16 @@ constexpr std::array<const uint16_t, 12 * 8> g_PeriodTable = { {
                                                                  470, 467, 463, 460, 457
                                                                }
 };
+
+std::string trackerName(const XmHeader& hdr)
+{
+  std::string tmp = boost::algorithm::trim_copy( stringncpy( hdr.trackerName, 20 ) );
+  if( tmp.empty() )
+  {
+    return "<unknown>";
+  }
+  return tmp;
+}
 } // anonymous namespace
 
 XmModule::XmModule(int maxRpt, Sample::Interpolation inter)
@@ -116,17 +127,7 @@ bool XmModule::load(Stream* stream)
   stream->seek( hdr.headerSize + offsetof( XmHeader, headerSize ) );
   noConstMetaInfo().title = boost::algorithm::trim_copy( stringncpy( hdr.title, 20 ) );
   m_restartPos = hdr.restartPos;
-  {
-    std::string tmp = boost::algorithm::trim_copy( stringncpy( hdr.trackerName, 20 ) );
-    if( !tmp.empty() )
-    {
-      noConstMetaInfo().trackerInfo = tmp;
-    }
-    else
-    {
-      noConstMetaInfo().trackerInfo = "<unknown>";
-    }
-  }
+  noConstMetaInfo().trackerInfo = trackerName( hdr );
   setTempo( hdr.defaultTempo & 0xff );
   setSpeed( hdr.defaultSpeed & 0xff );
   state().globalVolume = 0x40;
@@ -191,6 +192,50 @@ bool XmModule::load(Stream* stream)
   return true;
 }
 
+std::unique_ptr<AbstractModule::ProbeInfo> XmModule::probe(Stream* stream)
+{
+  stream->seek( 0 );
+  XmHeader hdr;
+  *stream >> hdr;
+  if( !stream->good() || !std::equal( hdr.id, hdr.id + 17, "Extended Module: " ) || hdr.endOfFile != 0x1a
+    || hdr.version != 0x0104 )
+  {
+    return nullptr;
+  }
+
+  auto result = std::make_unique<ProbeInfo>();
+  result->filename = stream->name();
+  result->format = "xm";
+  result->title = boost::algorithm::trim_copy( stringncpy( hdr.title, 20 ) );
+  result->trackerInfo = trackerName( hdr );
+  result->channels = hdr.numChannels;
+  result->orders = hdr.songLength & 0xff;
+  result->patterns = hdr.numPatterns;
+  result->instruments = hdr.numInstruments;
+
+  stream->seek( hdr.headerSize + offsetof( XmHeader, headerSize ) );
+  for( uint_fast16_t i = 0; i < hdr.numPatterns; i++ )
+  {
+    // header length, pack type and row count precede the packed size
+    const size_t startPos = stream->pos();
+    uint32_t hdrLen;
+    *stream >> hdrLen;
+    stream->seekrel( 3 );
+    uint16_t packedSize;
+    *stream >> packedSize;
+    stream->seek( startPos + hdrLen + packedSize );
+  }
+  for( uint_fast16_t i = 0; i < hdr.numInstruments; i++ )
+  {
+    if( !XmInstrument::skip( stream, &result->sampleNames ) )
+    {
+      return nullptr;
+    }
+  }
+  result->samples = result->sampleNames.size();
+  return result;
+}
+
 size_t XmModule::internal_buildTick(const AudioFrameBufferPtr& buffer)
 {
   if( state().order >= orderCount() )
@@ -201,15 +246,23 @@ size_t XmModule::internal_buildTick(const AudioFrameBufferPtr& buffer)
   if( buffer )
   {
     MixerFrameBufferPtr mixerBuffer = std::make_shared<MixerFrameBuffer>( tickBufferLength() );
+    profile::count( profile::Counter::AnnotatedAllocations );
     const auto& currPat = m_patterns.at( state().pattern );
     for( uint8_t currTrack = 0; currTrack < channelCount(); currTrack++ )
     {
       const auto& chan = m_channels[currTrack];
       BOOST_ASSERT( chan != nullptr );
       const XmCell& cell = currPat->at( currTrack, state().row );
-      chan->update( cell, false );
-      chan->mixTick( mixerBuffer );
+      {
+        profile::ScopedTimer timer( profile::Stage::Update );
+        chan->update( cell, false );
+      }
+      {
+        profile::ScopedTimer timer( profile::Stage::Mix );
+        chan->mixTick( mixerBuffer );
+      }
     }
+    profile::ScopedTimer timer( profile::Stage::PostProcess );
     buffer->resize( mixerBuffer->size() );
     MixerSampleFrame* mixerBufferPtr = &mixerBuffer->front();
     BasicSampleFrame* bufPtr = &buffer->front();
@@ -334,6 +387,21 @@ int XmModule::internal_channelCount() const
   return m_channels.size();
 }
 
+void XmModule::internal_prefetch(size_t order)
+{
+  const auto& pattern = m_patterns.at( orderAt( order )->index() );
+  for( size_t row = 0; row < pattern->height(); row++ )
+  {
+    for( size_t chan = 0; chan < pattern->width(); chan++ )
+    {
+      if( const auto& instrument = getInstrument( pattern->at( chan, row ).instrument() ) )
+      {
+        instrument->prefetch();
+      }
+    }
+  }
+}
+
 const std::unique_ptr<XmInstrument>& XmModule::getInstrument(int idx) const
 {
   if( !between<int>( idx, 1, m_instruments.size() ) )
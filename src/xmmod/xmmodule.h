@@ -95,6 +95,13 @@ public:
                                                  int maxRpt,
                                                  Sample::Interpolation inter);
 
+  /**
+   * @brief Read the module's meta information without loading it
+   * @param[in] stream Module stream
+   * @return Meta information or nullptr if the stream does not contain an XM module
+   */
+  static std::unique_ptr<ProbeInfo> probe(Stream* stream);
+
   ~XmModule() override;
 
 private:
@@ -104,6 +111,8 @@ private:
 
   int internal_channelCount() const override;
 
+  void internal_prefetch(size_t order) override;
+
   /**
    * @brief Try to load a XM module
    * @param[in] filename Filename of the module to load
@@ -22,6 +22,7 @@
  */
 
 #include "xmsample.h"
+#include "genmod/sampledecoder.h"
 #include "stream/stream.h"
 
 namespace ppp
@@ -69,13 +70,13 @@ bool XmSample::load(Stream* str)
   m_16bit = (type & 0x10) != 0;
   if( m_16bit )
   {
-    resizeData( dataSize / 2u );
+    m_dataLength = dataSize / 2u;
     m_loopStart = loopStart / 2u;
     m_loopEnd = (loopStart + loopLen) / 2u;
   }
   else
   {
-    resizeData( dataSize );
+    m_dataLength = dataSize;
     m_loopStart = loopStart;
     m_loopEnd = loopStart + loopLen;
   }
@@ -91,30 +92,21 @@ bool XmSample::load(Stream* str)
 
 bool XmSample::loadData(Stream* str)
 {
-  if( length() == 0 )
+  if( m_dataLength == 0 )
     return true;
-  if( m_16bit )
-  { // 16 bit
-    int16_t smp16 = 0;
-    for( auto it = beginIterator(); it != endIterator(); ++it )
-    {
-      int16_t delta;
-      *str >> delta;
-      smp16 += delta;
-      it->left = it->right = smp16;
-    }
-  }
-  else
-  { // 8 bit
-    int8_t smp8 = 0;
-    for( auto it = beginIterator(); it != endIterator(); ++it )
-    {
-      int8_t delta;
-      *str >> delta;
-      smp8 += delta;
-      it->left = it->right = smp8 << 8;
-    }
+  const auto format = m_16bit ? sampledecoder::Format::Delta16 : sampledecoder::Format::Delta8;
+  const size_t count = m_dataLength;
+  const size_t size = count * sampledecoder::bytesPerValue( format );
+  const Decoder decoder = [format, count](Stream& stream, BasicSampleFrame* dest) {
+    sampledecoder::decode( stream, format, dest, count );
+  };
+  if( deferDecoding( str, count, size, decoder ) )
+  {
+    str->seekrel( size );
+    return str->good();
   }
+  resizeData( count );
+  decoder( *str, data() );
   return str->good();
 }
 
@@ -48,6 +48,8 @@ private:
   int8_t m_relativeNote;
   //! @brief Whether the sample is a 16-bit one
   bool m_16bit;
+  //! @brief Length in frames, the data is allocated by loadData()
+  size_t m_dataLength = 0;
   size_t m_loopStart = 0;
   size_t m_loopEnd = std::numeric_limits<size_t>::max();
   LoopType m_loopType = LoopType::None;
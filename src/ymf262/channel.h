@@ -40,9 +40,13 @@ class Operator;
 
 class Opl3;
 
+class OplLanes;
+
 class Channel
   : public ISerializable
 {
+  friend class OplLanes;
+
 public:
   DISABLE_COPY( Channel )
 
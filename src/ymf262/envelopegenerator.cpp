@@ -24,6 +24,7 @@
 
 #include "envelopegenerator.h"
 #include "opl3.h"
+#include <stream/abstractarchive.h>
 
 namespace opl
 {
@@ -89,7 +90,7 @@ uint8_t EnvelopeGenerator::calculateRate(uint8_t rateValue) const
   return std::min<uint8_t>( 60, rof + (rateValue << 2) );
 }
 
-inline uint8_t EnvelopeGenerator::advanceCounter(uint8_t rate)
+uint32_t EnvelopeGenerator::counterIncrement(uint8_t rate) const
 {
   BOOST_ASSERT( rate < 16 );
   if( rate == 0 )
@@ -104,7 +105,16 @@ inline uint8_t EnvelopeGenerator::advanceCounter(uint8_t rate)
   const uint8_t rof = effectiveRate & 3;
   BOOST_ASSERT( rof <= 3 );
   // 4 <= Delta <= (7<<15)
-  m_counter += uint32_t( 4 | rof ) << rateValue;
+  return uint32_t( 4 | rof ) << rateValue;
+}
+
+inline uint8_t EnvelopeGenerator::advanceCounter(uint8_t rate)
+{
+  if( rate == 0 )
+  {
+    return 0;
+  }
+  m_counter += counterIncrement( rate );
   // overflow <= 7
   uint8_t overflow = m_counter >> 15;
   BOOST_ASSERT( overflow <= 7 );
@@ -203,4 +213,11 @@ uint16_t EnvelopeGenerator::advance(bool egt, bool am)
     m_total = total;
   return m_total;
 }
-}
\ No newline at end of file
+
+AbstractArchive& EnvelopeGenerator::serialize(AbstractArchive* archive)
+{
+  *archive % m_stage % m_ar % m_dr % m_sl % m_rr % m_fnum % m_block % m_env
+    % m_ksr % m_tl % m_ksl % m_kslAdd % m_total % m_counter;
+  return *archive;
+}
+}
@@ -27,10 +27,14 @@
 
 #include <cstdint>
 
+class AbstractArchive;
+
 namespace opl
 {
 class Opl3;
 
+class OplLanes;
+
 /**
  * @class EnvelopeGenerator
  * @brief Envelope generator
@@ -41,6 +45,8 @@ class Opl3;
  */
 class EnvelopeGenerator
 {
+  friend class OplLanes;
+
 private:
   static constexpr uint16_t Silence = 511;
 
@@ -126,6 +132,13 @@ private:
    * @note This method is nearly frozen.
    */
   uint8_t calculateRate(uint8_t delta) const;
+  /**
+   * @brief Counter increment of a rate
+   * @param[in] rate Attack/decay/release rate
+   * @return Counter increment, 0 if @a rate is 0
+   * @pre rate<16
+   */
+  uint32_t counterIncrement(uint8_t rate) const;
   /**
    * @brief Advances the counter and returns the overflow
    * @param[in] rate Attack/decay/release rate
@@ -257,6 +270,11 @@ public:
   {
     m_stage = Stage::Release;
   }
+
+  /**
+   * @brief Archive the state, but not the owning chip
+   */
+  AbstractArchive& serialize(AbstractArchive* archive);
 };
 }
 
@@ -326,6 +326,28 @@ uint16_t sinLog(uint8_t ws, uint16_t phi)
   return 0x0C00;
 }
 
+struct TableValues
+  : Operator::Tables
+{
+  TableValues()
+    : Operator::Tables()
+  {
+    for( uint8_t ws = 0; ws < 8; ++ws )
+    {
+      for( uint16_t phi = 0; phi < 1024; ++phi )
+      {
+        log[ws * 1024 + phi] = sinLog( ws, phi );
+      }
+    }
+    for( int i = 0; i < 256; ++i )
+    {
+      exp[i] = (0x0400 + sinExpTable[i ^ 0xFF]) << 1;
+    }
+  }
+};
+
+const TableValues tableValues{};
+
 /**
  * @brief Calculate exponential value from logarithmic value
  * @param[in] expVal Exponent calculated by sinLog, including the envelope value and the @c SignBit.
@@ -338,8 +360,7 @@ int16_t sinExp(uint16_t expVal)
   expVal &= ~SignBit;
   // expVal: 0..2137+511*8 = 0..6225
   // result: 0..1018+1024
-  uint32_t result = 0x0400 + sinExpTable[(expVal & 0xff) ^ 0xFF];
-  result <<= 1;
+  uint32_t result = tableValues.exp[expVal & 0xff];
   result >>= (expVal >> 8); // exp
 
   if( isSigned )
@@ -359,16 +380,21 @@ int16_t sinExp(uint16_t expVal)
  * @param[in] ws Waveform selector (0..7), see reference manual
  * @param[in] phase Wave phase (0..1023)
  * @param[in] env Envelope value (0..511)
- * @note @a ws and @a phase will be bit-masked in sinLog().
+ * @note @a ws and @a phase will be bit-masked.
  * @warning @a env will not be checked for correct values.
  */
 int16_t oplSin(uint8_t ws, uint16_t phase, uint16_t env)
 {
   BOOST_ASSERT( env < 512 );
-  return sinExp( sinLog( ws, phase ) + (env << 3) );
+  return sinExp( tableValues.log[(ws & 7) * 1024 + (phase & 0x3ff)] + (env << 3) );
 }
 }
 
+const Operator::Tables& Operator::tables()
+{
+  return tableValues;
+}
+
 int16_t Operator::getOutput(uint16_t outputPhase, uint8_t ws)
 {
   if( m_envelopeGenerator.isSilent() )
@@ -380,7 +406,10 @@ int16_t Operator::getOutput(uint16_t outputPhase, uint8_t ws)
 
 AbstractArchive& Operator::serialize(AbstractArchive* archive)
 {
-  *archive % m_operatorBaseAddress % m_phaseGenerator % m_envelopeGenerator
+  // the generators are archived field by field, so that they stay attached to this chip
+  m_phaseGenerator.serialize( archive );
+  m_envelopeGenerator.serialize( archive );
+  *archive % m_operatorBaseAddress
     % m_phase % m_am % m_vib % m_egt
     % m_ws % m_f_number % m_block;
   return *archive;
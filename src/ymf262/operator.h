@@ -38,9 +38,13 @@ namespace opl
 {
 class Opl3;
 
+class OplLanes;
+
 class Operator
   : public ISerializable
 {
+  friend class OplLanes;
+
 public:
   DISABLE_COPY( Operator )
 
@@ -53,6 +57,26 @@ public:
     SL4_RR4_Offset = 0x80,
     _5_WS3_Offset = 0xE0;
 
+  /**
+   * @brief Waveform tables
+   *
+   * @details
+   * Every operator of every chip needs one value per sample, so the waveform
+   * switch is resolved once here instead of for each sample.
+   */
+  struct Tables
+  {
+    /**
+     * @brief Logarithmic waveform values, indexed by @c ws*1024+phase
+     * @note The last entry pads the table for 32 bit loads.
+     */
+    uint16_t log[8 * 1024 + 1];
+    //! @brief Exponential values of the lower 8 bits of the logarithm, not yet shifted
+    uint32_t exp[256];
+  };
+
+  static const Tables& tables();
+
 private:
   Opl3* m_opl;
   int m_operatorBaseAddress;
@@ -23,6 +23,7 @@
  */
 
 #include "opl3.h"
+#include "oplcapture.h"
 #include <stream/abstractarchive.h>
 #include <stuff/numberutils.h>
 
@@ -139,6 +140,11 @@ Opl3::Opl3()
 
 void Opl3::read(std::array<int16_t, 4>* dest)
 {
+  if( m_capture )
+  {
+    m_capture->sample( *this );
+  }
+
   std::array<int32_t, 4> outputBuffer;
   outputBuffer.fill( 0 );
 
@@ -157,6 +163,11 @@ void Opl3::read(std::array<int16_t, 4>* dest)
     }
   }
 
+  finishSample( outputBuffer, dest );
+}
+
+void Opl3::finishSample(std::array<int32_t, 4>& outputBuffer, std::array<int16_t, 4>* dest)
+{
   if( dest )
   {
     for( int outputChannelNumber = 0; outputChannelNumber < 4; outputChannelNumber++ )
@@ -195,6 +206,11 @@ void Opl3::write(int array, int address, uint8_t data)
     return;
   }
 
+  if( m_capture )
+  {
+    m_capture->write( registerAddress, data );
+  }
+
   m_registers[registerAddress] = data;
   switch( address & 0xE0 )
   {
@@ -402,14 +418,15 @@ void Opl3::set4opConnections()
 
 AbstractArchive& Opl3::serialize(AbstractArchive* archive)
 {
-  // reset channel pointers to not mix different channel data
-  for( int i = 6; i < 9; i++ )
-  {
-    m_channels[0][i] = m_channels2op[0][i];
-  }
   archive->array( m_registers, sizeof(m_registers) / sizeof(m_registers[0]) )
     % m_nts % m_dam % m_dvb % m_ryt % m_bd % m_sd % m_tc % m_hh
     % m_new % m_vibratoIndex % m_tremoloIndex % m_rand;
+  if( archive->isLoading() )
+  {
+    // the channel mapping depends on the registers, restore it before the operators
+    // so that updating the channels does not overwrite the loaded operator states
+    set4opConnections();
+  }
   for( int i = 0; i < 2; i++ )
   {
     for( int j = 0; j < 0x16; j++ )
@@ -420,16 +437,21 @@ AbstractArchive& Opl3::serialize(AbstractArchive* archive)
       }
     }
   }
+  // archive all channels, not only the mapped ones, so that switching between
+  // 2-op and 4-op mode after loading continues with the right feedback states
   for( int i = 0; i < 2; i++ )
   {
     for( int j = 0; j < 9; j++ )
     {
-      if( m_channels[i][j] )
-      {
-        archive->archive( m_channels[i][j].get() );
-      }
+      archive->archive( m_channels2op[i][j].get() );
+    }
+    for( int j = 0; j < 3; j++ )
+    {
+      archive->archive( m_channels4op[i][j].get() );
     }
   }
+  archive->archive( m_disabledChannel.get() );
+  m_filters.serialize( archive );
   return *archive;
 }
-}
\ No newline at end of file
+}
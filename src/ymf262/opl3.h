@@ -39,6 +39,10 @@ class OperatorView;
 
 class SlotView;
 
+class OplCapture;
+
+class OplLanes;
+
 class Opl3
   : public ISerializable
 {
@@ -46,7 +50,12 @@ class Opl3
 
   friend class SlotView;
 
+  friend class OplLanes;
+
 public:
+  //! @brief A copy would share the operators, the channels and the capture with the original
+  DISABLE_COPY( Opl3 )
+
   static constexpr const unsigned int MasterClock = static_cast<unsigned int>(14.31818e6);
   static constexpr const unsigned int SampleRate = MasterClock / 288;
 
@@ -102,6 +111,8 @@ private:
   uint16_t m_tremoloIndex = 0;
   //! @brief Random number generator
   uint32_t m_rand = 1;
+  //! @brief Receives all register writes and rendered samples, not owned
+  OplCapture* m_capture = nullptr;
 
 public:
   uint32_t randBit() const
@@ -187,6 +198,20 @@ public:
 
   void read(std::array<int16_t, 4>* dest);
 
+  /**
+   * @brief Record all following register writes and rendered samples
+   * @param[in] capture The capture, or @c nullptr to stop recording; must outlive the chip or be detached
+   */
+  void setCapture(OplCapture* capture) noexcept
+  {
+    m_capture = capture;
+  }
+
+  OplCapture* capture() const noexcept
+  {
+    return m_capture;
+  }
+
   Opl3();
 
   AbstractArchive& serialize(AbstractArchive* archive) override;
@@ -204,6 +229,13 @@ private:
 
   void write(int array, int address, uint8_t data);
 
+  /**
+   * @brief Mix the channel outputs and advance the chip-wide generators
+   * @param[in,out] outputBuffer Sum of the channel outputs
+   * @param[out] dest Receives the sample, may be @c nullptr
+   */
+  void finishSample(std::array<int32_t, 4>& outputBuffer, std::array<int16_t, 4>* dest);
+
   void replaceRegBits(int address, uint8_t ofs, uint8_t count, uint8_t value)
   {
     BOOST_ASSERT( value < (1 << count) );
@@ -0,0 +1,289 @@
+/*
+ * PPPlay - an old-fashioned module player
+ * Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "oplcapture.h"
+
+#include <stream/abstractarchive.h>
+#include <stream/memorystream.h>
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace opl
+{
+namespace
+{
+constexpr char Magic[8] = { 'P', 'P', 'P', 'O', 'P', 'L', 'C', 'P' };
+constexpr uint32_t Version = 1;
+
+void writeVarint(std::vector<uint8_t>& dest, uint64_t value)
+{
+  while( value >= 0x80 )
+  {
+    dest.emplace_back( static_cast<uint8_t>(value | 0x80) );
+    value >>= 7;
+  }
+  dest.emplace_back( static_cast<uint8_t>(value) );
+}
+
+/**
+ * @brief Decode a write
+ * @param[in] writes Encoded writes
+ * @param[in,out] offset Start of the write, set to the start of the following write
+ * @param[in,out] time Time of the previous write, set to the time of the decoded one
+ * @param[out] reg Register
+ * @param[out] value Value
+ * @return @c false if there is no complete write at @a offset
+ */
+bool decodeWrite(const std::vector<uint8_t>& writes, size_t& offset, uint64_t& time, uint16_t& reg, uint8_t& value)
+{
+  uint64_t header = 0;
+  size_t pos = offset;
+  for( int shift = 0; ; shift += 7 )
+  {
+    if( pos >= writes.size() || shift > 63 )
+    {
+      return false;
+    }
+    const uint8_t byte = writes[pos++];
+    header |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if( (byte & 0x80) == 0 )
+    {
+      break;
+    }
+  }
+  if( pos + 2 > writes.size() )
+  {
+    return false;
+  }
+  time += header >> 1;
+  reg = static_cast<uint16_t>(((header & 1) << 8) | writes[pos]);
+  value = writes[pos + 1];
+  offset = pos + 2;
+  return true;
+}
+
+template<typename T>
+T readValue(Stream& stream)
+{
+  T value;
+  stream.read( &value );
+  if( !stream.good() )
+  {
+    throw std::runtime_error( "Unexpected end of OPL capture" );
+  }
+  return value;
+}
+}
+
+OplCapture::OplCapture(uint32_t snapshotInterval)
+  : m_snapshotInterval( std::max( snapshotInterval, 1u ) )
+{
+}
+
+void OplCapture::write(uint16_t reg, uint8_t value)
+{
+  BOOST_ASSERT( reg < 0x200 );
+  writeVarint( m_writes, ((m_time - m_lastWrite) << 1) | (reg >> 8) );
+  m_writes.emplace_back( static_cast<uint8_t>(reg) );
+  m_writes.emplace_back( value );
+  m_lastWrite = m_time;
+}
+
+void OplCapture::sample(Opl3& chip)
+{
+  if( m_time % m_snapshotInterval == 0 )
+  {
+    auto stream = std::make_shared<MemoryStream>();
+    AbstractArchive archive( stream );
+    chip.serialize( &archive );
+
+    Snapshot snapshot{ m_time, m_writes.size(), m_lastWrite, {} };
+    snapshot.state.resize( static_cast<size_t>(stream->size()) );
+    stream->seek( 0 );
+    stream->read( snapshot.state.data(), snapshot.state.size() );
+    m_snapshots.emplace_back( std::move( snapshot ) );
+  }
+  ++m_time;
+}
+
+const OplCapture::Snapshot* OplCapture::snapshotAt(uint64_t time) const
+{
+  auto it = std::upper_bound( m_snapshots.begin(), m_snapshots.end(), time,
+                              [](uint64_t t, const Snapshot& snapshot)
+                              {
+                                return t < snapshot.time;
+                              } );
+  if( it == m_snapshots.begin() )
+  {
+    return nullptr;
+  }
+  return &*std::prev( it );
+}
+
+void OplCapture::save(Stream& stream) const
+{
+  stream.write( Magic, sizeof( Magic ) );
+  stream.write( &Version );
+  stream.write( &m_snapshotInterval );
+  stream.write( &m_time );
+  stream.write( &m_lastWrite );
+  const uint64_t writesSize = m_writes.size();
+  stream.write( &writesSize );
+  stream.write( m_writes.data(), m_writes.size() );
+  const uint64_t snapshotCount = m_snapshots.size();
+  stream.write( &snapshotCount );
+  for( const Snapshot& snapshot: m_snapshots )
+  {
+    stream.write( &snapshot.time );
+    stream.write( &snapshot.offset );
+    stream.write( &snapshot.lastWrite );
+    const uint64_t stateSize = snapshot.state.size();
+    stream.write( &stateSize );
+    stream.write( snapshot.state.data(), snapshot.state.size() );
+  }
+}
+
+std::unique_ptr<OplCapture> OplCapture::load(Stream& stream)
+{
+  char magic[sizeof( Magic )];
+  stream.read( magic, sizeof( magic ) );
+  if( !stream.good() || std::memcmp( magic, Magic, sizeof( Magic ) ) != 0 )
+  {
+    throw std::runtime_error( "Not an OPL capture" );
+  }
+  if( readValue<uint32_t>( stream ) != Version )
+  {
+    throw std::runtime_error( "Unsupported OPL capture version" );
+  }
+
+  std::unique_ptr<OplCapture> capture( new OplCapture( readValue<uint32_t>( stream ) ) );
+  capture->m_time = readValue<uint64_t>( stream );
+  capture->m_lastWrite = readValue<uint64_t>( stream );
+
+  const auto remaining = [&stream]()
+  {
+    return static_cast<uint64_t>(stream.size() - stream.pos());
+  };
+
+  const auto writesSize = readValue<uint64_t>( stream );
+  if( writesSize > remaining() )
+  {
+    throw std::runtime_error( "Truncated OPL capture" );
+  }
+  capture->m_writes = stream.readVector<uint8_t>( writesSize );
+
+  const auto snapshotCount = readValue<uint64_t>( stream );
+  for( uint64_t i = 0; i < snapshotCount; ++i )
+  {
+    Snapshot snapshot{ readValue<uint64_t>( stream ), readValue<uint64_t>( stream ), readValue<uint64_t>( stream ), {} };
+    const auto stateSize = readValue<uint64_t>( stream );
+    if( stateSize > remaining() )
+    {
+      throw std::runtime_error( "Truncated OPL capture" );
+    }
+    if( snapshot.offset > writesSize || snapshot.time > capture->m_time
+        || (!capture->m_snapshots.empty() && snapshot.time <= capture->m_snapshots.back().time) )
+    {
+      throw std::runtime_error( "Invalid OPL capture snapshot index" );
+    }
+    snapshot.state = stream.readVector<uint8_t>( stateSize );
+    capture->m_snapshots.emplace_back( std::move( snapshot ) );
+  }
+  if( !stream.good() )
+  {
+    throw std::runtime_error( "Truncated OPL capture" );
+  }
+  return capture;
+}
+
+OplReplayer::OplReplayer(const OplCapture& capture)
+  : m_capture( capture )
+{
+  if( const OplCapture::Snapshot* snapshot = capture.snapshotAt( 0 ) )
+  {
+    restore( *snapshot );
+  }
+  else
+  {
+    fetchNextWrite( 0 );
+  }
+}
+
+void OplReplayer::restore(const OplCapture::Snapshot& snapshot)
+{
+  auto stream = std::make_shared<MemoryStream>();
+  stream->write( snapshot.state.data(), snapshot.state.size() );
+  AbstractArchive archive( stream );
+  archive.finishSave();
+  m_chip.serialize( &archive );
+
+  m_time = snapshot.time;
+  m_offset = snapshot.offset;
+  fetchNextWrite( snapshot.lastWrite );
+}
+
+void OplReplayer::fetchNextWrite(uint64_t lastWrite)
+{
+  m_nextWrite = lastWrite;
+  if( !decodeWrite( m_capture.writes(), m_offset, m_nextWrite, m_nextReg, m_nextValue ) )
+  {
+    m_nextWrite = std::numeric_limits<uint64_t>::max();
+  }
+}
+
+void OplReplayer::seek(uint64_t time)
+{
+  time = std::min( time, m_capture.length() );
+  const OplCapture::Snapshot* snapshot = m_capture.snapshotAt( time );
+  if( snapshot != nullptr && (m_time > time || m_time < snapshot->time) )
+  {
+    restore( *snapshot );
+  }
+
+  std::array<int16_t, 4> discard;
+  while( m_time < time )
+  {
+    render( &discard, 1 );
+  }
+}
+
+size_t OplReplayer::render(std::array<int16_t, 4>* dest, size_t count)
+{
+  for( size_t i = 0; i < count; ++i )
+  {
+    if( m_time >= m_capture.length() )
+    {
+      return i;
+    }
+    while( m_nextWrite <= m_time )
+    {
+      m_chip.writeReg( m_nextReg, m_nextValue );
+      fetchNextWrite( m_nextWrite );
+    }
+    m_chip.read( dest != nullptr ? dest + i : nullptr );
+    ++m_time;
+  }
+  return count;
+}
+}
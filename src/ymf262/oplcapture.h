@@ -0,0 +1,189 @@
+/*
+ * PPPlay - an old-fashioned module player
+ * Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PPP_OPL_OPLCAPTURE_H
+#define PPP_OPL_OPLCAPTURE_H
+
+#include "opl3.h"
+
+#include "stuff/utils.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Stream;
+
+namespace opl
+{
+/**
+ * @brief Records the register writes of a chip together with periodic chip snapshots
+ *
+ * @details
+ * Attach the capture with Opl3::setCapture() and run the player as usual. Every
+ * register write is stored as a variable-length delay in samples since the previous
+ * write, followed by the register and the value, so that a typical write takes three
+ * bytes. Before rendering every @c snapshotInterval-th sample, the complete chip
+ * state is archived and indexed by its sample time.
+ *
+ * An OplReplayer renders the chip output from the capture alone, without running
+ * the player logic again, and can seek to any sample by restoring the nearest
+ * preceding snapshot. Several replayers may share one capture, e.g. to render
+ * segments in parallel. badplay records a capture with @c --capture and plays it
+ * back with @c --replay.
+ *
+ * @note Snapshots contain the chip state in the host's binary layout, so saved
+ *       captures are only portable between builds of the same architecture.
+ */
+class OplCapture
+{
+public:
+  DISABLE_COPY( OplCapture )
+
+  struct Snapshot
+  {
+    //! @brief Number of samples rendered before the snapshot was taken
+    uint64_t time;
+    //! @brief Offset of the first write following the snapshot
+    uint64_t offset;
+    //! @brief Time of the last write before the snapshot, base for the next delay
+    uint64_t lastWrite;
+    //! @brief The archived chip state
+    std::vector<uint8_t> state;
+  };
+
+  /**
+   * @param[in] snapshotInterval Samples between two snapshots, defaults to one second
+   */
+  explicit OplCapture(uint32_t snapshotInterval = Opl3::SampleRate);
+
+  //! @brief Called by the chip for every register write
+  void write(uint16_t reg, uint8_t value);
+
+  //! @brief Called by the chip before a sample is rendered
+  void sample(Opl3& chip);
+
+  //! @brief Number of captured samples
+  uint64_t length() const noexcept
+  {
+    return m_time;
+  }
+
+  uint32_t snapshotInterval() const noexcept
+  {
+    return m_snapshotInterval;
+  }
+
+  const std::vector<uint8_t>& writes() const noexcept
+  {
+    return m_writes;
+  }
+
+  /**
+   * @brief Find the latest snapshot at or before a sample time
+   * @param[in] time Sample time
+   * @return The snapshot, or @c nullptr if nothing has been captured
+   */
+  const Snapshot* snapshotAt(uint64_t time) const;
+
+  /**
+   * @brief Write the capture to a stream
+   * @param[in] stream Destination stream
+   */
+  void save(Stream& stream) const;
+
+  /**
+   * @brief Read a capture written by save()
+   * @param[in] stream Source stream
+   * @return The capture
+   * @throws std::runtime_error if the stream does not contain a valid capture
+   */
+  static std::unique_ptr<OplCapture> load(Stream& stream);
+
+private:
+  const uint32_t m_snapshotInterval;
+  uint64_t m_time = 0;
+  uint64_t m_lastWrite = 0;
+  std::vector<uint8_t> m_writes{};
+  std::vector<Snapshot> m_snapshots{};
+};
+
+/**
+ * @brief Renders the chip output recorded by an OplCapture
+ */
+class OplReplayer
+{
+public:
+  DISABLE_COPY( OplReplayer )
+
+  /**
+   * @param[in] capture The capture to render, must outlive the replayer
+   */
+  explicit OplReplayer(const OplCapture& capture);
+
+  /**
+   * @brief Continue rendering at a sample time
+   * @param[in] time Sample time, clipped to the capture length
+   *
+   * @details
+   * Restores the nearest preceding snapshot unless the current position is
+   * closer, and renders forward from there.
+   */
+  void seek(uint64_t time);
+
+  /**
+   * @brief Render samples, applying the captured writes
+   * @param[out] dest Destination, may be @c nullptr to advance without output
+   * @param[in] count Number of samples to render
+   * @return Number of rendered samples, less than @a count at the end of the capture
+   *
+   * @note Advancing without output also skips the output filter; use seek()
+   *       to keep the output identical to the original rendering.
+   */
+  size_t render(std::array<int16_t, 4>* dest, size_t count);
+
+  uint64_t position() const noexcept
+  {
+    return m_time;
+  }
+
+  const Opl3& chip() const noexcept
+  {
+    return m_chip;
+  }
+
+private:
+  const OplCapture& m_capture;
+  Opl3 m_chip{};
+  uint64_t m_time = 0;
+  //! @brief Offset of the write following the pending one
+  size_t m_offset = 0;
+  //! @brief Time of the pending write, @c UINT64_MAX if there is none
+  uint64_t m_nextWrite = 0;
+  uint16_t m_nextReg = 0;
+  uint8_t m_nextValue = 0;
+
+  void restore(const OplCapture::Snapshot& snapshot);
+
+  void fetchNextWrite(uint64_t lastWrite);
+};
+}
+
+#endif
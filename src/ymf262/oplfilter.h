@@ -3,6 +3,13 @@
 #include <cmath>
 #include <array>
 #include <numeric>
+#include <type_traits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <stream/abstractarchive.h>
 
 namespace opl
 {
@@ -55,6 +62,11 @@ public:
 
     return std::inner_product( m_sr.begin(), m_sr.end(), m_taps.begin(), 0.0 );
   }
+
+  AbstractArchive& serialize(AbstractArchive* archive)
+  {
+    return archive->array( m_sr.data(), m_sr.size() );
+  }
 };
 
 template<int InputRate, int Cutoff, int NTaps>
@@ -93,6 +105,11 @@ public:
 
     return std::inner_product( m_sr.begin(), m_sr.end(), m_taps.begin(), 0.0f );
   }
+
+  AbstractArchive& serialize(AbstractArchive* archive)
+  {
+    return archive->array( m_sr.data(), m_sr.size() );
+  }
 };
 
 template<int InputRate, int CutoffLow, int CutoffHigh, int NTaps>
@@ -102,26 +119,31 @@ class BandPassFilter
   static_assert( InputRate > 0, "Invalid input sample rate" );
   static_assert( CutoffLow > 0 && CutoffLow < InputRate / 2, "Invalid lowpass cutoff frequency" );
   static_assert( CutoffHigh > 0 && CutoffHigh < InputRate / 2, "Invalid highpass cutoff frequency" );
-private:
-  std::array<float_t, NTaps> m_taps = detail::createZeroArray<float_t, NTaps>();
-  std::array<float_t, NTaps> m_sr = detail::createZeroArray<float_t, NTaps>();
-
 public:
-  BandPassFilter()
+  static constexpr int Taps = NTaps;
+
+  static std::array<float_t, NTaps> createTaps()
   {
     static constexpr float_t lambda = 2 * detail::Pi * CutoffLow / InputRate;
     static constexpr float_t phi = 2 * detail::Pi * CutoffHigh / InputRate;
 
+    std::array<float_t, NTaps> taps;
     for( int n = 0; n < NTaps; n++ )
     {
       float_t mm = n - (NTaps - 1) / 2.0f;
       if( mm == 0.0 )
-        m_taps[n] = (phi - lambda) / detail::Pi;
+        taps[n] = (phi - lambda) / detail::Pi;
       else
-        m_taps[n] = (std::sin( mm * phi ) - std::sin( mm * lambda )) / (mm * detail::Pi);
+        taps[n] = (std::sin( mm * phi ) - std::sin( mm * lambda )) / (mm * detail::Pi);
     }
+    return taps;
   }
 
+private:
+  std::array<float_t, NTaps> m_taps = createTaps();
+  std::array<float_t, NTaps> m_sr = detail::createZeroArray<float_t, NTaps>();
+
+public:
   float_t filter(float_t sample)
   {
     // push the sample to the front
@@ -133,24 +155,92 @@ public:
 
     return std::inner_product( m_sr.begin(), m_sr.end(), m_taps.begin(), 0.0f );
   }
+
+  AbstractArchive& serialize(AbstractArchive* archive)
+  {
+    return archive->array( m_sr.data(), m_sr.size() );
+  }
 };
 
+/**
+ * @brief Applies the same filter to several channels
+ * @tparam Filter Provides the taps through @c Taps and @c createTaps()
+ *
+ * @details
+ * The histories of all channels are stored tap by tap, so that a tap is applied
+ * to all channels at once; with 4 channels, this maps directly to SSE2 registers.
+ * The products are summed in the same order as Filter::filter(), so the results
+ * are identical.
+ */
 template<int N, class Filter>
 class MultiplexFilter
 {
 private:
-  std::array<Filter, N> m_filters;
-public:
-  MultiplexFilter()
-    : m_filters()
+  static constexpr int Taps = Filter::Taps;
+
+  std::array<float_t, Taps> m_taps = Filter::createTaps();
+  //! @brief Input history, m_sr[tap][channel]
+  std::array<std::array<float_t, N>, Taps> m_sr{ {} };
+
+  template<class T>
+  void filter(std::array<T, N>& samples, std::false_type)
   {
+    for( int i = Taps - 1; i >= 1; --i )
+      m_sr[i] = m_sr[i - 1];
+    for( int n = 0; n < N; ++n )
+      m_sr[0][n] = samples[n];
+
+    std::array<float_t, N> acc;
+    acc.fill( 0 );
+    for( int i = 0; i < Taps; ++i )
+    {
+      for( int n = 0; n < N; ++n )
+        acc[n] = acc[n] + m_sr[i][n] * m_taps[i];
+    }
+    for( int n = 0; n < N; ++n )
+      samples[n] = static_cast<T>(acc[n]);
   }
 
+#ifdef __SSE2__
+  void filter(std::array<int32_t, 4>& samples, std::true_type)
+  {
+    for( int i = Taps - 1; i >= 1; --i )
+      m_sr[i] = m_sr[i - 1];
+    const __m128 input = _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>(samples.data()) ) );
+    _mm_storeu_ps( m_sr[0].data(), input );
+
+    __m128 acc = _mm_setzero_ps();
+    for( int i = 0; i < Taps; ++i )
+    {
+      acc = _mm_add_ps( acc, _mm_mul_ps( _mm_loadu_ps( m_sr[i].data() ), _mm_set1_ps( m_taps[i] ) ) );
+    }
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(samples.data()), _mm_cvttps_epi32( acc ) );
+  }
+#endif
+
+public:
+  MultiplexFilter() = default;
+
   template<class T>
   void filter(std::array<T, N>& samples)
   {
-    for( int i = 0; i < N; ++i )
-      samples[i] = static_cast<T>(m_filters[i].filter( samples[i] ));
+#ifdef __SSE2__
+    filter( samples, std::integral_constant<bool, N == 4 && std::is_same<T, int32_t>::value
+                                                  && std::is_same<float_t, float>::value>() );
+#else
+    filter( samples, std::false_type() );
+#endif
+  }
+
+  AbstractArchive& serialize(AbstractArchive* archive)
+  {
+    // channel by channel, like the single filters
+    for( int n = 0; n < N; ++n )
+    {
+      for( int i = 0; i < Taps; ++i )
+        *archive % m_sr[i][n];
+    }
+    return *archive;
   }
 };
 }
@@ -0,0 +1,354 @@
+/*
+ * PPPlay - an old-fashioned module player
+ * Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "opllanes.h"
+#include "oplcapture.h"
+#include "opllaneskernel.h"
+
+#include <boost/assert.hpp>
+
+#include <cstring>
+
+namespace opl
+{
+namespace lanes
+{
+namespace
+{
+#ifdef __GNUC__
+//! @brief Vector operations using the generic vector extensions, 4 lanes
+struct Generic
+{
+  typedef int32_t Vec __attribute__((vector_size(16)));
+  typedef uint32_t UVec __attribute__((vector_size(16)));
+  static constexpr size_t Width = 4;
+
+  static Vec load(const int32_t* src)
+  {
+    Vec result;
+    std::memcpy( &result, src, sizeof(result) );
+    return result;
+  }
+
+  static void store(int32_t* dest, const Vec& x)
+  {
+    std::memcpy( dest, &x, sizeof(x) );
+  }
+
+  static Vec splat(int32_t value)
+  {
+    return Vec{ value, value, value, value };
+  }
+
+  static Vec eq(const Vec& a, const Vec& b)
+  {
+    return a == b;
+  }
+
+  static Vec gt(const Vec& a, const Vec& b)
+  {
+    return a > b;
+  }
+
+  static Vec select(const Vec& mask, const Vec& a, const Vec& b)
+  {
+    return (mask & a) | (~mask & b);
+  }
+
+  static Vec add(const Vec& a, const Vec& b)
+  {
+    return reinterpret_cast<Vec>(reinterpret_cast<UVec>(a) + reinterpret_cast<UVec>(b));
+  }
+
+  static Vec toInt16(const Vec& x)
+  {
+    return reinterpret_cast<Vec>(reinterpret_cast<UVec>(x) << 16) >> 16;
+  }
+
+  static Vec gatherLog(const uint16_t* table, const Vec& index)
+  {
+    return Vec{ table[index[0]], table[index[1]], table[index[2]], table[index[3]] };
+  }
+
+  static Vec gatherExp(const uint32_t* table, const Vec& index)
+  {
+    return Vec{
+      static_cast<int32_t>(table[index[0]]), static_cast<int32_t>(table[index[1]]),
+      static_cast<int32_t>(table[index[2]]), static_cast<int32_t>(table[index[3]])
+    };
+  }
+};
+#else
+//! @brief Vector operations on single lanes
+struct Generic
+{
+  typedef int32_t Vec;
+  static constexpr size_t Width = 1;
+
+  static Vec load(const int32_t* src)
+  {
+    return *src;
+  }
+
+  static void store(int32_t* dest, Vec x)
+  {
+    *dest = x;
+  }
+
+  static Vec splat(int32_t value)
+  {
+    return value;
+  }
+
+  static Vec eq(Vec a, Vec b)
+  {
+    return a == b ? -1 : 0;
+  }
+
+  static Vec gt(Vec a, Vec b)
+  {
+    return a > b ? -1 : 0;
+  }
+
+  static Vec select(Vec mask, Vec a, Vec b)
+  {
+    return mask ? a : b;
+  }
+
+  static Vec add(Vec a, Vec b)
+  {
+    return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+  }
+
+  static Vec toInt16(Vec x)
+  {
+    return static_cast<int16_t>(x);
+  }
+
+  static Vec gatherLog(const uint16_t* table, Vec index)
+  {
+    return table[index];
+  }
+
+  static Vec gatherExp(const uint32_t* table, Vec index)
+  {
+    return static_cast<int32_t>(table[index]);
+  }
+};
+#endif
+
+static_assert( MaxLanes % Generic::Width == 0, "Lane count must be a multiple of the vector width" );
+}
+
+void render(State* state, size_t count)
+{
+  Kernel<Generic>::render( state, count );
+}
+}
+
+namespace
+{
+constexpr int32_t mask(bool value)
+{
+  return value ? -1 : 0;
+}
+
+void renderLanes(lanes::State* state, size_t count)
+{
+#ifdef PPP_OPL_LANES_AVX2
+  static const bool hasAvx2 = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) != 0;
+  }();
+  if( hasAvx2 )
+  {
+    lanes::renderAvx2( state, count );
+    return;
+  }
+#endif
+  lanes::render( state, count );
+}
+}
+
+static_assert( OplLanes::MaxLanes == lanes::MaxLanes, "Inconsistent lane count" );
+
+OplLanes::OplLanes(size_t lanes)
+  : m_chips(), m_state( new lanes::State() ), m_chipStale( lanes, false ), m_laneStale( lanes, true )
+{
+  BOOST_ASSERT( lanes > 0 && lanes <= MaxLanes );
+  for( size_t i = 0; i < lanes; ++i )
+  {
+    m_chips.emplace_back( new Opl3() );
+  }
+  m_state->sinLog = Operator::tables().log;
+  m_state->sinExp = Operator::tables().exp;
+}
+
+OplLanes::~OplLanes() = default;
+
+Opl3& OplLanes::chip(size_t lane)
+{
+  BOOST_ASSERT( lane < m_chips.size() );
+  if( m_chipStale[lane] )
+  {
+    storeLane( lane );
+    m_chipStale[lane] = false;
+  }
+  m_laneStale[lane] = true;
+  return *m_chips[lane];
+}
+
+void OplLanes::read(std::array<int16_t, 4>* dest)
+{
+  lanes::State& state = *m_state;
+  for( size_t lane = 0; lane < m_chips.size(); ++lane )
+  {
+    Opl3& chip = *m_chips[lane];
+    if( m_laneStale[lane] )
+    {
+      loadLane( lane );
+      m_laneStale[lane] = false;
+    }
+    if( chip.m_capture )
+    {
+      if( m_chipStale[lane] )
+      {
+        storeLane( lane );
+        m_chipStale[lane] = false;
+      }
+      chip.m_capture->sample( chip );
+    }
+    state.vibratoIndex.v[lane] = chip.m_vibratoIndex;
+    state.tremoloIndex.v[lane] = chip.m_tremoloIndex;
+    state.randBit.v[lane] = chip.randBit();
+  }
+
+  renderLanes( m_state.get(), m_chips.size() );
+
+  for( size_t lane = 0; lane < m_chips.size(); ++lane )
+  {
+    std::array<int32_t, 4> outputBuffer;
+    for( size_t i = 0; i < 4; ++i )
+    {
+      outputBuffer[i] = state.output[i].v[lane];
+    }
+    m_chips[lane]->finishSample( outputBuffer, dest != nullptr ? &dest[lane] : nullptr );
+    m_chipStale[lane] = true;
+  }
+}
+
+void OplLanes::loadLane(size_t lane)
+{
+  const Opl3& chip = *m_chips[lane];
+  lanes::State& state = *m_state;
+  for( int array = 0; array < 2; ++array )
+  {
+    for( int i = 0; i < 18; ++i )
+    {
+      // offsets 0x00..0x05, 0x08..0x0d, 0x10..0x15
+      const int offset = (i / 6) * 8 + i % 6;
+      const Operator& op = *chip.m_operators[array][offset];
+      const PhaseGenerator& pg = op.m_phaseGenerator;
+      const EnvelopeGenerator& eg = op.m_envelopeGenerator;
+      const bool isRhythm = array == 0 && chip.m_ryt && offset >= 0x10;
+      lanes::OperatorState& dest = state.operators[array * 18 + i];
+
+      dest.incBase.v[lane] = pg.increment();
+      dest.vibDelta.v[lane] = pg.m_fNum >> 7;
+      dest.vib.v[lane] = mask( op.m_vib );
+      dest.am.v[lane] = mask( op.m_am );
+      dest.egt.v[lane] = mask( op.m_egt && !isRhythm );
+      dest.ws.v[lane] = chip.m_new ? op.m_ws : (op.m_ws & 0x03);
+      dest.arIncrement.v[lane] = eg.counterIncrement( eg.m_ar );
+      dest.drIncrement.v[lane] = eg.counterIncrement( eg.m_dr );
+      dest.rrIncrement.v[lane] = eg.counterIncrement( eg.m_rr );
+      dest.sl.v[lane] = eg.m_sl;
+      dest.base.v[lane] = (eg.m_tl << 2) + eg.m_kslAdd;
+
+      dest.stage.v[lane] = static_cast<int32_t>(eg.m_stage);
+      dest.env.v[lane] = eg.m_env;
+      dest.counter.v[lane] = eg.m_counter;
+      dest.phaseAccumulator.v[lane] = static_cast<int32_t>(pg.m_phase);
+      dest.phase.v[lane] = op.m_phase;
+      dest.total.v[lane] = eg.m_total;
+    }
+
+    const auto loadChannel = [lane](lanes::ChannelState& dest, const Channel& channel) {
+      dest.cnt.v[lane] = mask( channel.m_cnt );
+      dest.fb.v[lane] = channel.m_fb;
+      dest.ch.v[lane] = channel.m_ch;
+      dest.feedback0.v[lane] = channel.m_feedback[0];
+      dest.feedback1.v[lane] = channel.m_feedback[1];
+    };
+    for( int i = 0; i < 9; ++i )
+    {
+      loadChannel( state.channels2op[array][i], *chip.m_channels2op[array][i] );
+    }
+    for( int i = 0; i < 3; ++i )
+    {
+      loadChannel( state.channels4op[array][i], *chip.m_channels4op[array][i] );
+      state.fourOp[array][i].v[lane] = mask( chip.m_channels[array][i] == chip.m_channels4op[array][i] );
+      const int secondChannel = (array << 8) + i + 3;
+      state.secondCnt[array][i].v[lane] = mask( chip.readReg( secondChannel + Channel::CH4_FB3_CNT1_Offset ) & 0x01 );
+    }
+  }
+
+  state.isNew.v[lane] = mask( chip.m_new );
+  state.ryt.v[lane] = mask( chip.m_ryt );
+  state.dam.v[lane] = mask( chip.m_dam );
+  state.dvb.v[lane] = mask( chip.m_dvb );
+}
+
+void OplLanes::storeLane(size_t lane)
+{
+  Opl3& chip = *m_chips[lane];
+  const lanes::State& state = *m_state;
+  for( int array = 0; array < 2; ++array )
+  {
+    for( int i = 0; i < 18; ++i )
+    {
+      const int offset = (i / 6) * 8 + i % 6;
+      Operator& op = *chip.m_operators[array][offset];
+      PhaseGenerator& pg = op.m_phaseGenerator;
+      EnvelopeGenerator& eg = op.m_envelopeGenerator;
+      const lanes::OperatorState& src = state.operators[array * 18 + i];
+
+      eg.m_stage = static_cast<EnvelopeGenerator::Stage>(src.stage.v[lane]);
+      eg.m_env = src.env.v[lane];
+      eg.m_counter = src.counter.v[lane];
+      eg.m_total = src.total.v[lane];
+      pg.m_phase = static_cast<uint32_t>(src.phaseAccumulator.v[lane]);
+      op.m_phase = src.phase.v[lane];
+    }
+
+    const auto storeChannel = [lane](Channel& channel, const lanes::ChannelState& src) {
+      channel.m_feedback[0] = src.feedback0.v[lane];
+      channel.m_feedback[1] = src.feedback1.v[lane];
+    };
+    for( int i = 0; i < 9; ++i )
+    {
+      storeChannel( *chip.m_channels2op[array][i], state.channels2op[array][i] );
+    }
+    for( int i = 0; i < 3; ++i )
+    {
+      storeChannel( *chip.m_channels4op[array][i], state.channels4op[array][i] );
+    }
+  }
+}
+}
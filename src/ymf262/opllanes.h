@@ -0,0 +1,108 @@
+/*
+ * PPPlay - an old-fashioned module player
+ * Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PPP_OPL_OPLLANES_H
+#define PPP_OPL_OPLLANES_H
+
+#include "opl3.h"
+
+#include "stuff/utils.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace opl
+{
+namespace lanes
+{
+struct State;
+}
+
+/**
+ * @brief Renders several independent chips in lock-step
+ *
+ * @details
+ * Each lane is a complete Opl3 with its own registers, e.g. one song of a batch
+ * conversion. The operator and channel states of all lanes are kept in
+ * struct-of-arrays form, so that one sample of up to MaxLanes chips is computed
+ * by the same vector instructions; on x86 CPUs supporting AVX2, eight lanes are
+ * processed at once, including the waveform table gathers.
+ *
+ * The chip objects stay the reference: chip() brings the object of a lane up to
+ * date before it is accessed, and the lane is reloaded from the object before the
+ * next sample. The output of every lane is bit-identical to calling Opl3::read()
+ * on its chip.
+ */
+class OplLanes
+{
+public:
+  DISABLE_COPY( OplLanes )
+
+  static constexpr size_t MaxLanes = 16;
+
+  /**
+   * @param[in] lanes Number of chips, 1 to MaxLanes
+   */
+  explicit OplLanes(size_t lanes);
+
+  ~OplLanes();
+
+  size_t lanes() const noexcept
+  {
+    return m_chips.size();
+  }
+
+  /**
+   * @brief Access a chip, e.g. to write its registers or to serialize it
+   * @param[in] lane Lane index
+   * @note Accessing a chip is cheap, but it reloads the lane before the next sample.
+   */
+  Opl3& chip(size_t lane);
+
+  void writeReg(size_t lane, uint16_t index, uint8_t val)
+  {
+    chip( lane ).writeReg( index, val );
+  }
+
+  /**
+   * @brief Render one sample of every chip
+   * @param[out] dest Receives lanes() samples, may be @c nullptr
+   * @note The captures attached to the chips receive the samples like from Opl3::read().
+   */
+  void read(std::array<int16_t, 4>* dest);
+
+private:
+  std::vector<std::unique_ptr<Opl3>> m_chips;
+  std::unique_ptr<lanes::State> m_state;
+  //! @brief Lanes rendered since their chip was last updated
+  std::vector<bool> m_chipStale;
+  //! @brief Lanes whose chip may have been changed since they were loaded
+  std::vector<bool> m_laneStale;
+
+  //! @brief Copy the state of a chip into its lane
+  void loadLane(size_t lane);
+
+  //! @brief Copy the state of a lane back into its chip
+  void storeLane(size_t lane);
+};
+}
+
+#endif
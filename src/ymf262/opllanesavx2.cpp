@@ -0,0 +1,106 @@
+/*
+ * PPPlay - an old-fashioned module player
+ * Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * This unit is compiled with AVX2 enabled, so it must not include anything
+ * that could emit inline functions shared with the other units.
+ */
+
+#include "opllaneskernel.h"
+
+#include <cstring>
+#include <immintrin.h>
+
+namespace opl
+{
+namespace lanes
+{
+namespace
+{
+//! @brief Vector operations using AVX2, 8 lanes
+struct Avx2
+{
+  typedef int32_t Vec __attribute__((vector_size(32)));
+  typedef uint32_t UVec __attribute__((vector_size(32)));
+  static constexpr size_t Width = 8;
+
+  static Vec load(const int32_t* src)
+  {
+    Vec result;
+    std::memcpy( &result, src, sizeof(result) );
+    return result;
+  }
+
+  static void store(int32_t* dest, const Vec& x)
+  {
+    std::memcpy( dest, &x, sizeof(x) );
+  }
+
+  static Vec splat(int32_t value)
+  {
+    return Vec{ value, value, value, value, value, value, value, value };
+  }
+
+  static Vec eq(const Vec& a, const Vec& b)
+  {
+    return a == b;
+  }
+
+  static Vec gt(const Vec& a, const Vec& b)
+  {
+    return a > b;
+  }
+
+  static Vec select(const Vec& mask, const Vec& a, const Vec& b)
+  {
+    return (mask & a) | (~mask & b);
+  }
+
+  static Vec add(const Vec& a, const Vec& b)
+  {
+    return reinterpret_cast<Vec>(reinterpret_cast<UVec>(a) + reinterpret_cast<UVec>(b));
+  }
+
+  static Vec toInt16(const Vec& x)
+  {
+    return reinterpret_cast<Vec>(reinterpret_cast<UVec>(x) << 16) >> 16;
+  }
+
+  static Vec gatherLog(const uint16_t* table, const Vec& index)
+  {
+    // 32 bit loads of 16 bit entries, the table is padded for the last one
+    const __m256i values = _mm256_i32gather_epi32( reinterpret_cast<const int*>(table), reinterpret_cast<__m256i>(index), 2 );
+    return reinterpret_cast<Vec>(values) & splat( 0xffff );
+  }
+
+  static Vec gatherExp(const uint32_t* table, const Vec& index)
+  {
+    return reinterpret_cast<Vec>(_mm256_i32gather_epi32( reinterpret_cast<const int*>(table), reinterpret_cast<__m256i>(index), 4 ));
+  }
+};
+
+static_assert( MaxLanes % Avx2::Width == 0, "Lane count must be a multiple of the vector width" );
+}
+
+void renderAvx2(State* state, size_t count)
+{
+  Kernel<Avx2>::render( state, count );
+}
+}
+}
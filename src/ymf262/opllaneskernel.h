@@ -0,0 +1,333 @@
+/*
+ * PPPlay - an old-fashioned module player
+ * Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PPP_OPL_OPLLANESKERNEL_H
+#define PPP_OPL_OPLLANESKERNEL_H
+
+#include "opllanesstate.h"
+
+namespace opl
+{
+namespace lanes
+{
+/**
+ * @brief Renders one sample of all lanes, see Opl3::read()
+ * @tparam V Vector operations, providing the @c Vec type of @c V::Width lanes,
+ *           and @c load, @c store, @c splat, @c eq, @c gt, @c select, @c add (wrapping),
+ *           @c toInt16, @c gatherLog and @c gatherExp
+ *
+ * @details
+ * This is included by translation units compiled for different instruction sets,
+ * so @a V must be local to the including unit.
+ *
+ * The operators of a lane are advanced in a different order than by Opl3::read(),
+ * which is equivalent: the only state shared between operators is the high hat
+ * phase used by the snare drum and the top cymbal, and all phases are advanced
+ * before any channel is evaluated.
+ */
+template<typename V>
+struct Kernel
+{
+  typedef typename V::Vec Vec;
+
+  //! @brief Chip-wide values of a chunk of lanes
+  struct Chip
+  {
+    Vec isNew;
+    Vec ryt;
+    Vec amValue;
+    Vec vibShift;
+    Vec vibNegative;
+    Vec randBit;
+    Vec sums[4];
+  };
+
+  static Vec ld(const Values& values, size_t lane)
+  {
+    return V::load( values.v + lane );
+  }
+
+  static void st(Values& values, size_t lane, const Vec& x)
+  {
+    V::store( values.v + lane, x );
+  }
+
+  static Vec andNot(const Vec& mask, const Vec& x)
+  {
+    return ~mask & x;
+  }
+
+  static Vec ne(const Vec& a, const Vec& b)
+  {
+    return ~V::eq( a, b );
+  }
+
+  //! @see EnvelopeGenerator::advance(), PhaseGenerator::advance()
+  static void advanceOperator(OperatorState& op, size_t lane, const Vec& active, const Chip& chip)
+  {
+    const Vec stage = ld( op.stage, lane );
+    const Vec env = ld( op.env, lane );
+    const Vec attack = V::eq( stage, V::splat( 0 ) );
+    const Vec decay = V::eq( stage, V::splat( 1 ) );
+    const Vec sustain = V::eq( stage, V::splat( 2 ) );
+    const Vec release = V::eq( stage, V::splat( 3 ) );
+
+    const Vec envZero = V::eq( env, V::splat( 0 ) );
+    const Vec doAttack = andNot( envZero, attack );
+    const Vec toSustain = andNot( V::gt( ld( op.sl, lane ), env >> 4 ), decay );
+    const Vec doDecay = andNot( toSustain, decay );
+    const Vec toRelease = andNot( ld( op.egt, lane ), sustain );
+
+    // advanceCounter(); a rate of 0 has an increment of 0
+    const Vec counterIncrement = (doAttack & ld( op.arIncrement, lane ))
+                          | (doDecay & ld( op.drIncrement, lane ))
+                          | (release & ld( op.rrIncrement, lane ));
+    Vec counter = ld( op.counter, lane ) + counterIncrement;
+    const Vec overflow = counter >> 15;
+    counter = counter & V::splat( 0x7fff );
+
+    // attack() and attenuate()
+    Vec newEnv = V::select( doAttack & ne( overflow, V::splat( 0 ) ), env - (((env * overflow) >> 3) + V::splat( 1 )), env );
+    const Vec attenuated = env + overflow;
+    newEnv = V::select( doDecay | release,
+                        V::select( V::gt( attenuated, V::splat( 511 ) ), V::splat( 511 ), attenuated ),
+                        newEnv );
+
+    Vec newStage = V::select( attack & envZero, V::splat( 1 ), stage );
+    newStage = V::select( toSustain, V::splat( 2 ), newStage );
+    newStage = V::select( toRelease, V::splat( 3 ), newStage );
+
+    Vec total = newEnv + ld( op.base, lane ) + (ld( op.am, lane ) & chip.amValue);
+    total = V::select( V::gt( total, V::splat( 511 ) ), V::splat( 511 ), total );
+    total = V::select( V::gt( V::splat( 0 ), total ), V::splat( 0 ), total );
+
+    const Vec vibDelta = ld( op.vibDelta, lane ) >> chip.vibShift;
+    const Vec vibrato = V::select( chip.vibNegative, ~vibDelta, vibDelta );
+    const Vec phaseIncrement = ld( op.incBase, lane ) + (ld( op.vib, lane ) & vibrato);
+    const Vec phaseAccumulator = V::add( ld( op.phaseAccumulator, lane ), phaseIncrement );
+
+    st( op.stage, lane, V::select( active, newStage, stage ) );
+    st( op.env, lane, V::select( active, newEnv, env ) );
+    st( op.counter, lane, V::select( active, counter, ld( op.counter, lane ) ) );
+    st( op.total, lane, V::select( active, total, ld( op.total, lane ) ) );
+    st( op.phaseAccumulator, lane, V::select( active, phaseAccumulator, ld( op.phaseAccumulator, lane ) ) );
+    st( op.phase, lane, V::select( active, (phaseAccumulator >> 9) & V::splat( 0x3ff ), ld( op.phase, lane ) ) );
+  }
+
+  /**
+   * @brief Operator output, see Operator::getOutput() and sinExp()
+   * @param[in] modulatePhase Mask of the lanes adding @a modulator to the phase, the others add it to the output
+   */
+  static Vec output(const State& state, const OperatorState& op, size_t lane, const Vec& phase, const Vec& modulator,
+                    const Vec& modulatePhase)
+  {
+    const Vec total = ld( op.total, lane );
+    const Vec logIndex = (ld( op.ws, lane ) << 10) + ((phase + (modulator & modulatePhase)) & V::splat( 0x3ff ));
+    const Vec expVal = V::gatherLog( state.sinLog, logIndex ) + (total << 3);
+    const Vec isSigned = ne( expVal & V::splat( 0x8000 ), V::splat( 0 ) );
+    const Vec exponent = expVal & V::splat( 0x7fff );
+    Vec result = V::gatherExp( state.sinExp, exponent & V::splat( 0xff ) ) >> (exponent >> 8);
+    result = V::toInt16( result ^ isSigned );
+    result = andNot( V::eq( total, V::splat( 511 ) ), result );
+    return V::toInt16( result + andNot( modulatePhase, modulator ) );
+  }
+
+  static Vec output(const State& state, const OperatorState& op, size_t lane, const Vec& modulator)
+  {
+    return output( state, op, lane, ld( op.phase, lane ), modulator, V::splat( -1 ) );
+  }
+
+  //! @see Channel::feedback()
+  static Vec feedback(const ChannelState& channel, size_t lane)
+  {
+    const Vec fb = ld( channel.fb, lane );
+    const Vec sum = ld( channel.feedback0, lane ) + ld( channel.feedback1, lane );
+    const Vec shift = V::splat( 9 ) - fb;
+    // division rounding towards zero
+    const Vec quotient = (sum + ((sum >> 31) & ((V::splat( 1 ) << shift) - V::splat( 1 )))) >> shift;
+    return andNot( V::eq( fb, V::splat( 0 ) ), quotient );
+  }
+
+  //! @see Channel::pushFeedback()
+  static void pushFeedback(ChannelState& channel, size_t lane, const Vec& value, const Vec& mask)
+  {
+    const Vec feedback1 = ld( channel.feedback1, lane );
+    st( channel.feedback0, lane, V::select( mask, feedback1, ld( channel.feedback0, lane ) ) );
+    st( channel.feedback1, lane, V::select( mask, value, feedback1 ) );
+  }
+
+  //! @see Channel::getInFourChannels()
+  static void accumulate(Chip& chip, const Vec& mask, const Vec& ch, const Vec& value)
+  {
+    for( int i = 0; i < 4; i++ )
+    {
+      const Vec muted = chip.isNew & V::eq( ch & V::splat( 1 << i ), V::splat( 0 ) );
+      chip.sums[i] = chip.sums[i] + (mask & andNot( muted, value ));
+    }
+  }
+
+  //! @brief Channels 1 to 6 of an array, which may be combined to 4-op channels
+  static void channelGroup(State& state, Chip& chip, size_t lane, int array, int group, const Vec& active)
+  {
+    OperatorState* ops = state.operators + array * 18;
+    ChannelState& first = state.channels2op[array][group];
+    ChannelState& second = state.channels2op[array][group + 3];
+    ChannelState& fourOp = state.channels4op[array][group];
+    const Vec isFourOp = ld( state.fourOp[array][group], lane );
+    const Vec secondCnt = ld( state.secondCnt[array][group], lane );
+    const Vec cnt = V::select( isFourOp, ld( fourOp.cnt, lane ), ld( first.cnt, lane ) );
+    const Vec secondChannelCnt = ld( second.cnt, lane );
+
+    const Vec out0 = output( state, ops[group], lane,
+                             V::select( isFourOp, feedback( fourOp, lane ), feedback( first, lane ) ) );
+    pushFeedback( fourOp, lane, out0, active & isFourOp );
+    pushFeedback( first, lane, out0, andNot( isFourOp, active ) );
+
+    const Vec out1 = output( state, ops[group + 3], lane, andNot( cnt, out0 ) );
+
+    const Vec modulator2 = V::select( isFourOp,
+                                      V::select( cnt, out1, andNot( secondCnt, out1 ) ),
+                                      feedback( second, lane ) );
+    const Vec out2 = output( state, ops[group + 6], lane, modulator2 );
+    pushFeedback( second, lane, out2, andNot( isFourOp, active ) );
+
+    const Vec modulator3 = V::select( isFourOp,
+                                      V::select( cnt, andNot( secondCnt, out2 ), out2 ),
+                                      andNot( secondChannelCnt, out2 ) );
+    const Vec out3 = output( state, ops[group + 9], lane, modulator3 );
+
+    const Vec firstOutput = V::toInt16( V::select( cnt, out0 + out1, out1 ) );
+    const Vec secondOutput = V::toInt16( V::select( secondChannelCnt, out2 + out3, out3 ) );
+    const Vec fourOpOutput = V::toInt16( V::select( cnt,
+                                                    out0 + out3 + (secondCnt & out2),
+                                                    V::select( secondCnt, out1 + out3, out3 ) ) );
+    accumulate( chip, active & isFourOp, ld( fourOp.ch, lane ), fourOpOutput );
+    accumulate( chip, andNot( isFourOp, active ), ld( first.ch, lane ), firstOutput );
+    accumulate( chip, andNot( isFourOp, active ), ld( second.ch, lane ), secondOutput );
+  }
+
+  //! @brief Channels 7 to 9 of an array, which may be rhythm channels
+  static void rhythmGroup(State& state, Chip& chip, size_t lane, int array, const Vec& active)
+  {
+    OperatorState* ops = state.operators + array * 18;
+    const Vec rhythm = array == 0 ? chip.ryt : V::splat( 0 );
+    const Vec all = V::splat( -1 );
+
+    // the noise based rhythm operators, see Operator::nextSample()
+    const Vec hh = ld( ops[13].phase, lane );
+    const Vec phaseBit = V::select( ne( ((hh & V::splat( 0x88 )) ^ ((hh << 5) & V::splat( 0x80 ))) | ((hh ^ (hh << 2)) & V::splat( 0x20 )),
+                                        V::splat( 0 ) ),
+                                    V::splat( 2 ), V::splat( 0 ) );
+    const Vec highHatPhase = (phaseBit << 8) | (V::splat( 0x34 ) << (phaseBit ^ (chip.randBit << 1)));
+    const Vec snareDrumPhase = V::select( ne( hh & V::splat( 0x100 ), V::splat( 0 ) ), V::splat( 0x200 ), V::splat( 0x100 ) )
+                               ^ (chip.randBit << 8);
+    const Vec topCymbalPhase = (phaseBit + V::splat( 1 )) << 8;
+
+    for( int i = 0; i < 3; i++ )
+    {
+      ChannelState& channel = state.channels2op[array][6 + i];
+      const OperatorState& op0 = ops[12 + i];
+      const OperatorState& op1 = ops[15 + i];
+      const Vec cnt = ld( channel.cnt, lane );
+
+      Vec phase0 = ld( op0.phase, lane );
+      Vec modulatePhase0 = all;
+      Vec phase1 = ld( op1.phase, lane );
+      Vec modulatePhase1 = all;
+      if( i == 1 )
+      {
+        phase0 = V::select( rhythm, highHatPhase, phase0 );
+        modulatePhase0 = ~rhythm;
+        phase1 = V::select( rhythm, snareDrumPhase, phase1 );
+        modulatePhase1 = ~rhythm;
+      }
+      else if( i == 2 )
+      {
+        phase1 = V::select( rhythm, topCymbalPhase, phase1 );
+        modulatePhase1 = ~rhythm;
+      }
+
+      const Vec out0 = output( state, op0, lane, phase0, feedback( channel, lane ), modulatePhase0 );
+      pushFeedback( channel, lane, out0, active );
+      const Vec out1 = output( state, op1, lane, phase1, andNot( cnt, out0 ), modulatePhase1 );
+
+      // the first bass drum operator is ignored when in parallel
+      const Vec parallel = (i == 0 ? andNot( rhythm, out0 ) : out0) + out1;
+      Vec channelOutput = V::toInt16( V::select( cnt, parallel, out1 ) );
+      channelOutput = V::select( rhythm, V::toInt16( channelOutput + channelOutput ), channelOutput );
+      accumulate( chip, active, ld( channel.ch, lane ), channelOutput );
+    }
+  }
+
+  static void renderChunk(State& state, size_t lane)
+  {
+    Chip chip;
+    chip.isNew = ld( state.isNew, lane );
+    chip.ryt = ld( state.ryt, lane );
+    chip.randBit = ld( state.randBit, lane );
+
+    // EnvelopeGenerator::advance()
+    Vec amValue = ld( state.tremoloIndex, lane ) >> 8;
+    amValue = V::select( V::gt( amValue, V::splat( 26 ) ), V::splat( 2 * 26 ) + ~amValue, amValue );
+    chip.amValue = V::select( ld( state.dam, lane ), amValue, amValue >> 2 );
+
+    // PhaseGenerator::advance()
+    const Vec vib = ld( state.vibratoIndex, lane ) >> 10;
+    chip.vibShift = (V::eq( vib & V::splat( 3 ), V::splat( 3 ) ) & V::splat( 1 ))
+                    + andNot( ld( state.dvb, lane ), V::splat( 1 ) );
+    chip.vibNegative = ne( vib & V::splat( 4 ), V::splat( 0 ) );
+
+    for( Vec& sum: chip.sums )
+    {
+      sum = V::splat( 0 );
+    }
+
+    // If !m_new, use OPL2 mode with 9 channels, else use OPL3 18 channels.
+    for( int array = 0; array < 2; array++ )
+    {
+      const Vec active = array == 0 ? V::splat( -1 ) : chip.isNew;
+      for( int i = 0; i < 18; i++ )
+      {
+        advanceOperator( state.operators[array * 18 + i], lane, active, chip );
+      }
+      for( int group = 0; group < 3; group++ )
+      {
+        channelGroup( state, chip, lane, array, group, active );
+      }
+      rhythmGroup( state, chip, lane, array, active );
+    }
+
+    for( int i = 0; i < 4; i++ )
+    {
+      st( state.output[i], lane, chip.sums[i] );
+    }
+  }
+
+  static void render(State* state, size_t count)
+  {
+    for( size_t lane = 0; lane < count; lane += V::Width )
+    {
+      renderChunk( *state, lane );
+    }
+  }
+};
+}
+}
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ * PPPlay - an old-fashioned module player
+ * Copyright (C) 2016  Steffen Ohrendorf <steffen.ohrendorf@gmx.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PPP_OPL_OPLLANESSTATE_H
+#define PPP_OPL_OPLLANESSTATE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace opl
+{
+namespace lanes
+{
+constexpr size_t MaxLanes = 16;
+
+//! @brief One value per lane; flags are stored as masks, i.e. -1 or 0
+struct Values
+{
+  int32_t v[MaxLanes];
+};
+
+/**
+ * @brief Operator state of all lanes
+ * @see Operator, EnvelopeGenerator, PhaseGenerator
+ */
+struct OperatorState
+{
+  //! @brief PhaseGenerator::increment()
+  Values incBase;
+  //! @brief Vibrato depth, F-Number >> 7
+  Values vibDelta;
+  Values vib;
+  Values am;
+  //! @brief Envelope generator type, cleared for the rhythm operators in rhythm mode
+  Values egt;
+  //! @brief Waveform selector, limited to the first four waveforms in OPL2 mode
+  Values ws;
+  //! @brief EnvelopeGenerator::counterIncrement() of the attack, decay and release rates
+  Values arIncrement;
+  Values drIncrement;
+  Values rrIncrement;
+  Values sl;
+  //! @brief Total level and key scale level
+  Values base;
+
+  Values stage;
+  Values env;
+  Values counter;
+  //! @brief PhaseGenerator phase
+  Values phaseAccumulator;
+  //! @brief Operator phase, 10 bits
+  Values phase;
+  Values total;
+};
+
+/**
+ * @brief Channel state of all lanes
+ * @see Channel
+ */
+struct ChannelState
+{
+  Values cnt;
+  Values fb;
+  //! @brief Output channel bits
+  Values ch;
+  Values feedback0;
+  Values feedback1;
+};
+
+/**
+ * @brief State of all lanes, in struct-of-arrays form
+ *
+ * @details
+ * The operators are stored by array, with the 18 operators of an array at
+ * offsets 0x00..0x05, 0x08..0x0d and 0x10..0x15 stored consecutively.
+ */
+struct State
+{
+  OperatorState operators[36];
+  ChannelState channels2op[2][9];
+  ChannelState channels4op[2][3];
+  //! @brief Whether the 4-op channel is mapped instead of the two 2-op channels
+  Values fourOp[2][3];
+  //! @brief Connection bit of the second half of a 4-op channel
+  Values secondCnt[2][3];
+
+  Values isNew;
+  Values ryt;
+  Values dam;
+  Values dvb;
+  //! @brief Chip-wide generators, updated before every sample
+  Values vibratoIndex;
+  Values tremoloIndex;
+  Values randBit;
+
+  //! @brief Sum of the channel outputs of the last sample
+  Values output[4];
+
+  //! @brief The waveform tables, see Operator::tables()
+  const uint16_t* sinLog;
+  const uint32_t* sinExp;
+};
+
+//! @brief Render one sample of the first @a count lanes
+void render(State* state, size_t count);
+
+#ifdef PPP_OPL_LANES_AVX2
+//! @brief render() for CPUs supporting AVX2
+void renderAvx2(State* state, size_t count);
+#endif
+}
+}
+
+#endif
@@ -24,6 +24,7 @@
 
 #include "phasegenerator.h"
 #include "opl3.h"
+#include <stream/abstractarchive.h>
 
 namespace opl
 {
@@ -34,7 +35,7 @@ void PhaseGenerator::setFrequency(uint16_t f_number, uint8_t block, uint8_t mult
   m_mult = mult & 0x0f;
 }
 
-uint16_t PhaseGenerator::advance(bool vib)
+uint32_t PhaseGenerator::increment() const
 {
   /*
    * According to the YMF262 manual:
@@ -52,7 +53,12 @@ uint16_t PhaseGenerator::advance(bool vib)
   inc >>= 1;
 
   static constexpr int multTable[16] = { 1, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 20, 24, 24, 30, 30 };
-  inc = (inc * multTable[m_mult]) >> 1;
+  return (inc * multTable[m_mult]) >> 1;
+}
+
+uint16_t PhaseGenerator::advance(bool vib)
+{
+  uint32_t inc = increment();
 
   if( vib )
   {
@@ -81,4 +87,9 @@ uint16_t PhaseGenerator::advance(bool vib)
 
   return (m_phase >> 9) & 0x3ff;
 }
-}
\ No newline at end of file
+
+AbstractArchive& PhaseGenerator::serialize(AbstractArchive* archive)
+{
+  return *archive % m_phase % m_fNum % m_block % m_mult;
+}
+}
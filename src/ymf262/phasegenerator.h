@@ -28,16 +28,22 @@
 #include <boost/assert.hpp>
 #include <cstdint>
 
+class AbstractArchive;
+
 namespace opl
 {
 class Opl3;
 
+class OplLanes;
+
 /**
  * @class PhaseGenerator
  * @brief OPL 3 Phase generator
  */
 class PhaseGenerator
 {
+  friend class OplLanes;
+
   //! @brief Owning chip
   Opl3* m_opl;
   /**
@@ -72,6 +78,11 @@ public:
    */
   void setFrequency(uint16_t f_number, uint8_t block, uint8_t mult);
 
+  /**
+   * @brief Phase increment without vibrato
+   */
+  uint32_t increment() const;
+
   /**
    * @brief Advance phase
    * @param[in] vib Use vibrato
@@ -83,6 +94,11 @@ public:
   {
     m_phase = 0;
   }
+
+  /**
+   * @brief Archive the state, but not the owning chip
+   */
+  AbstractArchive& serialize(AbstractArchive* archive);
 };
 }
 
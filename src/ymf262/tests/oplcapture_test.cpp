@@ -0,0 +1,164 @@
+#define BOOST_TEST_MODULE OplCapture
+
+#include <boost/test/unit_test.hpp>
+
+#include "../oplcapture.h"
+#include "oplscript.h"
+
+#include <stream/abstractarchive.h>
+#include <stream/memorystream.h>
+
+using namespace opl;
+
+namespace
+{
+constexpr uint32_t SnapshotInterval = 4096;
+constexpr size_t Length = 3 * Opl3::SampleRate;
+
+struct Recording
+{
+  OplCapture capture{ SnapshotInterval };
+  Frames frames{};
+
+  Recording()
+  {
+    Opl3 chip;
+    chip.setCapture( &capture );
+    Script script;
+    script.setup( chip );
+    frames = script.render( chip, Length );
+    chip.setCapture( nullptr );
+  }
+};
+
+const Recording& recording()
+{
+  static const Recording instance;
+  return instance;
+}
+
+void checkFrames(const Frames& actual, const Frames& expected, size_t offset = 0)
+{
+  BOOST_REQUIRE_LE( offset + actual.size(), expected.size() );
+  for( size_t i = 0; i < actual.size(); ++i )
+  {
+    if( actual[i] != expected[offset + i] )
+    {
+      BOOST_FAIL( "Sample " << offset + i << " differs" );
+    }
+  }
+}
+
+Frames replay(OplReplayer& replayer, size_t count)
+{
+  Frames frames( count );
+  frames.resize( replayer.render( frames.data(), count ) );
+  return frames;
+}
+}
+
+BOOST_AUTO_TEST_CASE( ScriptIsAudible )
+{
+  const auto& frames = recording().frames;
+  BOOST_CHECK( std::any_of( frames.begin(), frames.end(), [](const Frame& frame) {
+    return frame[0] != 0 && frame[1] != 0;
+  } ) );
+  BOOST_CHECK_EQUAL( recording().capture.length(), Length );
+  BOOST_CHECK_GT( recording().capture.writes().size(), Length / 97 * 3 );
+}
+
+BOOST_AUTO_TEST_CASE( ReplayIsBitIdentical )
+{
+  OplReplayer replayer( recording().capture );
+  const Frames frames = replay( replayer, Length + 100 );
+  BOOST_CHECK_EQUAL( frames.size(), Length );
+  checkFrames( frames, recording().frames );
+}
+
+BOOST_AUTO_TEST_CASE( SeekMatchesLinearRender )
+{
+  const auto& capture = recording().capture;
+  BOOST_REQUIRE( capture.snapshotAt( 0 ) != nullptr );
+  BOOST_CHECK_EQUAL( capture.snapshotAt( SnapshotInterval - 1 )->time, 0 );
+  BOOST_CHECK_EQUAL( capture.snapshotAt( SnapshotInterval )->time, SnapshotInterval );
+
+  OplReplayer replayer( capture );
+  // forward and backward, on, before and after snapshots, and close to the current position
+  for( uint64_t time: { uint64_t( 12345 ), uint64_t( SnapshotInterval * 7 ), uint64_t( SnapshotInterval * 7 - 1 ),
+                        uint64_t( 1 ), uint64_t( 100000 ), uint64_t( 100100 ), uint64_t( Length - 50 ) } )
+  {
+    BOOST_TEST_CONTEXT( "seek to " << time )
+    {
+      replayer.seek( time );
+      BOOST_REQUIRE_EQUAL( replayer.position(), time );
+      const Frames frames = replay( replayer, 1000 );
+      BOOST_CHECK_EQUAL( frames.size(), std::min<size_t>( 1000, Length - time ) );
+      checkFrames( frames, recording().frames, time );
+    }
+  }
+
+  replayer.seek( Length + 10 );
+  BOOST_CHECK_EQUAL( replayer.position(), Length );
+  BOOST_CHECK( replay( replayer, 10 ).empty() );
+}
+
+BOOST_AUTO_TEST_CASE( SaveLoadRoundTrip )
+{
+  MemoryStream stream;
+  recording().capture.save( stream );
+  stream.seek( 0 );
+  const auto loaded = OplCapture::load( stream );
+  BOOST_REQUIRE( loaded != nullptr );
+  BOOST_CHECK_EQUAL( loaded->length(), Length );
+  BOOST_CHECK_EQUAL( loaded->snapshotInterval(), SnapshotInterval );
+  BOOST_CHECK( loaded->writes() == recording().capture.writes() );
+
+  OplReplayer replayer( *loaded );
+  replayer.seek( Length / 2 );
+  checkFrames( replay( replayer, Length - Length / 2 ), recording().frames, Length / 2 );
+}
+
+BOOST_AUTO_TEST_CASE( LoadRejectsTruncatedCaptures )
+{
+  MemoryStream full;
+  recording().capture.save( full );
+  std::vector<uint8_t> data( static_cast<size_t>(full.size()) );
+  full.seek( 0 );
+  full.read( data.data(), data.size() );
+
+  for( size_t size: { size_t( 0 ), size_t( 7 ), size_t( 30 ), data.size() / 2, data.size() - 1 } )
+  {
+    MemoryStream stream;
+    stream.write( data.data(), size );
+    stream.seek( 0 );
+    BOOST_CHECK_THROW( OplCapture::load( stream ), std::runtime_error );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( SerializeRoundTrip )
+{
+  // the original chip, and one continuing from its serialized state with the same writes
+  Opl3 original;
+  Script script;
+  script.setup( original );
+  script.render( original, 20000 );
+
+  auto stream = std::make_shared<MemoryStream>();
+  AbstractArchive archive( stream );
+  original.serialize( &archive );
+  archive.finishSave();
+  Opl3 restored;
+  // a different channel mapping must be replaced by the one of the loaded registers
+  restored.writeReg( 0x105, 0x01 );
+  restored.writeReg( 0x104, 0x00 );
+  restored.serialize( &archive );
+
+  for( uint16_t reg = 0; reg < 0x200; ++reg )
+  {
+    BOOST_REQUIRE_EQUAL( restored.readReg( reg ), original.readReg( reg ) );
+  }
+
+  Script continuation = script;
+  const Frames expected = script.render( original, 20000 );
+  checkFrames( continuation.render( restored, 20000 ), expected );
+}
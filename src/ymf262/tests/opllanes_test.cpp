@@ -0,0 +1,212 @@
+#define BOOST_TEST_MODULE OplLanes
+
+#include <boost/test/unit_test.hpp>
+
+#include "../opllanes.h"
+#include "oplscript.h"
+
+#include <stream/abstractarchive.h>
+#include <stream/memorystream.h>
+
+#include <algorithm>
+
+using namespace opl;
+
+namespace
+{
+const Script::Setup Setups[] = {
+  // OPL3 with all 4-op connections
+  { true, 0x3f, 0x00 },
+  // OPL3 with 2-op channels only
+  { true, 0x00, 0x00 },
+  // OPL2 in rhythm mode
+  { false, 0x00, 0x20 },
+  // OPL3, some 4-op connections, rhythm mode and deep LFOs
+  { true, 0x15, 0xe0 }
+};
+
+//! @brief Register writes to a lane, for Script
+struct LaneChip
+{
+  OplLanes& lanes;
+  size_t lane;
+
+  void writeReg(uint16_t index, uint8_t value)
+  {
+    lanes.writeReg( lane, index, value );
+  }
+};
+
+Script scriptFor(size_t lane)
+{
+  return Script( static_cast<unsigned int>(lane + 1), Setups[lane % 4] );
+}
+
+uint64_t hashFrames(const Frames& frames)
+{
+  // FNV-1a over the little endian samples
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for( const Frame& frame: frames )
+  {
+    for( int16_t sample: frame )
+    {
+      for( int shift: { 0, 8 } )
+      {
+        hash ^= (static_cast<uint16_t>(sample) >> shift) & 0xff;
+        hash *= 0x100000001b3ull;
+      }
+    }
+  }
+  return hash;
+}
+
+std::vector<uint8_t> serialized(Opl3& chip)
+{
+  auto stream = std::make_shared<MemoryStream>();
+  AbstractArchive archive( stream );
+  chip.serialize( &archive );
+  archive.finishSave();
+  stream->seek( 0 );
+  return stream->readVector<uint8_t>( static_cast<size_t>(stream->size()) );
+}
+
+void checkLanes(size_t count, size_t length)
+{
+  OplLanes lanes( count );
+  std::vector<Opl3> chips( count );
+  std::vector<Script> laneScripts;
+  std::vector<Script> chipScripts;
+  for( size_t lane = 0; lane < count; ++lane )
+  {
+    laneScripts.emplace_back( scriptFor( lane ) );
+    chipScripts.emplace_back( scriptFor( lane ) );
+    LaneChip laneChip{ lanes, lane };
+    laneScripts[lane].setup( laneChip );
+    chipScripts[lane].setup( chips[lane] );
+  }
+
+  std::vector<Frame> frames( count );
+  for( size_t i = 0; i < length; ++i )
+  {
+    for( size_t lane = 0; lane < count; ++lane )
+    {
+      LaneChip laneChip{ lanes, lane };
+      laneScripts[lane].tick( laneChip );
+    }
+    lanes.read( frames.data() );
+    for( size_t lane = 0; lane < count; ++lane )
+    {
+      const Frame expected = chipScripts[lane].render( chips[lane], 1 ).front();
+      if( frames[lane] != expected )
+      {
+        BOOST_FAIL( "Lane " << lane << " of " << count << " differs at sample " << i );
+      }
+    }
+  }
+}
+}
+
+BOOST_AUTO_TEST_CASE( MatchesReferenceEngine )
+{
+  // Hashes of one second per setup, rendered by the engine before the waveform
+  // table and the vectorized output filter were introduced.
+  static const uint64_t Expected[] = {
+    0x2e5d3e3b5f5a9f47ull,
+    0xd479f6fbc6540da4ull,
+    0x52a4c6395c6193d5ull,
+    0x2ea250b39ce9c084ull
+  };
+  for( size_t i = 0; i < 4; ++i )
+  {
+    BOOST_TEST_CONTEXT( "setup " << i )
+    {
+      Opl3 chip;
+      Script script = scriptFor( i );
+      script.setup( chip );
+      const Frames frames = script.render( chip, Opl3::SampleRate );
+      BOOST_CHECK( std::any_of( frames.begin(), frames.end(), [](const Frame& frame) {
+        return frame[0] != 0;
+      } ) );
+      BOOST_CHECK_EQUAL( hashFrames( frames ), Expected[i] );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( ChipAccess )
+{
+  // the chips of the lanes are kept up to date for serialization, and rendering
+  // continues from the state they are left in
+  const size_t count = 5;
+  OplLanes lanes( count );
+  std::vector<Opl3> chips( count );
+  std::vector<Script> laneScripts;
+  std::vector<Script> chipScripts;
+  for( size_t lane = 0; lane < count; ++lane )
+  {
+    laneScripts.emplace_back( scriptFor( lane ) );
+    chipScripts.emplace_back( scriptFor( lane ) );
+    LaneChip laneChip{ lanes, lane };
+    laneScripts[lane].setup( laneChip );
+    chipScripts[lane].setup( chips[lane] );
+  }
+
+  for( int round = 0; round < 4; ++round )
+  {
+    for( size_t i = 0; i < 5000; ++i )
+    {
+      for( size_t lane = 0; lane < count; ++lane )
+      {
+        LaneChip laneChip{ lanes, lane };
+        laneScripts[lane].tick( laneChip );
+        chipScripts[lane].tick( chips[lane] );
+        chips[lane].read( nullptr );
+      }
+      lanes.read( nullptr );
+    }
+    for( size_t lane = 0; lane < count; ++lane )
+    {
+      BOOST_TEST_CONTEXT( "round " << round << ", lane " << lane )
+      {
+        BOOST_CHECK( serialized( lanes.chip( lane ) ) == serialized( chips[lane] ) );
+      }
+    }
+    // detune one lane behind the back of the scripts
+    lanes.chip( round ).writeReg( 0xa0, 0x99 );
+    chips[round].writeReg( 0xa0, 0x99 );
+  }
+
+  std::vector<Frame> frames( count );
+  for( size_t i = 0; i < 2000; ++i )
+  {
+    lanes.read( frames.data() );
+    for( size_t lane = 0; lane < count; ++lane )
+    {
+      Frame expected;
+      chips[lane].read( &expected );
+      if( frames[lane] != expected )
+      {
+        BOOST_FAIL( "Lane " << lane << " differs at sample " << i );
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( FourLanes )
+{
+  checkLanes( 4, 40000 );
+}
+
+BOOST_AUTO_TEST_CASE( EightLanes )
+{
+  checkLanes( 8, 20000 );
+}
+
+BOOST_AUTO_TEST_CASE( SixteenLanes )
+{
+  checkLanes( 16, 20000 );
+}
+
+BOOST_AUTO_TEST_CASE( OddLaneCount )
+{
+  checkLanes( 3, 20000 );
+}
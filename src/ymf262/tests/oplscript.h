@@ -0,0 +1,130 @@
+#ifndef PPP_OPL_OPLSCRIPT_H
+#define PPP_OPL_OPLSCRIPT_H
+
+#include "../opl3.h"
+
+#include <random>
+#include <vector>
+
+typedef std::array<int16_t, 4> Frame;
+typedef std::vector<Frame> Frames;
+
+/**
+ * @brief Plays a register script on a chip
+ *
+ * @details
+ * Sets up the chip as given by Setup, keys on all 18 channels, and then
+ * changes random registers every few samples. The script only depends on the
+ * seed and the setup, so it can be continued on another chip.
+ *
+ * The register writes go to any @c Chip with a @c writeReg(index,value) method.
+ */
+class Script
+{
+public:
+  struct Setup
+  {
+    //! @brief OPL3 mode, OPL2 mode otherwise
+    bool opl3 = true;
+    //! @brief 4-operator connections, register 0x104
+    uint8_t connections = 0x3f;
+    //! @brief Rhythm and LFO depth, register 0xbd
+    uint8_t rhythm = 0x00;
+  };
+
+  Script(unsigned int seed, const Setup& setup)
+    : m_rng( seed ), m_setup( setup )
+  {
+  }
+
+  explicit Script(unsigned int seed = 1)
+    : Script( seed, Setup() )
+  {
+  }
+
+  template<typename Chip>
+  void setup(Chip& chip)
+  {
+    chip.writeReg( 0x105, m_setup.opl3 ? 0x01 : 0x00 );
+    chip.writeReg( 0x104, m_setup.connections );
+    chip.writeReg( 0xbd, m_setup.rhythm );
+    for( uint16_t bank = 0; bank < 0x200; bank += 0x100 )
+    {
+      for( uint16_t channel = 0; channel < 9; ++channel )
+      {
+        const uint16_t op = bank + (channel / 3) * 8 + channel % 3;
+        for( uint16_t slot: { op, uint16_t( op + 3 ) } )
+        {
+          chip.writeReg( 0x20 + slot, 0x21 );
+          chip.writeReg( 0x40 + slot, 0x10 );
+          chip.writeReg( 0x60 + slot, 0xf4 );
+          chip.writeReg( 0x80 + slot, 0x46 );
+          chip.writeReg( 0xe0 + slot, channel % 8 );
+        }
+        chip.writeReg( bank + 0xa0 + channel, static_cast<uint8_t>(0x40 + channel * 16) );
+        chip.writeReg( bank + 0xc0 + channel, static_cast<uint8_t>(0x30 | (channel % 4) << 1 | (channel & 1)) );
+        chip.writeReg( bank + 0xb0 + channel, 0x31 );
+      }
+    }
+  }
+
+  //! @brief Advance the script by one sample, writing a random register every 97 samples
+  template<typename Chip>
+  void tick(Chip& chip)
+  {
+    if( m_time++ % 97 == 0 )
+    {
+      writeRandom( chip );
+    }
+  }
+
+  Frames render(opl::Opl3& chip, size_t count)
+  {
+    Frames frames( count );
+    for( Frame& frame: frames )
+    {
+      tick( chip );
+      chip.read( &frame );
+    }
+    return frames;
+  }
+
+private:
+  std::mt19937 m_rng;
+  Setup m_setup;
+  uint64_t m_time = 0;
+
+  template<typename Chip>
+  void writeRandom(Chip& chip)
+  {
+    static const uint8_t Registers[] = { 0x20, 0x40, 0x60, 0x80, 0xa0, 0xb0, 0xbd, 0xc0, 0xe0 };
+    const uint16_t bank = std::uniform_int_distribution<uint16_t>( 0, 1 )( m_rng ) << 8;
+    const uint8_t base = Registers[std::uniform_int_distribution<size_t>( 0, sizeof( Registers ) - 1 )( m_rng )];
+    uint8_t value = static_cast<uint8_t>(std::uniform_int_distribution<int>( 0, 255 )( m_rng ));
+    uint16_t reg;
+    if( base == 0xbd )
+    {
+      reg = 0xbd;
+    }
+    else if( base >= 0xa0 && base <= 0xc0 )
+    {
+      reg = bank + base + std::uniform_int_distribution<uint16_t>( 0, 8 )( m_rng );
+      if( base == 0xc0 )
+      {
+        // keep the channel audible
+        value |= 0x30;
+      }
+    }
+    else
+    {
+      reg = bank + base + std::uniform_int_distribution<uint16_t>( 0, 0x15 )( m_rng );
+      if( base == 0x40 )
+      {
+        value &= 0x3f;
+      }
+    }
+    chip.writeReg( reg, value );
+  }
+};
+
+#endif